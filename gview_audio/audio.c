@@ -291,6 +291,7 @@ void audio_fill_buffer(audio_context_t *audio_ctx, int64_t ts) {
   audio_unlock_mutex(audio_ctx);
 
   if (flag == AUDIO_BUFF_USED) {
+    __atomic_fetch_add(&audio_ctx->dropped_buffers, 1, __ATOMIC_RELAXED);
     fprintf(stderr, "AUDIO: write buffer(%i) is still in use - dropping data\n",
             buffer_write_index);
     return;
@@ -633,6 +634,24 @@ double audio_get_latency(audio_context_t *audio_ctx) {
   return audio_ctx->latency;
 }
 
+/*
+ * get the number of buffers dropped with the audio ring buffer full
+ *   (can be polled from any thread)
+ * args:
+ *   audio_ctx - pointer to audio context data
+ *
+ * asserts:
+ *   audio_ctx is not null
+ *
+ * returns: dropped buffers count
+ */
+uint64_t audio_get_dropped_buffers(audio_context_t *audio_ctx) {
+  /*assertions*/
+  assert(audio_ctx != NULL);
+
+  return __atomic_load_n(&audio_ctx->dropped_buffers, __ATOMIC_RELAXED);
+}
+
 /*
  * set the number of channels
  * args:
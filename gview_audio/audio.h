@@ -54,6 +54,8 @@ struct _audio_context_t {
 
   int stream_flag; /*stream flag*/
 
+  uint64_t dropped_buffers; /*buffers dropped (audio ring buffer full)*/
+
   pthread_mutex_t mutex; /*audio mutex*/
 };
 
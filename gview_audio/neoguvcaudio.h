@@ -205,6 +205,19 @@ void audio_set_latency(audio_context_t *audio_ctx, double latency);
  */
 double audio_get_latency(audio_context_t *audio_ctx);
 
+/*
+ * get the number of buffers dropped with the audio ring buffer full
+ *   (can be polled from any thread)
+ * args:
+ *   audio_ctx - pointer to audio context data
+ *
+ * asserts:
+ *   audio_ctx is not null
+ *
+ * returns: dropped buffers count
+ */
+uint64_t audio_get_dropped_buffers(audio_context_t *audio_ctx);
+
 /*
  * set the number of channels
  * args:
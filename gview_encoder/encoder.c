@@ -45,7 +45,11 @@
 #include <locale.h>
 
 // #include "../config.h"
+#include "core_time.h"
 #include "encoder.h"
+#include "file_io.h"
+#include "h264_nal.h"
+#include "latency_hist.h"
 #include "packet.h"
 #include "neoguvc.h"
 #include "neoguvcencoder.h"
@@ -74,9 +78,13 @@ static int video_ring_buffer_size = 0;
 static video_buffer_t *video_ring_buffer = NULL;
 static int video_read_index = 0;
 static int video_write_index = 0;
-static int video_scheduler = 0;
 
 static SPacket_list_t* spkt_list = NULL;
+
+/*video encoding stats*/
+static latency_hist_t video_stage_hist[ENCODER_STAGE_COUNT];
+static uint64_t video_frames = 0;
+static uint64_t video_ring_full = 0;
 /*
  * set verbosity
  * args:
@@ -99,7 +107,7 @@ void encoder_set_verbosity(int value) {
  *   video_height - video frame height (in pixels)
  *   fps_den - frames per sec (denominator)
  *   fps_num - frames per sec (numerator)
- *   codec_ind - video codec index (-raw)
+ *   yu12_input - frames are yu12 (software codecs and raw sinks)
  *
  * asserts:
  *   none
@@ -108,7 +116,7 @@ void encoder_set_verbosity(int value) {
  */
 static void encoder_alloc_video_ring_buffer(int video_width, int video_height,
                                             int fps_den, int fps_num,
-                                            int codec_ind) {
+                                            int yu12_input) {
   video_ring_buffer_size = (fps_den * 3) / (fps_num * 2); /* 1.5 sec */
   if (video_ring_buffer_size < 20)
     video_ring_buffer_size = 20; /*at least 20 frames buffer*/
@@ -121,7 +129,7 @@ static void encoder_alloc_video_ring_buffer(int video_width, int video_height,
     exit(-1);
   }
 
-  if (codec_ind > 0)
+  if (yu12_input)
     video_frame_max_size = (video_width * video_height * 3) / 2;
   else
     video_frame_max_size = video_width * video_height * 3; // RGB formats
@@ -154,6 +162,9 @@ static void encoder_clean_video_ring_buffer() {
   if (!video_ring_buffer)
     return;
 
+  /*encoder_get_stats may be polling the ring*/
+  __LOCK_MUTEX(__PMUTEX);
+
   int i = 0;
   for (i = 0; i < video_ring_buffer_size; ++i) {
     /*Max: (yuyv) 2 bytes per pixel*/
@@ -161,6 +172,33 @@ static void encoder_clean_video_ring_buffer() {
   }
   free(video_ring_buffer);
   video_ring_buffer = NULL;
+
+  __UNLOCK_MUTEX(__PMUTEX);
+}
+
+/*
+ * get the number of video ring buffer slots waiting to be encoded
+ *   (must be called with __PMUTEX locked)
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: used slots
+ */
+static int encoder_video_ring_used() {
+  if (!video_ring_buffer)
+    return 0;
+
+  int used = video_write_index - video_read_index;
+  if (used < 0)
+    used += video_ring_buffer_size;
+  else if (used == 0 &&
+           video_ring_buffer[video_read_index].flag != VIDEO_BUFF_FREE)
+    used = video_ring_buffer_size; /*full*/
+
+  return used;
 }
 
 /*
@@ -490,8 +528,9 @@ encoder_video_init(encoder_context_t *encoder_ctx) {
   video_codec_data->codec_context->height = encoder_ctx->video_height;
 
   video_codec_data->codec_context->flags |= video_defaults->flags;
-  if (video_defaults->num_threads > 0)
-    video_codec_data->codec_context->thread_count = video_defaults->num_threads;
+  /*threads, preset/speed level and realtime tuning*/
+  encoder_apply_video_profile(video_codec_data->codec_context, video_defaults,
+                              &encoder_ctx->video_profile);
   /*
    * mb_decision:
    * 0 (FF_MB_DECISION_SIMPLE) Use mbcmp (default).
@@ -567,7 +606,6 @@ encoder_video_init(encoder_context_t *encoder_ctx) {
   case AV_CODEC_ID_H264: {
     /**/
     //video_codec_data->codec_context->me_range = 16;
-    av_opt_set(video_codec_data->codec_context->priv_data, "preset", "faster", 0);
     //av_dict_set(&video_codec_data->private_options, "crf", "23", 0);
     //av_dict_set(&video_codec_data->private_options, "tune", "zerolatency", 0);
   } break;
@@ -575,18 +613,11 @@ encoder_video_init(encoder_context_t *encoder_ctx) {
     //video_codec_data->codec_context->me_range = 57;
     if (video_codec_data->codec_context->max_b_frames > 8)
       video_codec_data->codec_context->max_b_frames = 8; // limit b frames to 8
-    av_opt_set(video_codec_data->codec_context->priv_data, "preset", "medium", 0);
     //av_opt_set(video_codec_data->codec_context->priv_data, "crf", "26", 0);
     //av_opt_set(video_codec_data->codec_context->priv_data, "x265-params",
     //            "ref=1:rc-lookahead=20", 0);
 
   } break;
-  case AV_CODEC_ID_VP8:    
-  case AV_CODEC_ID_VP9: {
-    av_opt_set(video_codec_data->codec_context->priv_data, "quality", "good", 0);
-    av_opt_set(video_codec_data->codec_context->priv_data, "cpu-used", "-10", 0);
-    av_opt_set(video_codec_data->codec_context->priv_data, "speed", "10", 0);
-  } break;
   default:
     break;
   }
@@ -1095,73 +1126,6 @@ int encoder_get_audio_sample_fmt(encoder_context_t *encoder_ctx) {
  */
 int encoder_get_max_audio_sample_fmt() { return AV_SAMPLE_FMT_NB - 1; }
 
-/*
- * get an estimated write loop sleep time to avoid a ring buffer overrun
- * args:
- *   mode: scheduler mode:
- *      0 - linear funtion; 1 - exponencial funtion
- *   thresh: ring buffer threshold in wich scheduler becomes active:
- *      [0.2 (20%) - 0.9 (90%)]
- *   max_time - maximum scheduler time (in ms)
- *
- * asserts:
- *   none
- *
- * returns: estimate sleep time (milisec)
- */
-double encoder_buff_scheduler(int mode, double thresh, double max_time) {
-  int diff_ind = 0;
-  double sched_time = 0; /*in milisec*/
-
-  __LOCK_MUTEX(__PMUTEX);
-  /* try to balance buffer overrun in read/write operations */
-  if (video_write_index >= video_read_index)
-    diff_ind = video_write_index - video_read_index;
-  else
-    diff_ind = (video_ring_buffer_size - video_read_index) + video_write_index;
-  __UNLOCK_MUTEX(__PMUTEX);
-
-  /*clip ring buffer threshold*/
-  if (thresh < 0.2)
-    thresh = 0.2; /*20% full*/
-  if (thresh > 0.9)
-    thresh = 0.9; /*90% full*/
-
-  int th = (int)lround((double)video_ring_buffer_size * thresh);
-
-  if (diff_ind >= th) {
-    switch (mode) {
-    case ENCODER_SCHED_LIN: /*linear function*/
-      sched_time =
-          (double)(diff_ind - th) * (max_time / (video_ring_buffer_size - th));
-      break;
-
-    case ENCODER_SCHED_EXP: /*exponencial*/
-    {
-      double exp = (double)log10(max_time) / log10(video_ring_buffer_size - th);
-      if (exp > 0)
-        sched_time = pow(diff_ind - th, exp);
-      else /*use linear function*/
-        sched_time = (double)(diff_ind - th) *
-                     (max_time / (video_ring_buffer_size - th));
-      break;
-    }
-    }
-  }
-
-  if (enc_verbosity > 2)
-    printf("ENCODER: scheduler %.2f ms (index delta %i)\n", sched_time,
-           diff_ind);
-
-  /*clip*/
-  if (sched_time > max_time)
-    sched_time = max_time;
-  if (sched_time < 0)
-    sched_time = 0;
-
-  return (sched_time);
-}
-
 /*
  * get valid video codec count
  * args:
@@ -1193,7 +1157,9 @@ int encoder_get_valid_audio_codecs() { return valid_audio_codecs; }
  *   video_codec_ind - video codec list index
  *   audio_codec_ind - audio codec list index
  *   muxer_id - file muxer:
- *        ENCODER_MUX_MKV; ENCODER_MUX_WEBM; ENCODER_MUX_AVI
+ *        ENCODER_MUX_MKV; ENCODER_MUX_WEBM; ENCODER_MUX_AVI;
+ *        ENCODER_MUX_Y4M; ENCODER_MUX_YUV (raw sinks: yu12 frames,
+ *        no codec and no audio)
  *   video_width - video frame width
  *   video_height - video frame height
  *   fps_num - fps numerator
@@ -1211,6 +1177,40 @@ encoder_context_t *encoder_init(int input_format, int video_codec_ind,
                                 int video_width, int video_height, int fps_num,
                                 int fps_den, int audio_channels,
                                 int audio_samprate) {
+  return encoder_init_profile(input_format, video_codec_ind, audio_codec_ind,
+                              muxer_id, video_width, video_height, fps_num,
+                              fps_den, audio_channels, audio_samprate, NULL);
+}
+
+/*
+ * encoder initialization with a video threading/speed profile
+ * args:
+ *   input_format - input v4l2 format (yuyv for encoding)
+ *   video_codec_ind - video codec list index
+ *   audio_codec_ind - audio codec list index
+ *   muxer_id - file muxer:
+ *        ENCODER_MUX_MKV; ENCODER_MUX_WEBM; ENCODER_MUX_AVI;
+ *        ENCODER_MUX_Y4M; ENCODER_MUX_YUV (raw sinks: yu12 frames,
+ *        no codec and no audio)
+ *   video_width - video frame width
+ *   video_height - video frame height
+ *   fps_num - fps numerator
+ *   fps_den - fps denominator
+ *   audio_channels- audio channels
+ *   audio_samprate- audio sample rate
+ *   profile - video encoder profile (if NULL use the codec table defaults)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to encoder context (NULL on error)
+ */
+encoder_context_t *
+encoder_init_profile(int input_format, int video_codec_ind,
+                     int audio_codec_ind, int muxer_id, int video_width,
+                     int video_height, int fps_num, int fps_den,
+                     int audio_channels, int audio_samprate,
+                     const encoder_video_profile_t *profile) {
   encoder_context_t *encoder_ctx = calloc(1, sizeof(encoder_context_t));
 
   if (encoder_ctx == NULL) {
@@ -1221,6 +1221,16 @@ encoder_context_t *encoder_init(int input_format, int video_codec_ind,
     exit(-1);
   }
 
+  if (profile)
+    encoder_ctx->video_profile = *profile;
+
+  /*raw sinks write the yu12 frames as they are*/
+  if (encoder_check_raw_muxer(muxer_id)) {
+    input_format = V4L2_PIX_FMT_YUV420;
+    video_codec_ind = 0;
+    audio_channels = 0;
+  }
+
   encoder_ctx->input_format = input_format;
 
   encoder_ctx->video_codec_ind = video_codec_ind;
@@ -1239,6 +1249,7 @@ encoder_context_t *encoder_init(int input_format, int video_codec_ind,
 
   /******************* video **********************/
   encoder_video_init(encoder_ctx);
+  quality_control_init(encoder_ctx);
 
   /******************* audio **********************/
   encoder_audio_init(encoder_ctx);
@@ -1248,7 +1259,10 @@ encoder_context_t *encoder_init(int input_format, int video_codec_ind,
 
   /****************** ring buffer *****************/
   encoder_alloc_video_ring_buffer(video_width, video_height, fps_den, fps_num,
-                                  video_codec_ind);
+                                  video_codec_ind > 0 ||
+                                      encoder_check_raw_muxer(muxer_id));
+
+  encoder_reset_stats();
 
   return encoder_ctx;
 }
@@ -1268,6 +1282,31 @@ encoder_context_t *encoder_init(int input_format, int video_codec_ind,
  */
 int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp,
                             int isKeyframe) {
+  return encoder_add_video_frame_nal(frame, size, timestamp, isKeyframe, NULL,
+                                     NULL, 0);
+}
+
+/*
+ * store an annex-b h264 input frame and its nal table in video ring buffer
+ *   (direct input: the muxer uses the table instead of rescanning the frame)
+ * args:
+ *   frame - pointer to h264 frame data
+ *   size - frame size (in bytes)
+ *   timestamp - frame timestamp (in nanosec)
+ *   isKeyframe - flag if it's a key(IDR) frame
+ *   nal_offset - nal header offsets table
+ *   nal_size - nal sizes table (without start code)
+ *   nal_count - nals in frame (if bigger than ENCODER_MAX_NALS
+ *      the table is dropped)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code
+ */
+int encoder_add_video_frame_nal(uint8_t *frame, int size, int64_t timestamp,
+                                int isKeyframe, const int *nal_offset,
+                                const int *nal_size, int nal_count) {
   if (!video_ring_buffer)
     return -1;
 
@@ -1284,6 +1323,7 @@ int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp,
   __UNLOCK_MUTEX(__PMUTEX);
 
   if (flag != VIDEO_BUFF_FREE) {
+    __atomic_fetch_add(&video_ring_full, 1, __ATOMIC_RELAXED);
     fprintf(stderr, "ENCODER: video ring buffer full - dropping frame\n");
     return -1;
   }
@@ -1299,8 +1339,22 @@ int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp,
   }
   memcpy(video_ring_buffer[video_write_index].frame, frame, size);
   video_ring_buffer[video_write_index].frame_size = size;
+
+  /*a partial (or clipped) nal table is of no use to the muxer*/
+  video_ring_buffer[video_write_index].nal_count = 0;
+  if (nal_offset != NULL && nal_size != NULL && nal_count > 0 &&
+      nal_count <= ENCODER_MAX_NALS &&
+      nal_offset[nal_count - 1] + nal_size[nal_count - 1] <= size) {
+    memcpy(video_ring_buffer[video_write_index].nal_offset, nal_offset,
+           nal_count * sizeof(int));
+    memcpy(video_ring_buffer[video_write_index].nal_size, nal_size,
+           nal_count * sizeof(int));
+    video_ring_buffer[video_write_index].nal_count = nal_count;
+  }
   video_ring_buffer[video_write_index].timestamp = pts;
   video_ring_buffer[video_write_index].keyframe = isKeyframe;
+  video_ring_buffer[video_write_index].queued_ts = ns_time_monotonic();
+  __atomic_fetch_add(&video_frames, 1, __ATOMIC_RELAXED);
 
   __LOCK_MUTEX(__PMUTEX);
   video_ring_buffer[video_write_index].flag = VIDEO_BUFF_USED;
@@ -1344,21 +1398,150 @@ int encoder_process_next_video_buffer(encoder_context_t *encoder_ctx) {
         video_ring_buffer[video_read_index].frame_size;
     if (video_ring_buffer[video_read_index].keyframe)
       encoder_ctx->enc_video_ctx->flags |= AV_PKT_FLAG_KEY;
+    encoder_ctx->enc_video_ctx->nal_count =
+        video_ring_buffer[video_read_index].nal_count;
+    encoder_ctx->enc_video_ctx->nal_offset =
+        video_ring_buffer[video_read_index].nal_offset;
+    encoder_ctx->enc_video_ctx->nal_size =
+        video_ring_buffer[video_read_index].nal_size;
+  }
+
+  /*overloaded software encoder: skip the frame (quality control)*/
+  if (encoder_ctx->video_codec_ind > 0 && quality_control_skip_frame()) {
+    __LOCK_MUTEX(__PMUTEX);
+
+    video_ring_buffer[video_read_index].flag = VIDEO_BUFF_FREE;
+    NEXT_IND(video_read_index, video_ring_buffer_size);
+
+    __UNLOCK_MUTEX(__PMUTEX);
+
+    return 0;
   }
 
+  /*the encoder writes the muxer: keep the mux time out of the encode stage*/
+  uint64_t mux_ns = __atomic_load_n(&video_stage_hist[ENCODER_STAGE_MUX].sum,
+                                    __ATOMIC_RELAXED);
+  uint64_t start = ns_time_monotonic();
+
+  latency_hist_add(&video_stage_hist[ENCODER_STAGE_QUEUE_WAIT],
+                   start - video_ring_buffer[video_read_index].queued_ts);
+
   encoder_encode_video(encoder_ctx, video_ring_buffer[video_read_index].frame);
 
+  uint64_t encode_ns = ns_time_monotonic() - start;
+  mux_ns = __atomic_load_n(&video_stage_hist[ENCODER_STAGE_MUX].sum,
+                           __ATOMIC_RELAXED) -
+           mux_ns;
+  latency_hist_add(&video_stage_hist[ENCODER_STAGE_ENCODE],
+                   encode_ns > mux_ns ? encode_ns - mux_ns : 0);
+
   /*mux the frame*/
   __LOCK_MUTEX(__PMUTEX);
 
   video_ring_buffer[video_read_index].flag = VIDEO_BUFF_FREE;
   NEXT_IND(video_read_index, video_ring_buffer_size);
 
+  double ring_fill =
+      (double)encoder_video_ring_used() / video_ring_buffer_size;
+
   __UNLOCK_MUTEX(__PMUTEX);
 
+  if (encoder_ctx->video_codec_ind > 0)
+    quality_control_update(encoder_ctx, encode_ns, ring_fill);
+
   return 0;
 }
 
+/*
+ * records a video encoding stage latency (encoder_get_stats)
+ * args:
+ *   stage - encoding stage (ENCODER_STAGE_*)
+ *   ns - stage latency (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_add_stage_latency(int stage, uint64_t ns) {
+  if (stage < 0 || stage >= ENCODER_STAGE_COUNT)
+    return;
+
+  latency_hist_add(&video_stage_hist[stage], ns);
+}
+
+/*
+ * gets the video encoding stats (stage latencies and drop counters)
+ *   the stats are reset by encoder_init; cheap enough to be polled
+ *   by a monitoring thread while recording
+ * args:
+ *   stats - pointer to stats struct (filled by the function)
+ *
+ * asserts:
+ *   stats is not null
+ *
+ * returns: none
+ */
+void encoder_get_stats(encoder_stats_t *stats) {
+  /*assertions*/
+  assert(stats != NULL);
+
+  int i = 0;
+  for (i = 0; i < ENCODER_STAGE_COUNT; i++) {
+    latency_hist_t *hist = &video_stage_hist[i];
+    encoder_latency_stats_t *stage = &stats->stage[i];
+
+    stage->count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    stage->mean = stage->count
+                      ? __atomic_load_n(&hist->sum, __ATOMIC_RELAXED) /
+                            stage->count
+                      : 0;
+    stage->p50 = latency_hist_percentile(hist, 500);
+    stage->p90 = latency_hist_percentile(hist, 900);
+    stage->p99 = latency_hist_percentile(hist, 990);
+    stage->p999 = latency_hist_percentile(hist, 999);
+    stage->max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+  }
+
+  stats->video_frames = __atomic_load_n(&video_frames, __ATOMIC_RELAXED);
+  stats->video_ring_full = __atomic_load_n(&video_ring_full, __ATOMIC_RELAXED);
+
+  /*ring buffer fill (encoder backpressure)*/
+  stats->video_ring_size = 0;
+  stats->video_ring_used = 0;
+
+  __LOCK_MUTEX(__PMUTEX);
+  if (video_ring_buffer) {
+    stats->video_ring_size = video_ring_buffer_size;
+    stats->video_ring_used = encoder_video_ring_used();
+  }
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  /*software encoder quality control*/
+  stats->quality_level = quality_control_get_level();
+  stats->video_skipped = quality_control_get_skipped();
+
+  /*disk writes (writer backpressure)*/
+  io_get_write_stats(&stats->io_bytes, &stats->io_write_ns);
+}
+
+/*
+ * resets the video encoding stats
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_reset_stats() {
+  memset(video_stage_hist, 0, sizeof(video_stage_hist));
+  video_frames = 0;
+  video_ring_full = 0;
+  io_reset_write_stats();
+}
+
 /*
  * process all used video frames from buffer
  * args:
@@ -1616,12 +1799,27 @@ static void write_pkt_buffer (encoder_context_t *encoder_ctx, SPacket_t *spkt) {
   enc_video_ctx->dts = spkt->dts;
   enc_video_ctx->flags = spkt->flags;
   enc_video_ctx->duration = 0;
- 
-  if (spkt->size <= enc_video_ctx->outbuf_size)
-    memcpy(enc_video_ctx->outbuf, spkt->data, spkt->size);
-  else
-    fprintf(stderr, "video packet size is bigger than output buffer(%i>%i)\n",
-            spkt->size, enc_video_ctx->outbuf_size);
+
+  /*lossless packets can be bigger than the frame size: grow the buffer*/
+  if (spkt->size > enc_video_ctx->outbuf_size) {
+    if (enc_verbosity > 1)
+      printf("ENCODER: video packet size is bigger than output buffer "
+             "(%i>%i): growing buffer\n",
+             spkt->size, enc_video_ctx->outbuf_size);
+    enc_video_ctx->outbuf_size = spkt->size;
+    if (enc_video_ctx->outbuf)
+      free(enc_video_ctx->outbuf);
+    enc_video_ctx->outbuf = calloc(enc_video_ctx->outbuf_size, sizeof(uint8_t));
+    if (enc_video_ctx->outbuf == NULL) {
+      fprintf(stderr,
+              "ENCODER: FATAL memory allocation failure (write_pkt_buffer): "
+              "%s\n",
+              strerror(errno));
+      exit(-1);
+    }
+  }
+
+  memcpy(enc_video_ctx->outbuf, spkt->data, spkt->size);
 
   encoder_ctx->enc_video_ctx->outbuf_coded_size = spkt->size;
 
@@ -1674,15 +1872,38 @@ int encoder_encode_video(encoder_context_t *encoder_ctx, void *input_frame) {
     }
     /*outbuf_coded_size must already be set*/
     outsize = enc_video_ctx->outbuf_coded_size;
-    if (outsize > enc_video_ctx->outbuf_size) {
-      enc_video_ctx->outbuf_size = outsize;
+
+    /*raw sinks: write straight from the ring buffer (no outbuf copy)*/
+    if (encoder_check_raw_muxer(encoder_ctx->muxer_id)) {
+      encoder_write_raw_video_data(encoder_ctx, input_frame);
+      return (outsize);
+    }
+    /*length prefixes are at most 1 byte bigger than the start codes*/
+    int max_size = outsize + enc_video_ctx->nal_count;
+    if (max_size > enc_video_ctx->outbuf_size) {
+      enc_video_ctx->outbuf_size = max_size;
       if (enc_video_ctx->outbuf)
         free(enc_video_ctx->outbuf);
       enc_video_ctx->outbuf =
           calloc(enc_video_ctx->outbuf_size, sizeof(uint8_t));
     }
 
-    memcpy(enc_video_ctx->outbuf, input_frame, outsize);
+    enc_video_ctx->outbuf_nal_prefixed = 0;
+    if (enc_video_ctx->h264_nal_prefix && enc_video_ctx->nal_count > 0) {
+      /*convert while copying, using the cached nal table (no rescan)*/
+      int size = h264_nals_to_avcc(
+          input_frame, enc_video_ctx->nal_offset, enc_video_ctx->nal_size,
+          enc_video_ctx->nal_count, enc_video_ctx->outbuf,
+          enc_video_ctx->outbuf_size);
+      if (size > 0) {
+        outsize = size;
+        enc_video_ctx->outbuf_coded_size = outsize;
+        enc_video_ctx->outbuf_nal_prefixed = 1;
+      }
+    }
+
+    if (!enc_video_ctx->outbuf_nal_prefixed)
+      memcpy(enc_video_ctx->outbuf, input_frame, outsize);
     enc_video_ctx->flags = 0;
     /*enc_video_ctx->flags must be set*/
     enc_video_ctx->dts = AV_NOPTS_VALUE;
@@ -1761,6 +1982,23 @@ int encoder_encode_video(encoder_context_t *encoder_ctx, void *input_frame) {
     if (enc_video_ctx->monotonic_pts)
       pkt->pts *= 10000;
 
+    /*
+     * ffv1 is intra only (packets come out in order):
+     * write straight from the libav packet, no clone and sort
+     */
+    if (video_codec_data->codec_context->codec_id == AV_CODEC_ID_FFV1 &&
+        spkt_list->size == 0) {
+      SPacket_t spkt = {.data = pkt->data,
+                        .size = pkt->size,
+                        .pts = pkt->pts,
+                        .dts = pkt->dts,
+                        .flags = pkt->flags};
+      outsize = pkt->size;
+      write_pkt_buffer(encoder_ctx, &spkt);
+      av_packet_unref(pkt);
+      continue;
+    }
+
     //lets buffer the packets to sort by pts
     SPacket_t* spkt = spacket_clone(pkt);
     
@@ -2166,7 +2404,6 @@ void encoder_close(encoder_context_t *encoder_ctx) {
   video_ring_buffer = NULL;
   video_read_index = 0;
   video_write_index = 0;
-  video_scheduler = 0;
 
   fprintf(stderr, "ENCODER_CLOSE: exit\n");
   fflush(stderr);
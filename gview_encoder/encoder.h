@@ -25,6 +25,8 @@
 #include <inttypes.h>
 #include <sys/types.h>
 
+#include "neoguvcencoder.h"
+
 // #include "../config.h"
 
 #ifdef HAVE_FFMPEG_AVCODEC_H
@@ -120,6 +122,18 @@
 #define VIDEO_BUFF_FREE (0)
 #define VIDEO_BUFF_USED (1)
 
+/*software encoder quality control (quality_control.c)*/
+#define ENCODER_QC_MAX_LEVEL (5)     /*cheapest encoding level*/
+#define ENCODER_QC_SPEED_LEVEL (2)   /*faster encoder speed from this level*/
+#define ENCODER_QC_SKIP_LEVEL (4)    /*frame skipping from this level*/
+#define ENCODER_QC_BITRATE_FACTOR (0.8) /*bit rate factor per level*/
+#define ENCODER_QC_CRF_STEP (3)      /*crf increment per level*/
+#define ENCODER_QC_HIGH_PRESSURE (0.9) /*encoder can't keep up*/
+#define ENCODER_QC_LOW_PRESSURE (0.5)  /*encoder has spare time*/
+#define ENCODER_QC_DOWN_HOLD_NS (NSEC_PER_SEC / 2)
+#define ENCODER_QC_UP_HOLD_NS (5 * NSEC_PER_SEC)
+#define ENCODER_QC_STEP_NS (NSEC_PER_SEC) /*minimum time between changes*/
+
 /*
  * codec data struct used for encoder context
  * we set all avcodec stuff here so that we don't
@@ -302,4 +316,115 @@ int encoder_get_audio_bits(int codec_ind);
  */
 int encoder_get_audio_bit_rate(int codec_ind);
 
+/*
+ * records a video encoding stage latency (encoder_get_stats)
+ * args:
+ *   stage - encoding stage (ENCODER_STAGE_*)
+ *   ns - stage latency (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_add_stage_latency(int stage, uint64_t ns);
+
+/*
+ * write a yu12 video frame to the raw sink (ENCODER_MUX_Y4M/YUV)
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *   frame - pointer to yu12 frame (outbuf_coded_size bytes)
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *   frame is not null
+ *
+ * returns: error code
+ */
+int encoder_write_raw_video_data(encoder_context_t *encoder_ctx,
+                                 uint8_t *frame);
+
+/*
+ * apply the threading, speed and bit rate profile to a video codec context
+ *   (before opening the codec)
+ * args:
+ *   avctx - pointer to codec context
+ *   video_defaults - pointer to the codec table entry
+ *   profile - pointer to profile (zero fields use the codec table defaults)
+ *
+ * asserts:
+ *   avctx is not null
+ *   video_defaults is not null
+ *   profile is not null
+ *
+ * returns: none
+ */
+void encoder_apply_video_profile(AVCodecContext *avctx,
+                                 video_codec_t *video_defaults,
+                                 const encoder_video_profile_t *profile);
+
+/*
+ * init the quality control for a new video encoder
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *
+ * returns: none
+ */
+void quality_control_init(encoder_context_t *encoder_ctx);
+
+/*
+ * check if the next frame should be skipped (highest quality levels)
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if the frame should be skipped; 0 otherwise
+ */
+int quality_control_skip_frame();
+
+/*
+ * feed the quality control with the last frame processing time
+ *   and the ring buffer fill (may change the quality level)
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *   encode_ns - frame processing time (encode + mux) in ns
+ *   ring_fill - video ring buffer fill (0 - empty; 1 - full)
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *
+ * returns: none
+ */
+void quality_control_update(encoder_context_t *encoder_ctx, uint64_t encode_ns,
+                            double ring_fill);
+
+/*
+ * get the current quality level
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: quality level (0 - codec defaults)
+ */
+int quality_control_get_level();
+
+/*
+ * get the number of frames skipped by the quality control
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: skipped frames
+ */
+uint64_t quality_control_get_skipped();
+
 #endif
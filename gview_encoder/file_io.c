@@ -32,9 +32,14 @@
 #include <libintl.h>
 
 #include "neoguvcencoder.h"
+#include "core_time.h"
 #include "file_io.h"
 #include "neoguvc.h"
 
+/*disk write stats (writer backpressure)*/
+static uint64_t io_bytes_written = 0;
+static uint64_t io_write_ns = 0;
+
 
 /*
  * get the file position pointer
@@ -189,11 +194,15 @@ int64_t io_flush_buffer(io_writer_t *writer)
 	if (writer->buf_ptr > writer->buffer)
 	{
 		nitems= writer->buf_ptr - writer->buffer;
+		uint64_t write_start = ns_time_monotonic();
 		if(fwrite(writer->buffer, 1, nitems, writer->fp) < nitems)
 		{
 			fprintf(stderr, "ENCODER: (io_flush) file write error: %s\n", strerror(errno));
 			return -1;
 		}
+		__atomic_add_fetch(&io_write_ns, ns_time_monotonic() - write_start,
+			__ATOMIC_RELAXED);
+		__atomic_add_fetch(&io_bytes_written, nitems, __ATOMIC_RELAXED);
 	}
 	else if (writer->buf_ptr < writer->buffer)
 	{
@@ -576,3 +585,55 @@ void io_write_4cc(io_writer_t *writer, const char *str)
 //        io_write_w8(writer, 0);
 //    return len;
 //}
+
+/*
+ * get the disk write stats (all writers)
+ * args:
+ *   bytes - pointer to bytes written (can be null)
+ *   ns - pointer to time spent writing in ns (can be null)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void io_get_write_stats(uint64_t *bytes, uint64_t *ns)
+{
+	if(bytes)
+		*bytes = __atomic_load_n(&io_bytes_written, __ATOMIC_RELAXED);
+	if(ns)
+		*ns = __atomic_load_n(&io_write_ns, __ATOMIC_RELAXED);
+}
+
+/*
+ * account a write done outside the io writers (e.g. raw sink)
+ * args:
+ *   bytes - bytes written
+ *   ns - time spent writing in ns
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void io_add_write_stats(uint64_t bytes, uint64_t ns)
+{
+	__atomic_add_fetch(&io_write_ns, ns, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&io_bytes_written, bytes, __ATOMIC_RELAXED);
+}
+
+/*
+ * reset the disk write stats
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void io_reset_write_stats()
+{
+	__atomic_store_n(&io_bytes_written, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&io_write_ns, 0, __ATOMIC_RELAXED);
+}
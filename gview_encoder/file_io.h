@@ -268,6 +268,44 @@ void io_write_4cc(io_writer_t *writer, const char *str);
  */
 // int io_write_str(io_writer_t * writer, const char *str);
 
+/*
+ * get the disk write stats (all writers)
+ * args:
+ *   bytes - pointer to bytes written (can be null)
+ *   ns - pointer to time spent writing in ns (can be null)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void io_get_write_stats(uint64_t *bytes, uint64_t *ns);
+
+/*
+ * account a write done outside the io writers (e.g. raw sink)
+ * args:
+ *   bytes - bytes written
+ *   ns - time spent writing in ns
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void io_add_write_stats(uint64_t bytes, uint64_t ns);
+
+/*
+ * reset the disk write stats
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void io_reset_write_stats();
+
 #if BIGENDIAN
 #define io_write_w16 io_write_wb16
 #define io_write_w24 io_write_wb24
@@ -40,6 +40,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     # # #
 #endif
 #include "encoder.h"
 #include "file_io.h"
+#include "h264_nal.h"
 #include "neoguvc.h"
 #include "neoguvcencoder.h"
 #include "matroska.h"
@@ -666,49 +667,55 @@ int mkv_write_header(mkv_context_t *mkv_ctx) {
   return 0;
 }
 
+/*
+ * replace the annex-b start codes of a h264 packet with the nal size
+ *   (in place) - only for packets without a cached nal table
+ * args:
+ *   data - pointer to packet data
+ *   size - packet size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: packet size after conversion
+ */
 static int mkv_processh264_nalu(uint8_t *data, int size) {
-  /*replace 00 00 00 01 (nalu marker) with nalu size*/
-  int last_nalu = 0; /*marks last nalu in buffer*/
-  int tot_nal = 0;
-  uint8_t *nal_start = data;
-  uint8_t *sp = data;
-  uint8_t *ep = NULL;
-  uint32_t nal_size = 0;
-
-  while (!last_nalu) {
-    nal_size = 0;
-
-    /*search for NALU marker*/
-    for (sp = nal_start; sp < data + size - 4; ++sp) {
-      if (sp[0] == 0x00 && sp[1] == 0x00 && sp[2] == 0x00 && sp[3] == 0x01) {
-        nal_start = sp + 4;
-        break;
-      }
-    }
-
-    /*search for end of NALU*/
-    for (ep = nal_start; ep < data + size - 4; ++ep) {
-      if (ep[0] == 0x00 && ep[1] == 0x00 && ep[2] == 0x00 && ep[3] == 0x01) {
-        nal_size = ep - nal_start;
-        nal_start = ep; /*reset for next NALU*/
-        break;
-      }
+  int nal_offset[ENCODER_MAX_NALS];
+  int nal_size[ENCODER_MAX_NALS];
+  int *offset = nal_offset;
+  int *nsize = nal_size;
+
+  int count =
+      h264_scan_nals(data, size, nal_offset, nal_size, NULL, ENCODER_MAX_NALS);
+
+  if (count > ENCODER_MAX_NALS) {
+    offset = calloc(count, sizeof(int));
+    nsize = calloc(count, sizeof(int));
+    if (offset == NULL || nsize == NULL) {
+      fprintf(stderr,
+              "ENCODER: FATAL memory allocation failure "
+              "(mkv_processh264_nalu): %s\n",
+              strerror(errno));
+      exit(-1);
     }
+    h264_scan_nals(data, size, offset, nsize, NULL, count);
+  }
 
-    if (!nal_size) {
-      last_nalu = 1;
-      nal_size = data + size - nal_start;
-    }
+  int out_size = h264_nals_to_avcc(data, offset, nsize, count, data, size);
 
-    sp[0] = (nal_size >> 24) & 0x000000FF;
-    sp[1] = (nal_size >> 16) & 0x000000FF;
-    sp[2] = (nal_size >> 8) & 0x000000FF;
-    sp[3] = (nal_size) & 0x000000FF;
+  if (offset != nal_offset) {
+    free(offset);
+    free(nsize);
+  }
 
-    tot_nal++;
+  if (out_size < 0) {
+    /*3 byte start codes don't fit a 4 byte nal size*/
+    fprintf(stderr,
+            "ENCODER: (matroska) can't convert h264 packet in place\n");
+    return size;
   }
 
-  return tot_nal;
+  return out_size;
 }
 
 static int mkv_blockgroup_size(int pkt_size) {
@@ -724,10 +731,6 @@ static int mkv_blockgroup_size(int pkt_size) {
 static void mkv_write_block(mkv_context_t *mkv_ctx, unsigned int blockid,
                             int stream_index, uint8_t *data, int size,
                             uint64_t pts, int flags) {
-  stream_io_t *stream = get_stream(mkv_ctx->stream_list, stream_index);
-  if (stream->codec_id == AV_CODEC_ID_H264 && stream->h264_process)
-    mkv_processh264_nalu(data, size);
-
   uint8_t block_flags = 0x00;
 
   if (!!(flags & AV_PKT_FLAG_KEY)) // for simple block
@@ -756,6 +759,10 @@ static int mkv_write_packet_internal(mkv_context_t *mkv_ctx, int stream_index,
   stream_io_t *stream = get_stream(mkv_ctx->stream_list, stream_index);
   stream->packet_count++;
 
+  if (stream->codec_id == AV_CODEC_ID_H264 && stream->h264_process &&
+      !(flags & MKV_PKT_FLAG_NAL_PREFIXED))
+    size = mkv_processh264_nalu(data, size);
+
   if (!mkv_ctx->cluster_pos) {
     mkv_ctx->cluster_pos = io_get_offset(mkv_ctx->writer);
     mkv_ctx->cluster = mkv_start_ebml_master(mkv_ctx, MATROSKA_ID_CLUSTER, 0);
@@ -325,6 +325,9 @@ stream_io_t *mkv_add_audio_stream(mkv_context_t *mkv_ctx,
 /** write the header*/
 int mkv_write_header(mkv_context_t *mkv_ctx);
 
+/** packet flag (with AV_PKT_FLAG_*): h264 nals are already length prefixed*/
+#define MKV_PKT_FLAG_NAL_PREFIXED (0x8000)
+
 int mkv_write_packet(mkv_context_t *mkv_ctx,
 					int stream_index,
 					uint8_t *data,
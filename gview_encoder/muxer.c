@@ -37,16 +37,19 @@ Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     # # #
 
 // #include "../config.h"
 #include "avi.h"
+#include "core_time.h"
 #include "encoder.h"
 #include "neoguvc.h"
 #include "neoguvcencoder.h"
 #include "matroska.h"
+#include "raw_sink.h"
 #include "stream_io.h"
 
 extern int enc_verbosity;
 
 static mkv_context_t *mkv_ctx = NULL;
 static avi_context_t *avi_ctx = NULL;
+static raw_sink_t *raw_sink = NULL;
 
 static stream_io_t *video_stream = NULL;
 static stream_io_t *audio_stream = NULL;
@@ -86,6 +89,13 @@ int encoder_write_video_data(encoder_context_t *encoder_ctx) {
   if (video_codec_data)
     block_align = video_codec_data->codec_context->block_align;
 
+  /*direct h264 input already converted with the cached nal table*/
+  int mkv_flags = enc_video_ctx->flags;
+  if (enc_video_ctx->outbuf_nal_prefixed)
+    mkv_flags |= MKV_PKT_FLAG_NAL_PREFIXED;
+
+  uint64_t start = ns_time_monotonic();
+
   __LOCK_MUTEX(__PMUTEX);
   switch (encoder_ctx->muxer_id) {
   case ENCODER_MUX_AVI:
@@ -96,9 +106,10 @@ int encoder_write_video_data(encoder_context_t *encoder_ctx) {
 
   case ENCODER_MUX_MKV:
   case ENCODER_MUX_WEBM:
-    ret = mkv_write_packet(
-        mkv_ctx, 0, enc_video_ctx->outbuf, enc_video_ctx->outbuf_coded_size,
-        enc_video_ctx->duration, enc_video_ctx->pts, enc_video_ctx->flags);
+    ret = mkv_write_packet(mkv_ctx, 0, enc_video_ctx->outbuf,
+                           enc_video_ctx->outbuf_coded_size,
+                           enc_video_ctx->duration, enc_video_ctx->pts,
+                           mkv_flags);
     break;
 
   default:
@@ -107,6 +118,62 @@ int encoder_write_video_data(encoder_context_t *encoder_ctx) {
   }
   __UNLOCK_MUTEX(__PMUTEX);
 
+  encoder_add_stage_latency(ENCODER_STAGE_MUX, ns_time_monotonic() - start);
+
+  return (ret);
+}
+
+/*
+ * checks if the muxer is a raw sink (ENCODER_MUX_Y4M or ENCODER_MUX_YUV)
+ *   raw sinks take yu12 frames (the caller must convert them)
+ * args:
+ *    muxer_id - file muxer
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 1 true; 0 false
+ */
+int encoder_check_raw_muxer(int muxer_id) {
+  return (muxer_id == ENCODER_MUX_Y4M || muxer_id == ENCODER_MUX_YUV);
+}
+
+/*
+ * write a yu12 video frame to the raw sink (ENCODER_MUX_Y4M/YUV)
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *   frame - pointer to yu12 frame (outbuf_coded_size bytes)
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *   frame is not null
+ *
+ * returns: error code
+ */
+int encoder_write_raw_video_data(encoder_context_t *encoder_ctx,
+                                 uint8_t *frame) {
+  /*assertions*/
+  assert(encoder_ctx != NULL);
+  assert(frame != NULL);
+
+  encoder_video_context_t *enc_video_ctx = encoder_ctx->enc_video_ctx;
+  assert(enc_video_ctx);
+
+  if (enc_video_ctx->outbuf_coded_size <= 0 || raw_sink == NULL)
+    return -1;
+
+  enc_video_ctx->framecount++;
+
+  uint64_t start = ns_time_monotonic();
+
+  __LOCK_MUTEX(__PMUTEX);
+  int ret = raw_sink_write_frame(raw_sink, frame,
+                                 enc_video_ctx->outbuf_coded_size,
+                                 enc_video_ctx->pts);
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  encoder_add_stage_latency(ENCODER_STAGE_MUX, ns_time_monotonic() - start);
+
   return (ret);
 }
 
@@ -179,9 +246,9 @@ int encoder_write_audio_data(encoder_context_t *encoder_ctx) {
  *   encoder_ctx is not null
  *   encoder_ctx->enc_video_ctx is not null
  *
- * returns: none
+ * returns: error code (0 - OK; -1 - couldn't open the output file)
  */
-void encoder_muxer_init(encoder_context_t *encoder_ctx, const char *filename) {
+int encoder_muxer_init(encoder_context_t *encoder_ctx, const char *filename) {
   /*assertions*/
   assert(encoder_ctx != NULL);
   assert(encoder_ctx->enc_video_ctx != NULL);
@@ -218,7 +285,9 @@ void encoder_muxer_init(encoder_context_t *encoder_ctx, const char *filename) {
         avi_ctx, encoder_ctx->video_width, encoder_ctx->video_height,
         encoder_ctx->fps_den, encoder_ctx->fps_num, video_codec_id);
 
-    if (video_codec_id == AV_CODEC_ID_THEORA && video_codec_data) {
+    if ((video_codec_id == AV_CODEC_ID_THEORA ||
+         video_codec_id == AV_CODEC_ID_FFV1) &&
+        video_codec_data) {
       video_stream->extra_data =
           (uint8_t *)video_codec_data->codec_context->extradata;
       video_stream->extra_data_size =
@@ -275,8 +344,10 @@ void encoder_muxer_init(encoder_context_t *encoder_ctx, const char *filename) {
     if (video_stream->extra_data_size > 0) {
       video_stream->extra_data = (uint8_t *)encoder_get_video_mkvCodecPriv(
           encoder_ctx->video_codec_ind);
-      if (encoder_ctx->input_format == V4L2_PIX_FMT_H264)
+      if (encoder_ctx->input_format == V4L2_PIX_FMT_H264) {
         video_stream->h264_process = 1; // we need to process NALU marker
+        encoder_ctx->enc_video_ctx->h264_nal_prefix = 1;
+      }
     }
 
     /*add audio stream*/
@@ -310,7 +381,24 @@ void encoder_muxer_init(encoder_context_t *encoder_ctx, const char *filename) {
     mkv_write_header(mkv_ctx);
 
     break;
+
+  case ENCODER_MUX_Y4M:
+  case ENCODER_MUX_YUV:
+    if (raw_sink != NULL) {
+      raw_sink_close(raw_sink);
+      raw_sink = NULL;
+    }
+    /*fps_num/fps_den is the frame period*/
+    raw_sink = raw_sink_create(filename, encoder_ctx->muxer_id,
+                               encoder_ctx->video_width,
+                               encoder_ctx->video_height, encoder_ctx->fps_den,
+                               encoder_ctx->fps_num);
+    if (raw_sink == NULL)
+      return -1;
+    break;
   }
+
+  return 0;
 }
 
 /*
@@ -353,6 +441,12 @@ void encoder_muxer_close(encoder_context_t *encoder_ctx) {
     }
     break;
 
+  case ENCODER_MUX_Y4M:
+  case ENCODER_MUX_YUV:
+    raw_sink_close(raw_sink);
+    raw_sink = NULL;
+    break;
+
   default:
   case ENCODER_MUX_MKV:
   case ENCODER_MUX_WEBM:
@@ -48,10 +48,16 @@ __BEGIN_DECLS
 #define ENCODER_MUX_MKV        (0)
 #define ENCODER_MUX_WEBM       (1)
 #define ENCODER_MUX_AVI        (2)
+/*raw sinks: uncompressed yu12 video only (<file>.idx timestamp sidecar)*/
+#define ENCODER_MUX_Y4M        (3) /*yuv4mpeg2*/
+#define ENCODER_MUX_YUV        (4) /*headerless planar yuv*/
 
-/*Scheduler Modes*/
-#define ENCODER_SCHED_LIN  (0)
-#define ENCODER_SCHED_EXP  (1)
+/*video encoder threading (encoder_video_profile_t)*/
+#define ENCODER_THREAD_FRAME   (1) /*one frame per thread (more latency)*/
+#define ENCODER_THREAD_SLICE   (2) /*slices of the same frame*/
+
+/*video encoder speed levels (encoder_video_profile_t)*/
+#define ENCODER_SPEED_MAX      (5)
 
 /*audio sample format*/
 #ifndef GV_SAMPLE_TYPE_INT16
@@ -63,6 +69,8 @@ __BEGIN_DECLS
 
 //#define MAX_DELAYED_FRAMES 68  /*Maximum supported delayed frames*/
 
+#define ENCODER_MAX_NALS (64) /*max cached nals per h264 frame (direct input)*/
+
 /*video buffer*/
 typedef struct _video_buffer_t
 {
@@ -71,8 +79,49 @@ typedef struct _video_buffer_t
 	int64_t timestamp;
 	int keyframe;  /* 1-keyframe; 0-non keyframe (only for direct input)*/
 	int flag;      /*VIDEO_BUFF_FREE | VIDEO_BUFF_USED*/
+	uint64_t queued_ts; /*monotonic time the frame was queued (ns)*/
+	int nal_count; /*nals in the nal table (direct h264 input) or 0*/
+	int nal_offset[ENCODER_MAX_NALS]; /*nal header offsets in frame*/
+	int nal_size[ENCODER_MAX_NALS];   /*nal sizes (without start code)*/
 } video_buffer_t;
 
+/*
+ * video encoding stages with latency stats (encoder_get_stats)
+ */
+#define ENCODER_STAGE_QUEUE_WAIT (0) /*time spent in the video ring buffer*/
+#define ENCODER_STAGE_ENCODE     (1) /*video encode (without muxing)*/
+#define ENCODER_STAGE_MUX        (2) /*video packet write to the muxer*/
+#define ENCODER_STAGE_COUNT      (3)
+
+/*
+ * latency summary (values in ns, taken from a hdr style histogram:
+ * percentiles have a relative error below 1/8)
+ */
+typedef struct _encoder_latency_stats_t
+{
+	uint64_t count; /*number of samples*/
+	uint64_t mean;
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+} encoder_latency_stats_t;
+
+/*encoder stats (encoder_get_stats)*/
+typedef struct _encoder_stats_t
+{
+	encoder_latency_stats_t stage[ENCODER_STAGE_COUNT]; /*ENCODER_STAGE_* */
+	uint64_t video_frames;    /*video frames queued for encoding*/
+	uint64_t video_ring_full; /*video frames dropped (ring buffer full)*/
+	int video_ring_size;      /*video ring buffer slots (0 if not allocated)*/
+	int video_ring_used;      /*video ring buffer slots waiting to be encoded*/
+	uint64_t io_bytes;        /*bytes written to disk*/
+	uint64_t io_write_ns;     /*time spent writing to disk (ns)*/
+	int quality_level;        /*software encoder quality level (0 - defaults)*/
+	uint64_t video_skipped;   /*video frames skipped by the quality control*/
+} encoder_stats_t;
+
 /*video codec properties*/
 typedef struct _video_codec_t
 {
@@ -107,9 +156,13 @@ typedef struct _video_codec_t
 	int me_method;            //lavc motion estimation method
 	int mpeg_quant;           //lavc mpeg quantization
 	int max_b_frames;         //lavc max b frames
-	int num_threads;          //lavc num threads
+	int num_threads;          //lavc num threads (0 - one per core)
 	int flags;                //lavc flags
 	int monotonic_pts;		  //use monotonic pts instead of timestamp based
+	int thread_type;          //lavc thread type (ENCODER_THREAD_*)
+	char preset[16];          //x264/x265 preset (speed level 0)
+	char rt_tune[16];         //realtime tuning (x264/x265 tune; libvpx deadline)
+	int cpu_used;             //libvpx cpu-used (speed level 0)
 } video_codec_t;
 
 /*audio codec properties*/
@@ -155,6 +208,13 @@ typedef struct _encoder_video_context_t
 	uint8_t* outbuf;
 	int outbuf_coded_size;
 
+	/*direct h264 input*/
+	int h264_nal_prefix;     /*muxer needs length prefixed nals*/
+	int outbuf_nal_prefixed; /*outbuf nals are already length prefixed*/
+	int nal_count;           /*nals in the input frame nal table (or 0)*/
+	int *nal_offset;         /*input frame nal table (video ring buffer)*/
+	int *nal_size;
+
 	int64_t framecount;
 
 	int64_t pts;
@@ -192,6 +252,16 @@ typedef struct _encoder_audio_context_t
 } encoder_audio_context_t;
 
 
+/*video encoder threading, speed and bit rate (encoder_init_profile)*/
+typedef struct _encoder_video_profile_t
+{
+	int thread_count; /*encoder threads (0 - codec table default)*/
+	int thread_type;  /*ENCODER_THREAD_* (0 - codec table default)*/
+	int speed;        /*0 - codec table preset; ENCODER_SPEED_MAX - fastest*/
+	int realtime;     /*low latency tuning (x264/x265 tune; libvpx deadline)*/
+	int bit_rate;     /*video bit rate (0 - codec table default)*/
+} encoder_video_profile_t;
+
 typedef struct _encoder_context_t
 {
 	int muxer_id;
@@ -209,6 +279,8 @@ typedef struct _encoder_context_t
 	int audio_channels;
 	int audio_samprate;
 
+	encoder_video_profile_t video_profile; /*threading and speed*/
+
 	encoder_video_context_t *enc_video_ctx;
 	encoder_audio_context_t *enc_audio_ctx;
 
@@ -311,7 +383,9 @@ const char *encoder_get_audio_codec_description(int codec_ind);
  *   video_codec_ind - video codec list index
  *   audio_codec_ind - audio codec list index
  *   muxer_id - file muxer:
- *        ENCODER_MUX_MKV; ENCODER_MUX_WEBM; ENCODER_MUX_AVI
+ *        ENCODER_MUX_MKV; ENCODER_MUX_WEBM; ENCODER_MUX_AVI;
+ *        ENCODER_MUX_Y4M; ENCODER_MUX_YUV (raw sinks: yu12 frames,
+ *        no codec and no audio)
  *   video_width - video frame width
  *   video_height - video frame height
  *   fps_num - fps numerator
@@ -336,6 +410,68 @@ encoder_context_t *encoder_init(
 	int audio_channels,
 	int audio_samprate);
 
+/*
+ * encoder initialization with a video threading/speed profile
+ * args:
+ *   input_format - input v4l2 format (yuyv for encoding)
+ *   video_codec_ind - video codec list index
+ *   audio_codec_ind - audio codec list index
+ *   muxer_id - file muxer:
+ *        ENCODER_MUX_MKV; ENCODER_MUX_WEBM; ENCODER_MUX_AVI;
+ *        ENCODER_MUX_Y4M; ENCODER_MUX_YUV (raw sinks: yu12 frames,
+ *        no codec and no audio)
+ *   video_width - video frame width
+ *   video_height - video frame height
+ *   fps_num - fps numerator
+ *   fps_den - fps denominator
+ *   audio_channels- audio channels
+ *   audio_samprate- audio sample rate
+ *   profile - video encoder profile (if NULL use the codec table defaults)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to encoder context (NULL on error)
+ */
+encoder_context_t *encoder_init_profile(
+	int input_format,
+	int video_codec_ind,
+	int audio_codec_ind,
+	int muxer_id,
+	int video_width,
+	int video_height,
+	int fps_num,
+	int fps_den,
+	int audio_channels,
+	int audio_samprate,
+	const encoder_video_profile_t *profile);
+
+/*
+ * benchmark a video codec at the given resolution and pick the
+ *   speed level and thread count that keep up with the frame rate
+ *   (opens the codec a few times: can take a few seconds, call it
+ *   before recording, e.g. when the codec or resolution changes)
+ * args:
+ *   video_codec_ind - video codec list index
+ *   video_width - video frame width
+ *   video_height - video frame height
+ *   fps_num - fps numerator
+ *   fps_den - fps denominator
+ *   profile - pointer to profile (filled by the function)
+ *
+ * asserts:
+ *   profile is not null
+ *
+ * returns: error code (0 - OK; -1 - codec can't be benchmarked)
+ */
+int encoder_tune_video_profile(
+	int video_codec_ind,
+	int video_width,
+	int video_height,
+	int fps_num,
+	int fps_den,
+	encoder_video_profile_t *profile);
+
 /*
  * initialization of the file muxer
  * args:
@@ -345,9 +481,9 @@ encoder_context_t *encoder_init(
  * asserts:
  *   encoder_ctx is not null
  *
- * returns: none
+ * returns: error code (0 - OK; -1 - couldn't open the output file)
  */
-void encoder_muxer_init(encoder_context_t *encoder_ctx, const char *filename);
+int encoder_muxer_init(encoder_context_t *encoder_ctx, const char *filename);
 
 /*
  * close the file muxer
@@ -563,35 +699,46 @@ void *encoder_get_audio_mkvCodecPriv(int codec_ind);
 int encoder_set_audio_mkvCodecPriv(encoder_context_t *encoder_ctx);
 
 /*
- * get an estimated write loop sleep time to avoid a ring buffer overrun
+ * store unprocessed input video frame in video ring buffer
  * args:
- *   mode: scheduler mode:
- *      0 - linear funtion; 1 - exponencial funtion
- *   thresh: ring buffer threshold in wich scheduler becomes active:
- *      [0.2 (20%) - 0.9 (90%)]
- *   max_time - maximum scheduler time (in ms)
+ *   frame - pointer to unprocessed frame data
+ *   size - frame size (in bytes)
+ *   timestamp - frame timestamp (in nanosec)
+ *   isKeyframe - flag if it's a key(IDR) frame
  *
  * asserts:
  *   none
  *
- * returns: estimate sleep time (milisec)
+ * returns: error code
  */
-double encoder_buff_scheduler(int mode, double thresh, double max_time);
+int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp, int isKeyframe);
 
 /*
- * store unprocessed input video frame in video ring buffer
+ * store an annex-b h264 input frame and its nal table in video ring buffer
+ *   (direct input: the muxer uses the table instead of rescanning the frame)
  * args:
- *   frame - pointer to unprocessed frame data
+ *   frame - pointer to h264 frame data
  *   size - frame size (in bytes)
  *   timestamp - frame timestamp (in nanosec)
  *   isKeyframe - flag if it's a key(IDR) frame
+ *   nal_offset - nal header offsets table
+ *   nal_size - nal sizes table (without start code)
+ *   nal_count - nals in frame (if bigger than ENCODER_MAX_NALS
+ *      the table is dropped)
  *
  * asserts:
  *   none
  *
  * returns: error code
  */
-int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp, int isKeyframe);
+int encoder_add_video_frame_nal(
+	uint8_t *frame,
+	int size,
+	int64_t timestamp,
+	int isKeyframe,
+	const int *nal_offset,
+	const int *nal_size,
+	int nal_count);
 
 /*
  * process next video frame on the ring buffer (encode and mux to file)
@@ -605,6 +752,48 @@ int encoder_add_video_frame(uint8_t *frame, int size, int64_t timestamp, int isK
  */
 int encoder_process_next_video_buffer(encoder_context_t *encoder_ctx);
 
+/*
+ * gets the video encoding stats (stage latencies and drop counters)
+ *   the stats are reset by encoder_init; cheap enough to be polled
+ *   by a monitoring thread while recording
+ * args:
+ *   stats - pointer to stats struct (filled by the function)
+ *
+ * asserts:
+ *   stats is not null
+ *
+ * returns: none
+ */
+void encoder_get_stats(encoder_stats_t *stats);
+
+/*
+ * enable/disable the software encoder quality control: when the encoder
+ *   can't keep up with the frame rate it lowers the bit rate (or raises
+ *   the crf), switches to a faster speed level (libvpx) and, as a last
+ *   resort, skips frames at a regular interval (encoder_get_stats)
+ *   takes effect on the next encoder_init (enabled by default)
+ * args:
+ *   enable - enable (1) or disable (0) the controller
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_set_quality_control(int enable);
+
+/*
+ * resets the video encoding stats
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_reset_stats();
+
 /*
  * process all used video frames from buffer
   * args:
@@ -692,6 +881,19 @@ void encoder_close(encoder_context_t *encoder_ctx);
  */
 int encoder_write_video_data(encoder_context_t *encoder_ctx);
 
+/*
+ * checks if the muxer is a raw sink (ENCODER_MUX_Y4M or ENCODER_MUX_YUV)
+ *   raw sinks take yu12 frames (the caller must convert them)
+ * args:
+ *    muxer_id - file muxer
+ *
+ * asserts:
+ *    none
+ *
+ * returns: 1 true; 0 false
+ */
+int encoder_check_raw_muxer(int muxer_id);
+
 /*
  * mux a audio frame
  * args:
@@ -0,0 +1,281 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  software video encoder quality control (encoder backpressure)                #
+#                                                                               #
+********************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libavutil/opt.h>
+
+#include "core_time.h"
+#include "encoder.h"
+#include "neoguvc.h"
+#include "neoguvcencoder.h"
+
+extern int enc_verbosity;
+
+typedef struct _quality_control_t {
+  int enabled;      /*controller enabled (encoder_set_quality_control)*/
+  int active;       /*software encoder with a controllable codec context*/
+  int level;        /*0 - codec defaults; ENCODER_QC_MAX_LEVEL - cheapest*/
+  int64_t bit_rate; /*codec default bit rate*/
+  double crf;       /*codec default crf (< 0 if not in crf mode)*/
+  int64_t deadline; /*libvpx default deadline (< 0 if not libvpx)*/
+  int skip_frames;  /*frame skipping allowed (timestamp based pts)*/
+  int skip_count;   /*frames since the last skipped one*/
+  uint64_t skipped; /*frames skipped (stats)*/
+  uint64_t frame_ns;  /*frame period (target fps)*/
+  double load;        /*encode time / frame period (moving average)*/
+  double pressure;    /*max(load, ring fill)*/
+  uint64_t high_since;  /*pressure above high threshold since (ns)*/
+  uint64_t low_since;   /*pressure below low threshold since (ns)*/
+  uint64_t last_change; /*last level change (ns)*/
+} quality_control_t;
+
+static quality_control_t qc = {.enabled = 1};
+
+/*
+ * apply the quality level to the codec context
+ *   (only options that libav encoders pick up while encoding)
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void quality_control_apply(encoder_context_t *encoder_ctx) {
+  encoder_codec_data_t *video_codec_data =
+      (encoder_codec_data_t *)encoder_ctx->enc_video_ctx->codec_data;
+  AVCodecContext *avctx = video_codec_data->codec_context;
+
+  /*quality: lower the bit rate (libx264 reconfigures on the next frame)*/
+  if (qc.bit_rate > 0) {
+    double factor = 1.0;
+    int i = 0;
+    for (i = 0; i < qc.level; i++)
+      factor *= ENCODER_QC_BITRATE_FACTOR;
+    avctx->bit_rate = (int64_t)(qc.bit_rate * factor);
+  }
+
+  /*crf mode: raise the crf instead*/
+  if (qc.crf >= 0)
+    av_opt_set_double(avctx->priv_data, "crf",
+                      MIN(qc.crf + qc.level * ENCODER_QC_CRF_STEP, 51), 0);
+
+  /*speed: libvpx takes the deadline on every encode call*/
+  if (qc.deadline >= 0) {
+    if (qc.level >= ENCODER_QC_SPEED_LEVEL)
+      av_opt_set(avctx->priv_data, "deadline", "realtime", 0);
+    else
+      av_opt_set_int(avctx->priv_data, "deadline", qc.deadline, 0);
+  }
+
+  /*restart the frame skip pattern*/
+  qc.skip_count = 0;
+
+  if (enc_verbosity > 0)
+    printf("ENCODER: (quality control) level %i (load %.2f; pressure %.2f)\n",
+           qc.level, qc.load, qc.pressure);
+}
+
+/*
+ * enable/disable the software encoder quality control
+ *   (takes effect on the next encoder_init)
+ * args:
+ *   enable - enable (1) or disable (0) the controller
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void encoder_set_quality_control(int enable) { qc.enabled = enable ? 1 : 0; }
+
+/*
+ * init the quality control for a new video encoder
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *
+ * returns: none
+ */
+void quality_control_init(encoder_context_t *encoder_ctx) {
+  /*assertions*/
+  assert(encoder_ctx != NULL);
+
+  int enabled = qc.enabled;
+  memset(&qc, 0, sizeof(quality_control_t));
+  qc.enabled = enabled;
+
+  encoder_video_context_t *enc_video_ctx = encoder_ctx->enc_video_ctx;
+  if (!qc.enabled || encoder_ctx->video_codec_ind == 0 || !enc_video_ctx ||
+      !enc_video_ctx->codec_data)
+    return;
+
+  encoder_codec_data_t *video_codec_data =
+      (encoder_codec_data_t *)enc_video_ctx->codec_data;
+  AVCodecContext *avctx = video_codec_data->codec_context;
+  if (!avctx)
+    return;
+
+  qc.bit_rate = avctx->bit_rate;
+  if (av_opt_get_double(avctx->priv_data, "crf", 0, &qc.crf) < 0)
+    qc.crf = -1;
+  qc.deadline = -1;
+  if ((avctx->codec_id == AV_CODEC_ID_VP8 ||
+       avctx->codec_id == AV_CODEC_ID_VP9) &&
+      av_opt_get_int(avctx->priv_data, "deadline", 0, &qc.deadline) < 0)
+    qc.deadline = -1;
+
+  /*skipping frames leaves gaps: only with timestamp based pts*/
+  qc.skip_frames = !enc_video_ctx->monotonic_pts;
+
+  if (encoder_ctx->fps_num > 0 && encoder_ctx->fps_den >= 5)
+    qc.frame_ns = NSEC_PER_SEC * encoder_ctx->fps_num / encoder_ctx->fps_den;
+  else
+    qc.frame_ns = NSEC_PER_SEC / 15; /*same fallback as the time base*/
+
+  qc.active = 1;
+}
+
+/*
+ * check if the next frame should be skipped (highest quality levels)
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if the frame should be skipped; 0 otherwise
+ */
+int quality_control_skip_frame() {
+  if (!qc.active || !qc.skip_frames || qc.level < ENCODER_QC_SKIP_LEVEL)
+    return 0;
+
+  /*skip 1 in every (ENCODER_QC_MAX_LEVEL - level + 2) frames*/
+  int interval = ENCODER_QC_MAX_LEVEL - qc.level + 2;
+  if (++qc.skip_count < interval)
+    return 0;
+
+  qc.skip_count = 0;
+  __atomic_add_fetch(&qc.skipped, 1, __ATOMIC_RELAXED);
+  return 1;
+}
+
+/*
+ * feed the quality control with the last frame processing time
+ *   and the ring buffer fill (may change the quality level)
+ * args:
+ *   encoder_ctx - pointer to encoder context
+ *   encode_ns - frame processing time (encode + mux) in ns
+ *   ring_fill - video ring buffer fill (0 - empty; 1 - full)
+ *
+ * asserts:
+ *   encoder_ctx is not null
+ *
+ * returns: none
+ */
+void quality_control_update(encoder_context_t *encoder_ctx, uint64_t encode_ns,
+                            double ring_fill) {
+  /*assertions*/
+  assert(encoder_ctx != NULL);
+
+  if (!qc.active)
+    return;
+
+  uint64_t now = ns_time_monotonic();
+
+  qc.load += ((double)encode_ns / qc.frame_ns - qc.load) / 8;
+  qc.pressure = MAX(qc.load, ring_fill);
+
+  /*between the thresholds (dead band) the level is kept*/
+  if (qc.pressure >= ENCODER_QC_HIGH_PRESSURE) {
+    if (qc.high_since == 0)
+      qc.high_since = now;
+    qc.low_since = 0;
+  } else if (qc.pressure <= ENCODER_QC_LOW_PRESSURE) {
+    if (qc.low_since == 0)
+      qc.low_since = now;
+    qc.high_since = 0;
+  } else {
+    qc.high_since = 0;
+    qc.low_since = 0;
+  }
+
+  if (qc.last_change > 0 && now - qc.last_change < ENCODER_QC_STEP_NS)
+    return;
+
+  int level = qc.level;
+  if (qc.high_since > 0 && now - qc.high_since >= ENCODER_QC_DOWN_HOLD_NS &&
+      qc.level < ENCODER_QC_MAX_LEVEL) {
+    level++;
+    qc.high_since = now; /*the pressure must hold for the next step*/
+  } else if (qc.low_since > 0 && now - qc.low_since >= ENCODER_QC_UP_HOLD_NS &&
+             qc.level > 0) {
+    level--;
+    qc.low_since = now;
+  }
+
+  if (level == qc.level)
+    return;
+
+  qc.level = level;
+  qc.last_change = now;
+  quality_control_apply(encoder_ctx);
+}
+
+/*
+ * get the current quality level
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: quality level (0 - codec defaults)
+ */
+int quality_control_get_level() { return qc.active ? qc.level : 0; }
+
+/*
+ * get the number of frames skipped by the quality control
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: skipped frames
+ */
+uint64_t quality_control_get_skipped() {
+  return __atomic_load_n(&qc.skipped, __ATOMIC_RELAXED);
+}
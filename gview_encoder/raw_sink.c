@@ -0,0 +1,341 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  raw sink: uncompressed yu12 frames (yuv4mpeg2 or headerless planar)          #
+#                                                                               #
+********************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /*sync_file_range*/
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "core_time.h"
+#include "file_io.h"
+#include "neoguvc.h"
+#include "neoguvcencoder.h"
+#include "raw_sink.h"
+
+extern int enc_verbosity;
+
+/*
+ * write the whole buffer (plain write mode)
+ * args:
+ *   fd - file descriptor
+ *   data - pointer to data
+ *   size - data size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 - OK)
+ */
+static int raw_sink_write_all(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+    ssize_t ret = write(fd, data, size);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "ENCODER: (raw sink) write failed: %s\n",
+              strerror(errno));
+      return -1;
+    }
+    data += ret;
+    size -= ret;
+  }
+  return 0;
+}
+
+/*
+ * map the next output window at the write position
+ *   (extends the file and pre-faults the pages)
+ * args:
+ *   sink - pointer to raw sink
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 - OK)
+ */
+static int raw_sink_map_window(raw_sink_t *sink) {
+  /*the write position is always at a window boundary here*/
+  sink->map_offset = sink->position;
+
+  if (ftruncate(sink->fd, sink->map_offset + RAW_SINK_WINDOW) < 0) {
+    fprintf(stderr, "ENCODER: (raw sink) couldn't extend the output: %s\n",
+            strerror(errno));
+    return -1;
+  }
+
+  void *map = mmap(NULL, RAW_SINK_WINDOW, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, sink->fd, sink->map_offset);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "ENCODER: (raw sink) mmap failed: %s\n", strerror(errno));
+    return -1;
+  }
+
+  sink->map = map;
+  return 0;
+}
+
+/*
+ * unmap a full output window and hand it to writeback
+ *   (waits for the previous window and drops it from the page cache,
+ *    so dirty pages stay bounded to two windows)
+ * args:
+ *   sink - pointer to raw sink
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void raw_sink_unmap_window(raw_sink_t *sink) {
+  if (sink->map == NULL)
+    return;
+
+  munmap(sink->map, RAW_SINK_WINDOW);
+  sink->map = NULL;
+
+  sync_file_range(sink->fd, sink->map_offset, RAW_SINK_WINDOW,
+                  SYNC_FILE_RANGE_WRITE);
+
+  if (sink->map_offset >= RAW_SINK_WINDOW) {
+    off_t prev = sink->map_offset - RAW_SINK_WINDOW;
+    sync_file_range(sink->fd, prev, RAW_SINK_WINDOW,
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                        SYNC_FILE_RANGE_WAIT_AFTER);
+    posix_fadvise(sink->fd, prev, RAW_SINK_WINDOW, POSIX_FADV_DONTNEED);
+  }
+}
+
+/*
+ * append data to the output
+ * args:
+ *   sink - pointer to raw sink
+ *   data - pointer to data
+ *   size - data size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 - OK)
+ */
+static int raw_sink_put(raw_sink_t *sink, const uint8_t *data, size_t size) {
+  while (sink->use_mmap && size > 0) {
+    if (sink->map == NULL && raw_sink_map_window(sink) != 0) {
+      /*fall back to plain writes from the current position*/
+      fprintf(stderr, "ENCODER: (raw sink) falling back to write()\n");
+      sink->use_mmap = 0;
+      if (ftruncate(sink->fd, sink->position) < 0 ||
+          lseek(sink->fd, sink->position, SEEK_SET) < 0)
+        return -1;
+      break;
+    }
+
+    size_t room = (size_t)(sink->map_offset + RAW_SINK_WINDOW - sink->position);
+    size_t n = MIN(room, size);
+    memcpy(sink->map + (sink->position - sink->map_offset), data, n);
+    sink->position += n;
+    data += n;
+    size -= n;
+
+    if (sink->position == sink->map_offset + RAW_SINK_WINDOW)
+      raw_sink_unmap_window(sink);
+  }
+
+  if (size == 0)
+    return 0;
+
+  if (raw_sink_write_all(sink->fd, data, size) != 0)
+    return -1;
+  sink->position += size;
+  return 0;
+}
+
+/*
+ * create a raw (uncompressed yu12) sink
+ * args:
+ *   filename - output file (a regular file is mmap'd; fifos are written)
+ *   mode - ENCODER_MUX_Y4M (yuv4mpeg2) or ENCODER_MUX_YUV (headerless)
+ *   width - frame width
+ *   height - frame height
+ *   rate_num - frame rate numerator
+ *   rate_den - frame rate denominator
+ *
+ * asserts:
+ *   filename is not null
+ *
+ * returns: pointer to raw sink (NULL on error)
+ */
+raw_sink_t *raw_sink_create(const char *filename, int mode, int width,
+                            int height, int rate_num, int rate_den) {
+  /*assertions*/
+  assert(filename != NULL);
+
+  raw_sink_t *sink = calloc(1, sizeof(raw_sink_t));
+  if (sink == NULL) {
+    fprintf(stderr,
+            "ENCODER: FATAL memory allocation failure (raw_sink_create): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  sink->mode = mode;
+  sink->width = width;
+  sink->height = height;
+
+  /*downstream tools may hand us a fifo: write it in order, no mmap*/
+  struct stat st;
+  if (stat(filename, &st) == 0 && !S_ISREG(st.st_mode)) {
+    sink->fd = open(filename, O_WRONLY);
+    sink->use_mmap = 0;
+  } else {
+    sink->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    sink->use_mmap = 1;
+  }
+
+  if (sink->fd < 0) {
+    fprintf(stderr, "ENCODER: (raw sink) couldn't open %s: %s\n", filename,
+            strerror(errno));
+    free(sink);
+    return NULL;
+  }
+
+  /*timestamp sidecar: frame number, data offset and pts (ns)*/
+  char *index_name = calloc(strlen(filename) + 5, sizeof(char));
+  if (index_name == NULL) {
+    fprintf(stderr,
+            "ENCODER: FATAL memory allocation failure (raw_sink_create): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+  sprintf(index_name, "%s.idx", filename);
+  sink->index = fopen(index_name, "w");
+  if (sink->index == NULL)
+    fprintf(stderr, "ENCODER: (raw sink) couldn't open %s: %s\n", index_name,
+            strerror(errno));
+  else
+    fprintf(sink->index, "# yu12 %ix%i %i/%i fps\n# frame offset pts_ns\n",
+            width, height, rate_num, rate_den);
+  free(index_name);
+
+  if (mode == ENCODER_MUX_Y4M) {
+    char header[128];
+    int len = snprintf(header, sizeof(header),
+                       "YUV4MPEG2 W%i H%i F%i:%i Ip A1:1 C420jpeg\n", width,
+                       height, rate_num, rate_den);
+    raw_sink_put(sink, (uint8_t *)header, len);
+  }
+
+  if (enc_verbosity > 0)
+    printf("ENCODER: (raw sink) %s %ix%i (%s)\n", filename, width, height,
+           sink->use_mmap ? "mmap" : "write");
+
+  return sink;
+}
+
+/*
+ * write a yu12 frame and its index entry
+ * args:
+ *   sink - pointer to raw sink
+ *   frame - pointer to yu12 frame data
+ *   size - frame size
+ *   pts - frame timestamp (in nanosec)
+ *
+ * asserts:
+ *   sink is not null
+ *   frame is not null
+ *
+ * returns: error code (0 - OK)
+ */
+int raw_sink_write_frame(raw_sink_t *sink, uint8_t *frame, int size,
+                         int64_t pts) {
+  /*assertions*/
+  assert(sink != NULL);
+  assert(frame != NULL);
+
+  uint64_t start = ns_time_monotonic();
+  int64_t begin = sink->position;
+
+  if (sink->mode == ENCODER_MUX_Y4M &&
+      raw_sink_put(sink, (const uint8_t *)"FRAME\n", 6) != 0)
+    return -1;
+
+  int64_t offset = sink->position;
+  if (raw_sink_put(sink, frame, size) != 0)
+    return -1;
+
+  io_add_write_stats(sink->position - begin, ns_time_monotonic() - start);
+
+  if (sink->index)
+    fprintf(sink->index, "%" PRId64 " %" PRId64 " %" PRId64 "\n",
+            sink->frames, offset, pts);
+  sink->frames++;
+
+  return 0;
+}
+
+/*
+ * close the raw sink (trims the output to the data written)
+ * args:
+ *   sink - pointer to raw sink
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void raw_sink_close(raw_sink_t *sink) {
+  if (sink == NULL)
+    return;
+
+  if (sink->map != NULL) {
+    munmap(sink->map, RAW_SINK_WINDOW);
+    sink->map = NULL;
+  }
+  /*drop the unused tail of the last window*/
+  if (sink->use_mmap && ftruncate(sink->fd, sink->position) < 0)
+    fprintf(stderr, "ENCODER: (raw sink) couldn't trim the output: %s\n",
+            strerror(errno));
+  close(sink->fd);
+
+  if (sink->index)
+    fclose(sink->index);
+
+  if (enc_verbosity > 0)
+    printf("ENCODER: (raw sink) %" PRId64 " frames, %" PRId64 " bytes\n",
+           sink->frames, sink->position);
+
+  free(sink);
+}
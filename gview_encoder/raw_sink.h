@@ -0,0 +1,93 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+#ifndef RAW_SINK_H
+#define RAW_SINK_H
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/*mmap window size (a multiple of the page size)*/
+#define RAW_SINK_WINDOW (64 * 1024 * 1024)
+
+typedef struct _raw_sink_t
+{
+	int mode;           /*ENCODER_MUX_Y4M or ENCODER_MUX_YUV*/
+	int fd;             /*output file descriptor*/
+	FILE *index;        /*timestamp sidecar (<filename>.idx)*/
+	int use_mmap;       /*0 - plain write() (pipes, fifos or mmap failure)*/
+	uint8_t *map;       /*mapped output window (NULL if none)*/
+	int64_t map_offset; /*file offset of the mapped window*/
+	int64_t position;   /*write position (output size)*/
+	int64_t frames;     /*frames written*/
+	int width;
+	int height;
+} raw_sink_t;
+
+/*
+ * create a raw (uncompressed yu12) sink
+ * args:
+ *   filename - output file (a regular file is mmap'd; fifos are written)
+ *   mode - ENCODER_MUX_Y4M (yuv4mpeg2) or ENCODER_MUX_YUV (headerless)
+ *   width - frame width
+ *   height - frame height
+ *   rate_num - frame rate numerator
+ *   rate_den - frame rate denominator
+ *
+ * asserts:
+ *   filename is not null
+ *
+ * returns: pointer to raw sink (NULL on error)
+ */
+raw_sink_t *raw_sink_create(const char *filename, int mode, int width,
+                            int height, int rate_num, int rate_den);
+
+/*
+ * write a yu12 frame and its index entry
+ * args:
+ *   sink - pointer to raw sink
+ *   frame - pointer to yu12 frame data
+ *   size - frame size
+ *   pts - frame timestamp (in nanosec)
+ *
+ * asserts:
+ *   sink is not null
+ *   frame is not null
+ *
+ * returns: error code (0 - OK)
+ */
+int raw_sink_write_frame(raw_sink_t *sink, uint8_t *frame, int size,
+                         int64_t pts);
+
+/*
+ * close the raw sink (trims the output to the data written)
+ * args:
+ *   sink - pointer to raw sink
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void raw_sink_close(raw_sink_t *sink);
+
+#endif
@@ -31,6 +31,8 @@
 #include <libintl.h>
 #include <locale.h>
 
+#include <libavutil/opt.h>
+
 #include "encoder.h"
 #include "neoguvc.h"
 #include "neoguvcencoder.h"
@@ -57,6 +59,17 @@ static bmp_info_header_t mkv_codecPriv = {
     .biClrImportant = 0};
 
 /*list of software supported formats*/
+/*x264/x265 presets (fastest first)*/
+static const char *x26x_presets[] = {"ultrafast", "superfast", "veryfast",
+                                     "faster",    "fast",      "medium",
+                                     "slow",      "slower",    "veryslow",
+                                     NULL};
+
+/*ffv1 slice counts (v3 needs a grid of at least 2x2)*/
+static const int ffv1_slices[] = {4, 6, 9, 12, 16, 24, 30, 0};
+/*speed level that trades the range coder for golomb-rice*/
+#define FFV1_RICE_SPEED (3)
+
 static video_codec_t listSupCodecs[] = {
     /*
      * Raw camera input (yuvy or mjpg or H264)
@@ -368,7 +381,10 @@ static video_codec_t listSupCodecs[] = {
      .me_method = X264_ME_HEX,
      .mpeg_quant = 1,
      .max_b_frames = 16,
-     .num_threads = 4,
+     .num_threads = 0, /*one per core*/
+     .thread_type = ENCODER_THREAD_FRAME,
+     .preset = "faster",
+     .rt_tune = "zerolatency",
 #if LIBAVCODEC_VER_AT_LEAST(54, 01)
      .flags = CODEC_FLAG2_INTRA_REFRESH
 #else
@@ -409,7 +425,10 @@ static video_codec_t listSupCodecs[] = {
      .me_method = 0,
      .mpeg_quant = 1,
      .max_b_frames = 4,
-     .num_threads = 4,
+     .num_threads = 0, /*one per core*/
+     .thread_type = ENCODER_THREAD_FRAME,
+     .preset = "medium",
+     .rt_tune = "zerolatency",
      .flags = CODEC_FLAG2_INTRA_REFRESH},
 #endif
     {.valid = 1,
@@ -444,7 +463,9 @@ static video_codec_t listSupCodecs[] = {
      .me_method = 0,
      .mpeg_quant = 1,
      .max_b_frames = 0,
-     .num_threads = 4,
+     .num_threads = 0, /*one per core*/
+     .rt_tune = "realtime",
+     .cpu_used = 10,
      .flags = 0},
 #if LIBAVCODEC_VER_AT_LEAST(54, 42)
     {.valid = 1,
@@ -479,7 +500,9 @@ static video_codec_t listSupCodecs[] = {
      .me_method = 0,
      .mpeg_quant = 1,
      .max_b_frames = 16,
-     .num_threads = 4,
+     .num_threads = 0, /*one per core*/
+     .rt_tune = "realtime",
+     .cpu_used = 8,
      .flags = 0},
 #endif
     {.valid = 1,
@@ -515,6 +538,45 @@ static video_codec_t listSupCodecs[] = {
      .mpeg_quant = 1,
      .max_b_frames = 0,
      .num_threads = 4,
+     .flags = 0},
+    /*
+     * lossless archival: ffv1 version 3 (slices + slice crc),
+     *  intra only and fed straight from the yu12 ring buffer
+     */
+    {.valid = 1,
+     .compressor = "FFV1",
+     .mkv_4cc = v4l2_fourcc('F', 'F', 'V', '1'),
+     .mkv_codec = "V_FFV1",
+     .mkv_codecPriv = NULL,
+     .description = N_("FFV1 - lossless (archival)"),
+     .pix_fmt = AV_PIX_FMT_YUV420P,
+     .fps = 0,
+     .monotonic_pts = 0,
+     .bit_rate = 0,
+     .qmax = 0,
+     .qmin = 0,
+     .max_qdiff = 0,
+     .dia = 0,
+     .pre_dia = 0,
+     .pre_me = 0,
+     .me_pre_cmp = 0,
+     .me_cmp = 0,
+     .me_sub_cmp = 0,
+     .last_pred = 0,
+     .gop_size = 1, /*every frame is a keyframe*/
+     .qcompress = 0,
+     .qblur = 0,
+     .subq = 0,
+     .framerefs = 0,
+     .codec_id = AV_CODEC_ID_FFV1,
+     .codec_name = "ffv1",
+     .mb_decision = 0,
+     .trellis = 0,
+     .me_method = 0,
+     .mpeg_quant = 0,
+     .max_b_frames = 0,
+     .num_threads = 0, /*one per core*/
+     .thread_type = ENCODER_THREAD_SLICE,
      .flags = 0}};
 
 /*
@@ -802,6 +864,27 @@ int encoder_set_video_mkvCodecPriv(encoder_context_t *encoder_ctx) {
       tmp += header_len[i];
     }
 
+    listSupCodecs[real_index].mkv_codecPriv =
+        encoder_ctx->enc_video_ctx->priv_data;
+  } else if (codec_id == AV_CODEC_ID_FFV1) {
+    /*version 3 configuration record (libav extradata)*/
+    size = video_codec_data->codec_context->extradata_size;
+    if (size <= 0 || video_codec_data->codec_context->extradata == NULL) {
+      fprintf(stderr, "ENCODER: (ffv1 codec) - no extradata.\n");
+      return 0;
+    }
+
+    encoder_ctx->enc_video_ctx->priv_data = calloc(size, sizeof(uint8_t));
+    if (encoder_ctx->enc_video_ctx->priv_data == NULL) {
+      fprintf(stderr,
+              "ENCODER: FATAL memory allocation failure "
+              "(encoder_set_video_mkvCodecPriv): %s\n",
+              strerror(errno));
+      exit(-1);
+    }
+    memcpy(encoder_ctx->enc_video_ctx->priv_data,
+           video_codec_data->codec_context->extradata, size);
+
     listSupCodecs[real_index].mkv_codecPriv =
         encoder_ctx->enc_video_ctx->priv_data;
   } else if (listSupCodecs[real_index].mkv_codecPriv != NULL) {
@@ -1035,3 +1118,103 @@ int encoder_get_video_codec_ind_4cc(const char *codec_4cc) {
 
   return -1;
 }
+
+/*
+ * apply the threading, speed and bit rate profile to a video codec context
+ *   (before opening the codec)
+ * args:
+ *   avctx - pointer to codec context
+ *   video_defaults - pointer to the codec table entry
+ *   profile - pointer to profile (zero fields use the codec table defaults)
+ *
+ * asserts:
+ *   avctx is not null
+ *   video_defaults is not null
+ *   profile is not null
+ *
+ * returns: none
+ */
+void encoder_apply_video_profile(AVCodecContext *avctx,
+                                 video_codec_t *video_defaults,
+                                 const encoder_video_profile_t *profile) {
+  /*assertions*/
+  assert(avctx != NULL);
+  assert(video_defaults != NULL);
+  assert(profile != NULL);
+
+  int thread_count = profile->thread_count > 0 ? profile->thread_count
+                                               : video_defaults->num_threads;
+  int thread_type = profile->thread_type > 0 ? profile->thread_type
+                                             : video_defaults->thread_type;
+  int speed = profile->speed;
+  if (speed < 0)
+    speed = 0;
+  if (speed > ENCODER_SPEED_MAX)
+    speed = ENCODER_SPEED_MAX;
+
+  if (profile->bit_rate > 0)
+    avctx->bit_rate = profile->bit_rate;
+
+  /*0 - libav picks one thread per core*/
+  avctx->thread_count = thread_count > 0 ? thread_count : 0;
+  if (thread_type > 0)
+    avctx->thread_type = thread_type;
+
+  switch (video_defaults->codec_id) {
+  case AV_CODEC_ID_H264:
+  case AV_CODEC_ID_HEVC: {
+    if (video_defaults->preset[0] != '\0') {
+      int i = 0;
+      while (x26x_presets[i] &&
+             strcmp(x26x_presets[i], video_defaults->preset) != 0)
+        i++;
+      /*each speed level is one preset faster*/
+      const char *preset = x26x_presets[i]
+                               ? x26x_presets[MAX(i - speed, 0)]
+                               : video_defaults->preset;
+      av_opt_set(avctx->priv_data, "preset", preset, 0);
+    }
+    if (profile->realtime && video_defaults->rt_tune[0] != '\0')
+      av_opt_set(avctx->priv_data, "tune", video_defaults->rt_tune, 0);
+  } break;
+
+  case AV_CODEC_ID_VP8:
+  case AV_CODEC_ID_VP9: {
+    const char *deadline = "good";
+    if (profile->realtime && video_defaults->rt_tune[0] != '\0')
+      deadline = video_defaults->rt_tune;
+    av_opt_set(avctx->priv_data, "deadline", deadline, 0);
+
+    /*cpu-used: VP8 up to 16; VP9 up to 9*/
+    int max_cpu_used = video_defaults->codec_id == AV_CODEC_ID_VP8 ? 16 : 9;
+    int cpu_used = MIN(video_defaults->cpu_used + speed, max_cpu_used);
+    av_opt_set_int(avctx->priv_data, "cpu-used", cpu_used, 0);
+  } break;
+
+  case AV_CODEC_ID_FFV1: {
+    /*version 3: slice threads, each slice protected by a crc*/
+    av_opt_set_int(avctx, "level", 3, 0);
+    int cores = thread_count > 0 ? thread_count
+                                 : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 0;
+    /*at least one slice per thread*/
+    while (ffv1_slices[i + 1] > 0 && ffv1_slices[i] < cores)
+      i++;
+    av_opt_set_int(avctx, "slices", ffv1_slices[i], 0);
+    av_opt_set_int(avctx->priv_data, "slicecrc", 1, 0);
+    /*small context model (faster adaptation, less state per slice)*/
+    av_opt_set_int(avctx->priv_data, "context", 0, 0);
+    /*range coder with the default state table (no custom table pass)*/
+    av_opt_set(avctx->priv_data, "coder",
+               speed >= FFV1_RICE_SPEED ? "rice" : "range_def", 0);
+  } break;
+
+  default:
+    break;
+  }
+
+  if (enc_verbosity > 0)
+    printf("ENCODER: %s threads %i (type %i) speed %i%s\n",
+           video_defaults->codec_name, avctx->thread_count, avctx->thread_type,
+           speed, profile->realtime ? " (realtime)" : "");
+}
@@ -0,0 +1,311 @@
+/*******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net               #
+#                                                                               #
+#           Paulo Assis <pj.assis@gmail.com>                                    #
+#                                                                               #
+# This program is free software; you can redistribute it and/or modify          #
+# it under the terms of the GNU General Public License as published by          #
+# the Free Software Foundation; either version 2 of the License, or             #
+# (at your option) any later version.                                           #
+#                                                                               #
+# This program is distributed in the hope that it will be useful,               #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of                #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                 #
+# GNU General Public License for more details.                                  #
+#                                                                               #
+# You should have received a copy of the GNU General Public License             #
+# along with this program; if not, write to the Free Software                   #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     #
+#                                                                               #
+********************************************************************************/
+
+/*******************************************************************************#
+#                                                                               #
+#  video encoder auto-tuner (speed level and thread count)                      #
+#                                                                               #
+********************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core_time.h"
+#include "encoder.h"
+#include "neoguvc.h"
+#include "neoguvcencoder.h"
+
+extern int enc_verbosity;
+
+#define TUNE_FRAMES (24)       /*frames encoded per benchmark*/
+#define TUNE_MAX_THREADS (16)  /*libav auto threading caps at 16*/
+#define TUNE_LOAD (0.7)        /*keep encoding under 70% of the frame period*/
+
+/*
+ * fill a yu12 frame with a moving noisy gradient
+ *   (flat frames make most encoders look much faster than with real video)
+ * args:
+ *   frame - pointer to libav frame (yuv420p)
+ *   index - frame index (pattern motion)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void tune_fill_frame(AVFrame *frame, int index) {
+  uint32_t seed = 0x9e3779b9u * (index + 1);
+  int x = 0;
+  int y = 0;
+
+  for (y = 0; y < frame->height; y++) {
+    uint8_t *line = frame->data[0] + y * frame->linesize[0];
+    for (x = 0; x < frame->width; x++) {
+      seed = seed * 1664525u + 1013904223u;
+      line[x] = (uint8_t)(x + 2 * y + 4 * index + (seed >> 28));
+    }
+  }
+
+  for (y = 0; y < frame->height / 2; y++) {
+    uint8_t *u = frame->data[1] + y * frame->linesize[1];
+    uint8_t *v = frame->data[2] + y * frame->linesize[2];
+    for (x = 0; x < frame->width / 2; x++) {
+      u[x] = (uint8_t)(128 + ((x - index) & 0x3f));
+      v[x] = (uint8_t)(128 + ((y + index) & 0x3f));
+    }
+  }
+}
+
+/*
+ * set and open the codec context (same settings as encoder_video_init)
+ *   and allocate the frame buffers
+ * args:
+ *   avctx - pointer to codec context
+ *   codec - pointer to codec
+ *   frame - pointer to libav frame
+ *   video_defaults - pointer to the codec table entry
+ *   width - frame width
+ *   height - frame height
+ *   time_base - codec time base
+ *   profile - pointer to profile
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 - OK)
+ */
+static int tune_open_codec(AVCodecContext *avctx, const AVCodec *codec,
+                           AVFrame *frame, video_codec_t *video_defaults,
+                           int width, int height, AVRational time_base,
+                           const encoder_video_profile_t *profile) {
+  avctx->bit_rate = video_defaults->bit_rate;
+  avctx->width = width;
+  avctx->height = height;
+  avctx->flags |= video_defaults->flags;
+  avctx->max_b_frames = video_defaults->max_b_frames;
+  avctx->codec_id = video_defaults->codec_id;
+  avctx->codec_type = AVMEDIA_TYPE_VIDEO;
+  avctx->pix_fmt = video_defaults->pix_fmt;
+  avctx->time_base = time_base;
+  avctx->gop_size = video_defaults->gop_size > 0 ? video_defaults->gop_size
+                                                 : time_base.den;
+  encoder_apply_video_profile(avctx, video_defaults, profile);
+
+  if (avcodec_open2(avctx, codec, NULL) < 0) {
+    fprintf(stderr, "ENCODER: (tune) could not open video codec (%s)\n",
+            video_defaults->codec_name);
+    return -1;
+  }
+
+  frame->format = avctx->pix_fmt;
+  frame->width = width;
+  frame->height = height;
+  if (av_frame_get_buffer(frame, 0) < 0) {
+    fprintf(stderr, "ENCODER: (tune) av_frame_get_buffer failure\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+ * encode TUNE_FRAMES synthetic frames (and flush the encoder)
+ * args:
+ *   avctx - pointer to an open codec context
+ *   frame - pointer to libav frame (with buffers)
+ *   pkt - pointer to libav packet
+ *
+ * asserts:
+ *   none
+ *
+ * returns: mean encoding time per frame in ns (0 on error)
+ */
+static uint64_t tune_encode_frames(AVCodecContext *avctx, AVFrame *frame,
+                                   AVPacket *pkt) {
+  uint64_t start = ns_time_monotonic();
+
+  int i = 0;
+  for (i = 0; i <= TUNE_FRAMES; i++) {
+    int ret = 0;
+    if (i < TUNE_FRAMES) {
+      if (av_frame_make_writable(frame) < 0)
+        return 0;
+      tune_fill_frame(frame, i);
+      frame->pts = i;
+      ret = avcodec_send_frame(avctx, frame);
+    } else /*flush: frame threads and lookahead hold frames back*/
+      ret = avcodec_send_frame(avctx, NULL);
+
+    if (ret < 0)
+      return 0;
+
+    while (avcodec_receive_packet(avctx, pkt) == 0)
+      av_packet_unref(pkt);
+  }
+
+  return (ns_time_monotonic() - start) / TUNE_FRAMES;
+}
+
+/*
+ * benchmark the codec with the given profile
+ * args:
+ *   video_defaults - pointer to the codec table entry
+ *   width - frame width
+ *   height - frame height
+ *   time_base - codec time base
+ *   profile - pointer to profile
+ *
+ * asserts:
+ *   none
+ *
+ * returns: mean encoding time per frame in ns (0 on error)
+ */
+static uint64_t tune_encode_ns(video_codec_t *video_defaults, int width,
+                               int height, AVRational time_base,
+                               const encoder_video_profile_t *profile) {
+  const AVCodec *codec =
+      avcodec_find_encoder_by_name(video_defaults->codec_name);
+  if (!codec)
+    codec = avcodec_find_encoder(video_defaults->codec_id);
+  if (!codec)
+    return 0;
+
+  AVCodecContext *avctx = avcodec_alloc_context3(codec);
+  AVFrame *frame = av_frame_alloc();
+  AVPacket *pkt = av_packet_alloc();
+  uint64_t encode_ns = 0;
+
+  if (!avctx || !frame || !pkt)
+    fprintf(stderr, "ENCODER: (tune) libav allocation failure\n");
+  else if (tune_open_codec(avctx, codec, frame, video_defaults, width, height,
+                           time_base, profile) == 0)
+    encode_ns = tune_encode_frames(avctx, frame, pkt);
+
+  av_packet_free(&pkt);
+  av_frame_free(&frame);
+  avcodec_free_context(&avctx);
+
+  return encode_ns;
+}
+
+/*
+ * benchmark a video codec at the given resolution and pick the
+ *   speed level and thread count that keep up with the frame rate
+ * args:
+ *   video_codec_ind - video codec list index
+ *   video_width - video frame width
+ *   video_height - video frame height
+ *   fps_num - fps numerator
+ *   fps_den - fps denominator
+ *   profile - pointer to profile (filled by the function)
+ *
+ * asserts:
+ *   profile is not null
+ *
+ * returns: error code (0 - OK; -1 - codec can't be benchmarked)
+ */
+int encoder_tune_video_profile(int video_codec_ind, int video_width,
+                               int video_height, int fps_num, int fps_den,
+                               encoder_video_profile_t *profile) {
+  /*assertions*/
+  assert(profile != NULL);
+
+  memset(profile, 0, sizeof(encoder_video_profile_t));
+
+  if (video_codec_ind <= 0) /*raw: nothing to tune*/
+    return -1;
+
+  video_codec_t *video_defaults =
+      encoder_get_video_codec_defaults(video_codec_ind);
+  if (!video_defaults || !video_defaults->valid)
+    return -1;
+
+  /*same time base as encoder_video_init*/
+  AVRational time_base = {1, 15};
+  if (video_defaults->fps)
+    time_base = (AVRational){1, video_defaults->fps};
+  else if (fps_den >= 5)
+    time_base = (AVRational){fps_num, fps_den};
+
+  uint64_t budget_ns =
+      (uint64_t)(TUNE_LOAD * NSEC_PER_SEC * time_base.num / time_base.den);
+
+  int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  cores = MAX(MIN(cores, TUNE_MAX_THREADS), 1);
+
+  /*slowest speed level (best quality) that keeps up using all cores*/
+  profile->thread_count = cores;
+  uint64_t encode_ns = 0;
+  for (profile->speed = 0; profile->speed <= ENCODER_SPEED_MAX;
+       profile->speed++) {
+    encode_ns = tune_encode_ns(video_defaults, video_width, video_height,
+                               time_base, profile);
+    if (encode_ns == 0) {
+      memset(profile, 0, sizeof(encoder_video_profile_t));
+      return -1;
+    }
+
+    if (enc_verbosity > 0)
+      printf("ENCODER: (tune) %s speed %i threads %i: %" PRIu64 " us/frame "
+             "(budget %" PRIu64 " us)\n",
+             video_defaults->codec_name, profile->speed,
+             profile->thread_count, encode_ns / 1000, budget_ns / 1000);
+
+    if (encode_ns <= budget_ns)
+      break;
+  }
+
+  if (profile->speed > ENCODER_SPEED_MAX) {
+    /*can't keep up: fastest level, the quality control does the rest*/
+    profile->speed = ENCODER_SPEED_MAX;
+    return 0;
+  }
+
+  /*fewest threads that still keep up (leave cores to capture and decode)*/
+  int threads = cores / 2;
+  while (threads >= 1) {
+    encoder_video_profile_t test = *profile;
+    test.thread_count = threads;
+    encode_ns = tune_encode_ns(video_defaults, video_width, video_height,
+                               time_base, &test);
+
+    if (enc_verbosity > 0)
+      printf("ENCODER: (tune) %s speed %i threads %i: %" PRIu64 " us/frame\n",
+             video_defaults->codec_name, test.speed, threads,
+             encode_ns / 1000);
+
+    if (encode_ns == 0 || encode_ns > budget_ns)
+      break;
+
+    profile->thread_count = threads;
+    threads /= 2;
+  }
+
+  if (enc_verbosity > 0)
+    printf("ENCODER: (tune) %s: speed %i threads %i\n",
+           video_defaults->codec_name, profile->speed, profile->thread_count);
+
+  return 0;
+}
@@ -0,0 +1,596 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  V4L2 multi device capture engine (epoll)                                    #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "core_time.h"
+#include "neoguvc.h"
+#include "neoguvc_v4l2core.h"
+#include "v4l2_core.h"
+
+#define ENGINE_MAX_EVENTS (16)
+/*retry period for devices in error state (stream stopped, no queued buffers)*/
+#define ENGINE_STALL_RETRY_MS (100)
+
+#define __PMUTEX &(engine->mutex)
+
+extern int verbosity;
+
+typedef struct _engine_device_t {
+  v4l2_dev_t *vd;
+  v4l2_frame_cb_t frame_cb;
+  v4l2_event_cb_t event_cb;
+  void *data;
+
+  uint8_t busy;      // a dispatch thread is handling the device
+  uint8_t removed;   // removed while running (freed when the threads stop)
+  uint8_t stalled;   // device reported an error (rearmed periodically)
+  uint64_t stall_ts; // time the device stalled (ns, monotonic)
+
+  struct _engine_device_t *next;
+} engine_device_t;
+
+struct _v4l2_capture_engine_t {
+  int epfd;   // epoll file descriptor
+  int stopfd; // eventfd used to wake the dispatch threads on stop
+
+  int nthreads;           // number of dispatch threads
+  __THREAD_TYPE *threads; // dispatch threads
+  int running;            // number of running dispatch threads
+  int stalled;            // number of stalled devices
+
+  __MUTEX_TYPE mutex;       // protects the device lists
+  engine_device_t *devices; // device list
+  engine_device_t *removed; // devices removed while the threads run
+                            // (a pending epoll batch may still hold them)
+};
+
+/*
+ * (re)arms the device in the epoll set
+ *   the device is disarmed after each notification (EPOLLONESHOT)
+ *   so that only one thread handles it at a time
+ *   control events are not watched while flagged as pending (the
+ *   owner of the controls hasn't dequeued them yet)
+ * args:
+ *   engine - pointer to capture engine
+ *   dev - pointer to engine device
+ *   op - EPOLL_CTL_ADD or EPOLL_CTL_MOD
+ *
+ * asserts:
+ *   none
+ *
+ * returns: epoll_ctl result
+ */
+static int arm_device(v4l2_capture_engine_t *engine, engine_device_t *dev,
+                      int op) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(struct epoll_event));
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  if (!__atomic_load_n(&dev->vd->ctrl_events_pending, __ATOMIC_ACQUIRE))
+    ev.events |= EPOLLPRI;
+  ev.data.ptr = dev;
+
+  int ret = epoll_ctl(engine->epfd, op, dev->vd->fd, &ev);
+  if (ret < 0)
+    fprintf(stderr, "V4L2_CORE: (capture engine) epoll_ctl error: %s\n",
+            strerror(errno));
+
+  return ret;
+}
+
+/*
+ * rearms the devices stalled for at least ENGINE_STALL_RETRY_MS
+ *   (engine mutex must be locked)
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void rearm_stalled_devices(v4l2_capture_engine_t *engine) {
+  uint64_t now = ns_time_monotonic();
+  uint64_t retry = (uint64_t)ENGINE_STALL_RETRY_MS * 1000000;
+
+  engine_device_t *dev = engine->devices;
+  for (; dev != NULL; dev = dev->next) {
+    if (!dev->stalled || dev->busy || now - dev->stall_ts < retry)
+      continue;
+
+    dev->stalled = 0;
+    engine->stalled--;
+    arm_device(engine, dev, EPOLL_CTL_MOD);
+  }
+}
+
+/*
+ * unlinks the device from the engine list (engine mutex must be locked)
+ * args:
+ *   engine - pointer to capture engine
+ *   dev - pointer to engine device
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void unlink_device(v4l2_capture_engine_t *engine,
+                          engine_device_t *dev) {
+  engine_device_t **pdev = &engine->devices;
+  while (*pdev != NULL && *pdev != dev)
+    pdev = &(*pdev)->next;
+
+  if (*pdev != NULL)
+    *pdev = dev->next;
+
+  if (dev->stalled)
+    engine->stalled--;
+}
+
+/*
+ * frees the devices removed while the dispatch threads were running
+ *   (no dispatch thread may be running)
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void free_removed_devices(v4l2_capture_engine_t *engine) {
+  __LOCK_MUTEX(__PMUTEX);
+  engine_device_t *dev = engine->removed;
+  engine->removed = NULL;
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  while (dev != NULL) {
+    engine_device_t *next = dev->next;
+    free(dev);
+    dev = next;
+  }
+}
+
+/*
+ * handles the epoll notification of a device
+ * args:
+ *   engine - pointer to capture engine
+ *   dev - pointer to engine device
+ *   events - epoll event flags
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void handle_device(v4l2_capture_engine_t *engine, engine_device_t *dev,
+                          uint32_t events) {
+  __LOCK_MUTEX(__PMUTEX);
+  if (dev->removed) {
+    __UNLOCK_MUTEX(__PMUTEX);
+    return;
+  }
+  dev->busy = 1;
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  int stalled = 0;
+
+  /*the events are dequeued by the thread that owns the controls*/
+  if (events & EPOLLPRI) {
+    __atomic_store_n(&dev->vd->ctrl_events_pending, 1, __ATOMIC_RELEASE);
+    if (dev->event_cb)
+      dev->event_cb(dev->vd, dev->data);
+  }
+
+  if (events & EPOLLIN) {
+    v4l2_frame_buff_t *frame = NULL;
+    if (check_stream_state(dev->vd) == E_OK)
+      frame = dequeue_v4l2_frame(dev->vd);
+    else
+      stalled = 1;
+
+    if (frame != NULL) {
+      if (dev->frame_cb)
+        dev->frame_cb(dev->vd, frame, dev->data);
+      else
+        v4l2core_release_frame(dev->vd, frame);
+    }
+  }
+
+  /*
+   * the driver flags an error while not streaming or
+   * with no buffers queued - retry later instead of spinning
+   */
+  if ((events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN))
+    stalled = 1;
+
+  __LOCK_MUTEX(__PMUTEX);
+  dev->busy = 0;
+  if (dev->removed) {
+    /*already in the removed list*/
+  } else if (stalled) {
+    if (verbosity > 2)
+      printf("V4L2_CORE: (capture engine) device %s stalled (events 0x%x)\n",
+             dev->vd->videodevice, events);
+    dev->stalled = 1;
+    dev->stall_ts = ns_time_monotonic();
+    engine->stalled++;
+  } else
+    arm_device(engine, dev, EPOLL_CTL_MOD);
+  __UNLOCK_MUTEX(__PMUTEX);
+}
+
+/*
+ * capture engine dispatch thread
+ * args:
+ *   arg - pointer to capture engine
+ *
+ * asserts:
+ *   none
+ *
+ * returns: NULL
+ */
+static void *engine_thread(void *arg) {
+  v4l2_capture_engine_t *engine = (v4l2_capture_engine_t *)arg;
+  struct epoll_event events[ENGINE_MAX_EVENTS];
+
+  while (1) {
+    __LOCK_MUTEX(__PMUTEX);
+    int timeout = engine->stalled > 0 ? ENGINE_STALL_RETRY_MS : -1;
+    __UNLOCK_MUTEX(__PMUTEX);
+
+    int n = epoll_wait(engine->epfd, events, ENGINE_MAX_EVENTS, timeout);
+
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "V4L2_CORE: (capture engine) epoll_wait error: %s\n",
+              strerror(errno));
+      break;
+    }
+
+    /*
+     * retry the stalled devices on every wake up: with other devices
+     * streaming epoll_wait may never time out
+     */
+    __LOCK_MUTEX(__PMUTEX);
+    if (engine->stalled > 0)
+      rearm_stalled_devices(engine);
+    __UNLOCK_MUTEX(__PMUTEX);
+
+    int i = 0;
+    int stop = 0;
+    for (i = 0; i < n; ++i) {
+      /*
+       * stop request: the eventfd is not read back so it stays
+       * readable and wakes up every dispatch thread
+       * the rest of the batch is still handled, so that the
+       * (oneshot) devices in it are rearmed for the next start
+       */
+      if (events[i].data.ptr == NULL) {
+        stop = 1;
+        continue;
+      }
+
+      handle_device(engine, (engine_device_t *)events[i].data.ptr,
+                    events[i].events);
+    }
+
+    if (stop)
+      break;
+  }
+
+  return NULL;
+}
+
+/*
+ * creates a capture engine: nthreads threads waiting (epoll) on the
+ *   frame and control event notifications of all the added devices
+ * args:
+ *   nthreads - number of dispatch threads (<= 0 defaults to 1)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to capture engine (NULL on error)
+ */
+v4l2_capture_engine_t *v4l2core_engine_new(int nthreads) {
+  v4l2_capture_engine_t *engine = calloc(1, sizeof(v4l2_capture_engine_t));
+  if (engine == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure "
+            "(v4l2core_engine_new): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  engine->nthreads = nthreads > 0 ? nthreads : 1;
+  engine->threads = calloc(engine->nthreads, sizeof(__THREAD_TYPE));
+  if (engine->threads == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure "
+            "(v4l2core_engine_new): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  engine->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (engine->epfd < 0) {
+    fprintf(stderr, "V4L2_CORE: (capture engine) epoll_create1 error: %s\n",
+            strerror(errno));
+    free(engine->threads);
+    free(engine);
+    return NULL;
+  }
+
+  engine->stopfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (engine->stopfd < 0) {
+    fprintf(stderr, "V4L2_CORE: (capture engine) eventfd error: %s\n",
+            strerror(errno));
+    close(engine->epfd);
+    free(engine->threads);
+    free(engine);
+    return NULL;
+  }
+
+  /*the stop eventfd is level triggered and identified by a NULL pointer*/
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(struct epoll_event));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  if (epoll_ctl(engine->epfd, EPOLL_CTL_ADD, engine->stopfd, &ev) < 0) {
+    fprintf(stderr, "V4L2_CORE: (capture engine) epoll_ctl error: %s\n",
+            strerror(errno));
+    close(engine->stopfd);
+    close(engine->epfd);
+    free(engine->threads);
+    free(engine);
+    return NULL;
+  }
+
+  __INIT_MUTEX(__PMUTEX);
+
+  return engine;
+}
+
+/*
+ * adds a (streaming) device to the capture engine
+ *   callbacks for the same device are never called concurrently
+ * args:
+ *   engine - pointer to capture engine
+ *   vd - pointer to v4l2 device handler
+ *   frame_cb - frame callback (NULL: frames are released immediately)
+ *   event_cb - control event callback (can be NULL)
+ *   data - user data passed to the callbacks
+ *
+ * asserts:
+ *   engine is not null
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_add_device(v4l2_capture_engine_t *engine, v4l2_dev_t *vd,
+                               v4l2_frame_cb_t frame_cb,
+                               v4l2_event_cb_t event_cb, void *data) {
+  /*assertions*/
+  assert(engine != NULL);
+  assert(vd != NULL);
+
+  engine_device_t *dev = calloc(1, sizeof(engine_device_t));
+  if (dev == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure "
+            "(v4l2core_engine_add_device): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  dev->vd = vd;
+  dev->frame_cb = frame_cb;
+  dev->event_cb = event_cb;
+  dev->data = data;
+
+  __LOCK_MUTEX(__PMUTEX);
+  dev->next = engine->devices;
+  engine->devices = dev;
+
+  if (arm_device(engine, dev, EPOLL_CTL_ADD) < 0) {
+    engine->devices = dev->next;
+    __UNLOCK_MUTEX(__PMUTEX);
+    free(dev);
+    return E_DEVICE_ERR;
+  }
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  if (verbosity > 1)
+    printf("V4L2_CORE: (capture engine) added device %s\n", vd->videodevice);
+
+  return E_OK;
+}
+
+/*
+ * removes a device from the capture engine
+ *   a callback already running for the device may still complete
+ * args:
+ *   engine - pointer to capture engine
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   engine is not null
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_remove_device(v4l2_capture_engine_t *engine,
+                                  v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(engine != NULL);
+  assert(vd != NULL);
+
+  __LOCK_MUTEX(__PMUTEX);
+  engine_device_t *dev = engine->devices;
+  while (dev != NULL && dev->vd != vd)
+    dev = dev->next;
+
+  if (dev == NULL) {
+    __UNLOCK_MUTEX(__PMUTEX);
+    return E_DEVICE_ERR;
+  }
+
+  epoll_ctl(engine->epfd, EPOLL_CTL_DEL, vd->fd, NULL);
+  unlink_device(engine, dev);
+
+  /*
+   * a dispatch thread may be handling the device or still hold it
+   * in an epoll batch: free it only when the threads are stopped
+   */
+  if (engine->running) {
+    dev->removed = 1;
+    dev->next = engine->removed;
+    engine->removed = dev;
+  } else
+    free(dev);
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  return E_OK;
+}
+
+/*
+ * starts the capture engine dispatch threads
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   engine is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_start(v4l2_capture_engine_t *engine) {
+  /*assertions*/
+  assert(engine != NULL);
+
+  if (engine->running)
+    return E_OK;
+
+  /*drain any previous stop request*/
+  uint64_t val = 0;
+  if (read(engine->stopfd, &val, sizeof(uint64_t)) < 0 && errno != EAGAIN)
+    fprintf(stderr, "V4L2_CORE: (capture engine) eventfd read error: %s\n",
+            strerror(errno));
+
+  int i = 0;
+  for (i = 0; i < engine->nthreads; ++i) {
+    if (__THREAD_CREATE(&engine->threads[i], engine_thread, engine)) {
+      fprintf(stderr,
+              "V4L2_CORE: (capture engine) thread creation failed (%i)\n", i);
+      break;
+    }
+  }
+
+  engine->running = i;
+  if (i == 0)
+    return E_UNKNOWN_ERR;
+
+  return E_OK;
+}
+
+/*
+ * stops the capture engine dispatch threads (blocks until they exit)
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   engine is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_stop(v4l2_capture_engine_t *engine) {
+  /*assertions*/
+  assert(engine != NULL);
+
+  if (!engine->running)
+    return E_OK;
+
+  uint64_t val = 1;
+  if (write(engine->stopfd, &val, sizeof(uint64_t)) < 0) {
+    fprintf(stderr, "V4L2_CORE: (capture engine) eventfd write error: %s\n",
+            strerror(errno));
+    return E_UNKNOWN_ERR;
+  }
+
+  int i = 0;
+  for (i = 0; i < engine->running; ++i)
+    __THREAD_JOIN(engine->threads[i]);
+
+  engine->running = 0;
+
+  free_removed_devices(engine);
+
+  return E_OK;
+}
+
+/*
+ * stops and frees the capture engine (devices are not closed)
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_engine_free(v4l2_capture_engine_t *engine) {
+  if (engine == NULL)
+    return;
+
+  v4l2core_engine_stop(engine);
+  free_removed_devices(engine);
+
+  /*no dispatch threads left: devices can't be busy*/
+  engine_device_t *dev = engine->devices;
+  while (dev != NULL) {
+    engine_device_t *next = dev->next;
+    free(dev);
+    dev = next;
+  }
+
+  close(engine->stopfd);
+  close(engine->epfd);
+  __CLOSE_MUTEX(__PMUTEX);
+  free(engine->threads);
+  free(engine);
+}
@@ -2940,6 +2940,270 @@ void yu12_to_yuyv(uint8_t *out, uint8_t *in, int width, int height) {
   }
 }
 
+/*
+ * yu12 to rgba (rgb32)
+ * args:
+ *    out - pointer to output rgba data buffer
+ *    in - pointer to input yu12 data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void yu12_to_rgba(uint8_t *out, uint8_t *in, int width, int height) {
+  /*assertions*/
+  assert(out);
+  assert(in);
+
+  uint8_t *py1 = in;          // line 1
+  uint8_t *py2 = py1 + width; // line 2
+  uint8_t *pu = in + (width * height);
+  uint8_t *pv = pu + ((width * height) / 4);
+
+  uint8_t *pout1 = out;               // first line
+  uint8_t *pout2 = out + (width * 4); // second line
+
+  int h = 0, w = 0, i = 0;
+
+  for (h = 0; h < height; h += 2) // every two lines
+  {
+    py1 = in + (h * width);
+    py2 = py1 + width;
+
+    pout1 = out + (h * width * 4);
+    pout2 = pout1 + (width * 4);
+
+    for (w = 0; w < width; w += 2) // every 2 pixels
+    {
+      for (i = 0; i < 2; i++) {
+        /* standart: r = y0 + 1.402 (v-128) */
+        *pout1++ = CLIP(*py1 + 1.402 * (*pv - 128));
+        *pout2++ = CLIP(*py2 + 1.402 * (*pv - 128));
+        /* standart: g = y0 - 0.34414 (u-128) - 0.71414 (v-128)*/
+        *pout1++ = CLIP(*py1 - 0.34414 * (*pu - 128) - 0.71414 * (*pv - 128));
+        *pout2++ = CLIP(*py2 - 0.34414 * (*pu - 128) - 0.71414 * (*pv - 128));
+        /* standart: b = y0 + 1.772 (u-128) */
+        *pout1++ = CLIP(*py1 + 1.772 * (*pu - 128));
+        *pout2++ = CLIP(*py2 + 1.772 * (*pu - 128));
+        /* alpha set to 255*/
+        *pout1++ = 255;
+        *pout2++ = 255;
+
+        py1++;
+        py2++;
+      }
+      pu++;
+      pv++;
+    }
+  }
+}
+
+/*
+ * convert packed 422 yuv (yuyv) directly to rgb24
+ *   keeps the full vertical chroma resolution
+ *   (no intermediate 420 planar pass)
+ * args:
+ *    out - pointer to output rgb data buffer
+ *    in - pointer to input yuyv data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void yuyv_to_rgb24(uint8_t *out, uint8_t *in, int width, int height) {
+  /*assertions*/
+  assert(out);
+  assert(in);
+
+  uint8_t *pin = in;
+  uint8_t *pout = out;
+
+  int i = 0;
+  int size = (width * height) / 2; // yuyv macropixels (2 pixels each)
+
+  for (i = 0; i < size; i++) {
+    int y0 = pin[0];
+    int u = pin[1] - 128;
+    int y1 = pin[2];
+    int v = pin[3] - 128;
+
+    /* standart: r = y0 + 1.402 (v-128) */
+    *pout++ = CLIP(y0 + 1.402 * v);
+    /* standart: g = y0 - 0.34414 (u-128) - 0.71414 (v-128)*/
+    *pout++ = CLIP(y0 - 0.34414 * u - 0.71414 * v);
+    /* standart: b = y0 + 1.772 (u-128) */
+    *pout++ = CLIP(y0 + 1.772 * u);
+
+    *pout++ = CLIP(y1 + 1.402 * v);
+    *pout++ = CLIP(y1 - 0.34414 * u - 0.71414 * v);
+    *pout++ = CLIP(y1 + 1.772 * u);
+
+    pin += 4;
+  }
+}
+
+/*
+ * convert packed 422 yuv (uyvy) to packed 422 yuv (yuyv)
+ * args:
+ *    out - pointer to output yuyv data buffer
+ *    in - pointer to input uyvy data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void uyvy_to_yuyv(uint8_t *out, uint8_t *in, int width, int height) {
+  /*assertions*/
+  assert(out);
+  assert(in);
+
+  int i = 0;
+  int size = width * height * 2;
+
+  for (i = 0; i < size; i += 4) {
+    out[i] = in[i + 1];     // y0
+    out[i + 1] = in[i];     // u
+    out[i + 2] = in[i + 3]; // y1
+    out[i + 3] = in[i + 2]; // v
+  }
+}
+
+/*
+ * convert packed 422 yuv (yvyu) to packed 422 yuv (yuyv)
+ * args:
+ *    out - pointer to output yuyv data buffer
+ *    in - pointer to input yvyu data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void yvyu_to_yuyv(uint8_t *out, uint8_t *in, int width, int height) {
+  /*assertions*/
+  assert(out);
+  assert(in);
+
+  int i = 0;
+  int size = width * height * 2;
+
+  for (i = 0; i < size; i += 4) {
+    out[i] = in[i];         // y0
+    out[i + 1] = in[i + 3]; // u
+    out[i + 2] = in[i + 2]; // y1
+    out[i + 3] = in[i + 1]; // v
+  }
+}
+
+/*
+ * convert bgr24 to rgb24 (swap red and blue)
+ * args:
+ *    out - pointer to output rgb data buffer
+ *    in - pointer to input bgr data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void bgr24_to_rgb24(uint8_t *out, uint8_t *in, int width, int height) {
+  /*assertions*/
+  assert(out);
+  assert(in);
+
+  int i = 0;
+  int size = width * height * 3;
+
+  for (i = 0; i < size; i += 3) {
+    out[i] = in[i + 2];
+    out[i + 1] = in[i + 1];
+    out[i + 2] = in[i];
+  }
+}
+
+/*
+ * convert rgb24 to bgr24 with lines upsidedown
+ *   used for bitmap files (DIB24)
+ * args:
+ *    out - pointer to output bgr data buffer
+ *    in - pointer to input rgb data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void rgb24_to_dib24(uint8_t *out, uint8_t *in, int width, int height) {
+  /*assertions*/
+  assert(out);
+  assert(in);
+
+  int linesize = width * 3;
+  int h = 0, w = 0;
+
+  for (h = 0; h < height; h++) {
+    uint8_t *pin = in + ((height - 1 - h) * linesize); // from last line
+    uint8_t *pout = out + (h * linesize);
+
+    for (w = 0; w < linesize; w += 3) {
+      pout[w] = pin[w + 2];
+      pout[w + 1] = pin[w + 1];
+      pout[w + 2] = pin[w];
+    }
+  }
+}
+
+/*
+ * convert rgb24 to rgba (alpha set to 255)
+ * args:
+ *    out - pointer to output rgba data buffer
+ *    in - pointer to input rgb data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void rgb24_to_rgba(uint8_t *out, uint8_t *in, int width, int height) {
+  /*assertions*/
+  assert(out);
+  assert(in);
+
+  int i = 0;
+  int size = width * height;
+
+  for (i = 0; i < size; i++) {
+    *out++ = *in++;
+    *out++ = *in++;
+    *out++ = *in++;
+    *out++ = 255;
+  }
+}
+
 #if MJPG_BUILTIN // use internal jpeg decoder
 /*
  * used for internal jpeg decoding  420 planar to 422
@@ -651,6 +651,119 @@ void yu12_to_dib24(uint8_t *out, uint8_t *in, int width, int height);
  */
 void yu12_to_yuyv(uint8_t *out, uint8_t *in, int width, int height);
 
+/*
+ * yu12 to rgba (rgb32)
+ * args:
+ *    out - pointer to output rgba data buffer
+ *    in - pointer to input yu12 data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void yu12_to_rgba(uint8_t *out, uint8_t *in, int width, int height);
+
+/*
+ * convert packed 422 yuv (yuyv) directly to rgb24
+ * args:
+ *    out - pointer to output rgb data buffer
+ *    in - pointer to input yuyv data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void yuyv_to_rgb24(uint8_t *out, uint8_t *in, int width, int height);
+
+/*
+ * convert packed 422 yuv (uyvy) to packed 422 yuv (yuyv)
+ * args:
+ *    out - pointer to output yuyv data buffer
+ *    in - pointer to input uyvy data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void uyvy_to_yuyv(uint8_t *out, uint8_t *in, int width, int height);
+
+/*
+ * convert packed 422 yuv (yvyu) to packed 422 yuv (yuyv)
+ * args:
+ *    out - pointer to output yuyv data buffer
+ *    in - pointer to input yvyu data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void yvyu_to_yuyv(uint8_t *out, uint8_t *in, int width, int height);
+
+/*
+ * convert bgr24 to rgb24 (swap red and blue)
+ * args:
+ *    out - pointer to output rgb data buffer
+ *    in - pointer to input bgr data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void bgr24_to_rgb24(uint8_t *out, uint8_t *in, int width, int height);
+
+/*
+ * convert rgb24 to bgr24 with lines upsidedown
+ *   used for bitmap files (DIB24)
+ * args:
+ *    out - pointer to output bgr data buffer
+ *    in - pointer to input rgb data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void rgb24_to_dib24(uint8_t *out, uint8_t *in, int width, int height);
+
+/*
+ * convert rgb24 to rgba (alpha set to 255)
+ * args:
+ *    out - pointer to output rgba data buffer
+ *    in - pointer to input rgb data buffer
+ *    width - buffer width (in pixels)
+ *    height - buffer height (in pixels)
+ *
+ * asserts:
+ *    out is not null
+ *    in is not null
+ *
+ * returns: none
+ */
+void rgb24_to_rgba(uint8_t *out, uint8_t *in, int width, int height);
+
 /*
  * convert bayer raw data to rgb24
  * args:
@@ -34,8 +34,103 @@
 #include "v4l2_controls.h"
 // #include "../config.h"
 
+/*binary profile (native byte order: meant for presets in the same host)*/
+#define CTRL_PROFILE_MAGIC "V4L2CTRB"
+#define CTRL_PROFILE_VERSION (1)
+
+typedef struct _ctrl_profile_header_t {
+  char magic[8];    // CTRL_PROFILE_MAGIC
+  uint32_t version; // CTRL_PROFILE_VERSION
+  uint32_t count;   // number of entries
+} ctrl_profile_header_t;
+
+/*entries are followed by size string bytes (padded to 8 bytes)*/
+typedef struct _ctrl_profile_entry_t {
+  uint32_t id;    // control id
+  uint32_t chk;   // control range check (get_control_check)
+  int64_t value;  // control value (value64 for 64 bit controls)
+  uint32_t size;  // string size (with terminating null), 0 if no string
+  uint32_t pad;
+} ctrl_profile_entry_t;
+
+/*control value to apply*/
+typedef struct _ctrl_value_t {
+  v4l2_ctrl_t *control;
+  int32_t value;
+  int64_t value64;
+  char *string;
+} ctrl_value_t;
+
+/*auto controls that override manual ones*/
+static const struct {
+  uint32_t master;
+  uint32_t slave;
+} auto_controls[] = {
+    {V4L2_CID_EXPOSURE_AUTO, V4L2_CID_EXPOSURE_ABSOLUTE},
+    {V4L2_CID_EXPOSURE_AUTO, V4L2_CID_IRIS_ABSOLUTE},
+    {V4L2_CID_EXPOSURE_AUTO, V4L2_CID_IRIS_RELATIVE},
+    {V4L2_CID_FOCUS_AUTO, V4L2_CID_FOCUS_ABSOLUTE},
+    {V4L2_CID_FOCUS_AUTO, V4L2_CID_FOCUS_RELATIVE},
+    {V4L2_CID_HUE_AUTO, V4L2_CID_HUE},
+    {V4L2_CID_AUTO_WHITE_BALANCE, V4L2_CID_WHITE_BALANCE_TEMPERATURE},
+    {V4L2_CID_AUTO_WHITE_BALANCE, V4L2_CID_RED_BALANCE},
+    {V4L2_CID_AUTO_WHITE_BALANCE, V4L2_CID_BLUE_BALANCE},
+    {V4L2_CID_AUTOGAIN, V4L2_CID_GAIN},
+};
+
+#define N_AUTO_CONTROLS (sizeof(auto_controls) / sizeof(auto_controls[0]))
+
 extern int verbosity;
 
+/*
+ * control range check for binary profiles (fnv-1a hash)
+ * args:
+ *   control - pointer to control
+ *
+ * asserts:
+ *   none
+ *
+ * returns: check value
+ */
+static uint32_t get_control_check(v4l2_ctrl_t *control) {
+  int32_t range[5] = {control->control.type, control->control.minimum,
+                      control->control.maximum, control->control.step,
+                      control->control.default_value};
+  uint8_t *p = (uint8_t *)range;
+  uint32_t hash = 2166136261u;
+
+  size_t i = 0;
+  for (i = 0; i < sizeof(range); i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/*
+ * checks if the profile can save the control
+ * args:
+ *   control - pointer to control
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if the control value is saved, 0 otherwise
+ */
+static int control_is_saved(v4l2_ctrl_t *control) {
+  if ((control->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY) ||
+      (control->control.flags & V4L2_CTRL_FLAG_READ_ONLY) ||
+      (control->control.flags & V4L2_CTRL_FLAG_GRABBED)) {
+    if (verbosity > 0)
+      printf("V4L2_CORE: (save_control_profile) skiping control 0x%08x\n",
+             control->control.id);
+    return 0;
+  }
+
+  return 1;
+}
+
 /*
  * save the device control values into a profile file
  * args:
@@ -70,14 +165,9 @@ int save_control_profile(v4l2_dev_t *vd, const char *filename) {
       /*write control data*/
       fprintf(fp, "# control data\n");
       for (; current != NULL; current = current->next) {
-        if ((current->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY) ||
-            (current->control.flags & V4L2_CTRL_FLAG_READ_ONLY) ||
-            (current->control.flags & V4L2_CTRL_FLAG_GRABBED)) {
-          if (verbosity > 0)
-            printf("V4L2_CORE: (save_control_profile) skiping control 0x%08x\n",
-                   current->control.id);
+        if (!control_is_saved(current))
           continue;
-        }
+
         fprintf(fp, "#%s\n", current->control.name);
         switch (current->control.type) {
         case V4L2_CTRL_TYPE_STRING:
@@ -113,8 +203,10 @@ int save_control_profile(v4l2_dev_t *vd, const char *filename) {
   return (E_OK);
 }
 
+
 /*
- * load the device control values from a profile file
+ * save the device control values into a binary profile file
+ *   (compact and fast to load: for switching presets in a session)
  * args:
  *   vd - pointer to video device data
  *   filename - profile filename
@@ -124,99 +216,649 @@ int save_control_profile(v4l2_dev_t *vd, const char *filename) {
  *
  * returns: error code (0 -E_OK)
  */
-int load_control_profile(v4l2_dev_t *vd, const char *filename) {
+int save_control_profile_bin(v4l2_dev_t *vd, const char *filename) {
   /*assertions*/
   assert(vd != NULL);
 
-  FILE *fp;
-  int major = 0, minor = 0, rev = 0;
+  FILE *fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: (save_control_profile_bin) Could not open %s for "
+            "write: %s\n",
+            filename, strerror(errno));
+    return (E_FILE_IO_ERR);
+  }
+
+  ctrl_profile_header_t header;
+  memset(&header, 0, sizeof(ctrl_profile_header_t));
+  memcpy(header.magic, CTRL_PROFILE_MAGIC, sizeof(header.magic));
+  header.version = CTRL_PROFILE_VERSION;
+
+  v4l2_ctrl_t *current = vd->list_device_controls;
+  for (; current != NULL; current = current->next)
+    if (control_is_saved(current))
+      header.count++;
+
+  int ret = E_OK;
+  if (fwrite(&header, sizeof(header), 1, fp) != 1)
+    ret = E_FILE_IO_ERR;
+
+  current = vd->list_device_controls;
+  for (; current != NULL && ret == E_OK; current = current->next) {
+    if (!control_is_saved(current))
+      continue;
+
+    ctrl_profile_entry_t entry;
+    memset(&entry, 0, sizeof(ctrl_profile_entry_t));
+    entry.id = current->control.id;
+    entry.chk = get_control_check(current);
+
+    switch (current->control.type) {
+    case V4L2_CTRL_TYPE_STRING:
+      entry.size = current->string ? strlen(current->string) + 1 : 1;
+      break;
+    case V4L2_CTRL_TYPE_INTEGER64:
+      entry.value = current->value64;
+      break;
+    default:
+      entry.value = current->value;
+      break;
+    }
+
+    if (fwrite(&entry, sizeof(entry), 1, fp) != 1)
+      ret = E_FILE_IO_ERR;
+
+    if (entry.size > 0 && ret == E_OK) {
+      uint32_t padded = (entry.size + 7) & ~7;
+      char str[padded];
+      memset(str, 0, padded);
+      if (current->string)
+        memcpy(str, current->string, entry.size);
+      if (fwrite(str, padded, 1, fp) != 1)
+        ret = E_FILE_IO_ERR;
+    }
+  }
+
+  fflush(fp); /*flush stream buffers to filesystem*/
+  if (fsync(fileno(fp)) || fclose(fp) || ret != E_OK) {
+    fprintf(stderr,
+            "V4L2_CORE: (save_control_profile_bin) write to file failed: %s\n",
+            strerror(errno));
+    return (E_FILE_IO_ERR);
+  }
+
+  return (E_OK);
+}
+
+/*
+ * gets the value entry for a control (adds a new one if needed)
+ * args:
+ *   values - array of control values (vd->num_controls size)
+ *   count - pointer to number of values in the array
+ *   control - pointer to control
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to the control value entry
+ */
+static ctrl_value_t *get_value_entry(ctrl_value_t *values, int *count,
+                                     v4l2_ctrl_t *control) {
+  int i = 0;
+  for (i = 0; i < *count; i++)
+    if (values[i].control == control)
+      return &values[i];
+
+  ctrl_value_t *entry = &values[(*count)++];
+  memset(entry, 0, sizeof(ctrl_value_t));
+  entry->control = control;
+  return entry;
+}
+
+/*
+ * checks if a manual control is overridden by its auto control
+ *   (uses the auto control value to apply, if any, or else the current one)
+ * args:
+ *   vd - pointer to video device data
+ *   values - array of control values to apply
+ *   count - number of values in the array
+ *   id - manual control id
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if overridden, 0 otherwise
+ */
+static int control_is_overridden(v4l2_dev_t *vd, ctrl_value_t *values,
+                                 int count, uint32_t id) {
+  size_t i = 0;
+  for (i = 0; i < N_AUTO_CONTROLS; i++) {
+    if (auto_controls[i].slave != id)
+      continue;
+
+    v4l2_ctrl_t *master =
+        v4l2core_get_control_by_id(vd, auto_controls[i].master);
+    if (master == NULL)
+      continue;
+
+    int32_t value = master->value;
+    int j = 0;
+    for (j = 0; j < count; j++)
+      if (values[j].control == master)
+        value = values[j].value;
+
+    if (auto_controls[i].master != V4L2_CID_EXPOSURE_AUTO) {
+      if (value > 0)
+        return 1;
+    } else if (value == V4L2_EXPOSURE_AUTO ||
+               (value == V4L2_EXPOSURE_APERTURE_PRIORITY &&
+                id == V4L2_CID_EXPOSURE_ABSOLUTE) ||
+               (value == V4L2_EXPOSURE_SHUTTER_PRIORITY &&
+                id != V4L2_CID_EXPOSURE_ABSOLUTE))
+      return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * apply order of controls: by class, auto controls first
+ * args:
+ *   a - pointer to first control value pointer
+ *   b - pointer to second control value pointer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: qsort compare result
+ */
+static int compare_apply_order(const void *a, const void *b) {
+  v4l2_ctrl_t *ca = (*(ctrl_value_t *const *)a)->control;
+  v4l2_ctrl_t *cb = (*(ctrl_value_t *const *)b)->control;
+
+  if (ca->cclass != cb->cclass)
+    return (ca->cclass < cb->cclass) ? -1 : 1;
+
+  int ra = 1, rb = 1;
+  size_t i = 0;
+  for (i = 0; i < N_AUTO_CONTROLS; i++) {
+    if (auto_controls[i].master == ca->control.id)
+      ra = 0;
+    if (auto_controls[i].master == cb->control.id)
+      rb = 0;
+  }
+  if (ra != rb)
+    return ra - rb;
+
+  return (ca->control.id < cb->control.id) ? -1
+                                            : (ca->control.id > cb->control.id);
+}
+
+/*
+ * fills a v4l2 ext control with a value to apply
+ * args:
+ *   ext - pointer to v4l2 ext control
+ *   value - pointer to control value
+ *   old - use the current (old) control value instead
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void fill_ext_control(struct v4l2_ext_control *ext, ctrl_value_t *value,
+                             int old) {
+  v4l2_ctrl_t *control = value->control;
+
+  memset(ext, 0, sizeof(struct v4l2_ext_control));
+  ext->id = control->control.id;
+
+  switch (control->control.type) {
+  case V4L2_CTRL_TYPE_STRING:
+    /*the string buffer holds maximum + 1 chars*/
+    ext->string = old ? control->string : value->string;
+    ext->size = control->control.maximum + 1;
+    break;
+  case V4L2_CTRL_TYPE_INTEGER64:
+    ext->value64 = old ? control->value64 : value->value64;
+    break;
+  default:
+    ext->value = old ? control->value : value->value;
+    break;
+  }
+}
+
+/*
+ * sets (or validates) the controls of a class with a single ioctl
+ * args:
+ *   vd - pointer to video device data
+ *   apply - array of control value pointers (same class)
+ *   count - number of controls
+ *   request - VIDIOC_TRY_EXT_CTRLS or VIDIOC_S_EXT_CTRLS
+ *   old - set the current (old) control values (rollback)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: ioctl result
+ */
+static int ext_controls_ioctl(v4l2_dev_t *vd, ctrl_value_t **apply, int count,
+                              unsigned long request, int old) {
+  struct v4l2_ext_control clist[count];
+  struct v4l2_ext_controls ctrls = {0};
+
+  int i = 0;
+  for (i = 0; i < count; i++)
+    fill_ext_control(&clist[i], apply[i], old);
+
+  ctrls.ctrl_class = apply[0]->control->cclass;
+  ctrls.count = count;
+  ctrls.controls = clist;
+
+  int ret = xioctl(vd->fd, request, &ctrls);
+
+  if (ret) {
+    if (ctrls.error_idx < (uint32_t)count)
+      fprintf(stderr,
+              "V4L2_CORE: control(0x%08x) \"%s\" rejected by the device: %s\n",
+              clist[ctrls.error_idx].id,
+              apply[ctrls.error_idx]->control->control.name, strerror(errno));
+    return ret;
+  }
+
+  /*the values set by the driver (may be clamped)*/
+  if (request == VIDIOC_S_EXT_CTRLS && !old) {
+    for (i = 0; i < count; i++) {
+      if (apply[i]->control->control.type == V4L2_CTRL_TYPE_INTEGER64)
+        apply[i]->value64 = clist[i].value64;
+      else if (apply[i]->control->control.type != V4L2_CTRL_TYPE_STRING)
+        apply[i]->value = clist[i].value;
+    }
+  }
 
-  if ((fp = fopen(filename, "r")) != NULL) {
-    char line[200];
-    if (fgets(line, sizeof(line), fp) != NULL) {
-      if (sscanf(line, "#V4L2/CTRL/%3i.%3i.%3i", &major, &minor, &rev) == 3) {
-        // check standard version if needed
-      } else {
+  return ret;
+}
+
+/*
+ * gets the end of a class group in the (sorted) apply array
+ * args:
+ *   apply - array of control value pointers (sorted by class)
+ *   first - first index of the group
+ *   count - number of controls in the array
+ *
+ * asserts:
+ *   none
+ *
+ * returns: index after the last control of the group
+ */
+static int class_group_end(ctrl_value_t **apply, int first, int count) {
+  int last = first + 1;
+  while (last < count &&
+         apply[last]->control->cclass == apply[first]->control->cclass)
+    last++;
+
+  return last;
+}
+
+/*
+ * applies the control values to the device
+ *   controls are grouped by class (auto controls first, manual controls
+ *   overridden by auto controls are skipped), validated with
+ *   VIDIOC_TRY_EXT_CTRLS and set with a single VIDIOC_S_EXT_CTRLS per class;
+ *   if a class fails the classes already set are rolled back
+ * args:
+ *   vd - pointer to video device data
+ *   values - array of control values
+ *   count - number of values in the array
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 -E_OK)
+ */
+static int apply_control_values(v4l2_dev_t *vd, ctrl_value_t *values,
+                                int count) {
+  ctrl_value_t *apply[count > 0 ? count : 1];
+  int napply = 0;
+  int i = 0;
+
+  for (i = 0; i < count; i++) {
+    v4l2_ctrl_t *control = values[i].control;
+
+    if (control->control.flags &
+        (V4L2_CTRL_FLAG_READ_ONLY | V4L2_CTRL_FLAG_DISABLED))
+      continue;
+
+    /*unchanged (cached) values don't need a device transfer*/
+    if (control->cached) {
+      if (control->control.type == V4L2_CTRL_TYPE_STRING) {
+        if (control->string && values[i].string &&
+            strcmp(control->string, values[i].string) == 0)
+          continue;
+      } else if (control->control.type == V4L2_CTRL_TYPE_INTEGER64) {
+        if (control->value64 == values[i].value64)
+          continue;
+      } else if (control->value == values[i].value)
+        continue;
+    }
+
+    if (control_is_overridden(vd, values, count, control->control.id)) {
+      if (verbosity > 1)
+        printf("V4L2_CORE: (profile) control 0x%08x set by its auto "
+               "control: skip\n",
+               control->control.id);
+      continue;
+    }
+
+    /*the ioctl reads maximum + 1 string chars*/
+    if (control->control.type == V4L2_CTRL_TYPE_STRING) {
+      char *str = calloc(control->control.maximum + 1, sizeof(char));
+      if (str == NULL) {
         fprintf(stderr,
-                "V4L2_CORE: (load_control_profile) no valid header found\n");
-        fclose(fp);
-        return (E_NO_DATA);
+                "V4L2_CORE: FATAL memory allocation failure "
+                "(apply_control_values): %s\n",
+                strerror(errno));
+        exit(-1);
       }
-    } else {
+      if (values[i].string)
+        strncpy(str, values[i].string, control->control.maximum);
+      free(values[i].string);
+      values[i].string = str;
+    }
+
+    apply[napply++] = &values[i];
+  }
+
+  if (napply == 0)
+    return E_OK;
+
+  qsort(apply, napply, sizeof(ctrl_value_t *), compare_apply_order);
+
+  /*validate every class first: nothing is set if a value is rejected*/
+  int first = 0;
+  int last = 0;
+  for (first = 0; first < napply; first = last) {
+    last = class_group_end(apply, first, napply);
+
+    if (ext_controls_ioctl(vd, &apply[first], last - first,
+                           VIDIOC_TRY_EXT_CTRLS, 0)) {
+      if (errno == ENOTTY)
+        break; /*no ext controls: set them one by one*/
+
       fprintf(stderr,
-              "V4L2_CORE: (load_control_profile) no valid header found\n");
-      fclose(fp);
-      return (E_NO_DATA);
-    }
-
-    while (fgets(line, sizeof(line), fp) != NULL) {
-      int id = 0;
-      int min = 0, max = 0, step = 0, def = 0;
-      int32_t val = 0;
-      int64_t val64 = 0;
-
-      if ((line[0] != '#') && (line[0] != '\n')) {
-        if (sscanf(line, "ID{0x%08x};CHK{%5i:%5i:%5i:%5i}=VAL{%5i}", &id, &min,
-                   &max, &step, &def, &val) == 6) {
-          v4l2_ctrl_t *current = v4l2core_get_control_by_id(vd, id);
-
-          if (current) {
-            /*check values*/
-            if (current->control.minimum == min &&
-                current->control.maximum == max &&
-                current->control.step == step &&
-                current->control.default_value == def) {
-              current->value = val;
-            }
-          }
-        } else if (sscanf(line, "ID{0x%08x};CHK{0:0:0:0}=VAL64{%" PRId64 "}",
-                          &id, &val64) == 2) {
-          v4l2_ctrl_t *current = v4l2core_get_control_by_id(vd, id);
+              "V4L2_CORE: (profile) validation failed for class 0x%08x: "
+              "nothing set\n",
+              apply[first]->control->cclass);
+      return E_CTRL_ERR;
+    }
+  }
+
+  int ret = E_OK;
+
+  if (first < napply) {
+    /*legacy path (set_v4l2_control_values falls back to single controls)*/
+    for (i = 0; i < napply; i++) {
+      v4l2_ctrl_t *control = apply[i]->control;
+      control->value = apply[i]->value;
+      control->value64 = apply[i]->value64;
+      if (control->control.type == V4L2_CTRL_TYPE_STRING)
+        strncpy(control->string, apply[i]->string, control->control.maximum);
+    }
+    set_v4l2_control_values(vd);
+    get_v4l2_control_values(vd);
+    return E_OK;
+  }
+
+  for (first = 0; first < napply; first = last) {
+    last = class_group_end(apply, first, napply);
+
+    if (ext_controls_ioctl(vd, &apply[first], last - first, VIDIOC_S_EXT_CTRLS,
+                           0)) {
+      fprintf(stderr,
+              "V4L2_CORE: (profile) failed to set class 0x%08x: rolling back\n",
+              apply[first]->control->cclass);
+      /*restore the classes already set (control list holds the old values)*/
+      int r = 0;
+      int rlast = 0;
+      for (r = 0; r < first; r = rlast) {
+        rlast = class_group_end(apply, r, first);
+        if (ext_controls_ioctl(vd, &apply[r], rlast - r, VIDIOC_S_EXT_CTRLS,
+                               1))
+          fprintf(stderr,
+                  "V4L2_CORE: (profile) rollback failed for class 0x%08x\n",
+                  apply[r]->control->cclass);
+      }
+      ret = E_CTRL_ERR;
+      break;
+    }
+  }
+
+  if (ret != E_OK) {
+    get_v4l2_control_values(vd);
+    return ret;
+  }
+
+  /*update the control list*/
+  int refresh = 0;
+  for (i = 0; i < napply; i++) {
+    v4l2_ctrl_t *control = apply[i]->control;
+
+    switch (control->control.type) {
+    case V4L2_CTRL_TYPE_STRING:
+      strncpy(control->string, apply[i]->string, control->control.maximum);
+      break;
+    case V4L2_CTRL_TYPE_INTEGER64:
+      control->value64 = apply[i]->value64;
+      break;
+    default:
+      control->value = apply[i]->value;
+      break;
+    }
+
+    /*without control events the flags must be read again*/
+    if (!control->events)
+      refresh = 1;
+  }
+
+  if (refresh)
+    get_v4l2_control_values(vd);
+  else
+    process_control_events(vd);
+
+  return E_OK;
+}
+
+/*
+ * reads the control values from a text profile
+ * args:
+ *   vd - pointer to video device data
+ *   fp - profile file (after the header line)
+ *   values - array of control values (vd->num_controls size)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of control values
+ */
+static int read_text_profile(v4l2_dev_t *vd, FILE *fp, ctrl_value_t *values) {
+  char line[200];
+  int count = 0;
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    int id = 0;
+    int min = 0, max = 0, step = 0, def = 0;
+    int32_t val = 0;
+    int64_t val64 = 0;
+
+    if ((line[0] != '#') && (line[0] != '\n')) {
+      if (sscanf(line, "ID{0x%08x};CHK{%5i:%5i:%5i:%5i}=VAL{%5i}", &id, &min,
+                 &max, &step, &def, &val) == 6) {
+        v4l2_ctrl_t *current = v4l2core_get_control_by_id(vd, id);
 
-          if (current) {
-            current->value64 = val64;
+        if (current) {
+          /*check values*/
+          if (current->control.minimum == min &&
+              current->control.maximum == max &&
+              current->control.step == step &&
+              current->control.default_value == def) {
+            get_value_entry(values, &count, current)->value = val;
           }
-        } else if (sscanf(line, "ID{0x%08x};CHK{%5i:%5i:%5i:0}=STR{\"%*s\"}",
-                          &id, &min, &max, &step) == 5) {
-          v4l2_ctrl_t *current = v4l2core_get_control_by_id(vd, id);
-
-          if (current) {
-            /*check values*/
-            if (current->control.minimum == min &&
-                current->control.maximum == max &&
-                current->control.step == step) {
-              char str[max + 1];
-              char fmt[48];
-              sprintf(fmt, "ID{0x%%*x};CHK{%%*i:%%*i:%%*i:0}==STR{\"%%%is\"}",
-                      max);
-              sscanf(line, fmt, str);
-
-              /*we are only scannig for max chars so this should never happen*/
-              if (strlen(str) >
-                  max) /*FIXME: should also check (minimum +N*step)*/
-              {
-                fprintf(stderr,
-                        "V4L2_CORE: (load_control_profile) string bigger than "
-                        "maximum buffer size (%i > %i)\n",
-                        (int)strlen(str), max);
-                if (current->string)
-                  free(current->string);
-                current->string =
-                    strndup(str, max); /*FIXME: does max includes '\0' ?*/
-              } else {
-                if (current->string)
-                  free(current->string);
-                current->string = strndup(str, strlen(str) + 1);
-              }
+        }
+      } else if (sscanf(line, "ID{0x%08x};CHK{0:0:0:0}=VAL64{%" PRId64 "}",
+                        &id, &val64) == 2) {
+        v4l2_ctrl_t *current = v4l2core_get_control_by_id(vd, id);
+
+        if (current) {
+          get_value_entry(values, &count, current)->value64 = val64;
+        }
+      } else if (sscanf(line, "ID{0x%08x};CHK{%5i:%5i:%5i:0}=STR{\"%*s\"}",
+                        &id, &min, &max, &step) == 5) {
+        v4l2_ctrl_t *current = v4l2core_get_control_by_id(vd, id);
+
+        if (current) {
+          /*check values*/
+          if (current->control.minimum == min &&
+              current->control.maximum == max &&
+              current->control.step == step) {
+            char str[max + 1];
+            char fmt[48];
+            sprintf(fmt, "ID{0x%%*x};CHK{%%*i:%%*i:%%*i:0}==STR{\"%%%is\"}",
+                    max);
+            sscanf(line, fmt, str);
+
+            /*we are only scannig for max chars so this should never happen*/
+            /*FIXME: should also check (minimum +N*step)*/
+            if ((int)strlen(str) > max) {
+              fprintf(stderr,
+                      "V4L2_CORE: (load_control_profile) string bigger than "
+                      "maximum buffer size (%i > %i)\n",
+                      (int)strlen(str), max);
             }
+            ctrl_value_t *entry = get_value_entry(values, &count, current);
+            free(entry->string);
+            entry->string = strndup(str, max);
           }
         }
       }
     }
+  }
 
-    set_v4l2_control_values(vd);
-    get_v4l2_control_values(vd);
-  } else {
+  return count;
+}
+
+/*
+ * reads the control values from a binary profile
+ * args:
+ *   vd - pointer to video device data
+ *   fp - profile file (after the header)
+ *   header - pointer to profile header
+ *   values - array of control values (vd->num_controls size)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of control values (-1 on error)
+ */
+static int read_binary_profile(v4l2_dev_t *vd, FILE *fp,
+                               ctrl_profile_header_t *header,
+                               ctrl_value_t *values) {
+  if (header->version != CTRL_PROFILE_VERSION) {
+    fprintf(stderr,
+            "V4L2_CORE: (load_control_profile) unsupported binary profile "
+            "version %u\n",
+            header->version);
+    return -1;
+  }
+
+  int count = 0;
+  uint32_t i = 0;
+  for (i = 0; i < header->count; i++) {
+    ctrl_profile_entry_t entry;
+    if (fread(&entry, sizeof(entry), 1, fp) != 1) {
+      fprintf(stderr, "V4L2_CORE: (load_control_profile) truncated profile\n");
+      return -1;
+    }
+
+    /*string bytes (padded) - size comes from the file: no overflow*/
+    uint64_t padded = ((uint64_t)entry.size + 7) & ~((uint64_t)7);
+    v4l2_ctrl_t *current = v4l2core_get_control_by_id(vd, entry.id);
+
+    /*check values*/
+    if (current == NULL || get_control_check(current) != entry.chk) {
+      if (verbosity > 0)
+        printf("V4L2_CORE: (load_control_profile) skiping control 0x%08x\n",
+               entry.id);
+      if (padded > 0 && fseek(fp, (long)padded, SEEK_CUR) != 0) {
+        fprintf(stderr,
+                "V4L2_CORE: (load_control_profile) truncated profile\n");
+        return -1;
+      }
+      continue;
+    }
+
+    /*only string controls have a string, up to the control maximum*/
+    uint32_t max_size = 0;
+    if (current->control.type == V4L2_CTRL_TYPE_STRING)
+      max_size = (uint32_t)current->control.maximum + 1;
+
+    if (entry.size > max_size) {
+      fprintf(stderr,
+              "V4L2_CORE: (load_control_profile) bad string size for "
+              "control 0x%08x (%u > %u): corrupt profile\n",
+              entry.id, entry.size, max_size);
+      return -1;
+    }
+
+    char *str = NULL;
+    if (entry.size > 0) {
+      str = calloc(padded + 1, sizeof(char));
+      if (str == NULL) {
+        fprintf(stderr,
+                "V4L2_CORE: FATAL memory allocation failure "
+                "(read_binary_profile): %s\n",
+                strerror(errno));
+        exit(-1);
+      }
+      if (fread(str, padded, 1, fp) != 1) {
+        fprintf(stderr,
+                "V4L2_CORE: (load_control_profile) truncated profile\n");
+        free(str);
+        return -1;
+      }
+      /*terminated (at most maximum chars) whatever the file holds*/
+      str[entry.size - 1] = 0;
+    }
+
+    ctrl_value_t *value = get_value_entry(values, &count, current);
+    value->value = (int32_t)entry.value;
+    value->value64 = entry.value;
+    free(value->string);
+    value->string = str;
+  }
+
+  return count;
+}
+
+/*
+ * load the device control values from a profile file
+ *   (text or binary profile)
+ * args:
+ *   vd - pointer to video device data
+ *   filename - profile filename
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (0 -E_OK)
+ */
+int load_control_profile(v4l2_dev_t *vd, const char *filename) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  FILE *fp;
+  int major = 0, minor = 0, rev = 0;
+
+  if ((fp = fopen(filename, "rb")) == NULL) {
     fprintf(
         stderr,
         "V4L2_CORE: (load_control_profile) Could not open for %s read: %s\n",
@@ -224,6 +866,47 @@ int load_control_profile(v4l2_dev_t *vd, const char *filename) {
     return (E_FILE_IO_ERR);
   }
 
+  if (vd->num_controls <= 0) {
+    fclose(fp);
+    return (E_NO_DATA);
+  }
+
+  ctrl_value_t *values = calloc(vd->num_controls, sizeof(ctrl_value_t));
+  if (values == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure "
+            "(load_control_profile): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  int count = -1;
+  ctrl_profile_header_t header;
+  char line[200];
+
+  if (fread(&header, sizeof(header), 1, fp) == 1 &&
+      memcmp(header.magic, CTRL_PROFILE_MAGIC, sizeof(header.magic)) == 0)
+    count = read_binary_profile(vd, fp, &header, values);
+  else {
+    rewind(fp);
+    if (fgets(line, sizeof(line), fp) != NULL &&
+        sscanf(line, "#V4L2/CTRL/%3i.%3i.%3i", &major, &minor, &rev) == 3) {
+      // check standard version if needed
+      count = read_text_profile(vd, fp, values);
+    } else
+      fprintf(stderr,
+              "V4L2_CORE: (load_control_profile) no valid header found\n");
+  }
+
   fclose(fp);
-  return (E_OK);
+
+  int ret = (count < 0) ? E_NO_DATA : apply_control_values(vd, values, count);
+
+  /*a rejected profile may have filled some entries (count is -1)*/
+  int i = 0;
+  for (i = 0; i < vd->num_controls; i++)
+    free(values[i].string);
+  free(values);
+
+  return ret;
 }
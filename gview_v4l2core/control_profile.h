@@ -37,8 +37,23 @@
  */
 int save_control_profile(v4l2_dev_t *vd, const char *filename);
 
+/*
+ * save the device control values into a binary profile file
+ *   (compact and fast to load: for switching presets in a session)
+ * args:
+ *   vd - pointer to video device data
+ *   filename - profile filename
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (0 -E_OK)
+ */
+int save_control_profile_bin(v4l2_dev_t *vd, const char *filename);
+
 /*
  * load the device control values from a profile file
+ *   (text or binary profile)
  * args:
  *   vd - pointer to video device data
  *   filename - profile filename
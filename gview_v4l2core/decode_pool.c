@@ -0,0 +1,443 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  V4L2 pipelined decode pool                                                  #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "core_time.h"
+#include "decode_pool.h"
+#include "frame_decoder.h"
+#include "jpeg_decoder.h"
+#include "neoguvc.h"
+
+/*time to wait for a decoded frame before giving up (like select)*/
+#define POOL_GET_TIMEOUT_SEC (1)
+/*dequeue thread poll period while the stream is stopped*/
+#define POOL_IDLE_USEC (10000)
+
+#define JOB_FREE (0)
+#define JOB_QUEUED (1)
+#define JOB_DECODING (2)
+#define JOB_DONE (3)
+
+#define __PMUTEX &(pool->mutex)
+
+extern int verbosity;
+
+/*
+ * decode job (one per frame queue slot)
+ */
+typedef struct _decode_job_t {
+  v4l2_frame_buff_t *frame; // frame being decoded
+  uint64_t seq;             // capture order
+  int stateful;             // decode depends on previous frames (h264)
+  uint64_t serial;          // order among stateful jobs
+  int state;                // JOB_FREE, JOB_QUEUED, JOB_DECODING, JOB_DONE
+  int ret;                  // decode result
+} decode_job_t;
+
+/*
+ * decode worker data
+ */
+typedef struct _decode_worker_t {
+  decode_pool_t *pool;
+  __THREAD_TYPE thread;
+  jpeg_decoder_context_t *jpeg_ctx; // worker (m)jpeg decoder (lazy init)
+  int jpeg_width;                   // jpeg_ctx frame width
+  int jpeg_height;                  // jpeg_ctx frame height
+} decode_worker_t;
+
+struct _decode_pool_t {
+  v4l2_dev_t *vd;
+
+  int nworkers;
+  decode_worker_t *workers;
+  __THREAD_TYPE dequeue_thread;
+
+  __MUTEX_TYPE mutex;
+  __COND_TYPE job_cond;  // a job was queued (or quit)
+  __COND_TYPE done_cond; // a job is done (or quit)
+
+  decode_job_t *jobs; // indexed by frame queue slot
+  int *ring;          // frame queue slot of each in flight seq (seq % size)
+  int size;           // frame queue size
+
+  uint64_t next_seq;     // next capture sequence number
+  uint64_t next_job_seq; // next sequence number for the workers
+  uint64_t next_out_seq; // next sequence number to deliver
+
+  uint64_t serial_next; // next stateful serial to assign
+  uint64_t serial_done; // number of stateful jobs decoded
+
+  int quit;
+};
+
+/*
+ * queues a dequeued frame for decoding
+ * args:
+ *   pool - pointer to decode pool
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void queue_job(decode_pool_t *pool, v4l2_frame_buff_t *frame) {
+  int slot = (int)(frame - pool->vd->frame_queue);
+
+  __LOCK_MUTEX(__PMUTEX);
+  decode_job_t *job = &pool->jobs[slot];
+  job->frame = frame;
+  job->seq = pool->next_seq;
+  job->stateful = (pool->vd->requested_fmt == V4L2_PIX_FMT_H264);
+  job->serial = job->stateful ? pool->serial_next++ : 0;
+  job->state = JOB_QUEUED;
+  job->ret = E_OK;
+
+  pool->ring[pool->next_seq % pool->size] = slot;
+  pool->next_seq++;
+  __COND_SIGNAL(&pool->job_cond);
+  __UNLOCK_MUTEX(__PMUTEX);
+}
+
+/*
+ * dequeue thread: feeds captured frames to the decode workers
+ * args:
+ *   arg - pointer to decode pool
+ *
+ * asserts:
+ *   none
+ *
+ * returns: NULL
+ */
+static void *dequeue_thread(void *arg) {
+  decode_pool_t *pool = (decode_pool_t *)arg;
+  v4l2_dev_t *vd = pool->vd;
+
+  while (1) {
+    __LOCK_MUTEX(__PMUTEX);
+    int quit = pool->quit;
+    __UNLOCK_MUTEX(__PMUTEX);
+
+    if (quit)
+      break;
+
+    __LOCK_MUTEX(&vd->mutex);
+    int stream_state = vd->streaming;
+    __UNLOCK_MUTEX(&vd->mutex);
+
+    /*stream is not running: nothing to dequeue*/
+    if (stream_state != STRM_OK) {
+      if (stream_state == STRM_REQ_STOP)
+        check_stream_state(vd);
+      usleep(POOL_IDLE_USEC);
+      continue;
+    }
+
+    v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
+    if (frame != NULL)
+      queue_job(pool, frame);
+  }
+
+  return NULL;
+}
+
+/*
+ * decodes the job frame with the worker decoder
+ * args:
+ *   worker - pointer to decode worker
+ *   job - pointer to decode job
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (E_OK)
+ */
+static int decode_job(decode_worker_t *worker, decode_job_t *job) {
+  v4l2_dev_t *vd = worker->pool->vd;
+  v4l2_frame_buff_t *frame = job->frame;
+
+  if (vd->requested_fmt == V4L2_PIX_FMT_JPEG ||
+      vd->requested_fmt == V4L2_PIX_FMT_MJPEG) {
+    /*(re)init the worker decoder on first use or resolution change*/
+    if (worker->jpeg_ctx == NULL || worker->jpeg_width != frame->width ||
+        worker->jpeg_height != frame->height) {
+      jpeg_close_decoder(worker->jpeg_ctx);
+      worker->jpeg_ctx = jpeg_init_decoder(frame->width, frame->height);
+      worker->jpeg_width = frame->width;
+      worker->jpeg_height = frame->height;
+    }
+  }
+
+  return decode_v4l2_frame_ctx(vd, frame, worker->jpeg_ctx);
+}
+
+/*
+ * decode worker thread
+ * args:
+ *   arg - pointer to decode worker
+ *
+ * asserts:
+ *   none
+ *
+ * returns: NULL
+ */
+static void *worker_thread(void *arg) {
+  decode_worker_t *worker = (decode_worker_t *)arg;
+  decode_pool_t *pool = worker->pool;
+
+  __LOCK_MUTEX(__PMUTEX);
+  while (1) {
+    while (!pool->quit && pool->next_job_seq == pool->next_seq)
+      __COND_WAIT(&pool->job_cond, __PMUTEX);
+
+    if (pool->quit)
+      break;
+
+    decode_job_t *job =
+        &pool->jobs[pool->ring[pool->next_job_seq % pool->size]];
+    pool->next_job_seq++;
+    job->state = JOB_DECODING;
+
+    /*stateful (h264) frames are decoded one at a time in capture order*/
+    while (!pool->quit && job->stateful && pool->serial_done != job->serial)
+      __COND_WAIT(&pool->done_cond, __PMUTEX);
+
+    if (pool->quit)
+      break;
+
+    __UNLOCK_MUTEX(__PMUTEX);
+    int ret = decode_job(worker, job);
+    __LOCK_MUTEX(__PMUTEX);
+
+    job->ret = ret;
+    job->state = JOB_DONE;
+    if (job->stateful)
+      pool->serial_done++;
+    __COND_BCAST(&pool->done_cond);
+  }
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  return NULL;
+}
+
+/*
+ * creates a decode pool for the device and starts its threads
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   nworkers - number of decode workers
+ *
+ * asserts:
+ *   vd is not null
+ *   nworkers > 0
+ *
+ * returns: pointer to decode pool (NULL on error)
+ */
+decode_pool_t *decode_pool_new(v4l2_dev_t *vd, int nworkers) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(nworkers > 0);
+
+  decode_pool_t *pool = calloc(1, sizeof(decode_pool_t));
+  if (pool == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (decode_pool_new): "
+            "%s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  pool->vd = vd;
+  pool->nworkers = nworkers;
+  pool->size = vd->frame_queue_size;
+  pool->jobs = calloc(pool->size, sizeof(decode_job_t));
+  pool->ring = calloc(pool->size, sizeof(int));
+  pool->workers = calloc(nworkers, sizeof(decode_worker_t));
+  if (pool->jobs == NULL || pool->ring == NULL || pool->workers == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (decode_pool_new): "
+            "%s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  if (pool->size < nworkers + 1)
+    fprintf(stderr,
+            "V4L2_CORE: (decode pool) frame queue size (%i) should be at "
+            "least %i for %i workers (v4l2core_set_frame_queue_size)\n",
+            pool->size, nworkers + 1, nworkers);
+
+  __INIT_MUTEX(__PMUTEX);
+  __INIT_COND(&pool->job_cond);
+  __INIT_COND(&pool->done_cond);
+
+  int i = 0;
+  for (i = 0; i < nworkers; ++i) {
+    pool->workers[i].pool = pool;
+    if (__THREAD_CREATE(&pool->workers[i].thread, worker_thread,
+                        &pool->workers[i])) {
+      fprintf(stderr, "V4L2_CORE: (decode pool) worker creation failed\n");
+      break;
+    }
+  }
+  pool->nworkers = i;
+
+  if (pool->nworkers == 0 ||
+      __THREAD_CREATE(&pool->dequeue_thread, dequeue_thread, pool)) {
+    fprintf(stderr, "V4L2_CORE: (decode pool) couldn't start pool threads\n");
+    __LOCK_MUTEX(__PMUTEX);
+    pool->quit = 1;
+    __COND_BCAST(&pool->job_cond);
+    __UNLOCK_MUTEX(__PMUTEX);
+    for (i = 0; i < pool->nworkers; ++i)
+      __THREAD_JOIN(pool->workers[i].thread);
+    __CLOSE_COND(&pool->done_cond);
+    __CLOSE_COND(&pool->job_cond);
+    __CLOSE_MUTEX(__PMUTEX);
+    free(pool->workers);
+    free(pool->ring);
+    free(pool->jobs);
+    free(pool);
+    return NULL;
+  }
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: (decode pool) started with %i workers\n",
+           pool->nworkers);
+
+  return pool;
+}
+
+/*
+ * gets the next decoded frame, in capture order (must be released)
+ * args:
+ *   pool - pointer to decode pool
+ *
+ * asserts:
+ *   pool is not null
+ *
+ * returns: pointer to frame buffer (NULL on timeout or error)
+ */
+v4l2_frame_buff_t *decode_pool_get_frame(decode_pool_t *pool) {
+  /*assertions*/
+  assert(pool != NULL);
+
+  struct timespec timeout;
+  clock_gettime(CLOCK_REALTIME, &timeout);
+  timeout.tv_sec += POOL_GET_TIMEOUT_SEC;
+
+  __LOCK_MUTEX(__PMUTEX);
+  while (!pool->quit) {
+    decode_job_t *job = NULL;
+    if (pool->next_out_seq < pool->next_seq)
+      job = &pool->jobs[pool->ring[pool->next_out_seq % pool->size]];
+
+    if (job == NULL || job->state != JOB_DONE) {
+      if (__COND_TIMED_WAIT(&pool->done_cond, __PMUTEX, &timeout) ==
+          ETIMEDOUT) {
+        __UNLOCK_MUTEX(__PMUTEX);
+        fprintf(stderr, "V4L2_CORE: (decode pool) timeout waiting for a "
+                        "decoded frame\n");
+        return NULL;
+      }
+      continue;
+    }
+
+    pool->next_out_seq++;
+    job->state = JOB_FREE;
+    v4l2_frame_buff_t *frame = job->frame;
+    int ret = job->ret;
+    __UNLOCK_MUTEX(__PMUTEX);
+
+    if (ret != E_OK) {
+      fprintf(stderr, "V4L2_CORE: Error - Couldn't decode frame\n");
+      v4l2core_release_frame(pool->vd, frame);
+      __LOCK_MUTEX(__PMUTEX);
+      continue;
+    }
+
+    /*time added by the capture, queueing and decoding*/
+    frame->pipeline_latency = ns_time_monotonic() - frame->timestamp;
+
+    return frame;
+  }
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  return NULL;
+}
+
+/*
+ * stops the pool threads, releases undelivered frames and frees the pool
+ * args:
+ *   pool - pointer to decode pool
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void decode_pool_free(decode_pool_t *pool) {
+  if (pool == NULL)
+    return;
+
+  __LOCK_MUTEX(__PMUTEX);
+  pool->quit = 1;
+  __COND_BCAST(&pool->job_cond);
+  __COND_BCAST(&pool->done_cond);
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  /*the dequeue thread exits after at most one frame wait (1 sec)*/
+  __THREAD_JOIN(pool->dequeue_thread);
+
+  int i = 0;
+  for (i = 0; i < pool->nworkers; ++i) {
+    __THREAD_JOIN(pool->workers[i].thread);
+    jpeg_close_decoder(pool->workers[i].jpeg_ctx);
+  }
+
+  /*give back the frames that were never delivered*/
+  uint64_t seq = pool->next_out_seq;
+  for (; seq < pool->next_seq; ++seq)
+    v4l2core_release_frame(pool->vd,
+                           pool->jobs[pool->ring[seq % pool->size]].frame);
+
+  __CLOSE_COND(&pool->done_cond);
+  __CLOSE_COND(&pool->job_cond);
+  __CLOSE_MUTEX(__PMUTEX);
+  free(pool->workers);
+  free(pool->ring);
+  free(pool->jobs);
+  free(pool);
+}
@@ -0,0 +1,74 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef DECODE_POOL_H
+#define DECODE_POOL_H
+
+#include "neoguvc_v4l2core.h"
+#include "v4l2_core.h"
+
+/*
+ * pipelined decode pool: a dequeue thread feeds raw frames to
+ * decode workers, decoded frames are delivered in capture order
+ */
+typedef struct _decode_pool_t decode_pool_t;
+
+/*
+ * creates a decode pool for the device and starts its threads
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   nworkers - number of decode workers
+ *
+ * asserts:
+ *   vd is not null
+ *   nworkers > 0
+ *
+ * returns: pointer to decode pool (NULL on error)
+ */
+decode_pool_t *decode_pool_new(v4l2_dev_t *vd, int nworkers);
+
+/*
+ * gets the next decoded frame, in capture order (must be released)
+ * args:
+ *   pool - pointer to decode pool
+ *
+ * asserts:
+ *   pool is not null
+ *
+ * returns: pointer to frame buffer (NULL on timeout or error)
+ */
+v4l2_frame_buff_t *decode_pool_get_frame(decode_pool_t *pool);
+
+/*
+ * stops the pool threads, releases undelivered frames and frees the pool
+ * args:
+ *   pool - pointer to decode pool
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void decode_pool_free(decode_pool_t *pool);
+
+#endif
@@ -0,0 +1,814 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  device capabilities cache: stream formats and control descriptors           #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "device_cache.h"
+#include "neoguvc.h"
+#include "v4l2_controls.h"
+#include "v4l2_devices.h"
+#include "v4l2_formats.h"
+
+#define CAPS_CACHE_MAGIC "V4L2CAPC"
+#define CAPS_CACHE_VERSION (1)
+
+/*sanity limits for cache data*/
+#define CAPS_MAX_FORMATS (256)
+#define CAPS_MAX_RES (1024)
+#define CAPS_MAX_FRATES (256)
+#define CAPS_MAX_CONTROLS (1024)
+#define CAPS_MAX_MENU (256)
+
+/*FNV-1a (64 bit)*/
+#define FNV_OFFSET (0xcbf29ce484222325ULL)
+#define FNV_PRIME (0x100000001b3ULL)
+
+extern int verbosity;
+
+/*
+ * cache file header (native byte order)
+ *   followed by the format records, each with its resolutions
+ *   (width, height, number of frame rates, numerators, denominators),
+ *   and the control records (queryctrl, menu size, menu entries)
+ */
+typedef struct _caps_cache_header_t {
+  char magic[8];         // CAPS_CACHE_MAGIC
+  uint32_t version;      // CAPS_CACHE_VERSION
+  uint32_t num_formats;  // number of format records
+  uint32_t num_controls; // number of control records
+  uint32_t reserved;     // (zero)
+  uint64_t fingerprint;  // device capabilities fingerprint
+} caps_cache_header_t;
+
+typedef struct _caps_cache_format_t {
+  int32_t format;       // v4l2 pixel format
+  char fourcc[5];       // fourcc (mode)
+  char description[32]; // format description
+  uint8_t pad[3];       // (zero)
+  int32_t numb_res;     // number of resolution records
+} caps_cache_format_t;
+
+/*control record read from the cache*/
+typedef struct _caps_cache_control_t {
+  struct v4l2_queryctrl queryctrl;
+  struct v4l2_querymenu *menu;
+  int32_t menu_size; // menu list size (menu entries + end entry)
+} caps_cache_control_t;
+
+/*
+ * hashes a block of data (FNV-1a)
+ * args:
+ *   hash - current hash value
+ *   data - pointer to data
+ *   size - data size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: updated hash value
+ */
+static uint64_t hash_data(uint64_t hash, const void *data, size_t size) {
+  const uint8_t *p = (const uint8_t *)data;
+  size_t i = 0;
+  for (i = 0; i < size; i++) {
+    hash ^= p[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/*
+ * hashes an integer value
+ * args:
+ *   hash - current hash value
+ *   value - value to hash
+ *
+ * asserts:
+ *   none
+ *
+ * returns: updated hash value
+ */
+static uint64_t hash_value(uint64_t hash, int64_t value) {
+  return hash_data(hash, &value, sizeof(value));
+}
+
+/*
+ * computes the device capabilities fingerprint: driver data, pixel
+ *   formats, frame sizes and control descriptors (no frame intervals or
+ *   menus, so that it's much cheaper than a full enumeration)
+ * args:
+ *   fd - device file descriptor
+ *
+ * asserts:
+ *   none
+ *
+ * returns: fingerprint
+ */
+static uint64_t get_caps_fingerprint(int fd) {
+  uint64_t hash = FNV_OFFSET;
+
+  struct v4l2_capability cap;
+  memset(&cap, 0, sizeof(struct v4l2_capability));
+  if (xioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
+    hash = hash_data(hash, cap.driver, sizeof(cap.driver));
+    hash = hash_data(hash, cap.card, sizeof(cap.card));
+    hash = hash_value(hash, cap.version);
+  }
+
+  struct v4l2_fmtdesc fmt;
+  memset(&fmt, 0, sizeof(struct v4l2_fmtdesc));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  for (fmt.index = 0; xioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0; fmt.index++) {
+    hash = hash_value(hash, fmt.pixelformat);
+
+    struct v4l2_frmsizeenum fsize;
+    memset(&fsize, 0, sizeof(struct v4l2_frmsizeenum));
+    fsize.pixel_format = fmt.pixelformat;
+    for (fsize.index = 0; xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &fsize) == 0;
+         fsize.index++) {
+      hash = hash_value(hash, fsize.type);
+      if (fsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+        hash = hash_value(hash, fsize.discrete.width);
+        hash = hash_value(hash, fsize.discrete.height);
+      } else {
+        hash = hash_value(hash, fsize.stepwise.min_width);
+        hash = hash_value(hash, fsize.stepwise.max_width);
+        hash = hash_value(hash, fsize.stepwise.step_width);
+        hash = hash_value(hash, fsize.stepwise.min_height);
+        hash = hash_value(hash, fsize.stepwise.max_height);
+        hash = hash_value(hash, fsize.stepwise.step_height);
+      }
+    }
+  }
+
+  struct v4l2_queryctrl queryctrl;
+  memset(&queryctrl, 0, sizeof(struct v4l2_queryctrl));
+  queryctrl.id = V4L2_CTRL_FLAG_NEXT_CTRL;
+  while (xioctl(fd, VIDIOC_QUERYCTRL, &queryctrl) == 0) {
+    if (!(queryctrl.flags & V4L2_CTRL_FLAG_DISABLED)) {
+      hash = hash_value(hash, queryctrl.id);
+      hash = hash_value(hash, queryctrl.type);
+      hash = hash_value(hash, queryctrl.minimum);
+      hash = hash_value(hash, queryctrl.maximum);
+      hash = hash_value(hash, queryctrl.step);
+      hash = hash_value(hash, queryctrl.default_value);
+    }
+    queryctrl.id |= V4L2_CTRL_FLAG_NEXT_CTRL;
+  }
+
+  return hash;
+}
+
+/*
+ * gets the cache file path for the device
+ *   $XDG_CACHE_HOME/neoguvc/<vendor>_<product>_<bcdDevice>_<serial>.caps
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: allocated file path (NULL if the device can't be cached)
+ */
+static char *get_cache_file(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->is_virtual || vd->videodevice == NULL)
+    return NULL;
+
+  v4l2_device_list_t *device_list = get_device_list();
+  if (device_list == NULL || device_list->list_devices == NULL)
+    return NULL;
+
+  /*resolved by path: the list may have changed since the device opened*/
+  int index = v4l2core_get_this_device_index(vd);
+  if (index < 0 || index >= device_list->num_devices)
+    return NULL;
+
+  v4l2_dev_sys_data_t *sys = &device_list->list_devices[index];
+  /*only usb devices have a stable identity*/
+  if (sys->vendor == 0 || sys->device == NULL ||
+      strcmp(sys->device, vd->videodevice) != 0)
+    return NULL;
+
+  /*serial number (file name safe)*/
+  char serial[33] = "0";
+  if (sys->serial != NULL && sys->serial[0] != '\0') {
+    int i = 0;
+    for (i = 0; i < 32 && sys->serial[i] != '\0'; i++) {
+      char c = sys->serial[i];
+      if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+          (c >= 'A' && c <= 'Z') || c == '-')
+        serial[i] = c;
+      else
+        serial[i] = '_';
+    }
+    serial[i] = '\0';
+  }
+
+  char path[PATH_MAX];
+  const char *cache_home = getenv("XDG_CACHE_HOME");
+  int ret = 0;
+  if (cache_home != NULL && cache_home[0] == '/')
+    ret = snprintf(path, PATH_MAX, "%s/neoguvc/%04x_%04x_%04x_%s.caps",
+                   cache_home, sys->vendor, sys->product, sys->bcd_device,
+                   serial);
+  else {
+    const char *home = getenv("HOME");
+    if (home == NULL || home[0] != '/')
+      return NULL;
+    ret = snprintf(path, PATH_MAX, "%s/.cache/neoguvc/%04x_%04x_%04x_%s.caps",
+                   home, sys->vendor, sys->product, sys->bcd_device, serial);
+  }
+
+  if (ret < 0 || ret >= PATH_MAX)
+    return NULL;
+
+  return strdup(path);
+}
+
+/*
+ * creates the directory tree for a file
+ * args:
+ *   file - file path
+ *
+ * asserts:
+ *   file is not null
+ *
+ * returns: error code
+ */
+static int make_cache_dir(const char *file) {
+  /*assertions*/
+  assert(file != NULL);
+
+  char *dir = strdup(file);
+  if (dir == NULL)
+    return E_ALLOC_ERR;
+
+  char *p = NULL;
+  for (p = dir + 1; *p != '\0'; p++) {
+    if (*p != '/')
+      continue;
+
+    *p = '\0';
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+      fprintf(stderr, "V4L2_CORE: couldn't create cache dir %s: %s\n", dir,
+              strerror(errno));
+      free(dir);
+      return E_FILE_IO_ERR;
+    }
+    *p = '/';
+  }
+
+  free(dir);
+  return E_OK;
+}
+
+/*
+ * writes a block of data
+ * args:
+ *   fp - pointer to file
+ *   data - pointer to data
+ *   size - data size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, 1 on error
+ */
+static int write_data(FILE *fp, const void *data, size_t size) {
+  if (size == 0)
+    return 0;
+  return (fwrite(data, size, 1, fp) == 1) ? 0 : 1;
+}
+
+/*
+ * reads a block of data
+ * args:
+ *   fp - pointer to file
+ *   data - pointer to data
+ *   size - data size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, 1 on error
+ */
+static int read_data(FILE *fp, void *data, size_t size) {
+  if (size == 0)
+    return 0;
+  return (fread(data, size, 1, fp) == 1) ? 0 : 1;
+}
+
+/*
+ * gets the size of a control menu list
+ *   (the list ends with an entry past the control maximum)
+ * args:
+ *   control - pointer to control
+ *
+ * asserts:
+ *   control is not null
+ *
+ * returns: menu list size, including the end entry (0 if not a menu)
+ */
+static int32_t get_menu_size(v4l2_ctrl_t *control) {
+  /*assertions*/
+  assert(control != NULL);
+
+  if (control->menu == NULL)
+    return 0;
+
+  int32_t n = 0;
+  while (n < CAPS_MAX_MENU &&
+         (int64_t)control->menu[n].index <= control->control.maximum)
+    n++;
+
+  return n + 1;
+}
+
+/*
+ * saves the enumerated stream formats and control descriptors
+ *   to the capabilities cache
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *
+ * returns: error code
+ */
+int save_device_cache(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(vd->fd > 0);
+
+  char *file = get_cache_file(vd);
+  if (file == NULL)
+    return E_NO_DATA;
+
+  if (make_cache_dir(file) != E_OK) {
+    free(file);
+    return E_FILE_IO_ERR;
+  }
+
+  /*write to a temporary file and rename it (never leave a partial cache)*/
+  size_t tmp_size = strlen(file) + 5;
+  char *tmp_file = calloc(tmp_size, sizeof(char));
+  if (tmp_file == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (save_device_cache): "
+            "%s\n",
+            strerror(errno));
+    exit(-1);
+  }
+  snprintf(tmp_file, tmp_size, "%s.tmp", file);
+
+  FILE *fp = fopen(tmp_file, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "V4L2_CORE: couldn't open cache file %s: %s\n", tmp_file,
+            strerror(errno));
+    free(tmp_file);
+    free(file);
+    return E_FILE_IO_ERR;
+  }
+
+  caps_cache_header_t header;
+  memset(&header, 0, sizeof(caps_cache_header_t));
+  memcpy(header.magic, CAPS_CACHE_MAGIC, 8);
+  header.version = CAPS_CACHE_VERSION;
+  header.num_formats = vd->numb_formats;
+  header.fingerprint = get_caps_fingerprint(vd->fd);
+
+  v4l2_ctrl_t *current = vd->list_device_controls;
+  for (; current != NULL; current = current->next)
+    header.num_controls++;
+
+  int err = write_data(fp, &header, sizeof(caps_cache_header_t));
+
+  int i = 0;
+  for (i = 0; i < vd->numb_formats && !err; i++) {
+    v4l2_stream_formats_t *fmt = &vd->list_stream_formats[i];
+
+    caps_cache_format_t record;
+    memset(&record, 0, sizeof(caps_cache_format_t));
+    record.format = fmt->format;
+    memcpy(record.fourcc, fmt->fourcc, sizeof(record.fourcc));
+    memcpy(record.description, fmt->description, sizeof(record.description));
+    record.numb_res = fmt->list_stream_cap ? fmt->numb_res : 0;
+    err |= write_data(fp, &record, sizeof(caps_cache_format_t));
+
+    int j = 0;
+    for (j = 0; j < record.numb_res && !err; j++) {
+      v4l2_stream_cap_t *cap = &fmt->list_stream_cap[j];
+      int32_t res[3] = {cap->width, cap->height, cap->numb_frates};
+      if (cap->framerate_num == NULL || cap->framerate_denom == NULL)
+        res[2] = 0;
+      err |= write_data(fp, res, sizeof(res));
+      err |= write_data(fp, cap->framerate_num, res[2] * sizeof(int));
+      err |= write_data(fp, cap->framerate_denom, res[2] * sizeof(int));
+    }
+  }
+
+  for (current = vd->list_device_controls; current != NULL && !err;
+       current = current->next) {
+    int32_t menu_size = get_menu_size(current);
+
+    err |= write_data(fp, &current->control, sizeof(struct v4l2_queryctrl));
+    err |= write_data(fp, &menu_size, sizeof(int32_t));
+    err |= write_data(fp, current->menu,
+                      menu_size * sizeof(struct v4l2_querymenu));
+  }
+
+  if (fclose(fp) != 0)
+    err = 1;
+
+  if (err || rename(tmp_file, file) != 0) {
+    fprintf(stderr, "V4L2_CORE: couldn't write cache file %s: %s\n", file,
+            strerror(errno));
+    unlink(tmp_file);
+    free(tmp_file);
+    free(file);
+    return E_FILE_IO_ERR;
+  }
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: saved device capabilities to %s\n", file);
+
+  vd->caps_fingerprint = header.fingerprint;
+
+  free(tmp_file);
+  free(file);
+  return E_OK;
+}
+
+/*
+ * reads the format records from the cache file into vd->list_stream_formats
+ * args:
+ *   vd - pointer to video device data
+ *   fp - pointer to cache file
+ *   num_formats - number of format records
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->list_stream_formats is null
+ *
+ * returns: error code (the list is left allocated on error)
+ */
+static int read_cache_formats(v4l2_dev_t *vd, FILE *fp, int num_formats) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(vd->list_stream_formats == NULL);
+
+  vd->list_stream_formats = calloc(num_formats, sizeof(v4l2_stream_formats_t));
+  if (vd->list_stream_formats == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (read_cache_formats): "
+            "%s\n",
+            strerror(errno));
+    exit(-1);
+  }
+  vd->numb_formats = num_formats;
+
+  int valid_formats = 0;
+  int i = 0;
+  for (i = 0; i < num_formats; i++) {
+    v4l2_stream_formats_t *fmt = &vd->list_stream_formats[i];
+
+    caps_cache_format_t record;
+    if (read_data(fp, &record, sizeof(caps_cache_format_t)) ||
+        record.numb_res < 0 || record.numb_res > CAPS_MAX_RES)
+      return E_FILE_IO_ERR;
+
+    fmt->format = record.format;
+    memcpy(fmt->fourcc, record.fourcc, sizeof(fmt->fourcc));
+    fmt->fourcc[4] = '\0';
+    memcpy(fmt->description, record.description, sizeof(fmt->description));
+    fmt->description[31] = '\0';
+    /*decoder support depends on this build, not on the device*/
+    fmt->dec_support = can_decode_format(record.format);
+
+    if (record.numb_res == 0)
+      continue;
+
+    fmt->list_stream_cap = calloc(record.numb_res, sizeof(v4l2_stream_cap_t));
+    if (fmt->list_stream_cap == NULL) {
+      fprintf(stderr,
+              "V4L2_CORE: FATAL memory allocation failure "
+              "(read_cache_formats): %s\n",
+              strerror(errno));
+      exit(-1);
+    }
+    fmt->numb_res = record.numb_res;
+
+    int j = 0;
+    for (j = 0; j < fmt->numb_res; j++) {
+      v4l2_stream_cap_t *cap = &fmt->list_stream_cap[j];
+
+      int32_t res[3] = {0, 0, 0};
+      if (read_data(fp, res, sizeof(res)) || res[0] <= 0 || res[1] <= 0 ||
+          res[2] < 0 || res[2] > CAPS_MAX_FRATES)
+        return E_FILE_IO_ERR;
+
+      cap->width = res[0];
+      cap->height = res[1];
+      if (res[2] == 0)
+        continue;
+
+      cap->framerate_num = calloc(res[2], sizeof(int));
+      cap->framerate_denom = calloc(res[2], sizeof(int));
+      if (cap->framerate_num == NULL || cap->framerate_denom == NULL) {
+        fprintf(stderr,
+                "V4L2_CORE: FATAL memory allocation failure "
+                "(read_cache_formats): %s\n",
+                strerror(errno));
+        exit(-1);
+      }
+      cap->numb_frates = res[2];
+
+      if (read_data(fp, cap->framerate_num, res[2] * sizeof(int)) ||
+          read_data(fp, cap->framerate_denom, res[2] * sizeof(int)))
+        return E_FILE_IO_ERR;
+    }
+
+    if (fmt->dec_support)
+      valid_formats++;
+  }
+
+  /*same rule as enum_frame_formats*/
+  return (valid_formats > 0) ? E_OK : E_DEVICE_ERR;
+}
+
+/*
+ * reads the control records from the cache file
+ * args:
+ *   fp - pointer to cache file
+ *   controls - control records list
+ *   num_controls - number of control records
+ *
+ * asserts:
+ *   controls is not null
+ *
+ * returns: error code (menus read so far are left allocated on error)
+ */
+static int read_cache_controls(FILE *fp, caps_cache_control_t *controls,
+                               int num_controls) {
+  /*assertions*/
+  assert(controls != NULL);
+
+  int i = 0;
+  for (i = 0; i < num_controls; i++) {
+    if (read_data(fp, &controls[i].queryctrl, sizeof(struct v4l2_queryctrl)) ||
+        read_data(fp, &controls[i].menu_size, sizeof(int32_t)) ||
+        controls[i].menu_size < 0 ||
+        controls[i].menu_size > CAPS_MAX_MENU + 1)
+      return E_FILE_IO_ERR;
+
+    /*string controls allocate maximum + 1 bytes*/
+    if (controls[i].queryctrl.type == V4L2_CTRL_TYPE_STRING &&
+        (controls[i].queryctrl.maximum < 0 ||
+         controls[i].queryctrl.maximum > 65535))
+      return E_FILE_IO_ERR;
+
+    if (controls[i].menu_size == 0)
+      continue;
+
+    controls[i].menu =
+        calloc(controls[i].menu_size, sizeof(struct v4l2_querymenu));
+    if (controls[i].menu == NULL) {
+      fprintf(stderr,
+              "V4L2_CORE: FATAL memory allocation failure "
+              "(read_cache_controls): %s\n",
+              strerror(errno));
+      exit(-1);
+    }
+
+    if (read_data(fp, controls[i].menu,
+                  controls[i].menu_size * sizeof(struct v4l2_querymenu)))
+      return E_FILE_IO_ERR;
+  }
+
+  return E_OK;
+}
+
+/*
+ * loads the stream formats and control descriptors of a (usb) device
+ *   from the capabilities cache, skipping the device enumeration
+ *   (the cache is keyed by vendor, product, bcdDevice and serial)
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *   vd->list_stream_formats is null
+ *   vd->list_device_controls is null
+ *
+ * returns: error code (E_OK if the lists were restored)
+ */
+int load_device_cache(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(vd->fd > 0);
+  assert(vd->list_stream_formats == NULL);
+  assert(vd->list_device_controls == NULL);
+
+  char *file = get_cache_file(vd);
+  if (file == NULL)
+    return E_NO_DATA;
+
+  FILE *fp = fopen(file, "rb");
+  if (fp == NULL) {
+    if (verbosity > 0)
+      printf("V4L2_CORE: no capabilities cache for device (%s)\n", file);
+    free(file);
+    return E_NO_DATA;
+  }
+
+  caps_cache_header_t header;
+  if (read_data(fp, &header, sizeof(caps_cache_header_t)) ||
+      memcmp(header.magic, CAPS_CACHE_MAGIC, 8) != 0 ||
+      header.version != CAPS_CACHE_VERSION || header.num_formats == 0 ||
+      header.num_formats > CAPS_MAX_FORMATS ||
+      header.num_controls > CAPS_MAX_CONTROLS) {
+    fprintf(stderr, "V4L2_CORE: invalid capabilities cache %s (ignored)\n",
+            file);
+    fclose(fp);
+    free(file);
+    return E_FILE_IO_ERR;
+  }
+
+  caps_cache_control_t *controls = NULL;
+  if (header.num_controls > 0) {
+    controls = calloc(header.num_controls, sizeof(caps_cache_control_t));
+    if (controls == NULL) {
+      fprintf(stderr,
+              "V4L2_CORE: FATAL memory allocation failure "
+              "(load_device_cache): %s\n",
+              strerror(errno));
+      exit(-1);
+    }
+  }
+
+  int ret = read_cache_formats(vd, fp, header.num_formats);
+  if (ret == E_OK && controls != NULL)
+    ret = read_cache_controls(fp, controls, header.num_controls);
+
+  fclose(fp);
+
+  int i = 0;
+  if (ret != E_OK) {
+    fprintf(stderr, "V4L2_CORE: invalid capabilities cache %s (ignored)\n",
+            file);
+    free_frame_formats(vd);
+    vd->numb_formats = 0;
+    for (i = 0; controls != NULL && i < (int)header.num_controls; i++)
+      free(controls[i].menu);
+    free(controls);
+    free(file);
+    return ret;
+  }
+
+  /*the control list takes ownership of the menus*/
+  vd->num_controls = 0;
+  for (i = 0; i < (int)header.num_controls; i++) {
+    int menu_entries = controls[i].menu_size ? controls[i].menu_size - 1 : 0;
+    restore_v4l2_control(vd, &controls[i].queryctrl, controls[i].menu,
+                         menu_entries);
+  }
+  free(controls);
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: restored %i formats and %i controls from %s\n",
+           vd->numb_formats, vd->num_controls, file);
+
+  vd->caps_fingerprint = header.fingerprint;
+  vd->caps_cache_file = file;
+
+  return E_OK;
+}
+
+/*
+ * cache verification thread: invalidates a stale cache
+ * args:
+ *   data - pointer to video device data
+ *
+ * asserts:
+ *   data is not null
+ *
+ * returns: NULL
+ */
+static void *verify_cache_thread(void *data) {
+  v4l2_dev_t *vd = (v4l2_dev_t *)data;
+
+  /*assertions*/
+  assert(vd != NULL);
+
+  uint64_t fingerprint = get_caps_fingerprint(vd->fd);
+
+  if (fingerprint == vd->caps_fingerprint) {
+    if (verbosity > 1)
+      printf("V4L2_CORE: capabilities cache %s verified\n",
+             vd->caps_cache_file);
+    return NULL;
+  }
+
+  fprintf(stderr,
+          "V4L2_CORE: device capabilities changed, cache %s is stale\n",
+          vd->caps_cache_file);
+
+  if (unlink(vd->caps_cache_file) != 0 && errno != ENOENT)
+    fprintf(stderr, "V4L2_CORE: couldn't remove cache file %s: %s\n",
+            vd->caps_cache_file, strerror(errno));
+
+  /*the lists belong to the owner thread: flag them for enumeration*/
+  __atomic_store_n(&vd->caps_stale, 1, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+/*
+ * starts the background verification of a loaded cache: compares the
+ *   cached fingerprint with a fresh (cheap) one and on mismatch removes
+ *   the cache and flags the device (see v4l2core_check_device_caps)
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void verify_device_cache(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->caps_cache_file == NULL || vd->caps_verify_on)
+    return;
+
+  if (__THREAD_CREATE(&vd->caps_verify_thread, verify_cache_thread, vd)) {
+    fprintf(stderr, "V4L2_CORE: (device cache) verification thread creation "
+                    "failed\n");
+    return;
+  }
+
+  vd->caps_verify_on = 1;
+}
+
+/*
+ * waits for the cache verification and frees the cache data
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void close_device_cache(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->caps_verify_on) {
+    __THREAD_JOIN(vd->caps_verify_thread);
+    vd->caps_verify_on = 0;
+  }
+
+  free(vd->caps_cache_file);
+  vd->caps_cache_file = NULL;
+}
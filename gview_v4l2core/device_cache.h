@@ -0,0 +1,86 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef DEVICE_CACHE_H
+#define DEVICE_CACHE_H
+
+#include "v4l2_core.h"
+
+/*
+ * loads the stream formats and control descriptors of a (usb) device
+ *   from the capabilities cache, skipping the device enumeration
+ *   (the cache is keyed by vendor, product, bcdDevice and serial)
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *   vd->list_stream_formats is null
+ *   vd->list_device_controls is null
+ *
+ * returns: error code (E_OK if the lists were restored)
+ */
+int load_device_cache(v4l2_dev_t *vd);
+
+/*
+ * saves the enumerated stream formats and control descriptors
+ *   to the capabilities cache
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *
+ * returns: error code
+ */
+int save_device_cache(v4l2_dev_t *vd);
+
+/*
+ * starts the background verification of a loaded cache: compares the
+ *   cached fingerprint with a fresh (cheap) one and on mismatch removes
+ *   the cache and flags the device (see v4l2core_check_device_caps)
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void verify_device_cache(v4l2_dev_t *vd);
+
+/*
+ * waits for the cache verification and frees the cache data
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void close_device_cache(v4l2_dev_t *vd);
+
+#endif
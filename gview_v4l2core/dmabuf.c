@@ -0,0 +1,508 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  V4L2 dmabuf export/import and frame handoff over unix sockets               #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "dmabuf.h"
+#include "neoguvc.h"
+
+#define DMA_HEAP_SYSTEM "/dev/dma_heap/system"
+
+extern int verbosity;
+
+/*
+ * exports the (mmap) driver buffers as dmabuf file descriptors
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int export_dmabuf_buffers(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  /*buffers may be re-queried (fps change): drop the old exports*/
+  close_dmabuf_buffers(vd);
+
+  int i = 0;
+  for (i = 0; i < vd->nb_buffers; i++) {
+    struct v4l2_exportbuffer expbuf;
+    memset(&expbuf, 0, sizeof(struct v4l2_exportbuffer));
+    expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    expbuf.index = i;
+    expbuf.flags = O_RDONLY | O_CLOEXEC;
+
+    if (xioctl(vd->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+      fprintf(stderr,
+              "V4L2_CORE: (VIDIOC_EXPBUF) Unable to export buffer[%i]: %s\n",
+              i, strerror(errno));
+      close_dmabuf_buffers(vd);
+      return E_DMABUF_ERR;
+    }
+
+    vd->dmabuf_fd[i] = expbuf.fd;
+
+    if (verbosity > 1)
+      printf("V4L2_CORE: exported buffer[%i] as dmabuf fd %i\n", i,
+             expbuf.fd);
+  }
+
+  return E_OK;
+}
+
+/*
+ * closes the exported dmabuf file descriptors (if any)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void close_dmabuf_buffers(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  /*imported dmabufs belong to the caller*/
+  if (vd->cap_meth == IO_DMABUF)
+    return;
+
+  int i = 0;
+  for (i = 0; i < V4L2_MAX_BUFFERS; i++) {
+    if (vd->dmabuf_fd[i] >= 0)
+      close(vd->dmabuf_fd[i]);
+    vd->dmabuf_fd[i] = -1;
+  }
+}
+
+/*
+ * maps the imported dmabufs for cpu access (vd->mem)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int map_dmabuf_buffers(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  int i = 0;
+  for (i = 0; i < vd->nb_buffers; i++) {
+    vd->mem[i] = mmap(NULL, vd->buff_length[i], PROT_READ, MAP_SHARED,
+                      vd->dmabuf_fd[i], 0);
+    if (vd->mem[i] == MAP_FAILED) {
+      fprintf(stderr, "V4L2_CORE: Unable to map dmabuf %i: %s\n",
+              vd->dmabuf_fd[i], strerror(errno));
+      return E_MMAP_ERR;
+    }
+    if (verbosity > 1)
+      printf("V4L2_CORE: mapped dmabuf[%i] (fd %i) with length %i to pos %p\n",
+             i, vd->dmabuf_fd[i], vd->buff_length[i], vd->mem[i]);
+  }
+
+  return E_OK;
+}
+
+/*
+ * unmaps the imported dmabufs
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void unmap_dmabuf_buffers(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  int i = 0;
+  for (i = 0; i < vd->nb_buffers; i++) {
+    if (vd->mem[i] != NULL && vd->mem[i] != MAP_FAILED)
+      munmap(vd->mem[i], vd->buff_length[i]);
+    vd->mem[i] = NULL;
+  }
+}
+
+/*
+ * brackets cpu access to an imported dmabuf (DMA_BUF_IOCTL_SYNC)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   index - buffer index
+ *   start - 1 before cpu access, 0 after it
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int sync_dmabuf_buffer(v4l2_dev_t *vd, int index, int start) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->cap_meth != IO_DMABUF || index < 0 || index >= vd->nb_buffers)
+    return E_OK;
+
+  struct dma_buf_sync sync;
+  sync.flags =
+      DMA_BUF_SYNC_READ | (start ? DMA_BUF_SYNC_START : DMA_BUF_SYNC_END);
+
+  if (ioctl(vd->dmabuf_fd[index], DMA_BUF_IOCTL_SYNC, &sync) < 0) {
+    if (verbosity > 1)
+      fprintf(stderr, "V4L2_CORE: (DMA_BUF_IOCTL_SYNC) dmabuf[%i]: %s\n",
+              index, strerror(errno));
+    return E_DMABUF_ERR;
+  }
+
+  return E_OK;
+}
+
+/*
+ * exports the capture buffers as dmabufs (IO_MMAP only)
+ *   must be set before setting the stream format
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   enable - 1 to export the buffers, 0 to stop exporting
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_dmabuf_export(v4l2_dev_t *vd, int enable) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->cap_meth != IO_MMAP) {
+    fprintf(stderr, "V4L2_CORE: dmabuf export requires the mmap method\n");
+    return E_DMABUF_ERR;
+  }
+
+  vd->dmabuf_export = enable ? 1 : 0;
+
+  return E_OK;
+}
+
+/*
+ * imports external dmabufs as capture buffers (sets IO_DMABUF method)
+ *   must be set before setting the stream format; the dmabufs
+ *   still belong to the caller and must outlive the stream
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   fds - NB_BUFFER dmabuf file descriptors
+ *   length - size of each dmabuf (>= frame size image)
+ *
+ * asserts:
+ *   vd is not null
+ *   fds is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_dmabuf_import(v4l2_dev_t *vd, const int *fds,
+                               uint32_t length) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(fds != NULL);
+
+  int i = 0;
+  for (i = 0; i < NB_BUFFER; i++) {
+    if (fds[i] < 0) {
+      fprintf(stderr, "V4L2_CORE: invalid dmabuf fd for buffer[%i]\n", i);
+      return E_DMABUF_ERR;
+    }
+  }
+
+  /*drop any exported buffer fds*/
+  close_dmabuf_buffers(vd);
+
+  vd->cap_meth = IO_DMABUF;
+  vd->dmabuf_export = 0;
+  /*the caller owns a fixed set of buffers: no buffer autotuning*/
+  vd->nb_buffers = NB_BUFFER;
+  vd->req_nb_buffers = NB_BUFFER;
+  for (i = 0; i < NB_BUFFER; i++) {
+    vd->dmabuf_fd[i] = fds[i];
+    vd->buff_length[i] = length;
+  }
+
+  return E_OK;
+}
+
+/*
+ * gets the dmabuf file descriptor of the frame buffer
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   vd is not null
+ *   frame is not null
+ *
+ * returns: dmabuf fd (owned by the device) or -1 if none
+ */
+int v4l2core_get_frame_dmabuf_fd(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(frame != NULL);
+
+  if (frame->index < 0 || frame->index >= vd->nb_buffers)
+    return -1;
+
+  return vd->dmabuf_fd[frame->index];
+}
+
+/*
+ * allocates a dmabuf from the system dma heap
+ * args:
+ *   size - buffer size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: dmabuf fd (-1 on error)
+ */
+int v4l2core_dmabuf_alloc(uint32_t size) {
+  int heap_fd = open(DMA_HEAP_SYSTEM, O_RDONLY | O_CLOEXEC);
+  if (heap_fd < 0) {
+    fprintf(stderr, "V4L2_CORE: couldn't open %s: %s\n", DMA_HEAP_SYSTEM,
+            strerror(errno));
+    return -1;
+  }
+
+  struct dma_heap_allocation_data data;
+  memset(&data, 0, sizeof(struct dma_heap_allocation_data));
+  data.len = size;
+  data.fd_flags = O_RDWR | O_CLOEXEC;
+
+  int ret = ioctl(heap_fd, DMA_HEAP_IOCTL_ALLOC, &data);
+  close(heap_fd);
+
+  if (ret < 0) {
+    fprintf(stderr, "V4L2_CORE: (DMA_HEAP_IOCTL_ALLOC) %u bytes: %s\n", size,
+            strerror(errno));
+    return -1;
+  }
+
+  return (int)data.fd;
+}
+
+/*
+ * sends the frame dmabuf (and its description) over a unix socket
+ *   the frame must only be released after the peer sends it back
+ *   (v4l2core_dmabuf_recv_release)
+ * args:
+ *   sock - connected unix socket
+ *   vd - pointer to v4l2 device handler
+ *   frame - pointer to frame buffer (with an exported or imported dmabuf)
+ *
+ * asserts:
+ *   vd is not null
+ *   frame is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_dmabuf_send_frame(int sock, v4l2_dev_t *vd,
+                               v4l2_frame_buff_t *frame) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(frame != NULL);
+
+  int fd = v4l2core_get_frame_dmabuf_fd(vd, frame);
+  if (fd < 0) {
+    fprintf(stderr, "V4L2_CORE: frame %i has no dmabuf\n", frame->index);
+    return E_DMABUF_ERR;
+  }
+
+  v4l2_dmabuf_frame_t info;
+  memset(&info, 0, sizeof(v4l2_dmabuf_frame_t));
+  info.index = frame->index;
+  info.width = vd->format.fmt.pix.width;
+  info.height = vd->format.fmt.pix.height;
+  info.pixelformat = vd->format.fmt.pix.pixelformat;
+  info.bytesperline = vd->format.fmt.pix.bytesperline;
+  info.bytesused = (uint32_t)frame->raw_frame_size;
+  info.length = vd->buff_length[frame->index];
+  info.timestamp = frame->timestamp;
+
+  struct iovec iov;
+  iov.iov_base = &info;
+  iov.iov_len = sizeof(v4l2_dmabuf_frame_t);
+
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  memset(&control, 0, sizeof(control));
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(struct msghdr));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) < 0) {
+    fprintf(stderr, "V4L2_CORE: (dmabuf) sendmsg error: %s\n",
+            strerror(errno));
+    return E_DMABUF_ERR;
+  }
+
+  return E_OK;
+}
+
+/*
+ * receives a frame dmabuf sent with v4l2core_dmabuf_send_frame
+ * args:
+ *   sock - connected unix socket
+ *   info - pointer to frame description (filled by the function)
+ *
+ * asserts:
+ *   info is not null
+ *
+ * returns: received dmabuf fd (owned by the caller) or -1 on error
+ */
+int v4l2core_dmabuf_recv_frame(int sock, v4l2_dmabuf_frame_t *info) {
+  /*assertions*/
+  assert(info != NULL);
+
+  struct iovec iov;
+  iov.iov_base = info;
+  iov.iov_len = sizeof(v4l2_dmabuf_frame_t);
+
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(struct msghdr));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  if (n < 0) {
+    fprintf(stderr, "V4L2_CORE: (dmabuf) recvmsg error: %s\n",
+            strerror(errno));
+    return -1;
+  }
+
+  /*take the fd first: an error below must not leak it*/
+  int fd = -1;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len >= CMSG_LEN(sizeof(int)))
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+  if (n != (ssize_t)sizeof(v4l2_dmabuf_frame_t) ||
+      (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+    if (n > 0) /*0 - sender closed the socket*/
+      fprintf(stderr, "V4L2_CORE: (dmabuf) truncated frame message\n");
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+
+  if (fd < 0) {
+    fprintf(stderr, "V4L2_CORE: (dmabuf) message without a dmabuf fd\n");
+    return -1;
+  }
+
+  return fd;
+}
+
+/*
+ * tells the sender that a received frame is no longer in use
+ * args:
+ *   sock - connected unix socket
+ *   index - frame index (v4l2_dmabuf_frame_t.index)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_dmabuf_send_release(int sock, int index) {
+  int32_t msg = index;
+  if (send(sock, &msg, sizeof(int32_t), MSG_NOSIGNAL) !=
+      (ssize_t)sizeof(int32_t)) {
+    fprintf(stderr, "V4L2_CORE: (dmabuf) release send error: %s\n",
+            strerror(errno));
+    return E_DMABUF_ERR;
+  }
+
+  return E_OK;
+}
+
+/*
+ * waits for the peer to release a frame sent with v4l2core_dmabuf_send_frame
+ * args:
+ *   sock - connected unix socket
+ *
+ * asserts:
+ *   none
+ *
+ * returns: released frame index (-1 on error)
+ */
+int v4l2core_dmabuf_recv_release(int sock) {
+  int32_t msg = -1;
+  if (recv(sock, &msg, sizeof(int32_t), MSG_WAITALL) !=
+      (ssize_t)sizeof(int32_t))
+    return -1;
+
+  return msg;
+}
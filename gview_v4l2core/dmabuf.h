@@ -0,0 +1,92 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef DMABUF_H
+#define DMABUF_H
+
+#include "neoguvc_v4l2core.h"
+#include "v4l2_core.h"
+
+/*
+ * exports the (mmap) driver buffers as dmabuf file descriptors
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int export_dmabuf_buffers(v4l2_dev_t *vd);
+
+/*
+ * closes the exported dmabuf file descriptors (if any)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void close_dmabuf_buffers(v4l2_dev_t *vd);
+
+/*
+ * maps the imported dmabufs for cpu access (vd->mem)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int map_dmabuf_buffers(v4l2_dev_t *vd);
+
+/*
+ * unmaps the imported dmabufs
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void unmap_dmabuf_buffers(v4l2_dev_t *vd);
+
+/*
+ * brackets cpu access to an imported dmabuf (DMA_BUF_IOCTL_SYNC)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   index - buffer index
+ *   start - 1 before cpu access, 0 after it
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int sync_dmabuf_buffer(v4l2_dev_t *vd, int index, int start);
+
+#endif
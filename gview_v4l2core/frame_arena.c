@@ -0,0 +1,201 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "frame_arena.h"
+#include "neoguvc_v4l2core.h"
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26) /*MAP_HUGE_SHIFT = 26*/
+#endif
+
+#define ARENA_HUGEPAGE_SIZE (2 * 1024 * 1024)
+#define ARENA_CACHE_LINE (64)
+
+extern int verbosity;
+
+/*
+ * maps the arena (2 MB hugepages if available) and locks it in memory
+ * args:
+ *   arena - pointer to frame arena
+ *   size - minimum arena size in bytes
+ *
+ * asserts:
+ *   arena is not null
+ *   size > 0
+ *
+ * returns: error code (E_OK)
+ */
+int frame_arena_init(frame_arena_t *arena, size_t size) {
+  /*assertions*/
+  assert(arena != NULL);
+  assert(size > 0);
+
+  memset(arena, 0, sizeof(frame_arena_t));
+
+  arena->size =
+      (size + ARENA_HUGEPAGE_SIZE - 1) & ~((size_t)ARENA_HUGEPAGE_SIZE - 1);
+
+  /*try the hugetlb pool first (needs vm.nr_hugepages)*/
+  void *base = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+                    -1, 0);
+
+  if (base != MAP_FAILED)
+    arena->hugepages = 1;
+  else {
+    /*
+     * fall back to regular pages: map an extra hugepage so the arena
+     * can be aligned for transparent hugepages (MADV_HUGEPAGE)
+     */
+    size_t map_size = arena->size + ARENA_HUGEPAGE_SIZE;
+    uint8_t *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+      fprintf(stderr, "V4L2_CORE: couldn't map frame arena (%zu bytes): %s\n",
+              arena->size, strerror(errno));
+      arena->size = 0;
+      return E_ALLOC_ERR;
+    }
+
+    uint8_t *aligned =
+        (uint8_t *)(((uintptr_t)map + ARENA_HUGEPAGE_SIZE - 1) &
+                    ~((uintptr_t)ARENA_HUGEPAGE_SIZE - 1));
+    /*trim the unaligned head and tail*/
+    if (aligned > map)
+      munmap(map, aligned - map);
+    if (aligned + arena->size < map + map_size)
+      munmap(aligned + arena->size, (map + map_size) - (aligned + arena->size));
+
+    base = aligned;
+    if (madvise(base, arena->size, MADV_HUGEPAGE) == 0)
+      arena->hugepages = 2;
+  }
+
+  arena->base = base;
+
+  /*lock the arena (also faults in every page up front)*/
+  if (mlock(arena->base, arena->size) == 0)
+    arena->locked = 1;
+  else if (verbosity > 0)
+    fprintf(stderr,
+            "V4L2_CORE: couldn't lock frame arena (%zu bytes): %s "
+            "(check RLIMIT_MEMLOCK)\n",
+            arena->size, strerror(errno));
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: frame arena of %zu bytes (%s pages%s)\n", arena->size,
+           arena->hugepages == 1   ? "hugetlb"
+           : arena->hugepages == 2 ? "transparent huge"
+                                   : "regular",
+           arena->locked ? ", locked" : "");
+
+  return E_OK;
+}
+
+/*
+ * allocates a zeroed buffer from the arena (cache line aligned)
+ * args:
+ *   arena - pointer to frame arena
+ *   size - buffer size in bytes
+ *   align - buffer alignment (power of 2, 0 for cache line alignment)
+ *
+ * asserts:
+ *   arena is not null
+ *
+ * returns: pointer to buffer (NULL if the arena is full)
+ */
+void *frame_arena_alloc(frame_arena_t *arena, size_t size, size_t align) {
+  /*assertions*/
+  assert(arena != NULL);
+
+  if (arena->base == NULL)
+    return NULL;
+
+  if (align < ARENA_CACHE_LINE)
+    align = ARENA_CACHE_LINE;
+
+  size_t offset = (arena->used + align - 1) & ~(align - 1);
+  if (offset + size > arena->size) {
+    fprintf(stderr,
+            "V4L2_CORE: frame arena is full (%zu of %zu bytes, %zu requested)\n",
+            arena->used, arena->size, size);
+    return NULL;
+  }
+
+  arena->used = offset + size;
+
+  /*anonymous mappings are zero filled and the arena is never reused*/
+  return arena->base + offset;
+}
+
+/*
+ * checks if the buffer was allocated from the arena
+ * args:
+ *   arena - pointer to frame arena
+ *   ptr - pointer to buffer
+ *
+ * asserts:
+ *   arena is not null
+ *
+ * returns: 1 if ptr is in the arena, 0 otherwise
+ */
+int frame_arena_owns(frame_arena_t *arena, const void *ptr) {
+  /*assertions*/
+  assert(arena != NULL);
+
+  if (arena->base == NULL || ptr == NULL)
+    return 0;
+
+  return ((const uint8_t *)ptr >= arena->base &&
+          (const uint8_t *)ptr < arena->base + arena->size);
+}
+
+/*
+ * unmaps the arena (all arena buffers become invalid)
+ * args:
+ *   arena - pointer to frame arena
+ *
+ * asserts:
+ *   arena is not null
+ *
+ * returns: none
+ */
+void frame_arena_clean(frame_arena_t *arena) {
+  /*assertions*/
+  assert(arena != NULL);
+
+  if (arena->base == NULL)
+    return;
+
+  if (arena->locked)
+    munlock(arena->base, arena->size);
+  munmap(arena->base, arena->size);
+
+  memset(arena, 0, sizeof(frame_arena_t));
+}
@@ -0,0 +1,95 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * single mapping holding the raw (USERPTR) capture buffers and the
+ * decode outputs of the frame queue (bump allocated, freed as a whole)
+ */
+typedef struct _frame_arena_t {
+  uint8_t *base; // arena mapping (NULL if not in use)
+  size_t size;   // mapping size (multiple of the hugepage size)
+  size_t used;   // allocated bytes
+  int hugepages; // 1: hugetlb pages, 2: transparent hugepages, 0: none
+  int locked;    // mapping is locked in memory (mlock)
+} frame_arena_t;
+
+/*
+ * maps the arena (2 MB hugepages if available) and locks it in memory
+ * args:
+ *   arena - pointer to frame arena
+ *   size - minimum arena size in bytes
+ *
+ * asserts:
+ *   arena is not null
+ *   size > 0
+ *
+ * returns: error code (E_OK)
+ */
+int frame_arena_init(frame_arena_t *arena, size_t size);
+
+/*
+ * allocates a zeroed buffer from the arena (cache line aligned)
+ * args:
+ *   arena - pointer to frame arena
+ *   size - buffer size in bytes
+ *   align - buffer alignment (power of 2, 0 for cache line alignment)
+ *
+ * asserts:
+ *   arena is not null
+ *
+ * returns: pointer to buffer (NULL if the arena is full)
+ */
+void *frame_arena_alloc(frame_arena_t *arena, size_t size, size_t align);
+
+/*
+ * checks if the buffer was allocated from the arena
+ * args:
+ *   arena - pointer to frame arena
+ *   ptr - pointer to buffer
+ *
+ * asserts:
+ *   arena is not null
+ *
+ * returns: 1 if ptr is in the arena, 0 otherwise
+ */
+int frame_arena_owns(frame_arena_t *arena, const void *ptr);
+
+/*
+ * unmaps the arena (all arena buffers become invalid)
+ * args:
+ *   arena - pointer to frame arena
+ *
+ * asserts:
+ *   arena is not null
+ *
+ * returns: none
+ */
+void frame_arena_clean(frame_arena_t *arena);
+
+#endif
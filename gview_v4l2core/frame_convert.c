@@ -0,0 +1,672 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "colorspaces.h"
+#include "core_time.h"
+#include "frame_convert.h"
+#include "frame_decoder.h"
+#include "neoguvc_v4l2core.h"
+
+extern int verbosity;
+
+/*
+ * relative kernel costs:
+ *   plane copies and byte shuffles are cheap,
+ *   yuv <-> rgb arithmetic and demosaicing cost more,
+ *   subsampling chroma to 420 also loses information
+ */
+#define CONV_COST_PACK (1)
+#define CONV_COST_RGB (3)
+#define CONV_COST_SUBSAMPLE (4)
+
+/*max number of cached conversion paths*/
+#define CONV_CACHE_SIZE (32)
+
+/*bayer wrappers (pixel order fixed by the fourcc)*/
+static void sgbrg8_to_rgb24(uint8_t *out, uint8_t *in, int width, int height) {
+  bayer_to_rgb24(in, out, width, height, 0);
+}
+
+static void sgrbg8_to_rgb24(uint8_t *out, uint8_t *in, int width, int height) {
+  bayer_to_rgb24(in, out, width, height, 1);
+}
+
+static void sbggr8_to_rgb24(uint8_t *out, uint8_t *in, int width, int height) {
+  bayer_to_rgb24(in, out, width, height, 2);
+}
+
+static void srggb8_to_rgb24(uint8_t *out, uint8_t *in, int width, int height) {
+  bayer_to_rgb24(in, out, width, height, 3);
+}
+
+/*
+ * conversion registry: every direct kernel available
+ *   keyed by (source format, destination format)
+ */
+static const conv_edge_t conv_registry[] = {
+    /*---------------- to yu12 ----------------*/
+    {V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     yuyv_to_yu12, "yuyv_to_yu12"},
+    {V4L2_PIX_FMT_YVYU, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     yvyu_to_yu12, "yvyu_to_yu12"},
+    {V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     uyvy_to_yu12, "uyvy_to_yu12"},
+    {V4L2_PIX_FMT_VYUY, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     vyuy_to_yu12, "vyuy_to_yu12"},
+    {V4L2_PIX_FMT_YYUV, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     yyuv_to_yu12, "yyuv_to_yu12"},
+    {V4L2_PIX_FMT_YUV444, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     y444_to_yu12, "y444_to_yu12"},
+    {V4L2_PIX_FMT_YUV555, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     yuvo_to_yu12, "yuvo_to_yu12"},
+    {V4L2_PIX_FMT_YUV565, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     yuvp_to_yu12, "yuvp_to_yu12"},
+    {V4L2_PIX_FMT_YUV32, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     yuv4_to_yu12, "yuv4_to_yu12"},
+    {V4L2_PIX_FMT_YUV422P, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     yuv422p_to_yu12, "yuv422p_to_yu12"},
+    {V4L2_PIX_FMT_YVU420, V4L2_PIX_FMT_YUV420, CONV_COST_PACK, yv12_to_yu12,
+     "yv12_to_yu12"},
+    {V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YUV420, CONV_COST_PACK, nv12_to_yu12,
+     "nv12_to_yu12"},
+    {V4L2_PIX_FMT_NV21, V4L2_PIX_FMT_YUV420, CONV_COST_PACK, nv21_to_yu12,
+     "nv21_to_yu12"},
+    {V4L2_PIX_FMT_NV16, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     nv16_to_yu12, "nv16_to_yu12"},
+    {V4L2_PIX_FMT_NV61, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     nv61_to_yu12, "nv61_to_yu12"},
+    {V4L2_PIX_FMT_NV24, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     nv24_to_yu12, "nv24_to_yu12"},
+    {V4L2_PIX_FMT_NV42, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     nv42_to_yu12, "nv42_to_yu12"},
+    {V4L2_PIX_FMT_Y41P, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     y41p_to_yu12, "y41p_to_yu12"},
+    {V4L2_PIX_FMT_GREY, V4L2_PIX_FMT_YUV420, CONV_COST_PACK, grey_to_yu12,
+     "grey_to_yu12"},
+    {V4L2_PIX_FMT_Y10BPACK, V4L2_PIX_FMT_YUV420, CONV_COST_PACK,
+     y10b_to_yu12, "y10b_to_yu12"},
+    {V4L2_PIX_FMT_Y16, V4L2_PIX_FMT_YUV420, CONV_COST_PACK, y16_to_yu12,
+     "y16_to_yu12"},
+#ifdef V4L2_PIX_FMT_Y16_BE
+    {V4L2_PIX_FMT_Y16_BE, V4L2_PIX_FMT_YUV420, CONV_COST_PACK, y16x_to_yu12,
+     "y16x_to_yu12"},
+#endif
+    {V4L2_PIX_FMT_SPCA501, V4L2_PIX_FMT_YUV420, CONV_COST_PACK,
+     s501_to_yu12, "s501_to_yu12"},
+    {V4L2_PIX_FMT_SPCA505, V4L2_PIX_FMT_YUV420, CONV_COST_PACK,
+     s505_to_yu12, "s505_to_yu12"},
+    {V4L2_PIX_FMT_SPCA508, V4L2_PIX_FMT_YUV420, CONV_COST_PACK,
+     s508_to_yu12, "s508_to_yu12"},
+    {V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     rgb24_to_yu12, "rgb24_to_yu12"},
+    {V4L2_PIX_FMT_BGR24, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     bgr24_to_yu12, "bgr24_to_yu12"},
+    {V4L2_PIX_FMT_RGB332, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     rgb1_to_yu12, "rgb1_to_yu12"},
+    {V4L2_PIX_FMT_RGB565, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     rgbp_to_yu12, "rgbp_to_yu12"},
+    {V4L2_PIX_FMT_RGB565X, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     rgbr_to_yu12, "rgbr_to_yu12"},
+    {V4L2_PIX_FMT_RGB444, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar12_to_yu12, "ar12_to_yu12"},
+#ifdef V4L2_PIX_FMT_ARGB444
+    {V4L2_PIX_FMT_ARGB444, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar12_to_yu12, "ar12_to_yu12"},
+    {V4L2_PIX_FMT_XRGB444, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar12_to_yu12, "ar12_to_yu12"},
+#endif
+    {V4L2_PIX_FMT_RGB555, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar15_to_yu12, "ar15_to_yu12"},
+#ifdef V4L2_PIX_FMT_ARGB555
+    {V4L2_PIX_FMT_ARGB555, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar15_to_yu12, "ar15_to_yu12"},
+    {V4L2_PIX_FMT_XRGB555, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar15_to_yu12, "ar15_to_yu12"},
+#endif
+    {V4L2_PIX_FMT_RGB555X, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar15x_to_yu12, "ar15x_to_yu12"},
+#ifdef V4L2_PIX_FMT_ARGB555X
+    {V4L2_PIX_FMT_ARGB555X, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar15x_to_yu12, "ar15x_to_yu12"},
+    {V4L2_PIX_FMT_XRGB555X, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar15x_to_yu12, "ar15x_to_yu12"},
+#endif
+    {V4L2_PIX_FMT_BGR666, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     bgrh_to_yu12, "bgrh_to_yu12"},
+    {V4L2_PIX_FMT_BGR32, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar24_to_yu12, "ar24_to_yu12"},
+#ifdef V4L2_PIX_FMT_ABGR32
+    {V4L2_PIX_FMT_ABGR32, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar24_to_yu12, "ar24_to_yu12"},
+    {V4L2_PIX_FMT_XBGR32, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ar24_to_yu12, "ar24_to_yu12"},
+#endif
+    {V4L2_PIX_FMT_RGB32, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ba24_to_yu12, "ba24_to_yu12"},
+#ifdef V4L2_PIX_FMT_ARGB32
+    {V4L2_PIX_FMT_ARGB32, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ba24_to_yu12, "ba24_to_yu12"},
+    {V4L2_PIX_FMT_XRGB32, V4L2_PIX_FMT_YUV420, CONV_COST_SUBSAMPLE,
+     ba24_to_yu12, "ba24_to_yu12"},
+#endif
+    /*---------------- raw bayer ----------------*/
+    {V4L2_PIX_FMT_SGBRG8, V4L2_PIX_FMT_RGB24, CONV_COST_RGB, sgbrg8_to_rgb24,
+     "sgbrg8_to_rgb24"},
+    {V4L2_PIX_FMT_SGRBG8, V4L2_PIX_FMT_RGB24, CONV_COST_RGB, sgrbg8_to_rgb24,
+     "sgrbg8_to_rgb24"},
+    {V4L2_PIX_FMT_SBGGR8, V4L2_PIX_FMT_RGB24, CONV_COST_RGB, sbggr8_to_rgb24,
+     "sbggr8_to_rgb24"},
+    {V4L2_PIX_FMT_SRGGB8, V4L2_PIX_FMT_RGB24, CONV_COST_RGB, srggb8_to_rgb24,
+     "srggb8_to_rgb24"},
+    /*---------------- from yu12 ----------------*/
+    {V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_RGB24, CONV_COST_RGB, yu12_to_rgb24,
+     "yu12_to_rgb24"},
+    {V4L2_PIX_FMT_YUV420, CONV_FMT_DIB24, CONV_COST_RGB, yu12_to_dib24,
+     "yu12_to_dib24"},
+    {V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_YUYV, CONV_COST_PACK, yu12_to_yuyv,
+     "yu12_to_yuyv"},
+#ifdef V4L2_PIX_FMT_RGBA32
+    {V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_RGBA32, CONV_COST_RGB, yu12_to_rgba,
+     "yu12_to_rgba"},
+#endif
+    /*---------------- direct (no 420 pass) ----------------*/
+    {V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_RGB24, CONV_COST_RGB, yuyv_to_rgb24,
+     "yuyv_to_rgb24"},
+    {V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_YUYV, CONV_COST_PACK, uyvy_to_yuyv,
+     "uyvy_to_yuyv"},
+    {V4L2_PIX_FMT_YVYU, V4L2_PIX_FMT_YUYV, CONV_COST_PACK, yvyu_to_yuyv,
+     "yvyu_to_yuyv"},
+    {V4L2_PIX_FMT_BGR24, V4L2_PIX_FMT_RGB24, CONV_COST_PACK, bgr24_to_rgb24,
+     "bgr24_to_rgb24"},
+    {V4L2_PIX_FMT_RGB24, CONV_FMT_DIB24, CONV_COST_PACK, rgb24_to_dib24,
+     "rgb24_to_dib24"},
+#ifdef V4L2_PIX_FMT_RGBA32
+    {V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_RGBA32, CONV_COST_PACK, rgb24_to_rgba,
+     "rgb24_to_rgba"},
+#endif
+};
+
+#define CONV_REGISTRY_SIZE ((int)ARRAY_LENGTH(conv_registry))
+
+static conv_path_t conv_cache[CONV_CACHE_SIZE];
+static int conv_cache_count = 0;
+static int conv_cache_next = 0;
+static __MUTEX_TYPE conv_mutex = __STATIC_MUTEX_INIT;
+
+/*
+ * get the conversion registry
+ * args:
+ *   size - pointer to int to store the number of registry entries
+ *
+ * asserts:
+ *   size is not null
+ *
+ * returns: pointer to the (static) registry table
+ */
+const conv_edge_t *get_conv_registry(int *size) {
+  /*assertions*/
+  assert(size != NULL);
+
+  *size = CONV_REGISTRY_SIZE;
+  return conv_registry;
+}
+
+/*
+ * formats that can hold an intermediate result
+ *   (yu12 goes to frame->yuv_frame, the others to frame->tmp_buffer
+ *    so they must fit in 3 bytes per pixel)
+ * args:
+ *   fmt - format fourcc
+ *
+ * asserts:
+ *   none
+ *
+ * returns: TRUE or FALSE
+ */
+static int is_conv_intermediate(uint32_t fmt) {
+  switch (fmt) {
+  case V4L2_PIX_FMT_YUV420:
+  case V4L2_PIX_FMT_YUYV:
+  case V4L2_PIX_FMT_RGB24:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+/*
+ * search the cheapest chain (up to CONV_MAX_PATH kernels)
+ * args:
+ *   src_fmt - source format
+ *   dst_fmt - destination format
+ *   path - pointer to conversion path to store the result
+ *
+ * asserts:
+ *   path is not null
+ *
+ * returns: number of kernels in path (-1 if none)
+ */
+static int find_conv_path(uint32_t src_fmt, uint32_t dst_fmt,
+                          conv_path_t *path) {
+  /*assertions*/
+  assert(path != NULL);
+
+  /*cost[k][e]: cheapest chain from src_fmt with k+1 kernels ending in e*/
+  int cost[CONV_MAX_PATH][CONV_REGISTRY_SIZE];
+  int prev[CONV_MAX_PATH][CONV_REGISTRY_SIZE];
+
+  int k = 0, e = 0, p = 0;
+
+  memset(path, 0, sizeof(conv_path_t));
+  path->src_fmt = src_fmt;
+  path->dst_fmt = dst_fmt;
+  path->length = -1;
+
+  if (src_fmt == dst_fmt) {
+    path->length = 0;
+    return 0;
+  }
+
+  for (e = 0; e < CONV_REGISTRY_SIZE; e++) {
+    cost[0][e] = (conv_registry[e].src_fmt == src_fmt) ? conv_registry[e].cost
+                                                        : -1;
+    prev[0][e] = -1;
+  }
+
+  for (k = 1; k < CONV_MAX_PATH; k++) {
+    for (e = 0; e < CONV_REGISTRY_SIZE; e++) {
+      cost[k][e] = -1;
+      prev[k][e] = -1;
+
+      if (!is_conv_intermediate(conv_registry[e].src_fmt) ||
+          conv_registry[e].src_fmt == src_fmt)
+        continue;
+
+      for (p = 0; p < CONV_REGISTRY_SIZE; p++) {
+        if (cost[k - 1][p] < 0 ||
+            conv_registry[p].dst_fmt != conv_registry[e].src_fmt)
+          continue;
+
+        int c = cost[k - 1][p] + conv_registry[e].cost;
+        if (cost[k][e] < 0 || c < cost[k][e]) {
+          cost[k][e] = c;
+          prev[k][e] = p;
+        }
+      }
+    }
+  }
+
+  /*pick the cheapest (shortest on ties) chain ending in dst_fmt*/
+  int best_k = -1;
+  int best_e = -1;
+  for (k = 0; k < CONV_MAX_PATH; k++) {
+    for (e = 0; e < CONV_REGISTRY_SIZE; e++) {
+      if (cost[k][e] < 0 || conv_registry[e].dst_fmt != dst_fmt)
+        continue;
+      if (best_e < 0 || cost[k][e] < cost[best_k][best_e]) {
+        best_k = k;
+        best_e = e;
+      }
+    }
+  }
+
+  if (best_e < 0)
+    return -1;
+
+  path->length = best_k + 1;
+  path->cost = cost[best_k][best_e];
+
+  e = best_e;
+  for (k = best_k; k >= 0; k--) {
+    path->edge[k] = &conv_registry[e];
+    e = prev[k][e];
+  }
+
+  return path->length;
+}
+
+/*
+ * get the cheapest kernel chain from src_fmt to dst_fmt
+ *   (direct kernel if available) - results are cached
+ * args:
+ *   src_fmt - source format (v4l2 fourcc)
+ *   dst_fmt - destination format (v4l2 fourcc or CONV_FMT_*)
+ *   path - pointer to conversion path to store the result
+ *
+ * asserts:
+ *   path is not null
+ *
+ * returns: number of kernels in path (0 - same format; -1 - no path)
+ */
+int get_conv_path(uint32_t src_fmt, uint32_t dst_fmt, conv_path_t *path) {
+  /*assertions*/
+  assert(path != NULL);
+
+  int i = 0;
+
+  __LOCK_MUTEX(&conv_mutex);
+  for (i = 0; i < conv_cache_count; i++) {
+    if (conv_cache[i].src_fmt == src_fmt && conv_cache[i].dst_fmt == dst_fmt) {
+      *path = conv_cache[i];
+      __UNLOCK_MUTEX(&conv_mutex);
+      return path->length;
+    }
+  }
+  __UNLOCK_MUTEX(&conv_mutex);
+
+  find_conv_path(src_fmt, dst_fmt, path);
+
+  if (verbosity > 1) {
+    printf("V4L2_CORE: (conversion) %c%c%c%c -> %c%c%c%c:", src_fmt & 0xFF,
+           (src_fmt >> 8) & 0xFF, (src_fmt >> 16) & 0xFF,
+           (src_fmt >> 24) & 0xFF, dst_fmt & 0xFF, (dst_fmt >> 8) & 0xFF,
+           (dst_fmt >> 16) & 0xFF, (dst_fmt >> 24) & 0xFF);
+    if (path->length < 0)
+      printf(" no path");
+    else if (path->length == 0)
+      printf(" copy");
+    for (i = 0; i < path->length; i++)
+      printf(" %s", path->edge[i]->name);
+    printf("\n");
+  }
+
+  __LOCK_MUTEX(&conv_mutex);
+  if (conv_cache_count < CONV_CACHE_SIZE)
+    conv_cache_count++;
+  conv_cache[conv_cache_next] = *path;
+  conv_cache_next = (conv_cache_next + 1) % CONV_CACHE_SIZE;
+  __UNLOCK_MUTEX(&conv_mutex);
+
+  return path->length;
+}
+
+/*
+ * get the format of the raw frames for the current device setup
+ *   (maps yuyv bayer streams to the matching bayer fourcc)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: v4l2 fourcc
+ */
+uint32_t get_raw_conv_format(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->requested_fmt == V4L2_PIX_FMT_YUYV && vd->isbayer > 0) {
+    switch (vd->bayer_pix_order) {
+    case 0:
+      return V4L2_PIX_FMT_SGBRG8;
+    case 1:
+      return V4L2_PIX_FMT_SGRBG8;
+    case 2:
+      return V4L2_PIX_FMT_SBGGR8;
+    case 3:
+    default:
+      return V4L2_PIX_FMT_SRGGB8;
+    }
+  }
+
+  return vd->requested_fmt;
+}
+
+/*
+ * run the kernel chain
+ *   intermediate rgb results go to the frame temp buffer (one slot each)
+ *   or, with no device (vd NULL) and a short temp buffer, to a scratch
+ *   buffer freed on return (the frame buffers may be in the arena)
+ * args:
+ *   vd - pointer to v4l2 device handler (can be NULL)
+ *   frame - pointer to frame buffer
+ *   path - pointer to conversion path
+ *   in - pointer to source data
+ *   in_size - source data size (used for plain copies)
+ *   out - pointer to output buffer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void run_conv_path(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                          const conv_path_t *path, uint8_t *in,
+                          size_t in_size, uint8_t *out) {
+  int i = 0;
+  size_t slot_size = frame->width * frame->height * 3;
+  uint8_t *tmp = NULL;
+  uint8_t *scratch = NULL;
+
+  if (path->length == 0) {
+    if (out != in)
+      memcpy(out, in, in_size);
+    if (out == frame->yuv_frame && path->dst_fmt == V4L2_PIX_FMT_YUV420)
+      frame->yuv_ready = 1;
+    return;
+  }
+
+  if (path->length > 1) {
+    size_t tmp_size = slot_size * (path->length - 1);
+    if (vd != NULL)
+      tmp = get_frame_tmp_buffer(vd, frame, tmp_size);
+    else if (frame->tmp_buffer && frame->tmp_buffer_max_size >= tmp_size)
+      tmp = frame->tmp_buffer;
+    else {
+      scratch = calloc(tmp_size, sizeof(uint8_t));
+      if (scratch == NULL) {
+        fprintf(stderr,
+                "V4L2_CORE: FATAL memory allocation failure "
+                "(run_conv_path): %s\n",
+                strerror(errno));
+        exit(-1);
+      }
+      tmp = scratch;
+    }
+  }
+
+  for (i = 0; i < path->length; i++) {
+    const conv_edge_t *edge = path->edge[i];
+    uint8_t *pout = out;
+
+    if (i < path->length - 1) {
+      /*intermediate result: yu12 is kept in the frame yuv buffer*/
+      if (edge->dst_fmt == V4L2_PIX_FMT_YUV420)
+        pout = frame->yuv_frame;
+      else
+        pout = tmp + (i * slot_size);
+    }
+
+    edge->kernel(pout, in, frame->width, frame->height);
+
+    if (pout == frame->yuv_frame && edge->dst_fmt == V4L2_PIX_FMT_YUV420)
+      frame->yuv_ready = 1;
+
+    in = pout;
+  }
+
+  free(scratch);
+}
+
+/*
+ * convert the raw frame to dst_fmt (never decodes compressed formats)
+ * args:
+ *   vd - pointer to v4l2 device handler (can be NULL)
+ *   frame - pointer to frame buffer
+ *   dst_fmt - destination format
+ *   out - pointer to output buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   out is not null
+ *
+ * returns: error code (E_OK; E_FORMAT_ERR if no kernel path)
+ */
+int convert_raw_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                      uint32_t dst_fmt, uint8_t *out) {
+  /*assertions*/
+  assert(frame != NULL);
+  assert(out != NULL);
+
+  if (!frame->raw_frame || frame->raw_frame_size == 0)
+    return E_DECODE_ERR;
+
+  conv_path_t path;
+  if (get_conv_path(frame->raw_pixelformat, dst_fmt, &path) < 0)
+    return E_FORMAT_ERR;
+
+  size_t in_size = frame->raw_frame_size;
+  if (frame->raw_pixelformat == V4L2_PIX_FMT_YUV420 &&
+      in_size > (size_t)(frame->width * frame->height * 3 / 2))
+    in_size = frame->width * frame->height * 3 / 2;
+
+  run_conv_path(vd, frame, &path, frame->raw_frame, in_size, out);
+
+  return E_OK;
+}
+
+/*
+ * pack the decoder planes (yuv_plane) of a frame into a yu12 buffer
+ * args:
+ *   frame - pointer to frame buffer
+ *   out - pointer to output buffer (width * height * 3 / 2 bytes)
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->yuv_plane[0] is not null
+ *   out is not null
+ *
+ * returns: none
+ */
+void pack_yuv_planes(v4l2_frame_buff_t *frame, uint8_t *out) {
+  /*assertions*/
+  assert(frame != NULL);
+  assert(frame->yuv_plane[0] != NULL);
+  assert(out != NULL);
+
+  int i = 0;
+  for (i = 0; i < 3; i++) {
+    int width = (i == 0) ? frame->width : frame->width / 2;
+    int height = (i == 0) ? frame->height : frame->height / 2;
+    uint8_t *in = frame->yuv_plane[i];
+
+    if (frame->yuv_stride[i] == width) {
+      memcpy(out, in, (size_t)width * height);
+      out += width * height;
+      continue;
+    }
+
+    int h = 0;
+    for (h = 0; h < height; h++) {
+      memcpy(out, in, width);
+      out += width;
+      in += frame->yuv_stride[i];
+    }
+  }
+}
+
+/*
+ * convert the frame to dst_fmt (decoding to yuv_frame if needed)
+ * args:
+ *   vd - pointer to v4l2 device handler (NULL: no decoding)
+ *   frame - pointer to frame buffer
+ *   dst_fmt - destination format
+ *   out - pointer to output buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   out is not null
+ *
+ * returns: error code (E_OK)
+ */
+int convert_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, uint32_t dst_fmt,
+                  uint8_t *out) {
+  /*assertions*/
+  assert(frame != NULL);
+  assert(out != NULL);
+
+  int ret = E_OK;
+  conv_path_t path;
+
+  if (!frame->yuv_ready) {
+    /*try a kernel chain straight from the raw data*/
+    uint64_t start = ns_time_monotonic();
+    ret = convert_raw_frame(vd, frame, dst_fmt, out);
+    if (ret != E_FORMAT_ERR) {
+      /*raw to yu12 is the decode stage for uncompressed formats*/
+      if (ret == E_OK && vd != NULL && dst_fmt == V4L2_PIX_FMT_YUV420)
+        latency_hist_add(&vd->stage_hist[V4L2_STAGE_DECODE],
+                         ns_time_monotonic() - start);
+      return ret;
+    }
+
+    /*no kernel for the raw format (compressed): decode it to yu12*/
+    if (vd == NULL) {
+      fprintf(stderr,
+              "V4L2_CORE: (convert_frame) can't convert raw frame "
+              "(%c%c%c%c) without decoding\n",
+              frame->raw_pixelformat & 0xFF,
+              (frame->raw_pixelformat >> 8) & 0xFF,
+              (frame->raw_pixelformat >> 16) & 0xFF,
+              (frame->raw_pixelformat >> 24) & 0xFF);
+      return E_FORMAT_ERR;
+    }
+
+    /*h264 pictures stay in the decoder planes (no copy to yuv_frame)*/
+    if (frame->yuv_plane[0] == NULL) {
+      ret = decode_v4l2_frame_planes(vd, frame);
+      if (ret != E_OK)
+        return ret;
+    }
+
+    if (!frame->yuv_ready && frame->yuv_plane[0] != NULL) {
+      /*yu12 output: a single copy from the decoder planes*/
+      if (dst_fmt == V4L2_PIX_FMT_YUV420) {
+        pack_yuv_planes(frame, out);
+        return E_OK;
+      }
+      /*the kernels take packed yu12*/
+      pack_yuv_planes(frame, frame->yuv_frame);
+      frame->yuv_ready = 1;
+    }
+  }
+
+  if (get_conv_path(V4L2_PIX_FMT_YUV420, dst_fmt, &path) < 0) {
+    fprintf(stderr,
+            "V4L2_CORE: (convert_frame) no conversion to %c%c%c%c\n",
+            dst_fmt & 0xFF, (dst_fmt >> 8) & 0xFF, (dst_fmt >> 16) & 0xFF,
+            (dst_fmt >> 24) & 0xFF);
+    return E_FORMAT_ERR;
+  }
+
+  run_conv_path(vd, frame, &path, frame->yuv_frame,
+                frame->width * frame->height * 3 / 2, out);
+
+  return E_OK;
+}
@@ -0,0 +1,150 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef FRAME_CONVERT_H
+#define FRAME_CONVERT_H
+
+#include "neoguvc_v4l2core.h"
+#include "v4l2_core.h"
+
+/*max number of kernels chained in a conversion*/
+#define CONV_MAX_PATH (3)
+
+/*
+ * conversion kernel: same signature as the colorspaces functions
+ */
+typedef void (*conv_kernel_t)(uint8_t *out, uint8_t *in, int width,
+                              int height);
+
+/*
+ * conversion registry entry (one direct kernel)
+ */
+typedef struct _conv_edge_t {
+  uint32_t src_fmt;     // source format (v4l2 fourcc)
+  uint32_t dst_fmt;     // destination format (v4l2 fourcc or CONV_FMT_*)
+  int cost;             // relative cost (passes and chroma loss)
+  conv_kernel_t kernel; // conversion function
+  const char *name;     // kernel name
+} conv_edge_t;
+
+/*
+ * resolved conversion (chain of kernels)
+ */
+typedef struct _conv_path_t {
+  uint32_t src_fmt;
+  uint32_t dst_fmt;
+  int length; // number of kernels (0 - same format; -1 - no path)
+  int cost;   // total cost
+  const conv_edge_t *edge[CONV_MAX_PATH];
+} conv_path_t;
+
+/*
+ * get the conversion registry
+ * args:
+ *   size - pointer to int to store the number of registry entries
+ *
+ * asserts:
+ *   size is not null
+ *
+ * returns: pointer to the (static) registry table
+ */
+const conv_edge_t *get_conv_registry(int *size);
+
+/*
+ * get the cheapest kernel chain from src_fmt to dst_fmt
+ *   (direct kernel if available) - results are cached
+ * args:
+ *   src_fmt - source format (v4l2 fourcc)
+ *   dst_fmt - destination format (v4l2 fourcc or CONV_FMT_*)
+ *   path - pointer to conversion path to store the result
+ *
+ * asserts:
+ *   path is not null
+ *
+ * returns: number of kernels in path (0 - same format; -1 - no path)
+ */
+int get_conv_path(uint32_t src_fmt, uint32_t dst_fmt, conv_path_t *path);
+
+/*
+ * get the format of the raw frames for the current device setup
+ *   (maps yuyv bayer streams to the matching bayer fourcc)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: v4l2 fourcc
+ */
+uint32_t get_raw_conv_format(v4l2_dev_t *vd);
+
+/*
+ * convert the raw frame to dst_fmt (never decodes compressed formats)
+ * args:
+ *   vd - pointer to v4l2 device handler (can be NULL)
+ *   frame - pointer to frame buffer
+ *   dst_fmt - destination format
+ *   out - pointer to output buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   out is not null
+ *
+ * returns: error code (E_OK; E_FORMAT_ERR if no kernel path)
+ */
+int convert_raw_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                      uint32_t dst_fmt, uint8_t *out);
+
+/*
+ * pack the decoder planes (yuv_plane) of a frame into a yu12 buffer
+ * args:
+ *   frame - pointer to frame buffer
+ *   out - pointer to output buffer (width * height * 3 / 2 bytes)
+ *
+ * asserts:
+ *   frame is not null
+ *   frame->yuv_plane[0] is not null
+ *   out is not null
+ *
+ * returns: none
+ */
+void pack_yuv_planes(v4l2_frame_buff_t *frame, uint8_t *out);
+
+/*
+ * convert the frame to dst_fmt (decoding to yuv_frame if needed)
+ * args:
+ *   vd - pointer to v4l2 device handler (NULL: no decoding)
+ *   frame - pointer to frame buffer
+ *   dst_fmt - destination format
+ *   out - pointer to output buffer
+ *
+ * asserts:
+ *   frame is not null
+ *   out is not null
+ *
+ * returns: error code (E_OK)
+ */
+int convert_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame, uint32_t dst_fmt,
+                  uint8_t *out);
+
+#endif
@@ -32,7 +32,10 @@
 #include <unistd.h>
 
 #include "colorspaces.h"
+#include "core_time.h"
+#include "frame_convert.h"
 #include "frame_decoder.h"
+#include "h264_nal.h"
 #include "neoguvc_v4l2core.h"
 #include "jpeg_decoder.h"
 #include "uvc_h264.h"
@@ -40,6 +43,127 @@
 
 extern int verbosity;
 
+/*
+ * alloc a frame queue buffer
+ *   (from the frame arena if in use: IO_USERPTR)
+ * args:
+ *   vd - pointer to video device data
+ *   size - buffer size in bytes
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: pointer to zeroed buffer (NULL on error)
+ */
+static uint8_t *alloc_frame_buffer(v4l2_dev_t *vd, size_t size) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->frame_arena.base != NULL)
+    return frame_arena_alloc(&vd->frame_arena, size, 0);
+
+  return calloc(size, sizeof(uint8_t));
+}
+
+/*
+ * free a frame queue buffer (arena buffers are freed with the arena)
+ * args:
+ *   vd - pointer to video device data
+ *   buffer - pointer to buffer
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+static void free_frame_buffer(v4l2_dev_t *vd, uint8_t *buffer) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (buffer != NULL && !frame_arena_owns(&vd->frame_arena, buffer))
+    free(buffer);
+}
+
+/*
+ * get the frame temp buffer with at least size bytes
+ *   the arena is sized once at stream setup, so a bigger buffer
+ *   always comes from the heap (arena buffers are never freed)
+ * args:
+ *   vd - pointer to video device data
+ *   frame - pointer to frame buffer
+ *   size - minimum buffer size in bytes
+ *
+ * asserts:
+ *   vd is not null
+ *   frame is not null
+ *
+ * returns: pointer to temp buffer
+ */
+uint8_t *get_frame_tmp_buffer(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                              size_t size) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(frame != NULL);
+
+  if (frame->tmp_buffer != NULL && frame->tmp_buffer_max_size >= size)
+    return frame->tmp_buffer;
+
+  free_frame_buffer(vd, frame->tmp_buffer);
+  frame->tmp_buffer_max_size = size;
+  frame->tmp_buffer = calloc(size, sizeof(uint8_t));
+  if (frame->tmp_buffer == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure "
+            "(get_frame_tmp_buffer): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  return frame->tmp_buffer;
+}
+
+/*
+ * get the size of the decode buffers for each frame in the queue
+ *   (as allocated by alloc_v4l2_frames for the requested format)
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: size in bytes (including arena alignment)
+ */
+size_t get_v4l2_frame_buffers_size(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  size_t width = vd->format.fmt.pix.width;
+  size_t height = vd->format.fmt.pix.height;
+  size_t framesizeIn = (width * height * 3 / 2); /* 3/2 bytes per pixel*/
+  size_t align = 64; /*cache line (arena alignment)*/
+
+  size_t size = framesizeIn + align; /*yuv_frame*/
+
+  switch (vd->requested_fmt) {
+  case V4L2_PIX_FMT_H264:
+    size += width * height + align; /*h264_frame*/
+    break;
+
+  case V4L2_PIX_FMT_SGBRG8:
+  case V4L2_PIX_FMT_SGRBG8:
+  case V4L2_PIX_FMT_SBGGR8:
+  case V4L2_PIX_FMT_SRGGB8:
+    /*tmp_buffer: one rgb slot per intermediate conversion result*/
+    size += (CONV_MAX_PATH - 1) * width * height * 3 + align;
+    break;
+
+  default:
+    break;
+  }
+
+  return size;
+}
+
 /*
  * Alloc image buffers for decoding video stream
  * args:
@@ -75,7 +199,8 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
   switch (vd->requested_fmt) {
   case V4L2_PIX_FMT_H264:
     /*init h264 context*/
-    ret = h264_init_decoder(width, height);
+    ret = h264_init_decoder(width, height, vd->frame_queue_size,
+                            vd->h264_dec_threads, vd->h264_dec_thread_type);
 
     if (ret) {
       fprintf(stderr, "V4L2_CORE: couldn't init h264 decoder\n");
@@ -87,7 +212,7 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
       vd->frame_queue[i].h264_frame_max_size =
           width * height; /*1 byte per pixel*/
       vd->frame_queue[i].h264_frame =
-          calloc(vd->frame_queue[i].h264_frame_max_size, sizeof(uint8_t));
+          alloc_frame_buffer(vd, vd->frame_queue[i].h264_frame_max_size);
 
       if (vd->frame_queue[i].h264_frame == NULL) {
         fprintf(stderr,
@@ -97,7 +222,7 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
         exit(-1);
       }
 
-      vd->frame_queue[i].yuv_frame = calloc(framesizeIn, sizeof(uint8_t));
+      vd->frame_queue[i].yuv_frame = alloc_frame_buffer(vd, framesizeIn);
       if (vd->frame_queue[i].yuv_frame == NULL) {
         fprintf(stderr,
                 "V4L2_CORE: FATAL memory allocation failure "
@@ -107,31 +232,24 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
       }
     }
 
-    vd->h264_last_IDR = calloc(width * height, sizeof(uint8_t));
-    if (vd->h264_last_IDR == NULL) {
-      fprintf(stderr,
-              "V4L2_CORE: FATAL memory allocation failure (alloc_v4l2_frames): "
-              "%s\n",
-              strerror(errno));
-      exit(-1);
-    }
-    vd->h264_last_IDR_size = 0; /*reset (no frame stored)*/
+    /*empty gop (no IDR yet)*/
+    h264_gop_alloc(&vd->h264_gop, width * height);
 
     break;
 
   case V4L2_PIX_FMT_JPEG:
   case V4L2_PIX_FMT_MJPEG:
     /*init jpeg decoder*/
-    ret = jpeg_init_decoder(width, height);
+    vd->jpeg_ctx = jpeg_init_decoder(width, height);
 
-    if (ret) {
+    if (vd->jpeg_ctx == NULL) {
       fprintf(stderr, "V4L2_CORE: couldn't init jpeg decoder\n");
-      return ret;
+      return E_NO_CODEC;
     }
 
     /*frame queue*/
     for (i = 0; i < vd->frame_queue_size; ++i) {
-      vd->frame_queue[i].yuv_frame = calloc(framesizeIn, sizeof(uint8_t));
+      vd->frame_queue[i].yuv_frame = alloc_frame_buffer(vd, framesizeIn);
       if (vd->frame_queue[i].yuv_frame == NULL) {
         fprintf(stderr,
                 "V4L2_CORE: FATAL memory allocation failure "
@@ -203,7 +321,7 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
     framebuf_size = framesizeIn;
     /*frame queue*/
     for (i = 0; i < vd->frame_queue_size; ++i) {
-      vd->frame_queue[i].yuv_frame = calloc(framebuf_size, sizeof(uint8_t));
+      vd->frame_queue[i].yuv_frame = alloc_frame_buffer(vd, framebuf_size);
       if (vd->frame_queue[i].yuv_frame == NULL) {
         fprintf(stderr,
                 "V4L2_CORE: FATAL memory allocation failure "
@@ -223,7 +341,7 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
     framebuf_size = framesizeIn;
     /*frame queue*/
     for (i = 0; i < vd->frame_queue_size; ++i) {
-      vd->frame_queue[i].yuv_frame = calloc(framebuf_size, sizeof(uint8_t));
+      vd->frame_queue[i].yuv_frame = alloc_frame_buffer(vd, framebuf_size);
       if (vd->frame_queue[i].yuv_frame == NULL) {
         fprintf(stderr,
                 "V4L2_CORE: FATAL memory allocation failure "
@@ -248,10 +366,11 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
     /*frame queue*/
     for (i = 0; i < vd->frame_queue_size; ++i) {
       /* alloc a temp buffer for converting to YUYV*/
-      /* rgb buffer for decoding bayer data*/
-      vd->frame_queue[i].tmp_buffer_max_size = width * height * 3;
+      /* rgb buffers for decoding bayer data (conversion path slots)*/
+      vd->frame_queue[i].tmp_buffer_max_size =
+          (CONV_MAX_PATH - 1) * width * height * 3;
       vd->frame_queue[i].tmp_buffer =
-          calloc(vd->frame_queue[i].tmp_buffer_max_size, sizeof(uint8_t));
+          alloc_frame_buffer(vd, vd->frame_queue[i].tmp_buffer_max_size);
       if (vd->frame_queue[i].tmp_buffer == NULL) {
         fprintf(stderr,
                 "V4L2_CORE: FATAL memory allocation failure "
@@ -259,7 +378,7 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
                 strerror(errno));
         exit(-1);
       }
-      vd->frame_queue[i].yuv_frame = calloc(framebuf_size, sizeof(uint8_t));
+      vd->frame_queue[i].yuv_frame = alloc_frame_buffer(vd, framebuf_size);
       if (vd->frame_queue[i].yuv_frame == NULL) {
         fprintf(stderr,
                 "V4L2_CORE: FATAL memory allocation failure "
@@ -279,20 +398,15 @@ int alloc_v4l2_frames(v4l2_dev_t *vd) {
             "V4L2_CORE: (v4l2uvc.c) should never arrive (1)- exit fatal !!\n");
     ret = E_UNKNOWN_ERR;
 
-    if (vd->h264_last_IDR)
-      free(vd->h264_last_IDR);
-    vd->h264_last_IDR = NULL;
+    h264_gop_free(&vd->h264_gop);
     /*frame queue*/
     for (i = 0; i < vd->frame_queue_size; ++i) {
       vd->frame_queue[i].raw_frame = NULL;
-      if (vd->frame_queue[i].yuv_frame)
-        free(vd->frame_queue[i].yuv_frame);
+      free_frame_buffer(vd, vd->frame_queue[i].yuv_frame);
       vd->frame_queue[i].yuv_frame = NULL;
-      if (vd->frame_queue[i].tmp_buffer)
-        free(vd->frame_queue[i].tmp_buffer);
+      free_frame_buffer(vd, vd->frame_queue[i].tmp_buffer);
       vd->frame_queue[i].tmp_buffer = NULL;
-      if (vd->frame_queue[i].h264_frame)
-        free(vd->frame_queue[i].h264_frame);
+      free_frame_buffer(vd, vd->frame_queue[i].h264_frame);
       vd->frame_queue[i].h264_frame = NULL;
     }
     return (ret);
@@ -331,25 +445,22 @@ void clean_v4l2_frames(v4l2_dev_t *vd) {
     vd->frame_queue[i].raw_frame = NULL;
 
     if (vd->frame_queue[i].tmp_buffer) {
-      free(vd->frame_queue[i].tmp_buffer);
+      free_frame_buffer(vd, vd->frame_queue[i].tmp_buffer);
       vd->frame_queue[i].tmp_buffer = NULL;
     }
 
     if (vd->frame_queue[i].h264_frame) {
-      free(vd->frame_queue[i].h264_frame);
+      free_frame_buffer(vd, vd->frame_queue[i].h264_frame);
       vd->frame_queue[i].h264_frame = NULL;
     }
 
     if (vd->frame_queue[i].yuv_frame) {
-      free(vd->frame_queue[i].yuv_frame);
+      free_frame_buffer(vd, vd->frame_queue[i].yuv_frame);
       vd->frame_queue[i].yuv_frame = NULL;
     }
   }
 
-  if (vd->h264_last_IDR) {
-    free(vd->h264_last_IDR);
-    vd->h264_last_IDR = NULL;
-  }
+  h264_gop_free(&vd->h264_gop);
 
   if (vd->h264_SPS) {
     free(vd->h264_SPS);
@@ -364,83 +475,65 @@ void clean_v4l2_frames(v4l2_dev_t *vd) {
   if (vd->requested_fmt == V4L2_PIX_FMT_H264)
     h264_close_decoder();
 
-  if (vd->requested_fmt == V4L2_PIX_FMT_JPEG ||
-      vd->requested_fmt == V4L2_PIX_FMT_MJPEG)
-    jpeg_close_decoder();
+  if (vd->jpeg_ctx) {
+    jpeg_close_decoder(vd->jpeg_ctx);
+    vd->jpeg_ctx = NULL;
+  }
 }
 
 /*
- * check buff (*buff) of size (size) for NALU type (type)
+ * find NALU type (type) in the frame nal table
  * args:
+ *    frame - pointer to frame buffer (with a scanned h264_frame)
  *    type - NALU type
- *    buff - buffer with MJPG uvc frame containing h264 data
- *    size - buffer size
  *
  * asserts:
- *    buff is not null
+ *    frame is not null
  *
- * returns: buffer pointer to NALU type data if found
- *          NULL if not found
+ * returns: nal table index of NALU type
+ *          -1 if not found
  */
-static uint8_t *check_NALU(uint8_t type, uint8_t *buff, int size) {
+static int find_NALU(v4l2_frame_buff_t *frame, uint8_t type) {
   /*asserts*/
-  assert(buff != NULL);
+  assert(frame != NULL);
 
-  uint8_t *sp = buff;
-  uint8_t *nal = NULL;
-  // search for NALU of type
-  for (sp = buff; sp < buff + size - 5; ++sp) {
-    if (sp[0] == 0x00 && sp[1] == 0x00 && sp[2] == 0x00 && sp[3] == 0x01 &&
-        (sp[4] & 0x1F) == type) {
-      /*found it*/
-      nal = sp + 4;
-      break;
-    }
-  }
+  int count = MIN(frame->h264_nal_count, V4L2_H264_MAX_NALS);
+  int i = 0;
 
-  return nal;
+  for (i = 0; i < count; i++)
+    if (frame->h264_nal_type[i] == type)
+      return i;
+
+  return -1;
 }
 
 /*
- * parses a buff (*buff) of size (size) for NALU type (type)
+ * copies NALU type (type) of the frame h264 data
  * args:
  *    type - NALU type
  *    NALU - pointer to pointer to NALU data
- *    buff - pointer to buffer containing h264 data muxed in MJPG container
- *    size - buff size
+ *    frame - pointer to frame buffer (with a scanned h264_frame)
  *
  * asserts:
- *    buff is not null
+ *    frame is not null
  *
  * returns: NALU size and sets pointer (NALU) to NALU data
  *          -1 if no NALU found
  */
-static int parse_NALU(uint8_t type, uint8_t **NALU, uint8_t *buff, int size) {
+static int parse_NALU(uint8_t type, uint8_t **NALU,
+                      v4l2_frame_buff_t *frame) {
   /*asserts*/
-  assert(buff != NULL);
+  assert(frame != NULL);
 
-  int nal_size = 0;
-  uint8_t *sp = NULL;
-
-  // search for NALU of type
-  uint8_t *nal = check_NALU(type, buff, size);
-  if (nal == NULL) {
+  int ind = find_NALU(frame, type);
+  if (ind < 0) {
     fprintf(stderr,
             "V4L2_CORE: (uvc H264) could not find NALU of type %i in buffer\n",
             type);
     return -1;
   }
 
-  // search for end of NALU
-  for (sp = nal; sp < buff + size - 4; ++sp) {
-    if (sp[0] == 0x00 && sp[1] == 0x00 && sp[2] == 0x00 && sp[3] == 0x01) {
-      nal_size = sp - nal;
-      break;
-    }
-  }
-
-  if (!nal_size)
-    nal_size = buff + size - nal;
+  int nal_size = frame->h264_nal_size[ind];
 
   *NALU = calloc(nal_size, sizeof(uint8_t));
   if (*NALU == NULL) {
@@ -449,11 +542,7 @@ static int parse_NALU(uint8_t type, uint8_t **NALU, uint8_t *buff, int size) {
             strerror(errno));
     exit(-1);
   }
-  memcpy(*NALU, nal, nal_size);
-
-  // char test_filename2[20];
-  // snprintf(test_filename2, 20, "frame_nalu-%i.raw", type);
-  // SaveBuff (test_filename2, nal_size, *NALU);
+  memcpy(*NALU, frame->h264_frame + frame->h264_nal_offset[ind], nal_size);
 
   return nal_size;
 }
@@ -484,14 +573,23 @@ static int demux_uvcH264(uint8_t *h264_data, uint8_t *buff, int size,
   uint8_t *header = NULL;
   uint8_t *ph264 = h264_data;
 
+  if (size < 2)
+    return 0;
+
   // search for first APP4 marker
-  for (sp = buff; sp < buff + size - 2; ++sp) {
-    if (sp[0] == 0xFF && sp[1] == 0xE4) {
+  for (sp = memchr(buff, 0xFF, size - 1); sp != NULL;
+       sp = memchr(sp + 1, 0xFF, buff + size - 2 - sp)) {
+    if (sp[1] == 0xE4) {
       spl = sp + 2; // exclude APP4 marker
       break;
     }
   }
 
+  if (spl == NULL) {
+    fprintf(stderr, "V4L2_CORE: no APP4 marker found (demux_uvcH264)\n");
+    return 0;
+  }
+
   /*(in big endian)
    *includes payload size + header + 6 bytes(2 length + 4 payload size)
    */
@@ -594,8 +692,7 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
   assert(vd != NULL);
 
   if (vd->h264_SPS == NULL) {
-    vd->h264_SPS_size = parse_NALU(7, &vd->h264_SPS, frame->h264_frame,
-                                   (int)frame->h264_frame_size);
+    vd->h264_SPS_size = parse_NALU(7, &vd->h264_SPS, frame);
 
     if (vd->h264_SPS_size <= 0 || vd->h264_SPS == NULL) {
       fprintf(stderr,
@@ -607,8 +704,7 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
   }
 
   if (vd->h264_PPS == NULL) {
-    vd->h264_PPS_size = parse_NALU(8, &vd->h264_PPS, frame->h264_frame,
-                                   (int)frame->h264_frame_size);
+    vd->h264_PPS_size = parse_NALU(8, &vd->h264_PPS, frame);
 
     if (vd->h264_PPS_size <= 0 || vd->h264_PPS == NULL) {
       fprintf(stderr, "Could not find PPS (NALU type: 8)\n");
@@ -622,7 +718,8 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
 }
 
 /*
- * check/store the last IDR frame
+ * check for an IDR frame and add the frame to the gop
+ *   (frames since the last IDR, the IDR stored with SPS and PPS)
  * args:
  *    vd - pointer to device data
  *    frame - pointer to frame buffer
@@ -634,17 +731,26 @@ static int store_extra_data(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
  *         FALSE(0) if non IDR frame
  */
 static uint8_t is_h264_keyframe(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
+  uint8_t keyframe = FALSE;
+
   // check for a IDR frame type
-  if (check_NALU(5, frame->h264_frame, frame->h264_frame_size) != NULL) {
-    memcpy(vd->h264_last_IDR, frame->h264_frame, frame->h264_frame_size);
-    vd->h264_last_IDR_size = frame->h264_frame_size;
+  if (find_NALU(frame, 5) >= 0) {
+    keyframe = TRUE;
     if (verbosity > 1)
       printf("V4L2_CORE: (uvc H264) IDR frame found in frame %" PRIu64 "\n",
              vd->frame_index);
-    return TRUE;
   }
 
-  return FALSE;
+  /*the IDR may come without the parameter sets (use the stored ones)*/
+  int has_sps = (find_NALU(frame, 7) >= 0);
+  int has_pps = (find_NALU(frame, 8) >= 0);
+
+  h264_gop_add_frame(&vd->h264_gop, frame->h264_frame,
+                     (int)frame->h264_frame_size, frame->timestamp, keyframe,
+                     has_sps ? NULL : vd->h264_SPS, vd->h264_SPS_size,
+                     has_pps ? NULL : vd->h264_PPS, vd->h264_PPS_size);
+
+  return keyframe;
 }
 
 /*
@@ -708,6 +814,25 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
   /*asserts*/
   assert(vd != NULL);
 
+  return decode_v4l2_frame_ctx(vd, frame, vd->jpeg_ctx);
+}
+
+/*
+ * decode video stream (see decode_v4l2_frame_ctx)
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    jpeg_ctx - pointer to (m)jpeg decoder context
+ *    keep_planes - leave h264 pictures in the decoder planes (yuv_plane)
+ *                  instead of copying them to yuv_frame
+ *
+ * asserts:
+ *    none
+ *
+ * returns: error code ( 0 - E_OK)
+ */
+static int decode_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                        jpeg_decoder_context_t *jpeg_ctx, int keep_planes) {
   if (!frame->raw_frame || frame->raw_frame_size == 0) {
     fprintf(
         stderr,
@@ -743,6 +868,12 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
         demux_h264(frame->h264_frame, frame->raw_frame, frame->raw_frame_size,
                    frame->h264_frame_max_size);
 
+    /*scan the nals once: used here and by the muxer (no rescan)*/
+    frame->h264_nal_count = h264_scan_nals(
+        frame->h264_frame, (int)frame->h264_frame_size,
+        frame->h264_nal_offset, frame->h264_nal_size, frame->h264_nal_type,
+        V4L2_H264_MAX_NALS);
+
     /*
      * store SPS and PPS info (usually the first two NALU)
      * and check/store the last IDR frame
@@ -750,14 +881,22 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
     store_extra_data(vd, frame);
 
     /*
-     * check for keyframe and store it
+     * check for keyframe and store the frame in the gop
      */
     frame->isKeyframe = is_h264_keyframe(vd, frame);
 
     // decode if we already have a IDR frame
-    if (vd->h264_last_IDR_size > 0) {
-      /*no need to convert output*/
-      h264_decode(frame->yuv_frame, frame->h264_frame, frame->h264_frame_size);
+    if (h264_gop_has_idr(&vd->h264_gop)) {
+      /*errors are logged: the frame is still consumed (no picture)*/
+      h264_decode(frame, (int)(frame - vd->frame_queue), frame->h264_frame,
+                  frame->h264_frame_size);
+    }
+
+    if (frame->yuv_plane[0] != NULL) {
+      /*consumers that handle strides use the decoder planes directly*/
+      if (keep_planes)
+        return E_OK;
+      pack_yuv_planes(frame, frame->yuv_frame);
     }
     break;
 
@@ -770,8 +909,11 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
       return (ret);
     }
 
-    ret =
-        jpeg_decode(frame->yuv_frame, frame->raw_frame, frame->raw_frame_size);
+    if (jpeg_ctx == NULL)
+      return E_NO_CODEC;
+
+    ret = jpeg_decode(jpeg_ctx, frame->yuv_frame, frame->raw_frame,
+                      frame->raw_frame_size);
 
     // memcpy(frame->tmp_buffer, frame->raw_frame, frame->raw_frame_size);
     // ret = jpeg_decode(&frame->yuv_frame, frame->tmp_buffer, width, height);
@@ -787,219 +929,80 @@ int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
     ret = E_OK;
     break;
 
-  case V4L2_PIX_FMT_UYVY:
-    uyvy_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_VYUY:
-    vyuy_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YVYU:
-    yvyu_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YYUV:
-    yyuv_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YUV444:
-    y444_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YUV555:
-    yuvo_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YUV565:
-    yuvp_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YUV32:
-    yuv4_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YUV420:
-    if (frame->raw_frame_size > (width * height * 3 / 2))
-      frame->raw_frame_size = width * height * 3 / 2;
-    memcpy(frame->yuv_frame, frame->raw_frame, frame->raw_frame_size);
-    break;
-
-  case V4L2_PIX_FMT_YUV422P:
-    yuv422p_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YVU420:
-    yv12_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_NV12:
-    nv12_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_NV21:
-    nv21_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_NV16:
-    nv16_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_NV61:
-    nv61_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_NV24:
-    nv24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_NV42:
-    nv42_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_Y41P:
-    y41p_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_GREY:
-    grey_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_Y10BPACK:
-    y10b_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_Y16:
-    y16_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-#ifdef V4L2_PIX_FMT_Y16_BE
-  case V4L2_PIX_FMT_Y16_BE:
-    y16x_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-#endif
-  case V4L2_PIX_FMT_SPCA501:
-    s501_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_SPCA505:
-    s505_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_SPCA508:
-    s508_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_YUYV:
-    if (vd->isbayer > 0) {
-      if (!(frame->tmp_buffer)) {
-        /* rgb buffer for decoding bayer data*/
-        frame->tmp_buffer_max_size = width * height * 3;
-        frame->tmp_buffer = calloc(frame->tmp_buffer_max_size, sizeof(uint8_t));
-        if (frame->tmp_buffer == NULL) {
-          fprintf(stderr,
-                  "V4L2_CORE: FATAL memory allocation failure "
-                  "(v4l2core_frame_decode): %s\n",
-                  strerror(errno));
-          exit(-1);
-        }
-      }
-      /*convert raw bayer to iyuv*/
-      bayer_to_rgb24(frame->raw_frame, frame->tmp_buffer, width, height,
-                     vd->bayer_pix_order);
-      rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-    } else
-      yuyv_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
-
-  case V4L2_PIX_FMT_SGBRG8: // 0
-    bayer_to_rgb24(frame->raw_frame, frame->tmp_buffer, width, height, 0);
-    rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-    break;
-
-  case V4L2_PIX_FMT_SGRBG8: // 1
-    bayer_to_rgb24(frame->raw_frame, frame->tmp_buffer, width, height, 1);
-    rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-    break;
-
-  case V4L2_PIX_FMT_SBGGR8: // 2
-    bayer_to_rgb24(frame->raw_frame, frame->tmp_buffer, width, height, 2);
-    rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-    break;
-  case V4L2_PIX_FMT_SRGGB8: // 3
-    bayer_to_rgb24(frame->raw_frame, frame->tmp_buffer, width, height, 3);
-    rgb24_to_yu12(frame->yuv_frame, frame->tmp_buffer, width, height);
-    break;
-
-  case V4L2_PIX_FMT_RGB24:
-    rgb24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  default:
+    /*
+     * uncompressed formats: use the conversion registry
+     * (yuyv bayer streams map to the matching bayer format)
+     */
+    ret = convert_raw_frame(vd, frame, V4L2_PIX_FMT_YUV420,
+                            frame->yuv_frame);
+    if (ret == E_FORMAT_ERR)
+      fprintf(stderr, "V4L2_CORE: error decoding frame: unknown format: %i\n",
+              format);
+    return ret;
+  }
 
-  case V4L2_PIX_FMT_BGR24:
-    bgr24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  if (ret == E_OK)
+    frame->yuv_ready = 1;
 
-  case V4L2_PIX_FMT_RGB332:
-    rgb1_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  return ret;
+}
 
-  case V4L2_PIX_FMT_RGB565:
-    rgbp_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+/*
+ * decode video stream using the given (m)jpeg decoder context
+ *   (concurrent calls for the same device need distinct contexts;
+ *    h264 frames must still be decoded one at a time, in capture order)
+ *   successful decodes are accounted in the V4L2_STAGE_DECODE stats
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    jpeg_ctx - pointer to (m)jpeg decoder context
+ *
+ * asserts:
+ *    vd is not null
+ *
+ * returns: error code ( 0 - E_OK)
+ */
+int decode_v4l2_frame_ctx(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                          jpeg_decoder_context_t *jpeg_ctx) {
+  /*asserts*/
+  assert(vd != NULL);
 
-  case V4L2_PIX_FMT_RGB565X:
-    rgbr_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  uint64_t start = ns_time_monotonic();
 
-  case V4L2_PIX_FMT_RGB444:
-#ifdef V4L2_PIX_FMT_ARGB444
-  case V4L2_PIX_FMT_ARGB444:
-  case V4L2_PIX_FMT_XRGB444: // same as above but without alpha channel
-#endif
-    ar12_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  int ret = decode_frame(vd, frame, jpeg_ctx, 0);
 
-  case V4L2_PIX_FMT_RGB555:
-#ifdef V4L2_PIX_FMT_ARGB555
-  case V4L2_PIX_FMT_ARGB555:
-  case V4L2_PIX_FMT_XRGB555: // same as above but without alpha channel
-#endif
-    ar15_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  if (ret == E_OK)
+    latency_hist_add(&vd->stage_hist[V4L2_STAGE_DECODE],
+                     ns_time_monotonic() - start);
 
-  case V4L2_PIX_FMT_RGB555X:
-#ifdef V4L2_PIX_FMT_ARGB4555X
-  case V4L2_PIX_FMT_ARGB555X:
-  case V4L2_PIX_FMT_XRGB555X: // same as above but without alpha channel
-#endif
-    ar15x_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  return ret;
+}
 
-  case V4L2_PIX_FMT_BGR666:
-    bgrh_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+/*
+ * decode video stream leaving h264 pictures in the decoder planes
+ *   (frame->yuv_plane; yuv_frame is not filled for them)
+ *   other formats are decoded to yuv_frame as in decode_v4l2_frame
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *
+ * asserts:
+ *    vd is not null
+ *
+ * returns: error code ( 0 - E_OK)
+ */
+int decode_v4l2_frame_planes(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
+  /*asserts*/
+  assert(vd != NULL);
 
-  case V4L2_PIX_FMT_BGR32:
-#ifdef V4L2_PIX_FMT_ABGR32
-  case V4L2_PIX_FMT_ABGR32:
-  case V4L2_PIX_FMT_XBGR32: // same as above but without alpha channel
-#endif
-    ar24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  uint64_t start = ns_time_monotonic();
 
-  case V4L2_PIX_FMT_RGB32:
-#ifdef V4L2_PIX_FMT_ARGB32
-  case V4L2_PIX_FMT_ARGB32:
-  case V4L2_PIX_FMT_XRGB32: // same as above but without alpha channel
-#endif
-    ba24_to_yu12(frame->yuv_frame, frame->raw_frame, width, height);
-    break;
+  int ret = decode_frame(vd, frame, vd->jpeg_ctx, 1);
 
-  default:
-    fprintf(stderr, "V4L2_CORE: error decoding frame: unknown format: %i\n",
-            format);
-    ret = E_UNKNOWN_ERR;
-    break;
-  }
+  if (ret == E_OK)
+    latency_hist_add(&vd->stage_hist[V4L2_STAGE_DECODE],
+                     ns_time_monotonic() - start);
 
   return ret;
 }
@@ -54,6 +54,37 @@
 int libav_decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame,
                  AVPacket *pkt);
 
+/*
+ * get the frame temp buffer with at least size bytes
+ *   the arena is sized once at stream setup, so a bigger buffer
+ *   always comes from the heap (arena buffers are never freed)
+ * args:
+ *   vd - pointer to video device data
+ *   frame - pointer to frame buffer
+ *   size - minimum buffer size in bytes
+ *
+ * asserts:
+ *   vd is not null
+ *   frame is not null
+ *
+ * returns: pointer to temp buffer
+ */
+uint8_t *get_frame_tmp_buffer(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                              size_t size);
+
+/*
+ * get the size of the decode buffers for each frame in the queue
+ *   (as allocated by alloc_v4l2_frames for the requested format)
+ * args:
+ *   vd - pointer to video device data
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: size in bytes (including arena alignment)
+ */
+size_t get_v4l2_frame_buffers_size(v4l2_dev_t *vd);
+
 /*
  * Alloc image buffers for decoding video stream
  * args:
@@ -78,6 +109,38 @@ int alloc_v4l2_frames(v4l2_dev_t *vd);
  */
 int decode_v4l2_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
 
+/*
+ * decode video stream using the given (m)jpeg decoder context
+ *   (concurrent calls for the same device need distinct contexts;
+ *    h264 frames must still be decoded one at a time, in capture order)
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *    jpeg_ctx - pointer to (m)jpeg decoder context
+ *
+ * asserts:
+ *    vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int decode_v4l2_frame_ctx(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                          jpeg_decoder_context_t *jpeg_ctx);
+
+/*
+ * decode video stream leaving h264 pictures in the decoder planes
+ *   (frame->yuv_plane; yuv_frame is not filled for them)
+ *   other formats are decoded to yuv_frame as in decode_v4l2_frame
+ * args:
+ *    vd - pointer to device data
+ *    frame - pointer to frame buffer
+ *
+ * asserts:
+ *    vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int decode_v4l2_frame_planes(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
+
 /*
  * free image buffers for decoding video stream
  * args:
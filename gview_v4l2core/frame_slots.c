@@ -0,0 +1,175 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  lock-free frame queue slots                                                 #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_slots.h"
+
+/*
+ * packs the free list head
+ * args:
+ *   tag - ABA tag
+ *   ind - slot index (-1 for an empty list)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: packed head
+ */
+static inline uint64_t pack_head(uint64_t tag, int32_t ind) {
+  return (tag << 32) | (uint32_t)(ind + 1);
+}
+
+/*
+ * initializes the slot free list with all slots free
+ * args:
+ *   slots - pointer to frame slots
+ *   size - number of slots
+ *
+ * asserts:
+ *   slots is not null
+ *   size > 0
+ *
+ * returns: none
+ */
+void frame_slots_init(frame_slots_t *slots, int size) {
+  /*assertions*/
+  assert(slots != NULL);
+  assert(size > 0);
+
+  slots->size = size;
+  slots->next = calloc(size, sizeof(_Atomic int32_t));
+  if (slots->next == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (frame_slots_init): "
+            "%s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  int i = 0;
+  for (i = 0; i < size; ++i)
+    atomic_init(&slots->next[i], (i + 1 < size) ? i + 1 : -1);
+
+  atomic_init(&slots->head, pack_head(0, 0));
+  atomic_init(&slots->depth, 0);
+  atomic_init(&slots->max_depth, 0);
+  atomic_init(&slots->acquired, 0);
+  atomic_init(&slots->starved, 0);
+}
+
+/*
+ * frees the slot free list
+ * args:
+ *   slots - pointer to frame slots
+ *
+ * asserts:
+ *   slots is not null
+ *
+ * returns: none
+ */
+void frame_slots_clean(frame_slots_t *slots) {
+  /*assertions*/
+  assert(slots != NULL);
+
+  free((void *)slots->next);
+  slots->next = NULL;
+  slots->size = 0;
+}
+
+/*
+ * pops a free slot (O(1), lock-free)
+ * args:
+ *   slots - pointer to frame slots
+ *
+ * asserts:
+ *   none
+ *
+ * returns: slot index (-1 if no free slot is available)
+ */
+int frame_slots_acquire(frame_slots_t *slots) {
+  uint64_t head = atomic_load_explicit(&slots->head, memory_order_acquire);
+  int32_t ind = -1;
+
+  do {
+    ind = (int32_t)(head & 0xFFFFFFFF) - 1;
+    if (ind < 0) {
+      atomic_fetch_add_explicit(&slots->starved, 1, memory_order_relaxed);
+      return -1;
+    }
+  } while (!atomic_compare_exchange_weak_explicit(
+      &slots->head, &head,
+      pack_head((head >> 32) + 1, atomic_load_explicit(&slots->next[ind],
+                                                       memory_order_relaxed)),
+      memory_order_acquire, memory_order_acquire));
+
+  atomic_fetch_add_explicit(&slots->acquired, 1, memory_order_relaxed);
+
+  uint32_t depth =
+      atomic_fetch_add_explicit(&slots->depth, 1, memory_order_relaxed) + 1;
+  uint32_t max_depth =
+      atomic_load_explicit(&slots->max_depth, memory_order_relaxed);
+  while (depth > max_depth &&
+         !atomic_compare_exchange_weak_explicit(&slots->max_depth, &max_depth,
+                                                depth, memory_order_relaxed,
+                                                memory_order_relaxed))
+    ;
+
+  return ind;
+}
+
+/*
+ * pushes a slot back to the free list (O(1), lock-free)
+ * args:
+ *   slots - pointer to frame slots
+ *   ind - slot index
+ *
+ * asserts:
+ *   ind is in range
+ *
+ * returns: none
+ */
+void frame_slots_release(frame_slots_t *slots, int ind) {
+  /*assertions*/
+  assert(ind >= 0 && ind < slots->size);
+
+  atomic_fetch_sub_explicit(&slots->depth, 1, memory_order_relaxed);
+
+  uint64_t head = atomic_load_explicit(&slots->head, memory_order_relaxed);
+  do {
+    atomic_store_explicit(&slots->next[ind], (int32_t)(head & 0xFFFFFFFF) - 1,
+                          memory_order_relaxed);
+  } while (!atomic_compare_exchange_weak_explicit(
+      &slots->head, &head, pack_head((head >> 32) + 1, ind),
+      memory_order_release, memory_order_relaxed));
+}
@@ -0,0 +1,97 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef FRAME_SLOTS_H
+#define FRAME_SLOTS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/*
+ * lock-free free list of frame queue slots (per device)
+ *   the head packs an ABA tag (high 32 bits) with slot index + 1
+ *   (low 32 bits, 0 for an empty list)
+ */
+typedef struct _frame_slots_t {
+  _Atomic uint64_t head;  // free list head
+  _Atomic int32_t *next;  // next free slot for each slot (-1: end of list)
+  int size;               // number of slots
+
+  _Atomic uint32_t depth;     // slots currently held (dequeued frames)
+  _Atomic uint32_t max_depth; // depth high watermark
+  _Atomic uint64_t acquired;  // number of acquired slots
+  _Atomic uint64_t starved;   // acquire attempts with no free slot
+} frame_slots_t;
+
+/*
+ * initializes the slot free list with all slots free
+ * args:
+ *   slots - pointer to frame slots
+ *   size - number of slots
+ *
+ * asserts:
+ *   slots is not null
+ *   size > 0
+ *
+ * returns: none
+ */
+void frame_slots_init(frame_slots_t *slots, int size);
+
+/*
+ * frees the slot free list
+ * args:
+ *   slots - pointer to frame slots
+ *
+ * asserts:
+ *   slots is not null
+ *
+ * returns: none
+ */
+void frame_slots_clean(frame_slots_t *slots);
+
+/*
+ * pops a free slot (O(1), lock-free)
+ * args:
+ *   slots - pointer to frame slots
+ *
+ * asserts:
+ *   none
+ *
+ * returns: slot index (-1 if no free slot is available)
+ */
+int frame_slots_acquire(frame_slots_t *slots);
+
+/*
+ * pushes a slot back to the free list (O(1), lock-free)
+ * args:
+ *   slots - pointer to frame slots
+ *   ind - slot index
+ *
+ * asserts:
+ *   ind is in range
+ *
+ * returns: none
+ */
+void frame_slots_release(frame_slots_t *slots, int ind);
+
+#endif
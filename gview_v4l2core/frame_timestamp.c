@@ -0,0 +1,262 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  frame timestamps: driver clock with skew estimation and jitter filter       #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frame_timestamp.h"
+#include "neoguvc.h"
+#include "neoguvc_v4l2core.h"
+
+/*skew estimation window (driver time)*/
+#define TS_WINDOW_NS (NSEC_PER_SEC)
+/*larger dequeue latencies mean a bogus driver timestamp*/
+#define TS_MAX_LATENCY_NS (NSEC_PER_SEC)
+/*larger skews mean a bogus driver clock (5000 ppm)*/
+#define TS_MAX_SKEW (0.005)
+/*consecutive rejected driver timestamps before giving up*/
+#define TS_MAX_REJECTS (8)
+
+extern int verbosity;
+
+/*
+ * updates the filtered frame interval and its jitter
+ * args:
+ *   period - pointer to filtered interval (ns)
+ *   jitter - pointer to filtered jitter (ns)
+ *   interval - last frame interval (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void update_jitter(double *period, double *jitter, uint64_t interval) {
+  if (*period <= 0) {
+    *period = (double)interval;
+    return;
+  }
+
+  double d = (double)interval - *period;
+  /*limit the weight of dropped frames and stalls*/
+  if (d > *period)
+    d = *period;
+  else if (d < -*period)
+    d = -*period;
+
+  *period += d / 16;
+  *jitter += (fabs(d) - *jitter) / 16;
+}
+
+/*
+ * updates the clock skew estimation with a new latency sample
+ *   the minimum (dequeue - driver) delta of each window drifts at the
+ *   clock skew rate (other samples are delayed by scheduling and load)
+ * args:
+ *   filter - pointer to timestamp filter
+ *   drv_ts - driver timestamp (ns)
+ *   delta - dequeue time - driver timestamp (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void update_skew(ts_filter_t *filter, uint64_t drv_ts, int64_t delta) {
+  if (filter->win_min < 0)
+    filter->win_start = drv_ts;
+
+  if (filter->win_min < 0 || delta < filter->win_min) {
+    filter->win_min = delta;
+    filter->win_min_ts = drv_ts;
+  }
+
+  if (drv_ts - filter->win_start < TS_WINDOW_NS)
+    return;
+
+  if (filter->base_min < 0)
+    filter->base_min = filter->win_min;
+  else if (filter->win_min_ts > filter->prev_min_ts) {
+    double slope = (double)(filter->win_min - filter->prev_min) /
+                   (double)(filter->win_min_ts - filter->prev_min_ts);
+    if (filter->windows < 2)
+      filter->skew = slope;
+    else
+      filter->skew += (slope - filter->skew) / 4;
+
+    filter->drift +=
+        ((double)(filter->win_min - filter->base_min) - filter->drift) / 4;
+  }
+
+  filter->prev_min = filter->win_min;
+  filter->prev_min_ts = filter->win_min_ts;
+  filter->windows++;
+  filter->win_min = -1;
+}
+
+/*
+ * smooths the dequeue time with a first order filter locked to the
+ * frame interval (resyncs on drops and stalls)
+ * args:
+ *   filter - pointer to timestamp filter
+ *   dq_ts - dequeue time (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: filtered timestamp (ns)
+ */
+static uint64_t smooth_dequeue_ts(ts_filter_t *filter, uint64_t dq_ts) {
+  if (filter->last_ts == 0 || filter->period <= 0)
+    return dq_ts;
+
+  double pred = (double)filter->last_ts + filter->period;
+  double err = (double)dq_ts - pred;
+
+  if (fabs(err) > 2 * filter->period)
+    return dq_ts;
+
+  uint64_t ts = (uint64_t)(pred + err / 8);
+
+  /*frames can't be captured after being dequeued*/
+  return (ts < dq_ts) ? ts : dq_ts;
+}
+
+/*
+ * resets the timestamp filter state (keeps the mode)
+ *   must be called on stream start
+ * args:
+ *   filter - pointer to timestamp filter
+ *
+ * asserts:
+ *   filter is not null
+ *
+ * returns: none
+ */
+void ts_filter_reset(ts_filter_t *filter) {
+  /*assertions*/
+  assert(filter != NULL);
+
+  int mode = filter->mode;
+
+  memset(filter, 0, sizeof(ts_filter_t));
+  filter->mode = mode;
+  filter->source = V4L2_TS_SRC_DEQUEUE;
+  filter->win_min = -1;
+  filter->base_min = -1;
+}
+
+/*
+ * gets the timestamp for a dequeued buffer
+ * args:
+ *   filter - pointer to timestamp filter
+ *   buf - pointer to the dequeued v4l2 buffer
+ *   dq_ts - dequeue time (ns, monotonic clock)
+ *
+ * asserts:
+ *   filter is not null
+ *   buf is not null
+ *
+ * returns: frame timestamp (ns, monotonic clock)
+ */
+uint64_t ts_filter_apply(ts_filter_t *filter, struct v4l2_buffer *buf,
+                         uint64_t dq_ts) {
+  /*assertions*/
+  assert(filter != NULL);
+  assert(buf != NULL);
+
+  if (filter->last_dq_ts > 0 && dq_ts > filter->last_dq_ts)
+    update_jitter(&filter->dq_period, &filter->dq_jitter,
+                  dq_ts - filter->last_dq_ts);
+  filter->last_dq_ts = dq_ts;
+
+  uint64_t ts = 0;
+  int source = V4L2_TS_SRC_DEQUEUE;
+
+  if (filter->mode == V4L2_TS_MODE_DRIVER && !filter->driver_broken &&
+      (buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+          V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    uint64_t drv_ts = (uint64_t)buf->timestamp.tv_sec * NSEC_PER_SEC +
+                      (uint64_t)buf->timestamp.tv_usec * 1000;
+    int64_t delta = (int64_t)dq_ts - (int64_t)drv_ts;
+
+    if (drv_ts > filter->last_drv_ts && delta >= 0 &&
+        delta < TS_MAX_LATENCY_NS) {
+      filter->last_drv_ts = drv_ts;
+      filter->rejects = 0;
+      update_skew(filter, drv_ts, delta);
+
+      if (filter->windows >= 4 && fabs(filter->skew) > TS_MAX_SKEW) {
+        fprintf(stderr,
+                "V4L2_CORE: driver clock skew too large (%.0f ppm): "
+                "using dequeue time\n",
+                filter->skew * 1e6);
+        filter->driver_broken = 1;
+      } else {
+        ts = drv_ts + (int64_t)filter->drift;
+        if ((buf->flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK) ==
+            V4L2_BUF_FLAG_TSTAMP_SRC_SOE)
+          source = V4L2_TS_SRC_DRIVER_SOE;
+        else
+          source = V4L2_TS_SRC_DRIVER_EOF;
+      }
+    } else if (++filter->rejects >= TS_MAX_REJECTS) {
+      fprintf(stderr, "V4L2_CORE: bogus driver timestamps: "
+                      "using dequeue time\n");
+      filter->driver_broken = 1;
+    } else if (verbosity > 1)
+      fprintf(stderr, "V4L2_CORE: rejected driver timestamp (delta %" PRId64
+                      " ns)\n", delta);
+  }
+
+  if (ts == 0) {
+    if (filter->mode == V4L2_TS_MODE_DEQUEUE)
+      ts = dq_ts;
+    else if (!filter->driver_broken && filter->base_min >= 0 &&
+             dq_ts > (uint64_t)(filter->base_min + (int64_t)filter->drift))
+      /*keep the driver time base for a single rejected timestamp*/
+      ts = dq_ts - (uint64_t)(filter->base_min + (int64_t)filter->drift);
+    else
+      ts = smooth_dequeue_ts(filter, dq_ts);
+  }
+
+  /*timestamps must increase*/
+  if (ts <= filter->last_ts)
+    ts = filter->last_ts + 1;
+
+  if (filter->last_ts > 0)
+    update_jitter(&filter->period, &filter->jitter, ts - filter->last_ts);
+
+  filter->last_ts = ts;
+  filter->source = source;
+
+  return ts;
+}
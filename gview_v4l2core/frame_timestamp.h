@@ -0,0 +1,94 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef FRAME_TIMESTAMP_H
+#define FRAME_TIMESTAMP_H
+
+#include <linux/videodev2.h>
+#include <stdint.h>
+
+/*
+ * frame timestamp filter (per device)
+ *   uses the driver monotonic timestamps (start or end of frame) when
+ *   available, mapped to the system monotonic clock by tracking the drift
+ *   of the minimum dequeue latency (clock skew); falls back to the dequeue
+ *   time, smoothed by a first order jitter filter
+ */
+typedef struct _ts_filter_t {
+  int mode;   // V4L2_TS_MODE_*
+  int source; // V4L2_TS_SRC_* of the last frame
+  uint8_t driver_broken; // driver timestamps rejected for this stream
+
+  uint64_t last_ts;     // last frame timestamp (output)
+  uint64_t last_drv_ts; // last driver timestamp
+  uint64_t last_dq_ts;  // last dequeue time
+  int rejects;          // consecutive rejected driver timestamps
+
+  /*skew estimator: minimum (dequeue - driver) delta per window*/
+  uint64_t win_start;   // driver time of the window start
+  int64_t win_min;      // minimum delta in the window (-1: none)
+  uint64_t win_min_ts;  // driver time of the window minimum
+  int64_t base_min;     // first window minimum (-1: none)
+  int64_t prev_min;     // previous window minimum
+  uint64_t prev_min_ts; // driver time of the previous window minimum
+  int windows;          // completed windows
+  double drift;         // filtered drift of the minimum delta (ns)
+  double skew;          // filtered clock skew (ns/ns)
+
+  /*interval jitter (RFC 3550 style)*/
+  double period;    // filtered output frame interval (ns)
+  double jitter;    // filtered output interval jitter (ns)
+  double dq_period; // filtered dequeue interval (ns)
+  double dq_jitter; // filtered dequeue interval jitter (ns)
+} ts_filter_t;
+
+/*
+ * resets the timestamp filter state (keeps the mode)
+ *   must be called on stream start
+ * args:
+ *   filter - pointer to timestamp filter
+ *
+ * asserts:
+ *   filter is not null
+ *
+ * returns: none
+ */
+void ts_filter_reset(ts_filter_t *filter);
+
+/*
+ * gets the timestamp for a dequeued buffer
+ * args:
+ *   filter - pointer to timestamp filter
+ *   buf - pointer to the dequeued v4l2 buffer
+ *   dq_ts - dequeue time (ns, monotonic clock)
+ *
+ * asserts:
+ *   filter is not null
+ *   buf is not null
+ *
+ * returns: frame timestamp (ns, monotonic clock)
+ */
+uint64_t ts_filter_apply(ts_filter_t *filter, struct v4l2_buffer *buf,
+                         uint64_t dq_ts);
+
+#endif
@@ -0,0 +1,334 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  h264 gop buffer (frames since the last IDR)                                 #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "h264_gop.h"
+
+extern int verbosity;
+
+static const uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+
+/*
+ * initializes the gop (no buffer)
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_init(h264_gop_t *gop) {
+  /*assertions*/
+  assert(gop != NULL);
+
+  gop->buffer = NULL;
+  gop->buffer_size = 0;
+  gop->max_size = 0;
+  gop->used = 0;
+  gop->frame_count = 0;
+  gop->overflow = 0;
+  gop->idr_seen = 0;
+
+  __INIT_MUTEX(&gop->mutex);
+}
+
+/*
+ * frees the gop buffer and mutex
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_clean(h264_gop_t *gop) {
+  /*assertions*/
+  assert(gop != NULL);
+
+  h264_gop_free(gop);
+
+  __CLOSE_MUTEX(&gop->mutex);
+}
+
+/*
+ * allocs the gop buffer (empty gop)
+ *   the buffer grows up to H264_GOP_MAX_GROW times size for long gops
+ * args:
+ *   gop - pointer to gop
+ *   size - initial buffer size (bytes)
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_alloc(h264_gop_t *gop, size_t size) {
+  /*assertions*/
+  assert(gop != NULL);
+
+  __LOCK_MUTEX(&gop->mutex);
+
+  free(gop->buffer);
+  gop->buffer = calloc(size, sizeof(uint8_t));
+  if (gop->buffer == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (h264_gop_alloc): "
+            "%s\n",
+            strerror(errno));
+    exit(-1);
+  }
+  gop->buffer_size = size;
+  gop->max_size = size * H264_GOP_MAX_GROW;
+  gop->used = 0;
+  gop->frame_count = 0;
+  gop->overflow = 0;
+  gop->idr_seen = 0;
+
+  __UNLOCK_MUTEX(&gop->mutex);
+}
+
+/*
+ * frees the gop buffer (empty gop)
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_free(h264_gop_t *gop) {
+  /*assertions*/
+  assert(gop != NULL);
+
+  __LOCK_MUTEX(&gop->mutex);
+
+  free(gop->buffer);
+  gop->buffer = NULL;
+  gop->buffer_size = 0;
+  gop->max_size = 0;
+  gop->used = 0;
+  gop->frame_count = 0;
+  gop->overflow = 0;
+  gop->idr_seen = 0;
+
+  __UNLOCK_MUTEX(&gop->mutex);
+}
+
+/*
+ * makes room for size bytes in the gop buffer (gop is locked)
+ * args:
+ *   gop - pointer to gop
+ *   size - bytes needed
+ *
+ * asserts:
+ *   none
+ *
+ * returns: TRUE (1) if there is room, FALSE (0) otherwise
+ */
+static int gop_reserve(h264_gop_t *gop, size_t size) {
+  if (gop->used + size <= gop->buffer_size)
+    return TRUE;
+
+  if (gop->used + size > gop->max_size)
+    return FALSE;
+
+  size_t new_size = MIN(gop->max_size, MAX(gop->buffer_size * 2,
+                                           gop->used + size));
+  uint8_t *buffer = realloc(gop->buffer, new_size);
+  if (buffer == NULL) {
+    fprintf(stderr, "V4L2_CORE: couldn't grow h264 gop buffer: %s\n",
+            strerror(errno));
+    return FALSE;
+  }
+
+  gop->buffer = buffer;
+  gop->buffer_size = new_size;
+
+  return TRUE;
+}
+
+/*
+ * adds a frame to the gop (an IDR frame restarts it)
+ *   frames before the first IDR are not stored
+ * args:
+ *   gop - pointer to gop
+ *   data - pointer to annex-b frame data
+ *   size - frame size
+ *   timestamp - frame timestamp
+ *   keyframe - frame is an IDR frame
+ *   sps - SPS nal to store before the IDR (NULL if in the frame)
+ *   sps_size - SPS size
+ *   pps - PPS nal to store before the IDR (NULL if in the frame)
+ *   pps_size - PPS size
+ *
+ * asserts:
+ *   gop is not null
+ *   data is not null
+ *
+ * returns: none
+ */
+void h264_gop_add_frame(h264_gop_t *gop, uint8_t *data, int size,
+                        uint64_t timestamp, int keyframe, uint8_t *sps,
+                        int sps_size, uint8_t *pps, int pps_size) {
+  /*assertions*/
+  assert(gop != NULL);
+  assert(data != NULL);
+
+  if (size <= 0)
+    return;
+
+  __LOCK_MUTEX(&gop->mutex);
+
+  if (gop->buffer == NULL || (!keyframe && gop->frame_count == 0) ||
+      (!keyframe && gop->overflow)) {
+    __UNLOCK_MUTEX(&gop->mutex);
+    return;
+  }
+
+  if (keyframe) {
+    /*restart the gop*/
+    gop->used = 0;
+    gop->frame_count = 0;
+    gop->overflow = 0;
+    gop->idr_seen = 1;
+  }
+
+  if (sps == NULL || sps_size <= 0 || !keyframe)
+    sps_size = 0;
+  if (pps == NULL || pps_size <= 0 || !keyframe)
+    pps_size = 0;
+
+  size_t frame_size = size;
+  if (sps_size > 0)
+    frame_size += sizeof(start_code) + sps_size;
+  if (pps_size > 0)
+    frame_size += sizeof(start_code) + pps_size;
+
+  if (gop->frame_count >= H264_GOP_MAX_FRAMES ||
+      !gop_reserve(gop, frame_size)) {
+    if (!gop->overflow && verbosity > 0)
+      printf("V4L2_CORE: (H264 gop) gop too long: %i frames stored\n",
+             gop->frame_count);
+    gop->overflow = 1;
+    __UNLOCK_MUTEX(&gop->mutex);
+    return;
+  }
+
+  h264_gop_frame_t *frame = &gop->frame[gop->frame_count];
+  frame->offset = gop->used;
+  frame->size = (int)frame_size;
+  frame->timestamp = timestamp;
+
+  uint8_t *dst = gop->buffer + gop->used;
+  if (sps_size > 0) {
+    memcpy(dst, start_code, sizeof(start_code));
+    memcpy(dst + sizeof(start_code), sps, sps_size);
+    dst += sizeof(start_code) + sps_size;
+  }
+  if (pps_size > 0) {
+    memcpy(dst, start_code, sizeof(start_code));
+    memcpy(dst + sizeof(start_code), pps, pps_size);
+    dst += sizeof(start_code) + pps_size;
+  }
+  memcpy(dst, data, size);
+
+  gop->used += frame_size;
+  gop->frame_count++;
+
+  __UNLOCK_MUTEX(&gop->mutex);
+}
+
+/*
+ * checks if an IDR was added to the gop (frames can be decoded)
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: TRUE (1) if the gop has an IDR frame, FALSE (0) otherwise
+ */
+int h264_gop_has_idr(h264_gop_t *gop) {
+  /*assertions*/
+  assert(gop != NULL);
+
+  __LOCK_MUTEX(&gop->mutex);
+  int has_idr = gop->idr_seen ? TRUE : FALSE;
+  __UNLOCK_MUTEX(&gop->mutex);
+
+  return has_idr;
+}
+
+/*
+ * replays the gop frames (IDR first) in capture order
+ *   the gop is locked during the replay: the callback should not block
+ * args:
+ *   gop - pointer to gop
+ *   callback - called for each frame
+ *   data - callback user data
+ *
+ * asserts:
+ *   gop is not null
+ *   callback is not null
+ *
+ * returns: number of replayed frames
+ *          or E_NO_DATA if there is no (complete) gop
+ */
+int h264_gop_replay(h264_gop_t *gop, v4l2_h264_gop_cb_t callback,
+                    void *data) {
+  /*assertions*/
+  assert(gop != NULL);
+  assert(callback != NULL);
+
+  __LOCK_MUTEX(&gop->mutex);
+
+  if (gop->frame_count == 0 || gop->overflow) {
+    __UNLOCK_MUTEX(&gop->mutex);
+    return E_NO_DATA;
+  }
+
+  int i = 0;
+  for (i = 0; i < gop->frame_count; i++)
+    callback(gop->buffer + gop->frame[i].offset, gop->frame[i].size,
+             gop->frame[i].timestamp, (i == 0) ? 1 : 0, data);
+
+  int count = gop->frame_count;
+
+  __UNLOCK_MUTEX(&gop->mutex);
+
+  return count;
+}
@@ -0,0 +1,167 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef H264_GOP_H
+#define H264_GOP_H
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#include "neoguvc.h"
+#include "neoguvc_v4l2core.h"
+
+#define H264_GOP_MAX_FRAMES (300) /*10 sec at 30 fps*/
+#define H264_GOP_MAX_GROW (8)     /*max buffer size (times the initial size)*/
+
+/*
+ * compressed frame in the gop buffer
+ */
+typedef struct _h264_gop_frame_t {
+  size_t offset;      // frame offset in the gop buffer
+  int size;           // frame size (bytes)
+  uint64_t timestamp; // captured frame timestamp
+} h264_gop_frame_t;
+
+/*
+ * compressed (annex-b) h264 frames since the last IDR
+ *   restarts on each IDR; the IDR frame is stored with SPS and PPS
+ *   so the gop can prime a decoder (or muxer) on its own
+ */
+typedef struct _h264_gop_t {
+  uint8_t *buffer;    // frames data
+  size_t buffer_size; // buffer size (bytes)
+  size_t max_size;    // buffer size limit (bytes)
+  size_t used;        // bytes in use
+
+  h264_gop_frame_t frame[H264_GOP_MAX_FRAMES];
+  int frame_count; // frames in the gop (0 - no IDR yet)
+  int overflow;    // frames after the IDR didn't fit (gop is incomplete)
+  int idr_seen;    // an IDR was added (even if it didn't fit)
+
+  __MUTEX_TYPE mutex; // gop writer (decoder) vs replay (consumers)
+} h264_gop_t;
+
+/*
+ * initializes the gop (no buffer)
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_init(h264_gop_t *gop);
+
+/*
+ * frees the gop buffer and mutex
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_clean(h264_gop_t *gop);
+
+/*
+ * allocs the gop buffer (empty gop)
+ *   the buffer grows up to H264_GOP_MAX_GROW times size for long gops
+ * args:
+ *   gop - pointer to gop
+ *   size - initial buffer size (bytes)
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_alloc(h264_gop_t *gop, size_t size);
+
+/*
+ * frees the gop buffer (empty gop)
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: none
+ */
+void h264_gop_free(h264_gop_t *gop);
+
+/*
+ * adds a frame to the gop (an IDR frame restarts it)
+ *   frames before the first IDR are not stored
+ * args:
+ *   gop - pointer to gop
+ *   data - pointer to annex-b frame data
+ *   size - frame size
+ *   timestamp - frame timestamp
+ *   keyframe - frame is an IDR frame
+ *   sps - SPS nal to store before the IDR (NULL if in the frame)
+ *   sps_size - SPS size
+ *   pps - PPS nal to store before the IDR (NULL if in the frame)
+ *   pps_size - PPS size
+ *
+ * asserts:
+ *   gop is not null
+ *   data is not null
+ *
+ * returns: none
+ */
+void h264_gop_add_frame(h264_gop_t *gop, uint8_t *data, int size,
+                        uint64_t timestamp, int keyframe, uint8_t *sps,
+                        int sps_size, uint8_t *pps, int pps_size);
+
+/*
+ * checks if an IDR was added to the gop (frames can be decoded)
+ * args:
+ *   gop - pointer to gop
+ *
+ * asserts:
+ *   gop is not null
+ *
+ * returns: TRUE (1) if the gop has an IDR frame, FALSE (0) otherwise
+ */
+int h264_gop_has_idr(h264_gop_t *gop);
+
+/*
+ * replays the gop frames (IDR first) in capture order
+ *   the gop is locked during the replay: the callback should not block
+ * args:
+ *   gop - pointer to gop
+ *   callback - called for each frame
+ *   data - callback user data
+ *
+ * asserts:
+ *   gop is not null
+ *   callback is not null
+ *
+ * returns: number of replayed frames
+ *          or E_NO_DATA if there is no (complete) gop
+ */
+int h264_gop_replay(h264_gop_t *gop, v4l2_h264_gop_cb_t callback, void *data);
+
+#endif
@@ -0,0 +1,207 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  uvc h264 bit rate controller (consumer backpressure)                        #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "core_time.h"
+#include "h264_rate_control.h"
+#include "uvc_h264.h"
+#include "v4l2_core.h"
+
+extern int verbosity;
+
+/*
+ * sets the camera bit rate (peak scaled with the average)
+ * args:
+ *   vd - pointer to video device data
+ *   bitrate - average bit rate (bits/sec)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code ( 0 -OK)
+ */
+static int rate_control_set(v4l2_dev_t *vd, uint32_t bitrate) {
+  h264_rate_control_t *rc = &vd->h264_rc;
+
+  uint32_t peak = bitrate;
+  if (rc->max_bitrate > 0 && rc->max_peak > rc->max_bitrate)
+    peak = (uint32_t)((uint64_t)rc->max_peak * bitrate / rc->max_bitrate);
+
+  int ret = h264_set_bitrate(vd, bitrate, peak);
+  if (ret != E_OK)
+    return ret;
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: (H264 rate control) bit rate %u -> %u bps "
+           "(backpressure %.2f)\n",
+           rc->bitrate, bitrate, rc->pressure);
+
+  rc->bitrate = bitrate;
+  return E_OK;
+}
+
+/*
+ * starts/stops the bit rate controller
+ *   starting takes the current camera bit rate as ceiling;
+ *   stopping restores it
+ * args:
+ *   vd - pointer to video device data
+ *   enable - start (1) or stop (0) the controller
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int h264_rate_control_enable(v4l2_dev_t *vd, int enable) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  h264_rate_control_t *rc = &vd->h264_rc;
+
+  if (!enable) {
+    if (!rc->enabled)
+      return E_OK;
+
+    rc->enabled = 0;
+    if (rc->bitrate == rc->max_bitrate)
+      return E_OK;
+
+    return rate_control_set(vd, rc->max_bitrate);
+  }
+
+  if (rc->enabled)
+    return E_OK;
+
+  uint32_t average = 0;
+  uint32_t peak = 0;
+  int ret = h264_query_bitrate(vd, UVC_GET_CUR, &average, &peak);
+  if (ret != E_OK)
+    return ret;
+
+  if (average == 0) {
+    fprintf(stderr, "V4L2_CORE: (H264 rate control) no current bit rate\n");
+    return E_NO_DATA;
+  }
+
+  uint32_t min_average = 0;
+  uint32_t min_peak = 0;
+  if (h264_query_bitrate(vd, UVC_GET_MIN, &min_average, &min_peak) != E_OK ||
+      min_average == 0 || min_average >= average)
+    min_average = average / H264_RC_MIN_DIVISOR;
+
+  memset(rc, 0, sizeof(h264_rate_control_t));
+  rc->max_bitrate = average;
+  rc->min_bitrate = MAX(min_average, 1);
+  rc->max_peak = peak;
+  rc->bitrate = average;
+  rc->enabled = 1;
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: (H264 rate control) started: %u bps (min %u bps)\n",
+           rc->max_bitrate, rc->min_bitrate);
+
+  return E_OK;
+}
+
+/*
+ * feeds the controller with the consumer backpressure
+ *   (may change the camera bit rate)
+ * args:
+ *   vd - pointer to video device data
+ *   pressure - consumer backpressure (0 - idle; 1 - saturated)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: current average bit rate (0 if the controller is stopped)
+ */
+uint32_t h264_rate_control_update(v4l2_dev_t *vd, double pressure) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  h264_rate_control_t *rc = &vd->h264_rc;
+
+  if (!rc->enabled)
+    return 0;
+
+  uint64_t now = ns_time_monotonic();
+  rc->pressure = pressure;
+
+  /*between the thresholds (dead band) the bit rate is kept*/
+  if (pressure >= H264_RC_HIGH_PRESSURE) {
+    if (rc->high_since == 0)
+      rc->high_since = now;
+    rc->low_since = 0;
+  } else if (pressure <= H264_RC_LOW_PRESSURE) {
+    if (rc->low_since == 0)
+      rc->low_since = now;
+    rc->high_since = 0;
+  } else {
+    rc->high_since = 0;
+    rc->low_since = 0;
+  }
+
+  if (rc->last_change > 0 && now - rc->last_change < H264_RC_STEP_NS)
+    return rc->bitrate;
+
+  uint32_t bitrate = rc->bitrate;
+
+  if (rc->high_since > 0 && now - rc->high_since >= H264_RC_DOWN_HOLD_NS &&
+      rc->bitrate > rc->min_bitrate) {
+    bitrate = (uint32_t)(rc->bitrate * H264_RC_DOWN_FACTOR);
+    bitrate = MAX(bitrate, rc->min_bitrate);
+    rc->high_since = now; /*the pressure must hold for the next step*/
+  } else if (rc->low_since > 0 && now - rc->low_since >= H264_RC_UP_HOLD_NS &&
+             rc->bitrate < rc->max_bitrate) {
+    bitrate = (uint32_t)(rc->bitrate * H264_RC_UP_FACTOR);
+    bitrate = MIN(bitrate, rc->max_bitrate);
+    rc->low_since = now;
+  }
+
+  if (bitrate == rc->bitrate)
+    return rc->bitrate;
+
+  if (rate_control_set(vd, bitrate) != E_OK) {
+    /*the camera doesn't take bit rate changes: stop trying*/
+    fprintf(stderr, "V4L2_CORE: (H264 rate control) stopped: couldn't set "
+                    "the bit rate\n");
+    rc->enabled = 0;
+    return 0;
+  }
+
+  rc->last_change = now;
+
+  return rc->bitrate;
+}
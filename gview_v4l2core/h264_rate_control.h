@@ -0,0 +1,92 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef H264_RATE_CONTROL_H
+#define H264_RATE_CONTROL_H
+
+#include <inttypes.h>
+
+#include "neoguvc.h"
+#include "neoguvc_v4l2core.h"
+
+/*
+ * uvc h264 bit rate controller
+ *   lowers the camera encoder bit rate while the consumer (muxer, disk,
+ *   network sink) can't keep up and raises it back when it recovers;
+ *   backpressure goes from 0 (idle) to 1 (saturated, dropping frames)
+ *
+ *   hysteresis: a dead band between the low and high thresholds, and
+ *   the bit rate goes down fast (after a short hold) and up slowly
+ */
+#define H264_RC_HIGH_PRESSURE (0.75) /*lower the bit rate above this*/
+#define H264_RC_LOW_PRESSURE (0.25)  /*raise the bit rate below this*/
+#define H264_RC_DOWN_HOLD_NS (NSEC_PER_SEC / 2) /*high pressure time*/
+#define H264_RC_UP_HOLD_NS (5 * NSEC_PER_SEC)   /*low pressure time*/
+#define H264_RC_STEP_NS (NSEC_PER_SEC)          /*min time between steps*/
+#define H264_RC_DOWN_FACTOR (0.75)              /*bit rate step down*/
+#define H264_RC_UP_FACTOR (1.10)                /*bit rate step up*/
+#define H264_RC_MIN_DIVISOR (8) /*floor (if no GET_MIN): max / divisor*/
+
+typedef struct _h264_rate_control_t {
+  int enabled;          // controller is running
+  uint32_t max_bitrate; // average bit rate ceiling (set when enabled)
+  uint32_t min_bitrate; // average bit rate floor
+  uint32_t max_peak;    // peak bit rate when enabled
+  uint32_t bitrate;     // current average bit rate
+  double pressure;      // last backpressure value
+
+  uint64_t high_since;  // start of high pressure period (0 - none)
+  uint64_t low_since;   // start of low pressure period (0 - none)
+  uint64_t last_change; // time of the last bit rate change
+} h264_rate_control_t;
+
+/*
+ * starts/stops the bit rate controller
+ *   starting takes the current camera bit rate as ceiling;
+ *   stopping restores it
+ * args:
+ *   vd - pointer to video device data
+ *   enable - start (1) or stop (0) the controller
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int h264_rate_control_enable(v4l2_dev_t *vd, int enable);
+
+/*
+ * feeds the controller with the consumer backpressure
+ *   (may change the camera bit rate)
+ * args:
+ *   vd - pointer to video device data
+ *   pressure - consumer backpressure (0 - idle; 1 - saturated)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: current average bit rate (0 if the controller is stopped)
+ */
+uint32_t h264_rate_control_update(v4l2_dev_t *vd, double pressure);
+
+#endif
@@ -95,18 +95,15 @@ const uint8_t jpeg_huffman_table[JPG_HUFFMAN_TABLE_LENGTH] = {
     0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4,
     0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA};
 
-typedef struct _jpeg_decoder_context_t {
-  void *codec_data;
+struct _jpeg_decoder_context_t {
+  void *codec_data; // decoder data (parse state or libav codec data)
 
   int width;
   int height;
   int pic_size;
 
   uint8_t *tmp_frame; // temp frame buffer
-
-} jpeg_decoder_context_t;
-
-static jpeg_decoder_context_t *jpeg_ctx = NULL;
+};
 
 #if MJPG_BUILTIN // use internal jpeg decoder
 
@@ -233,17 +230,22 @@ struct jpginfo {
   int rm;  /* next restart marker */
 };
 
-static struct jpginfo info;
-static struct comp comps[MAXCOMP];
-
-static struct scan dscans[MAXCOMP];
-
-static uint8_t quant[4][64];
-
-static struct dec_hufftbl dhuff[4];
+/*
+ * decoder parse state (one per decoder context - keeps the decoder reentrant)
+ */
+struct jpeg_state {
+  struct jpginfo info;
+  struct comp comps[MAXCOMP];
+  struct scan dscans[MAXCOMP];
+  uint8_t quant[4][64];
+  struct dec_hufftbl dhuff[4];
+
+  uint8_t *datap; /* pointer to pixel data */
+  struct in inp;  /* input structure */
+};
 
-#define dec_huffdc (dhuff + 0)
-#define dec_huffac (dhuff + 2)
+#define dec_huffdc(st) ((st)->dhuff + 0)
+#define dec_huffac(st) ((st)->dhuff + 2)
 
 /*
  * build huffman data
@@ -312,14 +314,14 @@ static void dec_makehuff(struct dec_hufftbl *hu, int *hufflen,
 /*
  * huffman decoder initialization
  * args:
- *    none
+ *    dhuff - pointer to the decoder huffman tables
  *
  * asserts:
  *    none
  *
  * returns: error code (0 - OK)
  */
-static int huffman_init(void) {
+static int huffman_init(struct dec_hufftbl *dhuff) {
   uint8_t *ptr = (uint8_t *)jpeg_huffman_table;
   int i, j, l;
   l = JPG_HUFFMAN_TABLE_LENGTH;
@@ -671,51 +673,42 @@ inline static void idct(int *inp, int *out, int *quant, long off, int max) {
 typedef void (*ftopict)(int *out, uint8_t *pic, int width);
 
 /*********************************/
-/*
- * pointer to pixel data
- */
-static uint8_t *datap;
-
-/*
- * input structure (in)
- */
-static struct in inp;
-
 /*
  * get byte (8 bit) from datap
  */
-static int getbyte(void) { return *datap++; }
+static int getbyte(struct jpeg_state *st) { return *st->datap++; }
 
 /*
  * get word (16 bit) from datap
  */
-static int getword(void) {
+static int getword(struct jpeg_state *st) {
   int c1, c2;
-  c1 = *datap++;
-  c2 = *datap++;
+  c1 = *st->datap++;
+  c2 = *st->datap++;
   return c1 << 8 | c2;
 }
 
 /*
  * read jpeg tables (huffman and quantization)
  * args:
+ *    st - pointer to decoder parse state
  *    till - Marker (frame - SOF0   scan - SOS)
  *    isDHT - flag indicating the presence of huffman tables (if 0 must use
  * default ones - MJPG frame) asserts: none
  *
  * returns: error code (0 - OK)
  */
-static int readtables(int till, int *isDHT) {
+static int readtables(struct jpeg_state *st, int till, int *isDHT) {
   int l, i, j, lq, pq, tq;
   int tc, th, tt;
 
   for (;;) {
-    if (getbyte() != 0xff)
+    if (getbyte(st) != 0xff)
       return -1;
 
     int m = 0;
 
-    if ((m = getbyte()) == till)
+    if ((m = getbyte(st)) == till)
       break;
 
     switch (m) {
@@ -723,9 +716,9 @@ static int readtables(int till, int *isDHT) {
       return 0;
     /*read quantization tables (Lqt and Cqt)*/
     case M_DQT:
-      lq = getword();
+      lq = getword(st);
       while (lq > 2) {
-        pq = getbyte();
+        pq = getbyte(st);
         /*Lqt=0x00   Cqt=0x01*/
         tq = pq & 15;
         if (tq > 3)
@@ -734,18 +727,18 @@ static int readtables(int till, int *isDHT) {
         if (pq != 0)
           return -1;
         for (i = 0; i < 64; i++)
-          quant[tq][i] = getbyte();
+          st->quant[tq][i] = getbyte(st);
         lq -= 64 + 1;
       }
       break;
     /*read huffman table*/
     case M_DHT:
-      l = getword();
+      l = getword(st);
       while (l > 2) {
         int hufflen[16], k;
         uint8_t huffvals[256];
 
-        tc = getbyte();
+        tc = getbyte(st);
         th = tc & 15;
         tc >>= 4;
         tt = tc * 2 + th;
@@ -753,29 +746,29 @@ static int readtables(int till, int *isDHT) {
           return -1;
 
         for (i = 0; i < 16; i++)
-          hufflen[i] = getbyte();
+          hufflen[i] = getbyte(st);
         l -= 1 + 16;
         k = 0;
         for (i = 0; i < 16; i++) {
           for (j = 0; j < hufflen[i]; j++)
-            huffvals[k++] = getbyte();
+            huffvals[k++] = getbyte(st);
           l -= hufflen[i];
         }
-        dec_makehuff(dhuff + tt, hufflen, huffvals);
+        dec_makehuff(st->dhuff + tt, hufflen, huffvals);
       }
       /* has huffman tables defined (JPEG)*/
       *isDHT = 1;
       break;
     /*restart interval*/
     case M_DRI:
-      l = getword();
-      info.dri = getword();
+      l = getword(st);
+      st->info.dri = getword(st);
       break;
 
     default:
-      l = getword();
+      l = getword(st);
       while (l-- > 2)
-        getbyte();
+        getbyte(st);
       break;
     }
   }
@@ -785,41 +778,41 @@ static int readtables(int till, int *isDHT) {
 /*
  * init dscans
  * args:
- *    none
+ *    st - pointer to decoder parse state
  *
  * asserts:
  *    none
  *
  * returns: none
  */
-static void dec_initscans(void) {
+static void dec_initscans(struct jpeg_state *st) {
   int i;
 
-  info.nm = info.dri + 1;
-  info.rm = M_RST0;
-  for (i = 0; i < info.ns; i++)
-    dscans[i].dc = 0;
+  st->info.nm = st->info.dri + 1;
+  st->info.rm = M_RST0;
+  for (i = 0; i < st->info.ns; i++)
+    st->dscans[i].dc = 0;
 }
 
 /*
  * check markers
  * args:
- *    none
+ *    st - pointer to decoder parse state
  *
  * asserts:
  *    none
  *
  * returns: error code (0 - OK)
  */
-static int dec_checkmarker(void) {
+static int dec_checkmarker(struct jpeg_state *st) {
   int i;
 
-  if (dec_readmarker(&inp) != info.rm)
+  if (dec_readmarker(&st->inp) != st->info.rm)
     return -1;
-  info.nm = info.dri;
-  info.rm = (info.rm + 1) & ~0x08;
-  for (i = 0; i < info.ns; i++)
-    dscans[i].dc = 0;
+  st->info.nm = st->info.dri;
+  st->info.rm = (st->info.rm + 1) & ~0x08;
+  for (i = 0; i < st->info.ns; i++)
+    st->dscans[i].dc = 0;
   return 0;
 }
 
@@ -875,13 +868,10 @@ static int dec_rec2(struct in *inp, struct dec_hufftbl *hu, int *runp, int c,
  * asserts:
  *    none
  *
- * returns: error code (0 - E_OK)
+ * returns: pointer to decoder context (NULL on error)
  */
-int jpeg_init_decoder(int width, int height) {
-  if (jpeg_ctx != NULL)
-    jpeg_close_decoder();
-
-  jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
+jpeg_decoder_context_t *jpeg_init_decoder(int width, int height) {
+  jpeg_decoder_context_t *jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
   if (jpeg_ctx == NULL) {
     fprintf(
         stderr,
@@ -893,7 +883,15 @@ int jpeg_init_decoder(int width, int height) {
   jpeg_ctx->width = width;
   jpeg_ctx->height = height;
   jpeg_ctx->pic_size = width * height * 2; // yuyv
-  jpeg_ctx->codec_data = NULL;
+
+  jpeg_ctx->codec_data = calloc(1, sizeof(struct jpeg_state));
+  if (jpeg_ctx->codec_data == NULL) {
+    fprintf(
+        stderr,
+        "V4L2_CORE: FATAL memory allocation failure (jpeg_init_decoder): %s\n",
+        strerror(errno));
+    exit(-1);
+  }
 
   jpeg_ctx->tmp_frame = calloc(jpeg_ctx->pic_size, sizeof(uint8_t));
   if (jpeg_ctx->tmp_frame == NULL) {
@@ -904,30 +902,36 @@ int jpeg_init_decoder(int width, int height) {
     exit(-1);
   }
 
-  return E_OK;
+  return jpeg_ctx;
 }
 
 /*
  * jpeg decode
  * args:
+ *   jpeg_ctx - pointer to decoder context
  *   out_buf -  pointer to picture data ( decoded image - yuyv format)
  *   in_buf -  pointer to input data ( compressed jpeg )
  *   size - picture size
  *
  * asserts:
+ *   jpeg_ctx not null
  *   out_buf not null
  *   in_buf not null
  *
  * returns: error code (0 - OK)
  */
 // int jpeg_decode(uint8_t **pic, uint8_t *buf, int width, int height)
-int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
+int jpeg_decode(jpeg_decoder_context_t *jpeg_ctx, uint8_t *out_buf,
+                uint8_t *in_buf, int size) {
   /*asserts*/
+  assert(jpeg_ctx != NULL);
   assert(in_buf != NULL);
   assert(out_buf != NULL);
 
   memcpy(jpeg_ctx->tmp_frame, in_buf, size);
 
+  struct jpeg_state *st = (struct jpeg_state *)jpeg_ctx->codec_data;
+
   struct jpeg_decdata *decdata;
   int i = 0, j = 0, m = 0, tac = 0, tdc = 0;
   int intwidth = 0, intheight = 0;
@@ -954,95 +958,95 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
     goto error;
   }
 
-  datap = jpeg_ctx->tmp_frame;
+  st->datap = jpeg_ctx->tmp_frame;
   /*check SOI (0xFFD8)*/
-  if (getbyte() != 0xff) {
+  if (getbyte(st) != 0xff) {
     err = E_NO_SOI_ERR;
     goto error;
   }
-  if (getbyte() != M_SOI) {
+  if (getbyte(st) != M_SOI) {
     err = E_NO_SOI_ERR;
     goto error;
   }
   /*read tables - if exist, up to start frame marker (0xFFC0)*/
-  if (readtables(M_SOF0, &isInitHuffman)) {
+  if (readtables(st, M_SOF0, &isInitHuffman)) {
     err = E_BAD_TABLES_ERR;
     goto error;
   }
-  getword();     /*header lenght*/
-  i = getbyte(); /*precision (8 bit)*/
+  getword(st);     /*header lenght*/
+  i = getbyte(st); /*precision (8 bit)*/
   if (i != 8) {
     err = E_NOT_8BIT_ERR;
     goto error;
   }
-  intheight = getword(); /*height*/
-  intwidth = getword();  /*width */
+  intheight = getword(st); /*height*/
+  intwidth = getword(st);  /*width */
 
   if ((intheight & 7) || (intwidth & 7)) /*must be even*/
   {
     err = E_BAD_WIDTH_OR_HEIGHT_ERR;
     goto error;
   }
-  info.nc = getbyte(); /*number of components*/
-  if (info.nc > MAXCOMP) {
+  st->info.nc = getbyte(st); /*number of components*/
+  if (st->info.nc > MAXCOMP) {
     err = E_TOO_MANY_COMPPS_ERR;
     goto error;
   }
   /*for each component*/
-  for (i = 0; i < info.nc; i++) {
+  for (i = 0; i < st->info.nc; i++) {
     int h, v;
-    comps[i].cid = getbyte(); /*component id*/
-    comps[i].hv = getbyte();
-    v = comps[i].hv & 15;    /*vertical sampling   */
-    h = comps[i].hv >> 4;    /*horizontal sampling */
-    comps[i].tq = getbyte(); /*quantization table used*/
+    st->comps[i].cid = getbyte(st); /*component id*/
+    st->comps[i].hv = getbyte(st);
+    v = st->comps[i].hv & 15;    /*vertical sampling   */
+    h = st->comps[i].hv >> 4;    /*horizontal sampling */
+    st->comps[i].tq = getbyte(st); /*quantization table used*/
     if (h > 3 || v > 3) {
       err = E_ILLEGAL_HV_ERR;
       goto error;
     }
-    if (comps[i].tq > 3) {
+    if (st->comps[i].tq > 3) {
       err = E_QUANT_TBL_SEL_ERR;
       goto error;
     }
   }
   /*read tables - if exist, up to start of scan marker (0xFFDA)*/
-  if (readtables(M_SOS, &isInitHuffman)) {
+  if (readtables(st, M_SOS, &isInitHuffman)) {
     err = E_BAD_TABLES_ERR;
     goto error;
   }
-  getword();           /* header lenght */
-  info.ns = getbyte(); /* number of scans */
-  if (!info.ns) {
-    printf("V4L2_CORE: (jpeg decoder) info ns %d/n", info.ns);
+  getword(st);           /* header lenght */
+  st->info.ns = getbyte(st); /* number of scans */
+  if (!st->info.ns) {
+    printf("V4L2_CORE: (jpeg decoder) info ns %d/n", st->info.ns);
     err = E_NOT_YCBCR_ERR;
     goto error;
   }
   /*for each scan*/
-  for (i = 0; i < info.ns; i++) {
-    dscans[i].cid = getbyte(); /*component id*/
-    tdc = getbyte();
+  for (i = 0; i < st->info.ns; i++) {
+    st->dscans[i].cid = getbyte(st); /*component id*/
+    tdc = getbyte(st);
     tac = tdc & 15; /*ac table*/
     tdc >>= 4;      /*dc table*/
     if (tdc > 1 || tac > 1) {
       err = E_QUANT_TBL_SEL_ERR;
       goto error;
     }
-    for (j = 0; j < info.nc; j++)
-      if (comps[j].cid == dscans[i].cid)
+    for (j = 0; j < st->info.nc; j++)
+      if (st->comps[j].cid == st->dscans[i].cid)
         break;
-    if (j == info.nc) {
+    if (j == st->info.nc) {
       err = E_UNKNOWN_CID_ERR;
       goto error;
     }
-    dscans[i].hv = comps[j].hv;
-    dscans[i].tq = comps[j].tq;
-    dscans[i].hudc.dhuff = dec_huffdc + tdc;
-    dscans[i].huac.dhuff = dec_huffac + tac;
+    st->dscans[i].hv = st->comps[j].hv;
+    st->dscans[i].tq = st->comps[j].tq;
+    st->dscans[i].hudc.dhuff = dec_huffdc(st) + tdc;
+    st->dscans[i].huac.dhuff = dec_huffac(st) + tac;
   }
 
-  i = getbyte(); /*0 */
-  j = getbyte(); /*63*/
-  m = getbyte(); /*0 */
+  i = getbyte(st); /*0 */
+  j = getbyte(st); /*63*/
+  m = getbyte(st); /*0 */
 
   if (i != 0 || j != 63 || m != 0) {
     fprintf(stderr, "V4L2_CORE: (jpeg decoder) FW error,not seq DCT ??\n");
@@ -1050,17 +1054,19 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
 
   /*build huffman tables*/
   if (!isInitHuffman) {
-    if (huffman_init() < 0)
-      return E_BAD_TABLES_ERR;
+    if (huffman_init(st->dhuff) < 0) {
+      err = E_BAD_TABLES_ERR;
+      goto error;
+    }
   }
   /*
-  if (dscans[0].cid != 1 || dscans[1].cid != 2 || dscans[2].cid != 3)
+  if (st->dscans[0].cid != 1 || st->dscans[1].cid != 2 || st->dscans[2].cid != 3)
   {
           err = ERR_NOT_YCBCR_221111;
           goto error;
   }
 
-  if (dscans[1].hv != 0x11 || dscans[2].hv != 0x11)
+  if (st->dscans[1].hv != 0x11 || st->dscans[2].hv != 0x11)
   {
           err = ERR_NOT_YCBCR_221111;
           goto error;
@@ -1085,7 +1091,7 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
   //	}
   // }
 
-  switch (dscans[0].hv) {
+  switch (st->dscans[0].hv) {
   case 0x22: // 411
     mb = 6;
     mcusx = jpeg_ctx->width >> 4;
@@ -1113,7 +1119,7 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
     xpitch = 8 * bpp;
     pitch = jpeg_ctx->width * bpp; // YUYV out
     ypitch = 8 * pitch;
-    if (info.ns == 1) {
+    if (st->info.ns == 1) {
       mb = 1;
       convert = yuv400pto422; // choose the right conversion function
     } else {
@@ -1127,25 +1133,25 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
     break;
   }
 
-  idctqtab(quant[dscans[0].tq], decdata->dquant[0]);
-  idctqtab(quant[dscans[1].tq], decdata->dquant[1]);
-  idctqtab(quant[dscans[2].tq], decdata->dquant[2]);
-  setinput(&inp, datap);
-  dec_initscans();
+  idctqtab(st->quant[st->dscans[0].tq], decdata->dquant[0]);
+  idctqtab(st->quant[st->dscans[1].tq], decdata->dquant[1]);
+  idctqtab(st->quant[st->dscans[2].tq], decdata->dquant[2]);
+  setinput(&st->inp, st->datap);
+  dec_initscans(st);
 
-  dscans[0].next = 2;
-  dscans[1].next = 1;
-  dscans[2].next = 0; /* 4xx encoding */
+  st->dscans[0].next = 2;
+  st->dscans[1].next = 1;
+  st->dscans[2].next = 0; /* 4xx encoding */
   for (my = 0, y = 0; my < mcusy; my++, y += ypitch) {
     for (mx = 0, x = 0; mx < mcusx; mx++, x += xpitch) {
-      if (info.dri && !--info.nm)
-        if (dec_checkmarker()) {
+      if (st->info.dri && !--st->info.nm)
+        if (dec_checkmarker(st)) {
           err = E_WRONG_MARKER_ERR;
           goto error;
         }
       switch (mb) {
       case 6:
-        decode_mcus(&inp, decdata->dcts, mb, dscans, max);
+        decode_mcus(&st->inp, decdata->dcts, mb, st->dscans, max);
         idct(decdata->dcts, decdata->out, decdata->dquant[0], IFIX(128.5),
              max[0]);
         idct(decdata->dcts + 64, decdata->out + 64, decdata->dquant[0],
@@ -1161,7 +1167,7 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
         break;
 
       case 4:
-        decode_mcus(&inp, decdata->dcts, mb, dscans, max);
+        decode_mcus(&st->inp, decdata->dcts, mb, st->dscans, max);
         idct(decdata->dcts, decdata->out, decdata->dquant[0], IFIX(128.5),
              max[0]);
         idct(decdata->dcts + 64, decdata->out + 64, decdata->dquant[0],
@@ -1173,7 +1179,7 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
         break;
 
       case 3:
-        decode_mcus(&inp, decdata->dcts, mb, dscans, max);
+        decode_mcus(&st->inp, decdata->dcts, mb, st->dscans, max);
         idct(decdata->dcts, decdata->out, decdata->dquant[0], IFIX(128.5),
              max[0]);
         idct(decdata->dcts + 64, decdata->out + 256, decdata->dquant[1],
@@ -1183,7 +1189,7 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
         break;
 
       case 1:
-        decode_mcus(&inp, decdata->dcts, mb, dscans, max);
+        decode_mcus(&st->inp, decdata->dcts, mb, st->dscans, max);
         idct(decdata->dcts, decdata->out, decdata->dquant[0], IFIX(128.5),
              max[0]);
         break;
@@ -1192,7 +1198,7 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
     }
   }
 
-  m = dec_readmarker(&inp);
+  m = dec_readmarker(&st->inp);
   if (m != M_EOI) {
     err = E_NO_EOI_ERR;
     goto error;
@@ -1207,21 +1213,20 @@ error:
 /*
  * close (m)jpeg decoder context
  * args:
- *    none
+ *    jpeg_ctx - pointer to decoder context
  *
  * asserts:
  *    none
  *
  * returns: none
  */
-void jpeg_close_decoder() {
+void jpeg_close_decoder(jpeg_decoder_context_t *jpeg_ctx) {
   if (jpeg_ctx == NULL)
     return;
 
+  free(jpeg_ctx->codec_data);
   free(jpeg_ctx->tmp_frame);
   free(jpeg_ctx);
-
-  jpeg_ctx = NULL;
 }
 
 #else // use libavcodec to decode mjpeg data
@@ -1241,9 +1246,9 @@ typedef struct _codec_data_t {
  * asserts:
  *    none
  *
- * returns: error code (0 - E_OK)
+ * returns: pointer to decoder context (NULL on error)
  */
-int jpeg_init_decoder(int width, int height) {
+jpeg_decoder_context_t *jpeg_init_decoder(int width, int height) {
 #if !LIBAVCODEC_VER_AT_LEAST(53, 34)
   avcodec_init();
 #endif
@@ -1256,10 +1261,7 @@ int jpeg_init_decoder(int width, int height) {
 #endif
   av_log_set_level(AV_LOG_PANIC);
 
-  if (jpeg_ctx != NULL)
-    jpeg_close_decoder();
-
-  jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
+  jpeg_decoder_context_t *jpeg_ctx = calloc(1, sizeof(jpeg_decoder_context_t));
   if (jpeg_ctx == NULL) {
     fprintf(
         stderr,
@@ -1282,8 +1284,7 @@ int jpeg_init_decoder(int width, int height) {
     fprintf(stderr, "V4L2_CORE: (mjpeg decoder) codec not found\n");
     free(jpeg_ctx);
     free(codec_data);
-    jpeg_ctx = NULL;
-    return E_NO_CODEC;
+    return NULL;
   }
 
 #if LIBAVCODEC_VER_AT_LEAST(57, 107)
@@ -1324,8 +1325,7 @@ int jpeg_init_decoder(int width, int height) {
 #endif
     free(codec_data);
     free(jpeg_ctx);
-    jpeg_ctx = NULL;
-    return E_NO_CODEC;
+    return NULL;
   }
 
 #if LIBAVCODEC_VER_AT_LEAST(55, 28)
@@ -1356,12 +1356,13 @@ int jpeg_init_decoder(int width, int height) {
   jpeg_ctx->height = height;
   jpeg_ctx->codec_data = codec_data;
 
-  return E_OK;
+  return jpeg_ctx;
 }
 
 /*
  * decode (m)jpeg frame
  * args:
+ *    jpeg_ctx - pointer to decoder context
  *    out_buf - pointer to decoded data
  *    in_buf - pointer to h264 data
  *    size - in_buf size
@@ -1373,7 +1374,8 @@ int jpeg_init_decoder(int width, int height) {
  *
  * returns: decoded data size
  */
-int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
+int jpeg_decode(jpeg_decoder_context_t *jpeg_ctx, uint8_t *out_buf,
+                uint8_t *in_buf, int size) {
   /*asserts*/
   assert(jpeg_ctx != NULL);
   assert(in_buf != NULL);
@@ -1453,14 +1455,14 @@ int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
 /*
  * close (m)jpeg decoder context
  * args:
- *    none
+ *    jpeg_ctx - pointer to decoder context
  *
  * asserts:
  *    none
  *
  * returns: none
  */
-void jpeg_close_decoder() {
+void jpeg_close_decoder(jpeg_decoder_context_t *jpeg_ctx) {
   if (jpeg_ctx == NULL)
     return;
 
@@ -1488,8 +1490,6 @@ void jpeg_close_decoder() {
 
   free(codec_data);
   free(jpeg_ctx);
-
-  jpeg_ctx = NULL;
 }
 
 #endif
@@ -49,6 +49,13 @@
 #define ERR_BAD_TABLES 14
 #define ERR_DEPTH_MISMATCH 15
 
+/*
+ * (m)jpeg decoder context - opaque data structure
+ *   (all decoder state lives in the context so that
+ *    several contexts can decode concurrently)
+ */
+typedef struct _jpeg_decoder_context_t jpeg_decoder_context_t;
+
 /*
  * init (m)jpeg decoder context
  * args:
@@ -58,35 +65,38 @@
  * asserts:
  *    none
  *
- * returns: error code (0 - E_OK)
+ * returns: pointer to decoder context (NULL on error)
  */
-int jpeg_init_decoder(int width, int height);
+jpeg_decoder_context_t *jpeg_init_decoder(int width, int height);
 
 /*
  * jpeg decode
  * args:
+ *   jpeg_ctx - pointer to decoder context
  *   out_buf -  pointer to picture data ( decoded image - yuyv format)
  *   in_buf -  pointer to input data ( compressed jpeg )
  *   size - picture size
  *
  * asserts:
+ *   jpeg_ctx not null
  *   out_buf not null
  *   in_buf not null
  *
  * returns: error code (0 - OK)
  */
-int jpeg_decode(uint8_t *out_buf, uint8_t *in_buf, int size);
+int jpeg_decode(jpeg_decoder_context_t *jpeg_ctx, uint8_t *out_buf,
+                uint8_t *in_buf, int size);
 
 /*
  * close (m)jpeg decoder context
  * args:
- *    none
+ *    jpeg_ctx - pointer to decoder context
  *
  * asserts:
  *    none
  *
  * returns: none
  */
-void jpeg_close_decoder();
+void jpeg_close_decoder(jpeg_decoder_context_t *jpeg_ctx);
 
 #endif
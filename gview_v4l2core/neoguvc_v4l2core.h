@@ -88,6 +88,8 @@ __BEGIN_DECLS
 #define E_WRONG_MARKER_ERR (-29)
 #define E_NO_EOI_ERR (-30)
 #define E_FILE_IO_ERR (-31)
+#define E_DMABUF_ERR (-32)
+#define E_CTRL_ERR (-33)
 #define E_UNKNOWN_ERR (-40)
 
 /*
@@ -97,11 +99,22 @@ __BEGIN_DECLS
 #define STRM_REQ_STOP (1)
 #define STRM_OK (2)
 
+/*
+ * virtual (replay file backed) device names for v4l2core_init_dev
+ *   "replay:<file>"       replays the recorded frames at the recorded rate
+ *   "replay-fast:<file>"  replays as fast as frames are requested
+ *   (recorded with v4l2core_replay_writer_*, see tools/capture_replay)
+ */
+#define V4L2_REPLAY_PREFIX "replay:"
+#define V4L2_REPLAY_FAST_PREFIX "replay-fast:"
+
 /*
  * IO methods
  */
 #define IO_MMAP 1
 #define IO_READ 2
+#define IO_DMABUF 3 /*imported dmabufs (v4l2core_set_dmabuf_import)*/
+#define IO_USERPTR 4 /*raw and decoded frames in a locked hugepage arena*/
 
 /*
  * Frame status
@@ -130,10 +143,21 @@ __BEGIN_DECLS
 #define IMG_FMT_PNG (2)
 #define IMG_FMT_BMP (3)
 
+/*
+ * conversion target formats not defined by v4l2
+ * (v4l2core_frame_convert also accepts v4l2 fourccs:
+ *  V4L2_PIX_FMT_YUV420, V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_RGB24,
+ *  V4L2_PIX_FMT_RGBA32, ...)
+ */
+#define CONV_FMT_DIB24 v4l2_fourcc('D', 'I', 'B', '3') /*bgr24 upsidedown (bmp)*/
+
 /*
  * buffer number (for driver mmap ops)
+ *   NB_BUFFER buffers are requested by default; with buffer autotuning
+ *   (v4l2core_set_buffer_autotune) the count grows up to V4L2_MAX_BUFFERS
  */
 #define NB_BUFFER 4
+#define V4L2_MAX_BUFFERS 16
 
 /*jpeg header def*/
 #define HEADERFRAME1 0xaf
@@ -226,6 +250,9 @@ typedef struct _v4l2_ctrl_t {
   int64_t value64;
   char *string;
 
+  uint8_t events; // control change events subscribed
+  uint8_t cached; // value is current (kept coherent by control events)
+
   /*localization*/
   char *name; /*gettext translated name*/
   int menu_entries;
@@ -235,6 +262,11 @@ typedef struct _v4l2_ctrl_t {
   struct _v4l2_ctrl_t *next;
 } v4l2_ctrl_t;
 
+/*
+ * max nal units cached per h264 frame (v4l2_frame_buff_t)
+ */
+#define V4L2_H264_MAX_NALS (64)
+
 /*
  * frame buffer struct
  */
@@ -260,8 +292,129 @@ typedef struct _v4l2_frame_buff_t {
   uint8_t *h264_frame; // pointer to regular or demultiplexed h264 frame
   uint8_t *tmp_buffer; // temporary buffer used in decoding
 
+  /*nal table of h264_frame (scanned once when demuxing)*/
+  int h264_nal_count; // nals in h264_frame (only the first
+                      // V4L2_H264_MAX_NALS are in the table)
+  int h264_nal_offset[V4L2_H264_MAX_NALS];   // nal header offset
+  int h264_nal_size[V4L2_H264_MAX_NALS];     // nal size (no start code)
+  uint8_t h264_nal_type[V4L2_H264_MAX_NALS]; // nal_unit_type
+
+  uint32_t raw_pixelformat; // pixel format of raw_frame (v4l2 fourcc)
+  int yuv_ready;            // yuv_frame holds the decoded raw_frame (yu12)
+  uint8_t *yuv_plane[3];    // decoded yu12 planes in decoder memory (h264)
+                            // or NULL - valid until the frame is released
+  int yuv_stride[3];        // yuv_plane line strides (bytes)
+
+  uint64_t pipeline_latency; // ns from capture to delivery (decode pool only)
+
 } v4l2_frame_buff_t;
 
+/*
+ * frame queue counters
+ */
+typedef struct _v4l2_frame_queue_stats_t {
+  int size;           // frame queue size (in frames)
+  uint32_t depth;     // frames currently held by the consumer
+  uint32_t max_depth; // depth high watermark
+  uint64_t dequeued;  // number of frames dequeued
+  uint64_t starved;   // frames dropped with no free slot in the queue
+} v4l2_frame_queue_stats_t;
+
+/*
+ * capture pipeline stages with latency stats (v4l2core_get_stats)
+ *   fx and preview conversion are run by the application, that reports
+ *   them with v4l2core_add_stage_latency
+ */
+#define V4L2_STAGE_DQBUF_WAIT (0) /*v4l2core_get_frame: wait and dequeue*/
+#define V4L2_STAGE_DECODE (1)     /*raw frame decode/conversion to yu12*/
+#define V4L2_STAGE_FX (2)         /*video fx (application)*/
+#define V4L2_STAGE_PREVIEW (3)    /*preview conversion (application)*/
+#define V4L2_STAGE_COUNT (4)
+
+/*
+ * latency summary (values in ns, taken from a hdr style histogram:
+ * percentiles have a relative error below 1/8)
+ */
+typedef struct _v4l2_latency_stats_t {
+  uint64_t count; // number of samples
+  uint64_t mean;
+  uint64_t p50;
+  uint64_t p90;
+  uint64_t p99;
+  uint64_t p999;
+  uint64_t max;
+} v4l2_latency_stats_t;
+
+/*
+ * frame timestamp modes (v4l2core_set_timestamp_mode)
+ */
+#define V4L2_TS_MODE_DEQUEUE (0) /*dequeue time*/
+#define V4L2_TS_MODE_DRIVER (1)  /*driver timestamp if monotonic (default)*/
+
+/*
+ * frame timestamp sources (v4l2_stats_t)
+ */
+#define V4L2_TS_SRC_DEQUEUE (0)    /*dequeue time (filtered in driver mode)*/
+#define V4L2_TS_SRC_DRIVER_EOF (1) /*driver: end of frame (or unknown)*/
+#define V4L2_TS_SRC_DRIVER_SOE (2) /*driver: start of exposure*/
+
+/*
+ * h264 decoder threading (v4l2core_set_h264_decoder_threads)
+ */
+#define V4L2_DEC_THREAD_SLICE (1) /*slice threads: no added latency*/
+#define V4L2_DEC_THREAD_FRAME (2) /*frame threads: hold threads - 1 frames*/
+
+/*
+ * capture stats (v4l2core_get_stats)
+ */
+typedef struct _v4l2_stats_t {
+  v4l2_latency_stats_t stage[V4L2_STAGE_COUNT]; // V4L2_STAGE_*
+  uint64_t frames;        // frames dequeued
+  uint64_t sequence_gaps; // frames lost by the driver (buffer sequence gaps)
+  uint64_t starved;       // frames dropped with no free slot in the queue
+  double real_fps;        // measured frame rate
+  int buffers;            // driver buffers in use
+  int queue_size;         // frame queue size (in frames)
+  int ts_source;          // V4L2_TS_SRC_* of the last frame
+  uint64_t ts_jitter;     // frame timestamp interval jitter (ns)
+  uint64_t dqbuf_jitter;  // dequeue time interval jitter (ns)
+  double clock_skew_ppm;  // driver clock skew to the system monotonic clock
+  int decode_delay;       // frames held by the h264 decoder (frame threads)
+  uint64_t decode_delay_ns; // latency added by the held frames (ns)
+} v4l2_stats_t;
+
+/*
+ * dmabuf frame description (sent along with the dmabuf fd)
+ */
+typedef struct _v4l2_dmabuf_frame_t {
+  int32_t index;         // frame index (sent back on release)
+  uint32_t width;        // frame width (in pixels)
+  uint32_t height;       // frame height (in pixels)
+  uint32_t pixelformat;  // v4l2 fourcc
+  uint32_t bytesperline; // line stride (bytes)
+  uint32_t bytesused;    // frame size (bytes)
+  uint32_t length;       // dmabuf size (bytes)
+  uint64_t timestamp;    // captured frame timestamp
+} v4l2_dmabuf_frame_t;
+
+/*
+ * device list change callback (called from the device monitor thread)
+ */
+typedef void (*v4l2_device_list_cb_t)(void *data);
+
+/*
+ * h264 gop replay callback (v4l2core_h264_replay_gop)
+ *   data is only valid during the call
+ */
+typedef void (*v4l2_h264_gop_cb_t)(uint8_t *frame, int size,
+                                   uint64_t timestamp, int keyframe,
+                                   void *data);
+
+/*
+ * replay file writer (opaque)
+ */
+typedef struct _v4l2_replay_writer_t v4l2_replay_writer_t;
+
 /*
  * v4l2 device system data
  */
@@ -272,6 +425,8 @@ typedef struct _v4l2_dev_sys_data_t {
   char *location;
   uint32_t vendor;
   uint32_t product;
+  uint32_t bcd_device; // usb device release number
+  char *serial;        // usb serial number (NULL if none)
   int valid;
   int current;
   uint64_t busnum;
@@ -281,6 +436,25 @@ typedef struct _v4l2_dev_sys_data_t {
 /* v4l2 device handler - opaque data structure*/
 typedef struct _v4l2_dev_t v4l2_dev_t;
 
+/* multi device capture engine - opaque data structure*/
+typedef struct _v4l2_capture_engine_t v4l2_capture_engine_t;
+
+/*
+ * capture engine frame callback
+ *   the callback owns the frame and must release it
+ *   (v4l2core_release_frame) once done with it
+ */
+typedef void (*v4l2_frame_cb_t)(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                                void *data);
+
+/*
+ * capture engine control event callback
+ *   called (from a dispatch thread) when the device has pending control
+ *   events: the thread that owns the controls applies them with
+ *   v4l2core_check_control_events (or on the next control read)
+ */
+typedef void (*v4l2_event_cb_t)(v4l2_dev_t *vd, void *data);
+
 /*
  * ioctl with a number of retries in the case of I/O failure
  * args:
@@ -409,13 +583,14 @@ uint8_t v4l2core_get_isbayer(v4l2_dev_t *vd);
 
 /*
  * gets current device index
+ *   (resolved by device path: the device list may have been swapped)
  * args:
  *   vd - pointer to v4l2 device handler
  *
  * asserts:
  *   none
  *
- * returns - device index
+ * returns - device index (-1 if the device is not in the list)
  */
 int v4l2core_get_this_device_index(v4l2_dev_t *vd);
 
@@ -471,7 +646,8 @@ double v4l2core_get_realfps(v4l2_dev_t *vd);
  * set v4l2 capture method to use
  * args:
  *   vd - pointer to v4l2 device handler
- *   method - capture method (IO_READ or IO_MMAP)
+ *   method - capture method (IO_READ, IO_MMAP or IO_USERPTR;
+ *            IO_DMABUF is set by v4l2core_set_dmabuf_import)
  *
  * asserts:
  *   vd is not null
@@ -483,7 +659,7 @@ void v4l2core_set_capture_method(v4l2_dev_t *vd, int method);
 /*
  * Initiate video device handler with default values
  * args:
- *   device - device name (e.g: "/dev/video0")
+ *   device - device name (e.g: "/dev/video0" or "replay:<file>")
  *
  * asserts:
  *   device is not null
@@ -617,6 +793,8 @@ int v4l2core_get_device_index(const char *videodevice);
 
 /*
  * check for new devices
+ *   with a device list callback set, this only takes the list updated
+ *   by the device monitor thread (no device io)
  * args:
  *   none
  *
@@ -628,7 +806,44 @@ int v4l2core_get_device_index(const char *videodevice);
 int v4l2core_check_device_list_events();
 
 /*
- * check for control events
+ * add a device list callback: the first one starts a udev monitor
+ *   thread that keeps an updated device list (new nodes are probed
+ *   concurrently); the callback is called from that thread when the
+ *   list changes and should only schedule a call to
+ *   v4l2core_check_device_list_events in the thread using the list
+ *   (it must not add or remove callbacks)
+ * args:
+ *   callback - callback function
+ *   data - callback user data
+ *
+ * asserts:
+ *   callback is not null
+ *
+ * returns: error code
+ */
+int v4l2core_add_device_list_callback(v4l2_device_list_cb_t callback,
+                                      void *data);
+
+/*
+ * remove a device list callback
+ *   (no calls to it are made after this returns)
+ * args:
+ *   callback - callback function
+ *   data - callback user data
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_remove_device_list_callback(v4l2_device_list_cb_t callback,
+                                          void *data);
+
+/*
+ * check for control events (updates the cached control values)
+ *   must run on the thread that sets the controls: v4l2core_get_frame
+ *   and the capture engine only flag pending events (dequeued here or
+ *   on the next control read)
  * args:
  *   vd - pointer to v4l2 device handler
  *
@@ -639,6 +854,21 @@ int v4l2core_check_device_list_events();
  */
 int v4l2core_check_control_events(v4l2_dev_t *vd);
 
+/*
+ * enumerate the frame formats and controls again if the background
+ *   verification found the capabilities cache stale
+ *   must run on the thread that owns the lists: format and control
+ *   pointers taken before a refresh are no longer valid
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: 1 if the lists were enumerated again, 0 otherwise
+ */
+int v4l2core_check_device_caps(v4l2_dev_t *vd);
+
 /*
  * get requested frame format
  * args:
@@ -816,6 +1046,118 @@ v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd);
  */
 int v4l2core_release_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
 
+/*
+ * gets the frame queue counters
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stats - pointer to frame queue stats struct (filled by the function)
+ *
+ * asserts:
+ *   vd is not null
+ *   stats is not null
+ *
+ * returns: none
+ */
+void v4l2core_get_frame_queue_stats(v4l2_dev_t *vd,
+                                    v4l2_frame_queue_stats_t *stats);
+
+/*
+ * gets the capture stats (stage latencies and drop counters)
+ *   cheap enough to be polled by a monitoring thread while streaming
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stats - pointer to stats struct (filled by the function)
+ *
+ * asserts:
+ *   vd is not null
+ *   stats is not null
+ *
+ * returns: none
+ */
+void v4l2core_get_stats(v4l2_dev_t *vd, v4l2_stats_t *stats);
+
+/*
+ * resets the stage latency histograms and the sequence gap counter
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_reset_stats(v4l2_dev_t *vd);
+
+/*
+ * records a stage latency (for stages run by the application)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stage - pipeline stage (V4L2_STAGE_*)
+ *   ns - stage latency (ns)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_add_stage_latency(v4l2_dev_t *vd, int stage, uint64_t ns);
+
+/*
+ * enables/disables buffer autotuning (enabled by default)
+ *   frames lost because the consumer is too slow (sequence gaps on buffers
+ *   that waited in the driver queue, or a full frame queue) grow the driver
+ *   buffer count and the frame queue size (up to V4L2_MAX_BUFFERS):
+ *   buffers are added right away with VIDIOC_CREATE_BUFS when the driver
+ *   supports it (plain IO_MMAP), everything else is applied when the
+ *   stream format is next set (v4l2core_update_current_format)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   enable - 1 to enable, 0 to disable
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_set_buffer_autotune(v4l2_dev_t *vd, int enable);
+
+/*
+ * sets the frame timestamp mode
+ *   V4L2_TS_MODE_DRIVER (default) uses the driver timestamps when the
+ *   driver advertises monotonic ones (V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC),
+ *   corrected for the driver clock skew, and falls back to the jitter
+ *   filtered dequeue time; V4L2_TS_MODE_DEQUEUE uses the raw dequeue time
+ *   applied on the next stream start
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   mode - V4L2_TS_MODE_*
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_timestamp_mode(v4l2_dev_t *vd, int mode);
+
+/*
+ * sets the h264 decoder threading
+ *   slice threads (default) add no latency; frame threads scale better
+ *   for large frames but hold (threads - 1) frames (decode_delay stats)
+ *   applied on the next stream start
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   threads - number of decoder threads (0 - auto)
+ *   thread_type - V4L2_DEC_THREAD_SLICE and/or V4L2_DEC_THREAD_FRAME
+ *                 (0 - single threaded)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_h264_decoder_threads(v4l2_dev_t *vd, int threads,
+                                      int thread_type);
+
 /*
  * gets the next video frame and decodes it
  * args:
@@ -828,6 +1170,288 @@ int v4l2core_release_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
  */
 v4l2_frame_buff_t *v4l2core_get_decoded_frame(v4l2_dev_t *vd);
 
+/*
+ * enables the pipelined decode mode for v4l2core_get_decoded_frame:
+ *   a dequeue thread hands raw frames to nworkers decode threads and
+ *   decoded frames are returned in capture order (the added latency is
+ *   set in frame->pipeline_latency); the frame queue size should be at
+ *   least nworkers + 1 (v4l2core_set_frame_queue_size)
+ *   don't call v4l2core_get_frame directly while the pool is enabled
+ * args:
+ *    vd - pointer to v4l2 device handler
+ *    nworkers - number of decode workers (0 disables the pipelined mode)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_decode_pool(v4l2_dev_t *vd, int nworkers);
+
+/*
+ * converts the frame to the requested format
+ *   uses a direct kernel from the raw frame format when available,
+ *   otherwise chains kernels (decoding to yuv_frame only if needed);
+ *   if the frame is already decoded (yuv_ready) yuv_frame is used as source
+ *   h264 pictures are read from the decoder planes (yuv_plane)
+ * args:
+ *    vd - pointer to v4l2 device handler (NULL: no decoding)
+ *    frame - pointer to frame buffer
+ *    dst_fmt - output format (v4l2 fourcc or CONV_FMT_*)
+ *    out - pointer to output buffer (big enough for dst_fmt)
+ *
+ * asserts:
+ *   frame is not null
+ *   out is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_frame_convert(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                           uint32_t dst_fmt, uint8_t *out);
+
+/*
+ * exports the capture buffers as dmabufs (IO_MMAP only)
+ *   must be set before setting the stream format
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   enable - 1 to export the buffers, 0 to stop exporting
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_dmabuf_export(v4l2_dev_t *vd, int enable);
+
+/*
+ * imports external dmabufs as capture buffers (sets IO_DMABUF method)
+ *   must be set before setting the stream format; the dmabufs
+ *   still belong to the caller and must outlive the stream
+ *   (libv4l2 format emulation is not available with imported buffers)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   fds - NB_BUFFER dmabuf file descriptors
+ *   length - size of each dmabuf (>= frame size image)
+ *
+ * asserts:
+ *   vd is not null
+ *   fds is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_dmabuf_import(v4l2_dev_t *vd, const int *fds,
+                               uint32_t length);
+
+/*
+ * gets the dmabuf file descriptor of the frame buffer
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   frame - pointer to frame buffer
+ *
+ * asserts:
+ *   vd is not null
+ *   frame is not null
+ *
+ * returns: dmabuf fd (owned by the device) or -1 if none
+ */
+int v4l2core_get_frame_dmabuf_fd(v4l2_dev_t *vd, v4l2_frame_buff_t *frame);
+
+/*
+ * allocates a dmabuf from the system dma heap
+ * args:
+ *   size - buffer size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: dmabuf fd (-1 on error)
+ */
+int v4l2core_dmabuf_alloc(uint32_t size);
+
+/*
+ * sends the frame dmabuf (and its description) over a unix socket
+ *   the frame must only be released after the peer sends it back
+ *   (v4l2core_dmabuf_recv_release)
+ * args:
+ *   sock - connected unix socket
+ *   vd - pointer to v4l2 device handler
+ *   frame - pointer to frame buffer (with an exported or imported dmabuf)
+ *
+ * asserts:
+ *   vd is not null
+ *   frame is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_dmabuf_send_frame(int sock, v4l2_dev_t *vd,
+                               v4l2_frame_buff_t *frame);
+
+/*
+ * receives a frame dmabuf sent with v4l2core_dmabuf_send_frame
+ * args:
+ *   sock - connected unix socket
+ *   info - pointer to frame description (filled by the function)
+ *
+ * asserts:
+ *   info is not null
+ *
+ * returns: received dmabuf fd (owned by the caller) or -1 on error
+ */
+int v4l2core_dmabuf_recv_frame(int sock, v4l2_dmabuf_frame_t *info);
+
+/*
+ * tells the sender that a received frame is no longer in use
+ * args:
+ *   sock - connected unix socket
+ *   index - frame index (v4l2_dmabuf_frame_t.index)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_dmabuf_send_release(int sock, int index);
+
+/*
+ * waits for the peer to release a frame sent with v4l2core_dmabuf_send_frame
+ * args:
+ *   sock - connected unix socket
+ *
+ * asserts:
+ *   none
+ *
+ * returns: released frame index (-1 on error)
+ */
+int v4l2core_dmabuf_recv_release(int sock);
+
+/*
+ * creates a replay file for the current device stream format
+ *   (the raw frames are recorded: uvc muxed h264 is recorded as mjpeg)
+ * args:
+ *   filename - replay file name
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   filename is not null
+ *   vd is not null
+ *
+ * returns: pointer to replay writer (NULL on error)
+ */
+v4l2_replay_writer_t *v4l2core_replay_writer_new(const char *filename,
+                                                 v4l2_dev_t *vd);
+
+/*
+ * appends the raw frame (and its timestamp) to the replay file
+ * args:
+ *   writer - pointer to replay writer
+ *   frame - pointer to frame buffer (as returned by v4l2core_get_frame)
+ *
+ * asserts:
+ *   writer is not null
+ *   frame is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_replay_writer_add_frame(v4l2_replay_writer_t *writer,
+                                     v4l2_frame_buff_t *frame);
+
+/*
+ * closes the replay file and frees the writer
+ * args:
+ *   writer - pointer to replay writer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of recorded frames
+ */
+int v4l2core_replay_writer_close(v4l2_replay_writer_t *writer);
+
+/*
+ * creates a capture engine: nthreads threads waiting (epoll) on the
+ *   frame and control event notifications of all the added devices
+ * args:
+ *   nthreads - number of dispatch threads (<= 0 defaults to 1)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to capture engine (NULL on error)
+ */
+v4l2_capture_engine_t *v4l2core_engine_new(int nthreads);
+
+/*
+ * adds a (streaming) device to the capture engine
+ *   callbacks for the same device are never called concurrently
+ * args:
+ *   engine - pointer to capture engine
+ *   vd - pointer to v4l2 device handler
+ *   frame_cb - frame callback (NULL: frames are released immediately)
+ *   event_cb - control event callback (can be NULL)
+ *   data - user data passed to the callbacks
+ *
+ * asserts:
+ *   engine is not null
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_add_device(v4l2_capture_engine_t *engine, v4l2_dev_t *vd,
+                               v4l2_frame_cb_t frame_cb,
+                               v4l2_event_cb_t event_cb, void *data);
+
+/*
+ * removes a device from the capture engine
+ *   a callback already running for the device may still complete
+ * args:
+ *   engine - pointer to capture engine
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   engine is not null
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_remove_device(v4l2_capture_engine_t *engine,
+                                  v4l2_dev_t *vd);
+
+/*
+ * starts the capture engine dispatch threads
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   engine is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_start(v4l2_capture_engine_t *engine);
+
+/*
+ * stops the capture engine dispatch threads (blocks until they exit)
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   engine is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_engine_stop(v4l2_capture_engine_t *engine);
+
+/*
+ * stops and frees the capture engine (devices are not closed)
+ * args:
+ *   engine - pointer to capture engine
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_engine_free(v4l2_capture_engine_t *engine);
+
 /*
  * clean v4l2 buffers
  * args:
@@ -946,6 +1570,8 @@ int v4l2core_set_control_value_by_id(v4l2_dev_t *vd, int id);
 /*
  * updates the value for control id from the device
  * also updates control flags
+ *   cached values (control->cached) are kept coherent by control events
+ *   and don't query the device
  * args:
  *   vd - pointer to v4l2 device handler
  *   id - control id
@@ -1045,7 +1671,25 @@ void v4l2core_soft_autofocus_close();
 int v4l2core_save_control_profile(v4l2_dev_t *vd, const char *filename);
 
 /*
- * load the device control values from a profile file
+ * save the device control values into a binary profile file
+ *   compact and fast to load, for switching presets during a session
+ *   (native byte order: not meant to be shared between hosts)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   filename - profile filename
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (0 -E_OK)
+ */
+int v4l2core_save_control_profile_bin(v4l2_dev_t *vd, const char *filename);
+
+/*
+ * load the device control values from a profile file (text or binary)
+ *   controls are validated (VIDIOC_TRY_EXT_CTRLS) and set with a single
+ *   VIDIOC_S_EXT_CTRLS per control class, auto controls first; nothing is
+ *   set if a value is rejected (E_CTRL_ERR)
  * args:
  *   vd - pointer to v4l2 device handler
  *   filename - profile filename
@@ -1145,6 +1789,26 @@ uint8_t *v4l2core_get_h264_sps(v4l2_dev_t *vd);
  */
 void v4l2core_h264_request_idr(v4l2_dev_t *vd);
 
+/*
+ * replays the compressed h264 frames since the last IDR (annex-b),
+ *   IDR first (with SPS and PPS): primes a new consumer (decoder or
+ *   muxer) without requesting an IDR from the camera
+ *   the gop is locked during the replay: the callback should not block
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   callback - called for each frame (in capture order)
+ *   data - callback user data
+ *
+ * asserts:
+ *   vd is not null
+ *   callback is not null
+ *
+ * returns: number of replayed frames
+ *          or E_NO_DATA if there is no (complete) gop: request an IDR
+ */
+int v4l2core_h264_replay_gop(v4l2_dev_t *vd, v4l2_h264_gop_cb_t callback,
+                             void *data);
+
 /*
  * query the frame rate config
  * args:
@@ -1183,6 +1847,69 @@ uint32_t v4l2core_get_h264_frame_rate_config(v4l2_dev_t *vd);
  */
 int v4l2core_set_h264_frame_rate_config(v4l2_dev_t *vd, uint32_t framerate);
 
+/*
+ * query the h264 encoder bit rate
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   query - query type (UVC_GET_CUR; UVC_GET_MAX; UVC_GET_MIN; ...)
+ *   average - pointer to average bit rate (bits/sec)
+ *   peak - pointer to peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *   average is not null
+ *   peak is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int v4l2core_query_h264_bitrate(v4l2_dev_t *vd, uint8_t query,
+                                uint32_t *average, uint32_t *peak);
+
+/*
+ * set the h264 encoder bit rate
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   average - average bit rate (bits/sec)
+ *   peak - peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int v4l2core_set_h264_bitrate(v4l2_dev_t *vd, uint32_t average, uint32_t peak);
+
+/*
+ * starts/stops the h264 bit rate controller: the camera encoder bit
+ *   rate follows the consumer backpressure (v4l2core_h264_rate_control_update)
+ *   starting takes the current bit rate as ceiling; stopping restores it
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   enable - start (1) or stop (0) the controller
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int v4l2core_h264_rate_control_enable(v4l2_dev_t *vd, int enable);
+
+/*
+ * feeds the h264 bit rate controller with the consumer backpressure
+ *   (call it regularly, e.g. on every recorded frame)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   ring_fill - encoder ring buffer fill (0 - empty; 1 - full/dropping)
+ *   io_load - share of time the writer spends writing (0 to 1)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: current average bit rate (0 if the controller is stopped)
+ */
+uint32_t v4l2core_h264_rate_control_update(v4l2_dev_t *vd, double ring_fill,
+                                           double io_load);
+
 /*
  * updates the h264_probe_commit_req field
  * args:
@@ -29,7 +29,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
-#include "colorspaces.h"
+#include "frame_convert.h"
 #include "neoguvc_v4l2core.h"
 #include "save_image.h"
 // #include "../config.h"
@@ -154,9 +154,9 @@ int save_image_bmp(v4l2_frame_buff_t *frame, const char *filename) {
             strerror(errno));
     exit(-1);
   }
-  yu12_to_dib24(bmp, frame->yuv_frame, width, height);
-
-  ret = save_bmp(filename, bmp, width, height, 24);
+  ret = convert_frame(NULL, frame, CONV_FMT_DIB24, bmp);
+  if (ret == E_OK)
+    ret = save_bmp(filename, bmp, width, height, 24);
   free(bmp);
 
   return ret;
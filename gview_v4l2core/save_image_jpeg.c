@@ -29,8 +29,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
-#include "colorspaces.h"
 #include "dct.h"
+#include "frame_convert.h"
 #include "neoguvc_v4l2core.h"
 #include "save_image.h"
 // #include "../config.h"
@@ -884,16 +884,6 @@ static int encode_jpeg(uint8_t *input, uint8_t *output,
   /* Writing Marker Data */
   tmp_optr = write_markers(jpeg_ctx, tmp_optr, huff);
 
-  uint8_t *yuv422 = calloc(jpeg_ctx->image_width * jpeg_ctx->image_height * 2,
-                           sizeof(uint8_t));
-  if (yuv422 == NULL) {
-    fprintf(stderr,
-            "V4L2_CORE: couldn't allocate memory for jpeg encoder (fatal)\n");
-    exit(-1);
-  }
-  yu12_to_yuyv(yuv422, input, jpeg_ctx->image_width, jpeg_ctx->image_height);
-  tmp_iptr = yuv422;
-
   for (i = 0; i < jpeg_ctx->vertical_mcus; i++) { /* height /8 */
     tmp_ptr = tmp_iptr;
     for (j = 0; j < jpeg_ctx->horizontal_mcus; j++) { /* width /16 */
@@ -913,8 +903,6 @@ static int encode_jpeg(uint8_t *input, uint8_t *output,
   }
 
   /* Close Routine */
-  free(yuv422);
-
   tmp_optr = close_bitstream(jpeg_ctx, tmp_optr);
   size = tmp_optr - output;
   tmp_iptr = NULL;
@@ -955,13 +943,31 @@ int save_image_jpeg(v4l2_frame_buff_t *frame, const char *filename) {
     exit(-1);
   }
 
+  /* the encoder reads yuyv: convert straight from the raw frame if possible*/
+  uint8_t *yuv422 = calloc(frame->width * frame->height * 2, sizeof(uint8_t));
+  if (yuv422 == NULL) {
+    fprintf(
+        stderr,
+        "V4L2_CORE: FATAL memory allocation failure (save_image_jpeg): %s\n",
+        strerror(errno));
+    exit(-1);
+  }
+
+  if (convert_frame(NULL, frame, V4L2_PIX_FMT_YUYV, yuv422) != E_OK) {
+    fprintf(stderr, "V4L2_CORE: (save_image_jpeg) couldn't convert frame\n");
+    free(yuv422);
+    free(jpeg);
+    free(jpeg_ctx);
+    return E_FORMAT_ERR;
+  }
+
   /* Initialization of JPEG control structure */
   initialization(jpeg_ctx, frame->width, frame->height);
 
   /* Initialization of Quantization Tables  */
   initialize_quantization_tables(jpeg_ctx);
 
-  int jpeg_size = encode_jpeg(frame->yuv_frame, jpeg, jpeg_ctx, 1);
+  int jpeg_size = encode_jpeg(yuv422, jpeg, jpeg_ctx, 1);
 
   if (v4l2core_save_data_to_file(filename, jpeg, jpeg_size)) {
     fprintf(stderr,
@@ -971,6 +977,7 @@ int save_image_jpeg(v4l2_frame_buff_t *frame, const char *filename) {
   }
 
   /*clean up*/
+  free(yuv422);
   free(jpeg);
   free(jpeg_ctx);
 
@@ -30,7 +30,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
-#include "colorspaces.h"
+#include "frame_convert.h"
 #include "neoguvc_v4l2core.h"
 #include "save_image.h"
 
@@ -231,9 +231,9 @@ int save_image_png(v4l2_frame_buff_t *frame, const char *filename) {
     exit(-1);
   }
 
-  yu12_to_rgb24(rgb, frame->yuv_frame, width, height);
-
-  int ret = save_png(filename, width, height, rgb);
+  int ret = convert_frame(NULL, frame, V4L2_PIX_FMT_RGB24, rgb);
+  if (ret == E_OK)
+    ret = save_png(filename, width, height, rgb);
 
   free(rgb);
 
@@ -44,11 +44,17 @@ extern int verbosity;
 typedef struct _h264_decoder_context_t {
   const AVCodec *codec;
   AVCodecContext *context;
-  AVFrame *picture;
+  AVFrame **picture; // decoded pictures (one per frame queue slot)
+  int num_pictures;  // number of pictures (frame queue size)
+#if LIBAVCODEC_VER_AT_LEAST(58, 129)
+  AVPacket *packet; // reused for every frame
+#else
+  AVPacket packet;
+#endif
 
   int width;
   int height;
-  int pic_size;
+  int delay; // frames held by the decoder (frame threads)
 
 } h264_decoder_context_t;
 
@@ -873,6 +879,94 @@ int h264_set_frame_rate_config(v4l2_dev_t *vd, uint32_t framerate) {
   return err;
 }
 
+/*
+ * query the encoder bit rate (layer 0)
+ * args:
+ *   vd - pointer to video device data
+ *   query - query type (UVC_GET_CUR; UVC_GET_MAX; UVC_GET_MIN; ...)
+ *   average - pointer to average bit rate (bits/sec)
+ *   peak - pointer to peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *   average is not null
+ *   peak is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int h264_query_bitrate(v4l2_dev_t *vd, uint8_t query, uint32_t *average,
+                       uint32_t *peak) {
+  /*asserts*/
+  assert(vd != NULL);
+  assert(average != NULL);
+  assert(peak != NULL);
+
+  if (vd->h264_unit_id <= 0) {
+    if (verbosity > 0)
+      printf("V4L2_CORE: device doesn't seem to support uvc H264 (%i)\n",
+             vd->h264_unit_id);
+    return E_NO_STREAM_ERR;
+  }
+
+  uvcx_bitrate_layers_t bitrate_req;
+  bitrate_req.wLayerID = 0;
+
+  int err = E_OK;
+
+  if ((err = v4l2core_query_xu_control(vd, vd->h264_unit_id,
+                                       UVCX_BITRATE_LAYERS, query,
+                                       &bitrate_req)) < 0) {
+    fprintf(stderr, "V4L2_CORE: (UVCX_BITRATE_LAYERS) query (%u) error: %s\n",
+            query, strerror(errno));
+    return err;
+  }
+
+  *average = bitrate_req.dwAverageBitrate;
+  *peak = bitrate_req.dwPeakBitrate;
+
+  return E_OK;
+}
+
+/*
+ * set the encoder bit rate (layer 0)
+ * args:
+ *   vd - pointer to video device data
+ *   average - average bit rate (bits/sec)
+ *   peak - peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int h264_set_bitrate(v4l2_dev_t *vd, uint32_t average, uint32_t peak) {
+  /*asserts*/
+  assert(vd != NULL);
+
+  if (vd->h264_unit_id <= 0) {
+    if (verbosity > 0)
+      printf("V4L2_CORE: device doesn't seem to support uvc H264 (%i)\n",
+             vd->h264_unit_id);
+    return E_NO_STREAM_ERR;
+  }
+
+  uvcx_bitrate_layers_t bitrate_req;
+  bitrate_req.wLayerID = 0;
+  bitrate_req.dwAverageBitrate = average;
+  bitrate_req.dwPeakBitrate = peak;
+
+  int err = E_OK;
+
+  if ((err = v4l2core_query_xu_control(vd, vd->h264_unit_id,
+                                       UVCX_BITRATE_LAYERS, UVC_SET_CUR,
+                                       &bitrate_req)) < 0) {
+    fprintf(stderr, "V4L2_CORE: (UVCX_BITRATE_LAYERS) SET_CUR error: %s\n",
+            strerror(errno));
+  }
+
+  return err;
+}
+
 /*
  * updates the h264_probe_commit_req field
  * args:
@@ -909,18 +1003,50 @@ int h264_probe_config_probe_req(
  * ############# H264 decoder ##############
  */
 
+/*
+ * frees a decoder picture
+ * args:
+ *    picture - pointer to picture pointer
+ *
+ * asserts:
+ *    picture is not null
+ *
+ * returns: none
+ */
+static void free_decoder_picture(AVFrame **picture) {
+  /*assertions*/
+  assert(picture != NULL);
+
+#if LIBAVCODEC_VER_AT_LEAST(55, 28)
+  av_frame_free(picture);
+#else
+#if LIBAVCODEC_VER_AT_LEAST(54, 28)
+  avcodec_free_frame(picture);
+#else
+  av_freep(picture);
+#endif
+#endif
+}
+
 /*
  * init h264 decoder context
  * args:
  *    width - image width
  *    height - image height
+ *    num_pictures - number of decoded pictures kept (frame queue size)
+ *    threads - number of decoder threads (0 - auto)
+ *    thread_type - V4L2_DEC_THREAD_SLICE and/or V4L2_DEC_THREAD_FRAME
  *
  * asserts:
- *    none
+ *    num_pictures > 0
  *
  * returns: error code (0 - E_OK)
  */
-int h264_init_decoder(int width, int height) {
+int h264_init_decoder(int width, int height, int num_pictures, int threads,
+                      int thread_type) {
+  /*assertions*/
+  assert(num_pictures > 0);
+
 #if !LIBAVCODEC_VER_AT_LEAST(53, 34)
   avcodec_init();
 #endif
@@ -977,6 +1103,19 @@ int h264_init_decoder(int width, int height) {
   h264_ctx->context->height = height;
   // h264_ctx->context->dsp_mask = (FF_MM_MMX | FF_MM_MMXEXT | FF_MM_SSE);
 
+  /*
+   * slice threads add no latency (but most uvc streams have a single
+   * slice per frame); frame threads hold (threads - 1) frames
+   */
+  h264_ctx->context->thread_count = threads > 0 ? threads : 0;
+  h264_ctx->context->thread_type = 0;
+  if (thread_type & V4L2_DEC_THREAD_SLICE)
+    h264_ctx->context->thread_type |= FF_THREAD_SLICE;
+  if (thread_type & V4L2_DEC_THREAD_FRAME)
+    h264_ctx->context->thread_type |= FF_THREAD_FRAME;
+  if (h264_ctx->context->thread_type == 0)
+    h264_ctx->context->thread_count = 1;
+
 #if LIBAVCODEC_VER_AT_LEAST(53, 6)
   if (avcodec_open2(h264_ctx->context, h264_ctx->codec, NULL) < 0)
 #else
@@ -996,93 +1135,163 @@ int h264_init_decoder(int width, int height) {
     return E_NO_CODEC;
   }
 
+  if (verbosity > 0)
+    printf("V4L2_CORE: (H264 decoder) %i threads (%s%s)\n",
+           h264_ctx->context->thread_count,
+           (h264_ctx->context->active_thread_type & FF_THREAD_FRAME)
+               ? "frame"
+               : "",
+           (h264_ctx->context->active_thread_type & FF_THREAD_SLICE)
+               ? "slice"
+               : "");
+
+  h264_ctx->picture = calloc(num_pictures, sizeof(AVFrame *));
+  if (h264_ctx->picture == NULL) {
+    fprintf(
+        stderr,
+        "V4L2_CORE: FATAL memory allocation failure (h264_init_decoder): %s\n",
+        strerror(errno));
+    exit(-1);
+  }
+  h264_ctx->num_pictures = num_pictures;
+
+  int i = 0;
+  for (i = 0; i < num_pictures; i++) {
 #if LIBAVCODEC_VER_AT_LEAST(55, 28)
-  h264_ctx->picture = av_frame_alloc();
-  av_frame_unref(h264_ctx->picture);
+    h264_ctx->picture[i] = av_frame_alloc();
 #else
-  h264_ctx->picture = avcodec_alloc_frame();
-  avcodec_get_frame_defaults(h264_ctx->picture);
+    h264_ctx->picture[i] = avcodec_alloc_frame();
 #endif
+    if (h264_ctx->picture[i] == NULL) {
+      fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure "
+                      "(h264_init_decoder): av_frame_alloc\n");
+      exit(-1);
+    }
+#if !LIBAVCODEC_VER_AT_LEAST(55, 28)
+    avcodec_get_frame_defaults(h264_ctx->picture[i]);
+#endif
+  }
 
-#if LIBAVUTIL_VER_AT_LEAST(54, 6)
-  h264_ctx->pic_size =
-      av_image_get_buffer_size(h264_ctx->context->pix_fmt, width, height, 1);
+#if LIBAVCODEC_VER_AT_LEAST(58, 129)
+  h264_ctx->packet = av_packet_alloc();
+  if (h264_ctx->packet == NULL) {
+    fprintf(stderr, "V4L2_CORE: FATAL memory allocation failure "
+                    "(h264_init_decoder): av_packet_alloc\n");
+    exit(-1);
+  }
 #else
-  h264_ctx->pic_size =
-      avpicture_get_size(h264_ctx->context->pix_fmt, width, height);
+  av_init_packet(&h264_ctx->packet);
 #endif
+
   h264_ctx->width = width;
   h264_ctx->height = height;
+  /*frame threads hold (threads - 1) frames once the pipeline is full*/
+  h264_ctx->delay = 0;
+  if ((h264_ctx->context->active_thread_type & FF_THREAD_FRAME) &&
+      h264_ctx->context->thread_count > 1)
+    h264_ctx->delay = h264_ctx->context->thread_count - 1;
 
   return E_OK;
 }
 
 /*
- * decode h264 frame
+ * decode h264 frame: the decoded picture planes are handed to the frame
+ *   (yuv_plane/yuv_stride) with no copy, and stay valid until the frame
+ *   queue slot is decoded again; with frame threads the picture is the
+ *   one of an earlier frame (see h264_get_decoder_delay)
  * args:
- *    out_buf - pointer to decoded data
+ *    frame - pointer to frame buffer
+ *    slot - frame queue slot of the frame
  *    in_buf - pointer to h264 data
  *    size - in_buf size
  *
  * asserts:
  *    h264_ctx is not null
+ *    frame is not null
  *    in_buf is not null
- *    out_buf is not null
  *
- * returns: decoded data size
+ * returns: error code (E_OK, also if no picture is out yet)
  */
-int h264_decode(uint8_t *out_buf, uint8_t *in_buf, int size) {
+int h264_decode(v4l2_frame_buff_t *frame, int slot, uint8_t *in_buf,
+                int size) {
   /*asserts*/
   assert(h264_ctx != NULL);
+  assert(frame != NULL);
   assert(in_buf != NULL);
-  assert(out_buf != NULL);
+
+  if (slot < 0 || slot >= h264_ctx->num_pictures)
+    slot = 0;
+
+  AVFrame *picture = h264_ctx->picture[slot];
+  /*drop the picture previously handed to this slot*/
+#if LIBAVCODEC_VER_AT_LEAST(55, 28)
+  av_frame_unref(picture);
+#endif
+
+  frame->yuv_plane[0] = NULL;
+  frame->yuv_plane[1] = NULL;
+  frame->yuv_plane[2] = NULL;
 
   int got_frame = 0;
 
 #if LIBAVCODEC_VER_AT_LEAST(58, 129)
-  AVPacket *avpkt = av_packet_alloc();
-  if (!avpkt) {
-    fprintf(stderr, "V4L2_CORE uvc_H264: could not allocate av_packet\n");
-    return -1;
-  }
-
+  AVPacket *avpkt = h264_ctx->packet;
+#else
+  AVPacket *avpkt = &h264_ctx->packet;
+#endif
   avpkt->size = size;
   avpkt->data = in_buf;
 
-  int ret =
-      libav_decode(h264_ctx->context, h264_ctx->picture, &got_frame, avpkt);
+  int ret = libav_decode(h264_ctx->context, picture, &got_frame, avpkt);
 
-  av_packet_free(&avpkt);
-#else
-  AVPacket avpkt;
-  av_init_packet(&avpkt);
-  avpkt.size = size;
-  avpkt.data = in_buf;
-
-  int ret =
-      libav_decode(h264_ctx->context, h264_ctx->picture, &got_frame, &avpkt);
-#endif
+  avpkt->size = 0;
+  avpkt->data = NULL;
 
   if (ret < 0) {
     fprintf(stderr, "V4L2_CORE: (H264 decoder) error while decoding frame\n");
-    return ret;
+    return E_DECODE_ERR;
   }
 
-  if (got_frame) {
-#if LIBAVUTIL_VER_AT_LEAST(54, 6)
-    av_image_copy_to_buffer(
-        out_buf, h264_ctx->pic_size,
-        (const unsigned char *const *)h264_ctx->picture->data,
-        h264_ctx->picture->linesize, h264_ctx->context->pix_fmt,
-        h264_ctx->width, h264_ctx->height, 1);
-#else
-    avpicture_layout((AVPicture *)h264_ctx->picture, h264_ctx->context->pix_fmt,
-                     h264_ctx->width, h264_ctx->height, out_buf,
-                     h264_ctx->pic_size);
+  if (!got_frame)
+    return E_OK;
+
+#if LIBAVCODEC_VER_AT_LEAST(55, 28)
+  /*planes are handed as yu12 (full range yuv has the same layout)*/
+  if (picture->width != h264_ctx->width ||
+      picture->height != h264_ctx->height ||
+      (picture->format != AV_PIX_FMT_YUV420P &&
+       picture->format != AV_PIX_FMT_YUVJ420P)) {
+    fprintf(stderr,
+            "V4L2_CORE: (H264 decoder) unexpected picture (%ix%i fmt %i)\n",
+            picture->width, picture->height, picture->format);
+    return E_DECODE_ERR;
+  }
 #endif
-    return ret;
-  } else
+
+  int i = 0;
+  for (i = 0; i < 3; i++) {
+    frame->yuv_plane[i] = picture->data[i];
+    frame->yuv_stride[i] = picture->linesize[i];
+  }
+
+  return E_OK;
+}
+
+/*
+ * get the h264 decoder delay
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of frames held by the decoder (frame threads)
+ */
+int h264_get_decoder_delay() {
+  if (h264_ctx == NULL)
     return 0;
+
+  return h264_ctx->delay;
 }
 
 /*
@@ -1106,14 +1315,13 @@ void h264_close_decoder() {
   free(h264_ctx->context);
 #endif
 
-#if LIBAVCODEC_VER_AT_LEAST(55, 28)
-  av_frame_free(&h264_ctx->picture);
-#else
-#if LIBAVCODEC_VER_AT_LEAST(54, 28)
-  avcodec_free_frame(&h264_ctx->picture);
-#else
-  av_freep(&h264_ctx->picture);
-#endif
+  int i = 0;
+  for (i = 0; i < h264_ctx->num_pictures; i++)
+    free_decoder_picture(&h264_ctx->picture[i]);
+  free(h264_ctx->picture);
+
+#if LIBAVCODEC_VER_AT_LEAST(58, 129)
+  av_packet_free(&h264_ctx->packet);
 #endif
 
   free(h264_ctx);
@@ -471,6 +471,38 @@ uint32_t h264_get_frame_rate_config(v4l2_dev_t *vd);
  */
 int h264_set_frame_rate_config(v4l2_dev_t *vd, uint32_t framerate);
 
+/*
+ * query the encoder bit rate (layer 0)
+ * args:
+ *   vd - pointer to video device data
+ *   query - query type (UVC_GET_CUR; UVC_GET_MAX; UVC_GET_MIN; ...)
+ *   average - pointer to average bit rate (bits/sec)
+ *   peak - pointer to peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *   average is not null
+ *   peak is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int h264_query_bitrate(v4l2_dev_t *vd, uint8_t query, uint32_t *average,
+                       uint32_t *peak);
+
+/*
+ * set the encoder bit rate (layer 0)
+ * args:
+ *   vd - pointer to video device data
+ *   average - average bit rate (bits/sec)
+ *   peak - peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int h264_set_bitrate(v4l2_dev_t *vd, uint32_t average, uint32_t peak);
+
 /*
  * updates the h264_probe_commit_req field
  * args:
@@ -493,29 +525,50 @@ int h264_probe_config_probe_req(
  * args:
  *    width - image width
  *    height - image height
+ *    num_pictures - number of decoded pictures kept (frame queue size)
+ *    threads - number of decoder threads (0 - auto)
+ *    thread_type - V4L2_DEC_THREAD_SLICE and/or V4L2_DEC_THREAD_FRAME
  *
  * asserts:
- *    none
+ *    num_pictures > 0
  *
  * returns: error code (0 - E_OK)
  */
-int h264_init_decoder(int width, int height);
+int h264_init_decoder(int width, int height, int num_pictures, int threads,
+                      int thread_type);
 
 /*
- * decode h264 frame
+ * decode h264 frame: the decoded picture planes are handed to the frame
+ *   (yuv_plane/yuv_stride) with no copy, and stay valid until the frame
+ *   queue slot is decoded again; with frame threads the picture is the
+ *   one of an earlier frame (see h264_get_decoder_delay)
  * args:
- *    out_buf - pointer to decoded data
+ *    frame - pointer to frame buffer
+ *    slot - frame queue slot of the frame
  *    in_buf - pointer to h264 data
  *    size - in_buf size
  *
  * asserts:
  *    h264_ctx is not null
+ *    frame is not null
  *    in_buf is not null
- *    out_buf is not null
  *
- * returns: decoded data size
+ * returns: error code (E_OK, also if no picture is out yet)
+ */
+int h264_decode(v4l2_frame_buff_t *frame, int slot, uint8_t *in_buf,
+                int size);
+
+/*
+ * get the h264 decoder delay
+ * args:
+ *    none
+ *
+ * asserts:
+ *    none
+ *
+ * returns: number of frames held by the decoder (frame threads)
  */
-int h264_decode(uint8_t *out_buf, uint8_t *in_buf, int size);
+int h264_get_decoder_delay();
 
 /*
  * close h264 decoder context
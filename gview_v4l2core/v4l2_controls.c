@@ -144,7 +144,7 @@ static int query_ioctl(v4l2_dev_t *vd, int current_ctrl,
   do {
     if (ret)
       ctrl->id = current_ctrl | V4L2_CTRL_FLAG_NEXT_CTRL;
-    ret = v4l2_ioctl(vd->fd, VIDIOC_QUERYCTRL, ctrl);
+    ret = xioctl(vd->fd, VIDIOC_QUERYCTRL, ctrl);
   } while (ret && tries-- &&
            ((errno == EIO || errno == EPIPE || errno == ETIMEDOUT)));
 
@@ -296,18 +296,27 @@ static uint8_t get_logitech_peripheral_unit_id(v4l2_dev_t *vd) {
  * asserts:
  *  vd is not null
  *
- * return: none
+ * return: error code (E_OK)
  */
-void v4l2_subscribe_control_events(v4l2_dev_t *vd, unsigned int control_id) {
+int v4l2_subscribe_control_events(v4l2_dev_t *vd, unsigned int control_id) {
   vd->evsub.type = V4L2_EVENT_CTRL;
   vd->evsub.id = control_id;
+  /*
+   * also get events for our own changes: the driver may clamp the value
+   * and update other controls in the same cluster
+   */
+  vd->evsub.flags = V4L2_EVENT_SUB_FL_ALLOW_FEEDBACK;
 
   int ret = xioctl(vd->fd, VIDIOC_SUBSCRIBE_EVENT, &vd->evsub);
 
-  if (ret)
+  if (ret) {
     fprintf(stderr,
             "V4L2_CORE: failed to subscribe events for control 0x%08x: %s\n",
             control_id, strerror(errno));
+    return E_DEVICE_ERR;
+  }
+
+  return E_OK;
 }
 
 /*
@@ -332,103 +341,125 @@ void v4l2_unsubscribe_control_events(v4l2_dev_t *vd) {
 }
 
 /*
- * add control to control list
+ * query the menu entries of a menu control
  * args:
  *   vd - pointer to video device data
  *   queryctrl - pointer to v4l2_queryctrl data
- *   current - pointer to pointer of current control from control list
- *   first - pointer to pointer of first control from control list
+ *   menu - pointer to menu list pointer (set to NULL if not a menu control)
  *
  * asserts:
  *   vd is not null
  *   vd->fd is valid
  *   queryctrl is not null
+ *   menu is not null
  *
- * returns: pointer to newly added control
+ * returns: number of menu entries (the list has an extra end entry)
  */
-static v4l2_ctrl_t *add_control(v4l2_dev_t *vd,
-                                struct v4l2_queryctrl *queryctrl,
-                                v4l2_ctrl_t **current, v4l2_ctrl_t **first) {
+static int query_control_menu(v4l2_dev_t *vd, struct v4l2_queryctrl *queryctrl,
+                              struct v4l2_querymenu **menu) {
   /*assertions*/
   assert(vd != NULL);
   assert(vd->fd > 0);
   assert(queryctrl != NULL);
-  int menu_entries = 0;
-
-  v4l2_ctrl_t *control = NULL;
-  struct v4l2_querymenu *menu = NULL;     // menu list
-  struct v4l2_querymenu *old_menu = menu; // temp menu list pointer
-
-  if (queryctrl->flags & V4L2_CTRL_FLAG_DISABLED) {
-    printf(
-        "V4L2_CORE: Control 0x%08x is disabled: remove it from control list\n",
-        queryctrl->id);
-    return NULL;
-  }
-
-  // check menu items if needed
-  if (queryctrl->type == V4L2_CTRL_TYPE_MENU ||
-      queryctrl->type == V4L2_CTRL_TYPE_INTEGER_MENU) {
-    int i = 0;
-    struct v4l2_querymenu querymenu = {0};
+  assert(menu != NULL);
 
-    for (querymenu.index = queryctrl->minimum;
-         querymenu.index <= queryctrl->maximum; querymenu.index++) {
-      querymenu.id = queryctrl->id;
-      if (xioctl(vd->fd, VIDIOC_QUERYMENU, &querymenu) < 0)
-        continue;
+  *menu = NULL;
 
-      old_menu = menu;
+  if (queryctrl->type != V4L2_CTRL_TYPE_MENU &&
+      queryctrl->type != V4L2_CTRL_TYPE_INTEGER_MENU)
+    return 0;
 
-      if (!menu)
-        menu = calloc(i + 1, sizeof(struct v4l2_querymenu));
-      else
-        menu = realloc(menu, (i + 1) * sizeof(struct v4l2_querymenu));
-
-      if (menu == NULL) {
-        /*since we exit on failure there was no need to free any previous */
-        /* menu allocation (realloc), but silence cppcheck anyway */
-        if (old_menu)
-          free(old_menu);
-
-        fprintf(
-            stderr,
-            "V4L2_CORE: FATAL memory allocation failure (add_control): %s\n",
-            strerror(errno));
-        exit(-1);
-      }
+  struct v4l2_querymenu *list = NULL;     // menu list
+  struct v4l2_querymenu *old_list = list; // temp menu list pointer
+  struct v4l2_querymenu querymenu = {0};
+  int i = 0;
 
-      memcpy(&(menu[i]), &querymenu, sizeof(struct v4l2_querymenu));
-      i++;
-    }
+  for (querymenu.index = queryctrl->minimum;
+       (int64_t)querymenu.index <= queryctrl->maximum; querymenu.index++) {
+    querymenu.id = queryctrl->id;
+    if (xioctl(vd->fd, VIDIOC_QUERYMENU, &querymenu) < 0)
+      continue;
 
-    old_menu = menu;
+    old_list = list;
 
-    /*last entry (NULL name)*/
-    if (!menu)
-      menu = calloc(i + 1, sizeof(struct v4l2_querymenu));
+    if (!list)
+      list = calloc(i + 1, sizeof(struct v4l2_querymenu));
     else
-      menu = realloc(menu, (i + 1) * sizeof(struct v4l2_querymenu));
+      list = realloc(list, (i + 1) * sizeof(struct v4l2_querymenu));
 
-    if (menu == NULL) {
+    if (list == NULL) {
       /*since we exit on failure there was no need to free any previous */
       /* menu allocation (realloc), but silence cppcheck anyway */
-      if (old_menu)
-        free(old_menu);
+      if (old_list)
+        free(old_list);
 
-      fprintf(stderr,
-              "V4L2_CORE: FATAL memory allocation failure (add_control): %s\n",
-              strerror(errno));
+      fprintf(
+          stderr,
+          "V4L2_CORE: FATAL memory allocation failure (add_control): %s\n",
+          strerror(errno));
       exit(-1);
     }
 
-    menu[i].id = querymenu.id;
-    menu[i].index = queryctrl->maximum + 1;
-    if (queryctrl->type == V4L2_CTRL_TYPE_MENU)
-      menu[i].name[0] = 0;
-    menu_entries = i;
+    memcpy(&(list[i]), &querymenu, sizeof(struct v4l2_querymenu));
+    i++;
   }
 
+  old_list = list;
+
+  /*last entry (NULL name)*/
+  if (!list)
+    list = calloc(i + 1, sizeof(struct v4l2_querymenu));
+  else
+    list = realloc(list, (i + 1) * sizeof(struct v4l2_querymenu));
+
+  if (list == NULL) {
+    /*since we exit on failure there was no need to free any previous */
+    /* menu allocation (realloc), but silence cppcheck anyway */
+    if (old_list)
+      free(old_list);
+
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (add_control): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  memset(&(list[i]), 0, sizeof(struct v4l2_querymenu));
+  list[i].id = queryctrl->id;
+  list[i].index = queryctrl->maximum + 1;
+
+  *menu = list;
+  return i;
+}
+
+/*
+ * link a control (with an already queried menu) to the control list
+ * args:
+ *   vd - pointer to video device data
+ *   queryctrl - pointer to v4l2_queryctrl data
+ *   menu - menu list (NULL if not a menu) - owned by the control
+ *   menu_entries - number of menu entries
+ *   current - pointer to pointer of current control from control list
+ *   first - pointer to pointer of first control from control list
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid
+ *   queryctrl is not null
+ *
+ * returns: pointer to newly added control
+ */
+static v4l2_ctrl_t *link_control(v4l2_dev_t *vd,
+                                 struct v4l2_queryctrl *queryctrl,
+                                 struct v4l2_querymenu *menu, int menu_entries,
+                                 v4l2_ctrl_t **current, v4l2_ctrl_t **first) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(vd->fd > 0);
+  assert(queryctrl != NULL);
+
+  v4l2_ctrl_t *control = NULL;
+
   /*check for focus control to enable software autofocus*/
   if (queryctrl->id == V4L2_CID_FOCUS_LOGITECH ||
       queryctrl->id == V4L2_CID_FOCUS_ABSOLUTE)
@@ -492,12 +523,85 @@ static v4l2_ctrl_t *add_control(v4l2_dev_t *vd,
     *current = *first;
   }
 
-  // subscribe control events
-  v4l2_subscribe_control_events(vd, queryctrl->id);
+  // subscribe control events (the control value can be cached)
+  control->events =
+      (v4l2_subscribe_control_events(vd, queryctrl->id) == E_OK) ? 1 : 0;
 
   return control;
 }
 
+/*
+ * add control to control list
+ * args:
+ *   vd - pointer to video device data
+ *   queryctrl - pointer to v4l2_queryctrl data
+ *   current - pointer to pointer of current control from control list
+ *   first - pointer to pointer of first control from control list
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid
+ *   queryctrl is not null
+ *
+ * returns: pointer to newly added control
+ */
+static v4l2_ctrl_t *add_control(v4l2_dev_t *vd,
+                                struct v4l2_queryctrl *queryctrl,
+                                v4l2_ctrl_t **current, v4l2_ctrl_t **first) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(vd->fd > 0);
+  assert(queryctrl != NULL);
+
+  if (queryctrl->flags & V4L2_CTRL_FLAG_DISABLED) {
+    printf(
+        "V4L2_CORE: Control 0x%08x is disabled: remove it from control list\n",
+        queryctrl->id);
+    return NULL;
+  }
+
+  struct v4l2_querymenu *menu = NULL;
+  int menu_entries = query_control_menu(vd, queryctrl, &menu);
+
+  return link_control(vd, queryctrl, menu, menu_entries, current, first);
+}
+
+/*
+ * add a control from previously enumerated (cached) data
+ *   to the end of the control list
+ * args:
+ *   vd - pointer to video device data
+ *   queryctrl - pointer to v4l2_queryctrl data
+ *   menu - menu list with menu_entries + 1 entries (NULL if not a menu)
+ *          the control takes ownership of the list
+ *   menu_entries - number of menu entries
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *   queryctrl is not null
+ *
+ * returns: error code
+ */
+int restore_v4l2_control(v4l2_dev_t *vd, struct v4l2_queryctrl *queryctrl,
+                         struct v4l2_querymenu *menu, int menu_entries) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(vd->fd > 0);
+  assert(queryctrl != NULL);
+
+  v4l2_ctrl_t *current = vd->list_device_controls;
+  while (current != NULL && current->next != NULL)
+    current = current->next;
+
+  if (link_control(vd, queryctrl, menu, menu_entries, &current,
+                   &(vd->list_device_controls)) == NULL)
+    return E_NO_DATA;
+
+  vd->num_controls++;
+  return E_OK;
+}
+
 /*
  * enumerate device (read/write) controls
  * args:
@@ -762,6 +866,69 @@ static void update_ctrl_list_flags(v4l2_dev_t *vd) {
     update_ctrl_flags(vd, current->control.id);
 }
 
+/*
+ * dequeues the pending control events and updates the control list
+ *   (no device io: events are queued by the driver)
+ *   must run on the thread that owns the control list, the capture
+ *   loop only flags the events (ctrl_events_pending)
+ * args:
+ *  vd - pointer to video device data
+ *
+ * asserts:
+ *  vd is not null
+ *
+ * return: number of processed control events
+ */
+int process_control_events(v4l2_dev_t *vd) {
+  /*asserts*/
+  assert(vd != NULL);
+
+  int ret = 0;
+  struct v4l2_event ev;
+
+  /*clear before dequeuing: events queued from now on are flagged again*/
+  __atomic_store_n(&vd->ctrl_events_pending, 0, __ATOMIC_RELEASE);
+
+  while (xioctl(vd->fd, VIDIOC_DQEVENT, &ev) == 0) {
+    if (ev.type != V4L2_EVENT_CTRL)
+      continue;
+
+    ret++;
+    // update control
+    v4l2_ctrl_t *control = v4l2core_get_control_by_id(vd, ev.id);
+    if (control == NULL)
+      continue;
+
+    control->control.flags = ev.u.ctrl.flags;
+    if (control->control.flags & V4L2_CTRL_FLAG_DISABLED)
+      continue;
+
+    control->control.minimum = ev.u.ctrl.minimum;
+    control->control.maximum = ev.u.ctrl.maximum;
+    control->control.step = ev.u.ctrl.step;
+    control->control.default_value = ev.u.ctrl.default_value;
+
+    switch (control->control.type) {
+    case V4L2_CTRL_TYPE_INTEGER64:
+      control->value64 = ev.u.ctrl.value64;
+      break;
+    case V4L2_CTRL_TYPE_STRING:
+      /*the event has no string: get it on next read*/
+      if (ev.u.ctrl.changes & V4L2_EVENT_CTRL_CH_VALUE)
+        control->cached = 0;
+      break;
+    default:
+      control->value = ev.u.ctrl.value;
+    }
+  }
+
+  /*event flags drop the (auto control) grabbed flags: set them again*/
+  if (ret > 0)
+    update_ctrl_list_flags(vd);
+
+  return ret;
+}
+
 /*
  * Disables special auto-controls with higher IDs than
  * their absolute/relative counterparts
@@ -810,6 +977,7 @@ void get_v4l2_control_values(v4l2_dev_t *vd) {
 
   int ret = 0;
   struct v4l2_ext_control clist[vd->num_controls];
+  uint8_t clist_ok[vd->num_controls]; /*value retrieved*/
   v4l2_ctrl_t *current = vd->list_device_controls;
 
   int count = 0;
@@ -819,6 +987,8 @@ void get_v4l2_control_values(v4l2_dev_t *vd) {
     if (current->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY)
       continue;
 
+    clist_ok[count] = 1;
+
     clist[count].id = current->control.id;
     clist[count].size = 0;
     if (current->control.type == V4L2_CTRL_TYPE_STRING) {
@@ -853,8 +1023,10 @@ void get_v4l2_control_values(v4l2_dev_t *vd) {
             ctrl.id = clist[i].id;
             ctrl.value = 0;
             ret = xioctl(vd->fd, VIDIOC_G_CTRL, &ctrl);
-            if (ret)
+            if (ret) {
+              clist_ok[i] = 0;
               continue;
+            }
             clist[i].value = ctrl.value;
           }
         } else {
@@ -866,11 +1038,13 @@ void get_v4l2_control_values(v4l2_dev_t *vd) {
             ctrls.count = 1;
             ctrls.controls = &clist[i];
             ret = xioctl(vd->fd, VIDIOC_G_EXT_CTRLS, &ctrls);
-            if (ret)
+            if (ret) {
+              clist_ok[i] = 0;
               fprintf(
                   stderr,
                   "V4L2_CORE: control id: 0x%08x failed to get (error %i)\n",
                   clist[i].id, ret);
+            }
           }
         }
       }
@@ -883,6 +1057,9 @@ void get_v4l2_control_values(v4l2_dev_t *vd) {
                   clist[i].id);
           continue;
         }
+        /*from now on control events keep the value coherent*/
+        ctrl->cached = (clist_ok[i] && ctrl->events) ? 1 : 0;
+
         switch (ctrl->control.type) {
 
         case V4L2_CTRL_TYPE_STRING: {
@@ -978,6 +1155,14 @@ int get_control_value_by_id(v4l2_dev_t *vd, int id) {
   if (control->control.flags & V4L2_CTRL_FLAG_WRITE_ONLY)
     return (-1);
 
+  /*cached value: apply the pending change events (no device io)*/
+  if (control->events)
+    process_control_events(vd);
+  if (control->cached) {
+    update_ctrl_flags(vd, id);
+    return (0);
+  }
+
   if (control->cclass == V4L2_CTRL_CLASS_USER &&
       control->control.type != V4L2_CTRL_TYPE_STRING &&
       control->control.type != V4L2_CTRL_TYPE_INTEGER64) {
@@ -989,8 +1174,10 @@ int get_control_value_by_id(v4l2_dev_t *vd, int id) {
       fprintf(stderr,
               "V4L2_CORE: control id: 0x%08x failed to get value (error %i)\n",
               ctrl.id, ret);
-    else
+    else {
       control->value = ctrl.value;
+      control->cached = control->events;
+    }
   } else {
     struct v4l2_ext_controls ctrls = {0};
     struct v4l2_ext_control ctrl = {0};
@@ -1015,6 +1202,7 @@ int get_control_value_by_id(v4l2_dev_t *vd, int id) {
       printf("control id: 0x%08x failed to get value (error %i)\n", ctrl.id,
              ret);
     else {
+      control->cached = control->events;
       switch (control->control.type) {
       case V4L2_CTRL_TYPE_STRING: {
         strncpy(control->string, ctrl.string, ctrl.size);
@@ -1283,6 +1471,8 @@ int set_control_value_by_id(v4l2_dev_t *vd, int id) {
     ctrl.id = control->control.id;
     ctrl.value = control->value;
     ret = xioctl(vd->fd, VIDIOC_S_CTRL, &ctrl);
+    if (!ret)
+      control->value = ctrl.value; /*the value set by the driver*/
   } else {
     // using VIDIOC_G_EXT_CTRLS on single controls
     struct v4l2_ext_controls ctrls = {0};
@@ -1334,7 +1524,12 @@ int set_control_value_by_id(v4l2_dev_t *vd, int id) {
     }
   }
 
-  // update real value
+  /*
+   * update real value
+   * (if set failed control->value is stale: query the device)
+   */
+  if (ret)
+    control->cached = 0;
   get_control_value_by_id(vd, id);
 
   return (ret);
@@ -39,6 +39,26 @@
  */
 int enumerate_v4l2_control(v4l2_dev_t *vd);
 
+/*
+ * add a control from previously enumerated (cached) data
+ *   to the end of the control list
+ * args:
+ *   vd - pointer to video device data
+ *   queryctrl - pointer to v4l2_queryctrl data
+ *   menu - menu list with menu_entries + 1 entries (NULL if not a menu)
+ *          the control takes ownership of the list
+ *   menu_entries - number of menu entries
+ *
+ * asserts:
+ *   vd is not null
+ *   vd->fd is valid ( > 0 )
+ *   queryctrl is not null
+ *
+ * returns: error code
+ */
+int restore_v4l2_control(v4l2_dev_t *vd, struct v4l2_queryctrl *queryctrl,
+                         struct v4l2_querymenu *menu, int menu_entries);
+
 /*
  * subscribe for v4l2 control events
  * args:
@@ -48,9 +68,9 @@ int enumerate_v4l2_control(v4l2_dev_t *vd);
  * asserts:
  *  vd is not null
  *
- * return: none
+ * return: error code (E_OK)
  */
-void v4l2_subscribe_control_events(v4l2_dev_t *vd, unsigned int control_id);
+int v4l2_subscribe_control_events(v4l2_dev_t *vd, unsigned int control_id);
 
 /*
  * unsubscribev4l2 control events
@@ -64,6 +84,21 @@ void v4l2_subscribe_control_events(v4l2_dev_t *vd, unsigned int control_id);
  */
 void v4l2_unsubscribe_control_events(v4l2_dev_t *vd);
 
+/*
+ * dequeues the pending control events and updates the control list
+ *   (no device io: events are queued by the driver)
+ *   must run on the thread that owns the control list, the capture
+ *   loop only flags the events (ctrl_events_pending)
+ * args:
+ *  vd - pointer to video device data
+ *
+ * asserts:
+ *  vd is not null
+ *
+ * return: number of processed control events
+ */
+int process_control_events(v4l2_dev_t *vd);
+
 /*
  * return the control associated to id from device list
  * args:
@@ -79,7 +114,7 @@ v4l2_ctrl_t *get_control_by_id(v4l2_dev_t *vd, int id);
 
 /*
  * updates the value for control id from the device
- * also updates control flags
+ * also updates control flags (cached values don't query the device)
  * args:
  *   vd - pointer to video device data
  *   id - control id
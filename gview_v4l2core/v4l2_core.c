@@ -47,6 +47,10 @@
 // #include "v4l2_core.h"
 #include "control_profile.h"
 #include "core_time.h"
+#include "decode_pool.h"
+#include "device_cache.h"
+#include "dmabuf.h"
+#include "frame_convert.h"
 #include "frame_decoder.h"
 #include "save_image.h"
 #include "soft_autofocus.h"
@@ -54,6 +58,7 @@
 #include "v4l2_controls.h"
 #include "v4l2_devices.h"
 #include "v4l2_formats.h"
+#include "virtual_device.h"
 // #include "../config.h"
 
 #ifndef GETTEXT_PACKAGE_V4L2CORE
@@ -70,11 +75,6 @@ static int my_pixelformat = 0;
 static int my_width = 0;
 static int my_height = 0;
 
-static uint64_t fps_ref_ts = 0;
-static uint32_t fps_frame_count = 0;
-
-static uint8_t flag_fps_change = 0; /*set to 1 to request a fps change*/
-
 static uint8_t disable_libv4l2 = 0; /*set to 1 to disable libv4l2 calls*/
 
 static int frame_queue_size =
@@ -95,8 +95,12 @@ static int frame_queue_size =
 int xioctl(int fd, int IOCTL_X, void *arg) {
   int ret = 0;
   int tries = IOCTL_RETRY;
+  /*virtual (replay) devices emulate the ioctls*/
+  int is_virtual = vdev_is_virtual(fd);
   do {
-    if (!disable_libv4l2)
+    if (is_virtual)
+      ret = vdev_ioctl(fd, IOCTL_X, arg);
+    else if (!disable_libv4l2)
       ret = v4l2_ioctl(fd, IOCTL_X, arg);
     else
       ret = ioctl(fd, IOCTL_X, arg);
@@ -196,19 +200,27 @@ static int check_v4l2_dev(v4l2_dev_t *vd) {
     printf("V4L2_CORE: Init. %s (location: %s)\n", vd->cap.card,
            vd->cap.bus_info);
 
-  /*enumerate frame formats supported by device*/
-  int ret = enum_frame_formats(vd);
-  if (ret != E_OK) {
-    fprintf(stderr, "V4L2_CORE: no valid frame formats (with valid sizes) "
-                    "found for device\n");
-    return ret;
+  /*restore frame formats and controls from the capabilities cache*/
+  uint8_t cached = (load_device_cache(vd) == E_OK) ? 1 : 0;
+
+  if (!cached) {
+    /*enumerate frame formats supported by device*/
+    int ret = enum_frame_formats(vd);
+    if (ret != E_OK) {
+      fprintf(stderr, "V4L2_CORE: no valid frame formats (with valid sizes) "
+                      "found for device\n");
+      return ret;
+    }
+
+    /*enumerate device controls*/
+    enumerate_v4l2_control(vd);
+
+    save_device_cache(vd);
   }
 
   /*add h264 (uvc muxed) to format list if supported by device*/
   add_h264_format(vd);
 
-  /*enumerate device controls*/
-  enumerate_v4l2_control(vd);
   /*gets the current control values and sets their flags*/
   get_v4l2_control_values(vd);
 
@@ -218,9 +230,70 @@ static int check_v4l2_dev(v4l2_dev_t *vd) {
       vd->has_focus_control_id = 0;
   }
 
+  /*check the cached capabilities against the device (in background)*/
+  if (cached)
+    verify_device_cache(vd);
+
   return E_OK;
 }
 
+/*
+ * gets the v4l2 memory type for the current capture method
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: v4l2 memory type (V4L2_MEMORY_MMAP, _DMABUF or _USERPTR)
+ */
+static int get_v4l2_memory(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  switch (vd->cap_meth) {
+  case IO_DMABUF:
+    return V4L2_MEMORY_DMABUF;
+  case IO_USERPTR:
+    return V4L2_MEMORY_USERPTR;
+  default:
+    return V4L2_MEMORY_MMAP;
+  }
+}
+
+/*
+ * sets up a v4l2 buffer struct for queueing buffer index
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   buf - pointer to v4l2 buffer struct
+ *   index - buffer index
+ *
+ * asserts:
+ *   vd is not null
+ *   buf is not null
+ *
+ * returns: none
+ */
+static void prepare_v4l2_buffer(v4l2_dev_t *vd, struct v4l2_buffer *buf,
+                                int index) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(buf != NULL);
+
+  memset(buf, 0, sizeof(struct v4l2_buffer));
+  buf->index = index;
+  buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf->memory = get_v4l2_memory(vd);
+
+  if (vd->cap_meth == IO_DMABUF) {
+    buf->m.fd = vd->dmabuf_fd[index];
+    buf->length = vd->buff_length[index];
+  } else if (vd->cap_meth == IO_USERPTR) {
+    buf->m.userptr = (unsigned long)vd->mem[index];
+    buf->length = vd->buff_length[index];
+  }
+}
+
 /*
  * unmaps v4l2 buffers
  * args:
@@ -245,14 +318,26 @@ static int unmap_buff(v4l2_dev_t *vd) {
     break;
 
   case IO_MMAP:
-    for (i = 0; i < NB_BUFFER; i++) {
-      // unmap old buffer
-      if ((vd->mem[i] != MAP_FAILED) && vd->buff_length[i])
+    for (i = 0; i < vd->nb_buffers; i++) {
+      // unmap old buffer (virtual device buffers are owned by the device)
+      if ((vd->mem[i] != MAP_FAILED) && vd->buff_length[i] &&
+          !vd->is_virtual)
         if ((ret = v4l2_munmap(vd->mem[i], vd->buff_length[i])) < 0) {
           fprintf(stderr, "V4L2_CORE: couldn't unmap buff: %s\n",
                   strerror(errno));
         }
     }
+    /*drop the exported dmabufs (if any)*/
+    close_dmabuf_buffers(vd);
+    break;
+
+  case IO_DMABUF:
+    unmap_dmabuf_buffers(vd);
+    break;
+
+  case IO_USERPTR:
+    /*buffers are freed with the frame arena*/
+    break;
   }
   return ret;
 }
@@ -276,10 +361,13 @@ static int map_buff(v4l2_dev_t *vd) {
 
   int i = 0;
   // map new buffer
-  for (i = 0; i < NB_BUFFER; i++) {
-    vd->mem[i] = v4l2_mmap(NULL, // start anywhere
-                           vd->buff_length[i], PROT_READ | PROT_WRITE,
-                           MAP_SHARED, vd->fd, vd->buff_offset[i]);
+  for (i = 0; i < vd->nb_buffers; i++) {
+    if (vd->is_virtual)
+      vd->mem[i] = vdev_mmap(vd->fd, vd->buff_length[i], vd->buff_offset[i]);
+    else
+      vd->mem[i] = v4l2_mmap(NULL, // start anywhere
+                             vd->buff_length[i], PROT_READ | PROT_WRITE,
+                             MAP_SHARED, vd->fd, vd->buff_offset[i]);
     if (vd->mem[i] == MAP_FAILED) {
       fprintf(stderr, "V4L2_CORE: Unable to map buffer: %s\n", strerror(errno));
       return E_MMAP_ERR;
@@ -292,6 +380,51 @@ static int map_buff(v4l2_dev_t *vd) {
   return (E_OK);
 }
 
+/*
+ * allocs the frame arena and the userptr capture buffers
+ *   the arena also holds the decode buffers of the frame queue
+ *   (allocated next by alloc_v4l2_frames)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code  (0- E_OK)
+ */
+static int alloc_userptr_buff(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  /*drop the previous frame buffers and arena*/
+  clean_v4l2_frames(vd);
+  frame_arena_clean(&vd->frame_arena);
+
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t raw_size = vd->format.fmt.pix.sizeimage;
+  if (raw_size == 0) /*worst case (rgb)*/
+    raw_size = vd->format.fmt.pix.width * vd->format.fmt.pix.height * 3;
+  raw_size = (raw_size + page_size - 1) & ~(page_size - 1);
+
+  size_t arena_size = vd->nb_buffers * raw_size + page_size +
+                      vd->frame_queue_size * get_v4l2_frame_buffers_size(vd);
+
+  if (frame_arena_init(&vd->frame_arena, arena_size) != E_OK)
+    return E_ALLOC_ERR;
+
+  int i = 0;
+  for (i = 0; i < vd->nb_buffers; i++) {
+    vd->mem[i] = frame_arena_alloc(&vd->frame_arena, raw_size, page_size);
+    if (vd->mem[i] == NULL) {
+      frame_arena_clean(&vd->frame_arena);
+      return E_ALLOC_ERR;
+    }
+    vd->buff_length[i] = raw_size;
+  }
+
+  return E_OK;
+}
+
 /*
  * Query and map buffers
  * args:
@@ -317,7 +450,7 @@ static int query_buff(v4l2_dev_t *vd) {
     break;
 
   case IO_MMAP:
-    for (i = 0; i < NB_BUFFER; i++) {
+    for (i = 0; i < vd->nb_buffers; i++) {
       memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
       vd->buf.index = i;
       vd->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -348,6 +481,31 @@ static int query_buff(v4l2_dev_t *vd) {
     // map the new buffers
     if (map_buff(vd) != 0)
       ret = E_MMAP_ERR;
+    else if (vd->dmabuf_export && export_dmabuf_buffers(vd) != E_OK)
+      ret = E_DMABUF_ERR;
+    break;
+
+  case IO_DMABUF:
+    /*imported buffers: the size was set by v4l2core_set_dmabuf_import*/
+    for (i = 0; i < vd->nb_buffers; i++) {
+      if (vd->buff_length[i] < vd->format.fmt.pix.sizeimage) {
+        fprintf(stderr,
+                "V4L2_CORE: dmabuf[%i] is too small (%u < %u bytes)\n", i,
+                vd->buff_length[i], vd->format.fmt.pix.sizeimage);
+        return E_DMABUF_ERR;
+      }
+    }
+    // map the imported buffers for cpu access
+    if (map_dmabuf_buffers(vd) != 0)
+      ret = E_MMAP_ERR;
+    memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
+    vd->buf.length = vd->buff_length[0];
+    break;
+
+  case IO_USERPTR:
+    /*buffers were allocated in the frame arena (alloc_userptr_buff)*/
+    memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
+    vd->buf.length = vd->buff_length[0];
     break;
   }
   for (i = 0; i < vd->frame_queue_size; ++i)
@@ -381,16 +539,14 @@ static int queue_buff(v4l2_dev_t *vd) {
     break;
 
   case IO_MMAP:
+  case IO_DMABUF:
   default:
-    for (i = 0; i < NB_BUFFER; ++i) {
-      memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
-      vd->buf.index = i;
-      vd->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (i = 0; i < vd->nb_buffers; ++i) {
+      prepare_v4l2_buffer(vd, &vd->buf, i);
       // vd->buf.flags = V4L2_BUF_FLAG_TIMECODE;
       // vd->buf.timecode = vd->timecode;
       // vd->buf.timestamp.tv_sec = 0;
       // vd->buf.timestamp.tv_usec = 0;
-      vd->buf.memory = V4L2_MEMORY_MMAP;
       ret = xioctl(vd->fd, VIDIOC_QBUF, &vd->buf);
       if (ret < 0) {
         fprintf(stderr, "V4L2_CORE: (VIDIOC_QBUF) Unable to queue buffer: %s\n",
@@ -485,6 +641,8 @@ static int set_v4l2_framerate(v4l2_dev_t *vd) {
     break;
 
   case IO_MMAP:
+  case IO_DMABUF:
+  case IO_USERPTR:
     if (stream_status == STRM_OK) {
       /*unmap the buffers*/
       unmap_buff(vd);
@@ -521,7 +679,8 @@ static int set_v4l2_framerate(v4l2_dev_t *vd) {
 }
 
 /*
- * checks if frame data is available
+ * adds the requested buffers while streaming (VIDIOC_CREATE_BUFS)
+ *   on failure the request is kept for the next stream format set
  * args:
  *   vd - pointer to v4l2 device handler
  *
@@ -530,13 +689,101 @@ static int set_v4l2_framerate(v4l2_dev_t *vd) {
  *
  * returns: error code  (0- E_OK)
  */
-static int check_frame_available(v4l2_dev_t *vd) {
-  /*asserts*/
+static int create_v4l2_buffers(v4l2_dev_t *vd) {
+  /*assertions*/
   assert(vd != NULL);
 
   int ret = E_OK;
-  fd_set rdset;
-  struct timeval timeout;
+
+  /*lock the mutex*/
+  __LOCK_MUTEX(__PMUTEX);
+
+  struct v4l2_create_buffers create;
+  memset(&create, 0, sizeof(struct v4l2_create_buffers));
+  create.count = vd->req_nb_buffers - vd->nb_buffers;
+  create.memory = V4L2_MEMORY_MMAP;
+  create.format = vd->format;
+
+  if (xioctl(vd->fd, VIDIOC_CREATE_BUFS, &create) < 0 || create.count == 0 ||
+      (int)create.index != vd->nb_buffers) {
+    if (verbosity > 0)
+      printf("V4L2_CORE: (VIDIOC_CREATE_BUFS) can't add buffers while "
+             "streaming: growing on next format set\n");
+    vd->create_bufs_err = 1;
+    /*unlock the mutex*/
+    __UNLOCK_MUTEX(__PMUTEX);
+    return E_REQBUFS_ERR;
+  }
+
+  int i = 0;
+  for (i = create.index;
+       i < (int)(create.index + create.count) && i < V4L2_MAX_BUFFERS; i++) {
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(struct v4l2_buffer));
+    buf.index = i;
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (xioctl(vd->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+      fprintf(stderr,
+              "V4L2_CORE: (VIDIOC_QUERYBUF) Unable to query buffer[%i]: %s\n",
+              i, strerror(errno));
+      ret = E_QUERYBUF_ERR;
+      break;
+    }
+
+    vd->buff_length[i] = buf.length;
+    vd->buff_offset[i] = buf.m.offset;
+    vd->mem[i] = v4l2_mmap(NULL, buf.length, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, vd->fd, buf.m.offset);
+    if (vd->mem[i] == MAP_FAILED) {
+      fprintf(stderr, "V4L2_CORE: Unable to map buffer: %s\n",
+              strerror(errno));
+      ret = E_MMAP_ERR;
+      break;
+    }
+
+    if (xioctl(vd->fd, VIDIOC_QBUF, &buf) < 0) {
+      fprintf(stderr, "V4L2_CORE: (VIDIOC_QBUF) Unable to queue buffer: %s\n",
+              strerror(errno));
+      v4l2_munmap(vd->mem[i], vd->buff_length[i]);
+      vd->mem[i] = MAP_FAILED;
+      ret = E_QBUF_ERR;
+      break;
+    }
+
+    vd->nb_buffers = i + 1;
+  }
+
+  if (ret != E_OK)
+    vd->create_bufs_err = 1;
+  else
+    vd->req_nb_buffers = vd->nb_buffers;
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: (autotune) streaming with %i driver buffers\n",
+           vd->nb_buffers);
+
+  /*unlock the mutex*/
+  __UNLOCK_MUTEX(__PMUTEX);
+
+  return ret;
+}
+
+/*
+ * checks the stream state and applies pending stream requests
+ *   (fps change, buffer growth) before dequeuing a frame
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code  (0- E_OK)
+ */
+int check_stream_state(v4l2_dev_t *vd) {
+  /*asserts*/
+  assert(vd != NULL);
 
   /*lock the mutex*/
   __LOCK_MUTEX(__PMUTEX);
@@ -555,35 +802,74 @@ static int check_frame_available(v4l2_dev_t *vd) {
   }
 
   /*a fps change was requested while streaming*/
-  if (flag_fps_change > 0) {
+  if (vd->fps_change_req > 0) {
     if (verbosity > 2)
       printf("V4L2_CORE: fps change request detected\n");
     set_v4l2_framerate(vd);
-    flag_fps_change = 0;
+    vd->fps_change_req = 0;
   }
 
-  FD_ZERO(&rdset);
-  FD_SET(vd->fd, &rdset);
-  timeout.tv_sec = 1; /* 1 sec timeout*/
-  timeout.tv_usec = 0;
-  /* select - wait for data or timeout*/
-  ret = select(vd->fd + 1, &rdset, NULL, NULL, &timeout);
-  if (ret < 0) {
-    fprintf(stderr, "V4L2_CORE: Could not grab image (select error): %s\n",
-            strerror(errno));
-    return E_SELECT_ERR;
-  }
+  /*buffer autotuning: add driver buffers without restarting the stream*/
+  if (vd->req_nb_buffers > vd->nb_buffers && vd->cap_meth == IO_MMAP &&
+      !vd->dmabuf_export && !vd->is_virtual && !vd->create_bufs_err)
+    create_v4l2_buffers(vd);
 
-  if (ret == 0) {
-    fprintf(stderr, "V4L2_CORE: Could not grab image (select timeout): %s\n",
-            strerror(errno));
-    return E_SELECT_TIMEOUT_ERR;
-  }
+  return E_OK;
+}
 
-  if ((ret > 0) && (FD_ISSET(vd->fd, &rdset)))
-    return E_OK;
+/*
+ * checks if frame data is available
+ *   control events flagged while waiting are only marked as pending:
+ *   the control list belongs to the thread that sets the controls,
+ *   so they are dequeued there (process_control_events)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code  (0- E_OK)
+ */
+static int check_frame_available(v4l2_dev_t *vd) {
+  /*asserts*/
+  assert(vd != NULL);
+
+  int ret = E_OK;
+  fd_set rdset;
+  fd_set exset;
+  struct timeval timeout;
 
-  return E_UNKNOWN_ERR;
+  do {
+    FD_ZERO(&rdset);
+    FD_SET(vd->fd, &rdset);
+    /*control change events are flagged as exceptions*/
+    FD_ZERO(&exset);
+    if (!__atomic_load_n(&vd->ctrl_events_pending, __ATOMIC_ACQUIRE))
+      FD_SET(vd->fd, &exset);
+    timeout.tv_sec = 1; /* 1 sec timeout*/
+    timeout.tv_usec = 0;
+    /* select - wait for data or timeout*/
+    ret = select(vd->fd + 1, &rdset, NULL, &exset, &timeout);
+    if (ret < 0) {
+      fprintf(stderr, "V4L2_CORE: Could not grab image (select error): %s\n",
+              strerror(errno));
+      return E_SELECT_ERR;
+    }
+
+    if (ret == 0) {
+      fprintf(stderr,
+              "V4L2_CORE: Could not grab image (select timeout): %s\n",
+              strerror(errno));
+      return E_SELECT_TIMEOUT_ERR;
+    }
+
+    /*the cached values are updated on the next control read*/
+    if (FD_ISSET(vd->fd, &exset))
+      __atomic_store_n(&vd->ctrl_events_pending, 1, __ATOMIC_RELEASE);
+
+  } while (!FD_ISSET(vd->fd, &rdset));
+
+  return E_OK;
 }
 
 /*
@@ -638,7 +924,8 @@ void v4l2core_enable_libv4l2() { disable_libv4l2 = 0; }
  * set v4l2 capture method to use
  * args:
  *   vd - pointer to v4l2 device handler
- *   method - capture method (IO_READ or IO_MMAP)
+ *   method - capture method (IO_READ, IO_MMAP or IO_USERPTR;
+ *            IO_DMABUF is set by v4l2core_set_dmabuf_import)
  *
  * asserts:
  *   vd is not null
@@ -868,18 +1155,21 @@ uint8_t v4l2core_get_isbayer(v4l2_dev_t *vd) {
 
 /*
  * gets current device index
+ *   (resolved by device path: the device list may have been swapped)
  * args:
  *   vd - pointer to v4l2 device handler
  *
  * asserts:
  *   vd is not null
  *
- * returns - device index
+ * returns - device index (-1 if the device is not in the list)
  */
 int v4l2core_get_this_device_index(v4l2_dev_t *vd) {
   /*assertions*/
   assert(vd != NULL);
 
+  vd->this_device = v4l2core_get_device_index(vd->videodevice);
+
   return vd->this_device;
 }
 
@@ -923,6 +1213,8 @@ int v4l2core_start_stream(v4l2_dev_t *vd) {
   }
 
   vd->streaming = STRM_OK;
+  vd->last_sequence = -1; /*sequence restarts with the stream*/
+  ts_filter_reset(&vd->ts_filter);
 
   if (verbosity > 2)
     printf("V4L2_CORE: (VIDIOC_STREAMON) stream_status = STRM_OK\n");
@@ -996,20 +1288,79 @@ int v4l2core_stop_stream(v4l2_dev_t *vd) {
 }
 
 /*
- * get next ready flaged frame from queue
+ * checks if the dequeued buffer waited in the driver queue
+ *   for longer than a frame period (the consumer is late)
  * args:
- *    vd - pointer to v4l2 device handler
+ *   vd - pointer to v4l2 device handler
  *
- * returns: index of frame queue or -1 if none
+ * asserts:
+ *   vd is not null
+ *
+ * returns: 1 if the consumer is late, 0 otherwise
  */
-static int get_next_ready_frame(v4l2_dev_t *vd) {
-  int i = 0;
-  for (i = 0; i < vd->frame_queue_size; ++i) {
-    if (vd->frame_queue[i].status == FRAME_READY)
-      return (i);
+static int consumer_is_late(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (!vd->is_virtual &&
+      (vd->buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+          V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    uint64_t frame_ns = (uint64_t)vd->fps_num * NSEC_PER_SEC /
+                        (vd->fps_denom > 0 ? vd->fps_denom : 25);
+    uint64_t buf_ts = (uint64_t)vd->buf.timestamp.tv_sec * NSEC_PER_SEC +
+                      (uint64_t)vd->buf.timestamp.tv_usec * 1000;
+    uint64_t now = ns_time_monotonic();
+
+    return (now > buf_ts && now - buf_ts > frame_ns);
+  }
+
+  /*no usable driver timestamp: the consumer holds all other buffers*/
+  return ((int)atomic_load(&vd->frame_slots.depth) >= vd->nb_buffers - 1);
+}
+
+/*
+ * requests more driver buffers (and frame queue slots)
+ *   applied while streaming if the driver supports VIDIOC_CREATE_BUFS
+ *   or else on the next stream format set
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   grow_queue - if set also grow the frame queue
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+static void request_buffer_growth(v4l2_dev_t *vd, int grow_queue) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (!vd->buffer_autotune || vd->cap_meth == IO_READ ||
+      vd->cap_meth == IO_DMABUF)
+    return;
+
+  if (grow_queue && vd->decode_pool == NULL &&
+      vd->req_frame_queue_size == vd->frame_queue_size &&
+      vd->frame_queue_size < V4L2_MAX_BUFFERS) {
+    vd->req_frame_queue_size = vd->frame_queue_size + 1;
+    if (verbosity > 0)
+      printf("V4L2_CORE: (autotune) frame queue will grow to %i frames\n",
+             vd->req_frame_queue_size);
   }
 
-  return -1;
+  /*one step at a time: wait for the pending request*/
+  if (vd->req_nb_buffers > vd->nb_buffers)
+    return;
+
+  /*keep at least two buffers with the driver*/
+  int nb_buffers = MAX(vd->nb_buffers + 2, vd->req_frame_queue_size + 2);
+  nb_buffers = MIN(nb_buffers, V4L2_MAX_BUFFERS);
+  if (nb_buffers > vd->nb_buffers) {
+    vd->req_nb_buffers = nb_buffers;
+    if (verbosity > 0)
+      printf("V4L2_CORE: (autotune) requesting %i driver buffers\n",
+             vd->req_nb_buffers);
+  }
 }
 
 /*
@@ -1021,32 +1372,55 @@ static int get_next_ready_frame(v4l2_dev_t *vd) {
  */
 static int process_input_buffer(v4l2_dev_t *vd) {
   /*get next available frame in queue*/
-  int qind = get_next_ready_frame(vd);
+  int qind = frame_slots_acquire(&vd->frame_slots);
 
   if (verbosity > 2)
     printf("V4L2_CORE: process frame queue index %i\n", qind);
 
-  if (qind < 0 || qind >= vd->frame_queue_size) {
+  if (qind < 0) {
     if (verbosity > 2)
       fprintf(stderr,
-              "V4L2_CORE: frame queue index %i is invalid (no free frames in "
-              "queue?)\n",
-              qind);
+              "V4L2_CORE: no free frames in queue (all %i in use)\n",
+              vd->frame_queue_size);
+    request_buffer_growth(vd, 1);
     return -1;
   }
 
   vd->frame_queue[qind].status = FRAME_DECODING;
 
   /*
-   * driver timestamp is unreliable
-   * use monotonic system time
+   * driver timestamp (if monotonic) corrected for clock skew or
+   * the (filtered) dequeue time, see v4l2core_set_timestamp_mode
+   * (virtual devices: the replayed monotonic based timestamp)
    */
-  vd->frame_queue[qind].timestamp = ns_time_monotonic();
+  if (vd->is_virtual && vd->cap_meth != IO_READ)
+    vd->frame_queue[qind].timestamp =
+        (uint64_t)vd->buf.timestamp.tv_sec * NSEC_PER_SEC +
+        (uint64_t)vd->buf.timestamp.tv_usec * 1000;
+  else if (vd->cap_meth == IO_READ)
+    vd->frame_queue[qind].timestamp = ns_time_monotonic();
+  else
+    vd->frame_queue[qind].timestamp =
+        ts_filter_apply(&vd->ts_filter, &vd->buf, ns_time_monotonic());
 
   vd->frame_queue[qind].index = vd->buf.index;
 
   vd->frame_index++;
 
+  /*frames lost by the driver show up as gaps in the buffer sequence*/
+  if (vd->cap_meth != IO_READ) {
+    if (vd->last_sequence >= 0 && vd->buf.sequence > vd->last_sequence + 1) {
+      uint32_t lost = vd->buf.sequence - (uint32_t)vd->last_sequence - 1;
+      vd->sequence_gaps += lost;
+      if (verbosity > 1)
+        fprintf(stderr, "V4L2_CORE: driver dropped %u frame(s)\n", lost);
+      /*drops caused by a late consumer: add buffers*/
+      if (consumer_is_late(vd))
+        request_buffer_growth(vd, 0);
+    }
+    vd->last_sequence = vd->buf.sequence;
+  }
+
   vd->frame_queue[qind].raw_frame_size = vd->buf.bytesused;
   if (vd->frame_queue[qind].raw_frame_size == 0) {
     if (verbosity > 1)
@@ -1055,18 +1429,22 @@ static int process_input_buffer(v4l2_dev_t *vd) {
 
   /*point vd->raw_frame to current frame buffer*/
   vd->frame_queue[qind].raw_frame = vd->mem[vd->buf.index];
+  vd->frame_queue[qind].raw_pixelformat = get_raw_conv_format(vd);
+  vd->frame_queue[qind].yuv_ready = 0;
+  vd->frame_queue[qind].yuv_plane[0] = NULL;
 
   /*determine real fps every 3 sec aprox.*/
-  fps_frame_count++;
+  vd->fps_frame_count++;
 
-  if (vd->frame_queue[qind].timestamp - fps_ref_ts >= (3 * NSEC_PER_SEC)) {
+  if (vd->frame_queue[qind].timestamp - vd->fps_ref_ts >= (3 * NSEC_PER_SEC)) {
     if (verbosity > 2)
       printf("V4L2CORE: (fps) ref:%" PRId64 " ts:%" PRId64 " frames:%i\n",
-             fps_ref_ts, vd->frame_queue[qind].timestamp, fps_frame_count);
-    vd->real_fps = (double)(fps_frame_count * NSEC_PER_SEC) /
-                   (double)(vd->frame_queue[qind].timestamp - fps_ref_ts);
-    fps_frame_count = 0;
-    fps_ref_ts = vd->frame_queue[qind].timestamp;
+             vd->fps_ref_ts, vd->frame_queue[qind].timestamp,
+             vd->fps_frame_count);
+    vd->real_fps = (double)(vd->fps_frame_count * NSEC_PER_SEC) /
+                   (double)(vd->frame_queue[qind].timestamp - vd->fps_ref_ts);
+    vd->fps_frame_count = 0;
+    vd->fps_ref_ts = vd->frame_queue[qind].timestamp;
   }
 
   return qind;
@@ -1086,19 +1464,51 @@ v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd) {
   /*asserts*/
   assert(vd != NULL);
 
-  /*for H264 streams request a IDR frame with SPS and PPS data if it's the first
-   * frame*/
-  if (vd->requested_fmt == V4L2_PIX_FMT_H264 && vd->frame_index < 1)
+  if (check_stream_state(vd) != E_OK)
+    return NULL;
+
+  uint64_t wait_start = ns_time_monotonic();
+
+  if (check_frame_available(vd) != E_OK)
+    return NULL;
+
+  v4l2_frame_buff_t *frame = dequeue_v4l2_frame(vd);
+
+  if (frame != NULL)
+    latency_hist_add(&vd->stage_hist[V4L2_STAGE_DQBUF_WAIT],
+                     ns_time_monotonic() - wait_start);
+
+  return frame;
+}
+
+/*
+ * dequeues the next frame from the driver (doesn't wait for data)
+ *   the frame must be released after processing
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: pointer frame buffer (NULL on error)
+ */
+v4l2_frame_buff_t *dequeue_v4l2_frame(v4l2_dev_t *vd) {
+  /*asserts*/
+  assert(vd != NULL);
+
+  /*
+   * for H264 streams request a IDR frame with SPS and PPS data if it's the
+   * first frame: there is no gop yet to prime the decoder (consumers that
+   * start later are primed with v4l2core_h264_replay_gop)
+   */
+  if (vd->requested_fmt == V4L2_PIX_FMT_H264 && vd->frame_index < 1 &&
+      !h264_gop_has_idr(&vd->h264_gop))
     request_h264_frame_type(vd, PICTURE_TYPE_IDR_FULL);
 
   int res = 0;
-  int ret = check_frame_available(vd);
-
+  int ret = 0;
   int qind = -1;
 
-  if (ret < 0)
-    return NULL;
-
   int bytes_used = 0;
 
   switch (vd->cap_meth) {
@@ -1107,8 +1517,12 @@ v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd) {
     /*lock the mutex*/
     __LOCK_MUTEX(__PMUTEX);
     if (vd->streaming == STRM_OK) {
-      vd->buf.bytesused =
-          v4l2_read(vd->fd, vd->mem[vd->buf.index], vd->buf.length);
+      if (vd->is_virtual)
+        vd->buf.bytesused =
+            vdev_read(vd->fd, vd->mem[vd->buf.index], vd->buf.length);
+      else
+        vd->buf.bytesused =
+            v4l2_read(vd->fd, vd->mem[vd->buf.index], vd->buf.length);
       bytes_used = vd->buf.bytesused;
 
       if (bytes_used > 0)
@@ -1175,80 +1589,310 @@ v4l2_frame_buff_t *v4l2core_get_frame(v4l2_dev_t *vd) {
       memset(&vd->buf, 0, sizeof(struct v4l2_buffer));
 
       vd->buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-      vd->buf.memory = V4L2_MEMORY_MMAP;
+      vd->buf.memory = get_v4l2_memory(vd);
 
       ret = xioctl(vd->fd, VIDIOC_DQBUF, &vd->buf);
 
-      if (!ret)
+      if (!ret) {
+        /*imported dmabuf: begin cpu access (ended on release)*/
+        sync_dmabuf_buffer(vd, vd->buf.index, 1);
         qind = process_input_buffer(vd);
-      else
+        /*
+         * no free frame slot (consumer is holding all frames):
+         * drop the frame and give the buffer back to the driver
+         */
+        if (qind < 0)
+          sync_dmabuf_buffer(vd, vd->buf.index, 0);
+        if (qind < 0 && xioctl(vd->fd, VIDIOC_QBUF, &vd->buf))
+          fprintf(stderr,
+                  "V4L2_CORE: (VIDIOC_QBUF) Unable to requeue buffer %i: %s\n",
+                  vd->buf.index, strerror(errno));
+      } else
         fprintf(stderr,
                 "V4L2_CORE: (VIDIOC_DQBUF) Unable to dequeue buffer: %s\n",
                 strerror(errno));
     } else
       res = -1;
 
-    /*unlock the mutex*/
-    __UNLOCK_MUTEX(__PMUTEX);
+    /*unlock the mutex*/
+    __UNLOCK_MUTEX(__PMUTEX);
+
+    if (res < 0 || ret < 0)
+      return NULL;
+  }
+
+  if (qind < 0 || qind >= vd->frame_queue_size)
+    return NULL;
+
+  vd->frame_queue[qind].width = vd->format.fmt.pix.width;
+  vd->frame_queue[qind].height = vd->format.fmt.pix.height;
+
+  return &vd->frame_queue[qind];
+}
+
+/*
+ * releases the video frame (so that it can be reused by the driver)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   frame - pointer to decoded frame buffer
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_release_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
+  int ret = 0;
+
+  /*
+   * match the v4l2_buffer with the correspondig frame
+   * (use a local buffer struct: vd->buf may be in use by a
+   *  concurrent dequeue from a capture engine thread)
+   */
+  struct v4l2_buffer buf;
+  prepare_v4l2_buffer(vd, &buf, frame->index);
+
+  switch (vd->cap_meth) {
+  case IO_READ:
+    break;
+
+  case IO_DMABUF:
+    sync_dmabuf_buffer(vd, frame->index, 0);
+    /*fall through*/
+  case IO_MMAP:
+  default:
+    /* queue the buffer */
+    ret = xioctl(vd->fd, VIDIOC_QBUF, &buf);
+
+    if (ret)
+      fprintf(stderr,
+              "V4L2_CORE: (VIDIOC_QBUF) Unable to queue buffer %i: %s\n",
+              frame->index, strerror(errno));
+    break;
+  }
+
+  frame->raw_frame = NULL;
+  frame->raw_frame_size = 0;
+  frame->yuv_ready = 0;
+  frame->yuv_plane[0] = NULL;
+  frame->status = FRAME_READY;
+
+  /*give the slot back (no lock: dequeue never waits on a release)*/
+  frame_slots_release(&vd->frame_slots, (int)(frame - vd->frame_queue));
+
+  if (ret < 0)
+    return E_QBUF_ERR;
+
+  return E_OK;
+}
+
+/*
+ * gets the frame queue counters
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stats - pointer to frame queue stats struct (filled by the function)
+ *
+ * asserts:
+ *   vd is not null
+ *   stats is not null
+ *
+ * returns: none
+ */
+void v4l2core_get_frame_queue_stats(v4l2_dev_t *vd,
+                                    v4l2_frame_queue_stats_t *stats) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(stats != NULL);
+
+  stats->size = vd->frame_queue_size;
+  stats->depth = atomic_load(&vd->frame_slots.depth);
+  stats->max_depth = atomic_load(&vd->frame_slots.max_depth);
+  stats->dequeued = atomic_load(&vd->frame_slots.acquired);
+  stats->starved = atomic_load(&vd->frame_slots.starved);
+}
+
+/*
+ * gets the capture stats (stage latencies and drop counters)
+ *   cheap enough to be polled by a monitoring thread while streaming
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stats - pointer to stats struct (filled by the function)
+ *
+ * asserts:
+ *   vd is not null
+ *   stats is not null
+ *
+ * returns: none
+ */
+void v4l2core_get_stats(v4l2_dev_t *vd, v4l2_stats_t *stats) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(stats != NULL);
+
+  int i = 0;
+  for (i = 0; i < V4L2_STAGE_COUNT; i++) {
+    latency_hist_t *hist = &vd->stage_hist[i];
+    v4l2_latency_stats_t *stage = &stats->stage[i];
+
+    stage->count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    stage->mean = stage->count
+                      ? __atomic_load_n(&hist->sum, __ATOMIC_RELAXED) /
+                            stage->count
+                      : 0;
+    stage->p50 = latency_hist_percentile(hist, 500);
+    stage->p90 = latency_hist_percentile(hist, 900);
+    stage->p99 = latency_hist_percentile(hist, 990);
+    stage->p999 = latency_hist_percentile(hist, 999);
+    stage->max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+  }
+
+  stats->frames = atomic_load(&vd->frame_slots.acquired);
+  stats->sequence_gaps = vd->sequence_gaps;
+  stats->starved = atomic_load(&vd->frame_slots.starved);
+  stats->real_fps = vd->real_fps;
+  stats->buffers = vd->nb_buffers;
+  stats->queue_size = vd->frame_queue_size;
+  stats->ts_source = vd->ts_filter.source;
+  stats->ts_jitter = (uint64_t)vd->ts_filter.jitter;
+  stats->dqbuf_jitter = (uint64_t)vd->ts_filter.dq_jitter;
+  stats->clock_skew_ppm = vd->ts_filter.skew * 1e6;
+
+  stats->decode_delay = 0;
+  stats->decode_delay_ns = 0;
+  if (vd->requested_fmt == V4L2_PIX_FMT_H264) {
+    stats->decode_delay = h264_get_decoder_delay();
+    if (vd->real_fps > 0)
+      stats->decode_delay_ns =
+          (uint64_t)(stats->decode_delay * NSEC_PER_SEC / vd->real_fps);
+  }
+}
+
+/*
+ * resets the stage latency histograms and the sequence gap counter
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_reset_stats(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  memset(vd->stage_hist, 0, sizeof(vd->stage_hist));
+  vd->sequence_gaps = 0;
+}
+
+/*
+ * enables/disables buffer autotuning (enabled by default)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   enable - 1 to enable, 0 to disable
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_set_buffer_autotune(v4l2_dev_t *vd, int enable) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  /*lock the mutex*/
+  __LOCK_MUTEX(__PMUTEX);
+
+  vd->buffer_autotune = enable ? 1 : 0;
+  if (!enable) {
+    /*drop pending requests*/
+    vd->req_nb_buffers = vd->nb_buffers;
+    vd->req_frame_queue_size = vd->frame_queue_size;
+  }
+
+  /*unlock the mutex*/
+  __UNLOCK_MUTEX(__PMUTEX);
+}
+
+/*
+ * sets the frame timestamp mode (applied on the next stream start)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   mode - V4L2_TS_MODE_*
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_timestamp_mode(v4l2_dev_t *vd, int mode) {
+  /*assertions*/
+  assert(vd != NULL);
 
-    if (res < 0 || ret < 0)
-      return NULL;
+  if (mode != V4L2_TS_MODE_DEQUEUE && mode != V4L2_TS_MODE_DRIVER) {
+    fprintf(stderr, "V4L2_CORE: invalid timestamp mode (%i)\n", mode);
+    return E_UNKNOWN_ERR;
   }
 
-  if (qind < 0 || qind >= vd->frame_queue_size)
-    return NULL;
-
-  vd->frame_queue[qind].width = vd->format.fmt.pix.width;
-  vd->frame_queue[qind].height = vd->format.fmt.pix.height;
+  vd->ts_filter.mode = mode;
 
-  return &vd->frame_queue[qind];
+  return E_OK;
 }
 
 /*
- * releases the video frame (so that it can be reused by the driver)
+ * sets the h264 decoder threading
+ *   slice threads (default) add no latency; frame threads scale better
+ *   for large frames but hold (threads - 1) frames (decode_delay stats)
+ *   applied on the next stream start
  * args:
  *   vd - pointer to v4l2 device handler
- *   frame - pointer to decoded frame buffer
+ *   threads - number of decoder threads (0 - auto)
+ *   thread_type - V4L2_DEC_THREAD_SLICE and/or V4L2_DEC_THREAD_FRAME
+ *                 (0 - single threaded)
  *
  * asserts:
  *   vd is not null
  *
  * returns: error code (E_OK)
  */
-int v4l2core_release_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
-  int ret = 0;
-
-  // match the v4l2_buffer with the correspondig frame
-  vd->buf.index = frame->index;
+int v4l2core_set_h264_decoder_threads(v4l2_dev_t *vd, int threads,
+                                      int thread_type) {
+  /*assertions*/
+  assert(vd != NULL);
 
-  switch (vd->cap_meth) {
-  case IO_READ:
-    break;
+  if (threads < 0 ||
+      (thread_type & ~(V4L2_DEC_THREAD_SLICE | V4L2_DEC_THREAD_FRAME))) {
+    fprintf(stderr, "V4L2_CORE: invalid h264 decoder threading (%i, %i)\n",
+            threads, thread_type);
+    return E_UNKNOWN_ERR;
+  }
 
-  case IO_MMAP:
-  default:
-    /* queue the buffer */
-    ret = xioctl(vd->fd, VIDIOC_QBUF, &vd->buf);
+  vd->h264_dec_threads = threads;
+  vd->h264_dec_thread_type = thread_type;
 
-    if (ret)
-      fprintf(stderr,
-              "V4L2_CORE: (VIDIOC_QBUF) Unable to queue buffer %i: %s\n",
-              frame->index, strerror(errno));
-    break;
-  }
+  return E_OK;
+}
 
-  /*lock the mutex*/
-  __LOCK_MUTEX(__PMUTEX);
-  frame->raw_frame = NULL;
-  frame->raw_frame_size = 0;
-  frame->status = FRAME_READY;
-  /*unlock the mutex*/
-  __UNLOCK_MUTEX(__PMUTEX);
+/*
+ * records a stage latency (for stages run by the application)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   stage - pipeline stage (V4L2_STAGE_*)
+ *   ns - stage latency (ns)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+void v4l2core_add_stage_latency(v4l2_dev_t *vd, int stage, uint64_t ns) {
+  /*assertions*/
+  assert(vd != NULL);
 
-  if (ret < 0)
-    return E_QBUF_ERR;
+  if (stage < 0 || stage >= V4L2_STAGE_COUNT)
+    return;
 
-  return E_OK;
+  latency_hist_add(&vd->stage_hist[stage], ns);
 }
 
 /*
@@ -1259,6 +1903,10 @@ int v4l2core_release_frame(v4l2_dev_t *vd, v4l2_frame_buff_t *frame) {
  * returns: pointer to decoded frame buffer ( NULL on error)
  */
 v4l2_frame_buff_t *v4l2core_get_decoded_frame(v4l2_dev_t *vd) {
+  /*pipelined mode: frames are already decoded by the pool workers*/
+  if (vd->decode_pool != NULL)
+    return decode_pool_get_frame(vd->decode_pool);
+
   v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
   if (frame != NULL) {
     /*decode the raw frame*/
@@ -1270,6 +1918,113 @@ v4l2_frame_buff_t *v4l2core_get_decoded_frame(v4l2_dev_t *vd) {
   return frame;
 }
 
+/*
+ * enables the pipelined decode mode for v4l2core_get_decoded_frame:
+ *   a dequeue thread hands raw frames to nworkers decode threads and
+ *   decoded frames are returned in capture order
+ * args:
+ *    vd - pointer to v4l2 device handler
+ *    nworkers - number of decode workers (0 disables the pipelined mode)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_set_decode_pool(v4l2_dev_t *vd, int nworkers) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (vd->decode_pool != NULL) {
+    decode_pool_free(vd->decode_pool);
+    vd->decode_pool = NULL;
+  }
+
+  if (nworkers <= 0)
+    return E_OK;
+
+  vd->decode_pool = decode_pool_new(vd, nworkers);
+  if (vd->decode_pool == NULL)
+    return E_UNKNOWN_ERR;
+
+  return E_OK;
+}
+
+/*
+ * converts the frame to the requested format
+ *   uses a direct kernel from the raw frame format when available,
+ *   otherwise chains kernels (decoding to yuv_frame only if needed);
+ *   if the frame is already decoded (yuv_ready) yuv_frame is used as source
+ *   h264 pictures are read from the decoder planes (yuv_plane)
+ * args:
+ *    vd - pointer to v4l2 device handler (NULL: no decoding)
+ *    frame - pointer to frame buffer
+ *    dst_fmt - output format (v4l2 fourcc or CONV_FMT_*)
+ *    out - pointer to output buffer (big enough for dst_fmt)
+ *
+ * asserts:
+ *   frame is not null
+ *   out is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_frame_convert(v4l2_dev_t *vd, v4l2_frame_buff_t *frame,
+                           uint32_t dst_fmt, uint8_t *out) {
+  return convert_frame(vd, frame, dst_fmt, out);
+}
+
+/*
+ * applies the pending buffer autotuning requests (stream is stopped)
+ *   grows the frame queue and sets the buffer count for the next REQBUFS
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: none
+ */
+static void apply_buffer_growth(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  /*the decode pool workers are sized for the current queue*/
+  if (vd->req_frame_queue_size > vd->frame_queue_size &&
+      vd->decode_pool == NULL) {
+    /*frame buffers are allocated again by alloc_v4l2_frames*/
+    clean_v4l2_frames(vd);
+
+    v4l2_frame_buff_t *queue =
+        calloc(vd->req_frame_queue_size, sizeof(v4l2_frame_buff_t));
+    if (queue == NULL) {
+      fprintf(stderr,
+              "V4L2_CORE: FATAL memory allocation failure "
+              "(apply_buffer_growth): %s\n",
+              strerror(errno));
+      exit(-1);
+    }
+    free(vd->frame_queue);
+    vd->frame_queue = queue;
+    vd->frame_queue_size = vd->req_frame_queue_size;
+
+    frame_slots_clean(&vd->frame_slots);
+    frame_slots_init(&vd->frame_slots, vd->frame_queue_size);
+
+    if (verbosity > 0)
+      printf("V4L2_CORE: frame queue grown to %i frames\n",
+             vd->frame_queue_size);
+  }
+  vd->req_frame_queue_size = vd->frame_queue_size;
+
+  if (vd->cap_meth != IO_DMABUF && vd->req_nb_buffers > vd->nb_buffers) {
+    vd->nb_buffers = vd->req_nb_buffers;
+    if (verbosity > 0)
+      printf("V4L2_CORE: requesting %i driver buffers\n", vd->nb_buffers);
+  }
+  vd->req_nb_buffers = vd->nb_buffers;
+  vd->create_bufs_err = 0;
+}
+
 /*
  * Try/Set device video stream format
  * args:
@@ -1358,6 +2113,14 @@ static int try_video_stream_format(v4l2_dev_t *vd, int width, int height,
         vd->format.fmt.pix.width, vd->format.fmt.pix.height);
   }
 
+  apply_buffer_growth(vd);
+
+  /*userptr: raw and decode buffers share the frame arena*/
+  if (vd->cap_meth == IO_USERPTR && alloc_userptr_buff(vd) != E_OK) {
+    fprintf(stderr, "V4L2_CORE: couldn't alloc the userptr frame arena\n");
+    return E_ALLOC_ERR;
+  }
+
   /*
    * try to alloc frame buffers based on requested format
    */
@@ -1392,9 +2155,9 @@ static int try_video_stream_format(v4l2_dev_t *vd, int width, int height,
   default:
     /* request buffers */
     memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
-    vd->rb.count = NB_BUFFER;
+    vd->rb.count = vd->nb_buffers;
     vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    vd->rb.memory = V4L2_MEMORY_MMAP;
+    vd->rb.memory = get_v4l2_memory(vd);
 
     ret = xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb);
 
@@ -1404,6 +2167,13 @@ static int try_video_stream_format(v4l2_dev_t *vd, int width, int height,
               strerror(errno));
       return E_REQBUFS_ERR;
     }
+    /*the driver may adjust the buffer count*/
+    if (vd->rb.count > 0 && (int)vd->rb.count < vd->nb_buffers)
+      vd->nb_buffers = vd->rb.count;
+    else if (vd->cap_meth == IO_MMAP && (int)vd->rb.count > vd->nb_buffers)
+      vd->nb_buffers = MIN((int)vd->rb.count, V4L2_MAX_BUFFERS);
+    vd->req_nb_buffers = vd->nb_buffers;
+
     /* map the buffers */
     if (query_buff(vd)) {
       fprintf(stderr, "V4L2_CORE: (VIDIOC_QBUFS) Unable to query buffers: %s\n",
@@ -1417,7 +2187,7 @@ static int try_video_stream_format(v4l2_dev_t *vd, int width, int height,
       memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
       vd->rb.count = 0;
       vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-      vd->rb.memory = V4L2_MEMORY_MMAP;
+      vd->rb.memory = get_v4l2_memory(vd);
       if (xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb) < 0)
         fprintf(stderr,
                 "V4L2_CORE: (VIDIOC_REQBUFS) Unable to delete buffers: %s\n",
@@ -1437,7 +2207,7 @@ static int try_video_stream_format(v4l2_dev_t *vd, int width, int height,
       memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
       vd->rb.count = 0;
       vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-      vd->rb.memory = V4L2_MEMORY_MMAP;
+      vd->rb.memory = get_v4l2_memory(vd);
       if (xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb) < 0)
         fprintf(stderr,
                 "V4L2_CORE: (VIDIOC_REQBUFS) Unable to delete buffers: %s\n",
@@ -1663,10 +2433,16 @@ static void clean_v4l2_dev(v4l2_dev_t *vd) {
   /*assertions*/
   assert(vd != NULL);
 
+  /*restore the h264 bit rate (the controller may have lowered it)*/
+  h264_rate_control_enable(vd, 0);
+
   if (vd->videodevice)
     free(vd->videodevice);
   vd->videodevice = NULL;
 
+  /*wait for the cache verification (uses the device descriptor)*/
+  close_device_cache(vd);
+
   if (vd->has_focus_control_id)
     v4l2core_soft_autofocus_close();
 
@@ -1676,11 +2452,21 @@ static void clean_v4l2_dev(v4l2_dev_t *vd) {
   if (vd->list_stream_formats)
     free_frame_formats(vd);
 
-  if (vd->frame_queue)
+  if (vd->frame_queue) {
     free(vd->frame_queue);
+    frame_slots_clean(&vd->frame_slots);
+  }
+
+  h264_gop_clean(&vd->h264_gop);
+
+  /*close exported dmabufs (imported ones belong to the caller)*/
+  close_dmabuf_buffers(vd);
+  frame_arena_clean(&vd->frame_arena);
 
   /*close descriptor*/
-  if (vd->fd > 0)
+  if (vd->fd > 0 && vd->is_virtual)
+    vdev_close(vd->fd);
+  else if (vd->fd > 0)
     v4l2_close(vd->fd);
 
   vd->fd = 0;
@@ -1691,7 +2477,7 @@ static void clean_v4l2_dev(v4l2_dev_t *vd) {
 /*
  * Initiate video device handler with default values
  * args:
- *   device - device name (e.g: "/dev/video0")
+ *   device - device name (e.g: "/dev/video0" or "replay:<file>")
  *
  * asserts:
  *   device is not null
@@ -1724,6 +2510,19 @@ v4l2_dev_t *v4l2core_init_dev(const char *device) {
 
   /*MMAP by default*/
   vd->cap_meth = IO_MMAP;
+  /*no dmabufs (exported or imported) yet*/
+  int i = 0;
+  for (i = 0; i < V4L2_MAX_BUFFERS; i++)
+    vd->dmabuf_fd[i] = -1;
+  /*buffer count (autotuned if consumer holds the buffers for too long)*/
+  vd->nb_buffers = NB_BUFFER;
+  vd->req_nb_buffers = NB_BUFFER;
+  vd->buffer_autotune = 1;
+  /*driver timestamps (if monotonic)*/
+  vd->ts_filter.mode = V4L2_TS_MODE_DRIVER;
+  vd->h264_dec_threads = 0;
+  vd->h264_dec_thread_type = V4L2_DEC_THREAD_SLICE;
+  ts_filter_reset(&vd->ts_filter);
 
   vd->videodevice = strdup(device);
 
@@ -1733,16 +2532,17 @@ v4l2_dev_t *v4l2core_init_dev(const char *device) {
   }
 
   vd->frame_queue_size = frame_queue_size;
+  vd->req_frame_queue_size = frame_queue_size;
   /*alloc frame buffer queue*/
   vd->frame_queue = calloc(vd->frame_queue_size, sizeof(v4l2_frame_buff_t));
+  frame_slots_init(&vd->frame_slots, vd->frame_queue_size);
 
   vd->h264_no_probe_default = 0;
   vd->h264_SPS = NULL;
   vd->h264_SPS_size = 0;
   vd->h264_PPS = NULL;
   vd->h264_PPS_size = 0;
-  vd->h264_last_IDR = NULL;
-  vd->h264_last_IDR_size = 0;
+  h264_gop_init(&vd->h264_gop);
 
   /*set some defaults*/
   vd->fps_num = 1;
@@ -1751,21 +2551,24 @@ v4l2_dev_t *v4l2core_init_dev(const char *device) {
   vd->pan_step = 128;
   vd->tilt_step = 128;
 
-  /*open device*/
-  if ((vd->fd = v4l2_open(vd->videodevice, O_RDWR | O_NONBLOCK, 0)) < 0) {
+  /*open device (or replay file)*/
+  vd->is_virtual = vdev_is_virtual_name(vd->videodevice);
+  if (vd->is_virtual)
+    vd->fd = vdev_open(vd->videodevice);
+  else
+    vd->fd = v4l2_open(vd->videodevice, O_RDWR | O_NONBLOCK, 0);
+
+  if (vd->fd < 0) {
     fprintf(stderr, "V4L2_CORE: ERROR opening V4L interface: %s\n",
             strerror(errno));
     clean_v4l2_dev(vd);
     return (NULL);
   }
 
-  vd->this_device = v4l2core_get_device_index(vd->videodevice);
-  if (vd->this_device < 0)
-    vd->this_device = 0;
-
   v4l2_device_list_t *device_list = get_device_list();
 
-  if (device_list && device_list->list_devices)
+  if (device_list && device_list->list_devices &&
+      v4l2core_get_this_device_index(vd) >= 0)
     device_list->list_devices[vd->this_device].current = 1;
 
   /*try to map known xu controls (we could/should leave this for libwebcam)*/
@@ -1784,8 +2587,7 @@ v4l2_dev_t *v4l2core_init_dev(const char *device) {
     return (NULL);
   }
 
-  int i = 0;
-  for (i = 0; i < NB_BUFFER; i++) {
+  for (i = 0; i < V4L2_MAX_BUFFERS; i++) {
     vd->mem[i] = MAP_FAILED; /*not mmaped yet*/
   }
 
@@ -1840,43 +2642,50 @@ int v4l2core_check_control_events(v4l2_dev_t *vd) {
   /*assertions*/
   assert(vd != NULL);
 
-  int ret = 0;
-  struct v4l2_event ev;
-
-  while (xioctl(vd->fd, VIDIOC_DQEVENT, &ev) == 0) {
-    if (ev.type != V4L2_EVENT_CTRL)
-      continue;
-
-    ret++;
-    // update control
-    v4l2_ctrl_t *control = v4l2core_get_control_by_id(vd, ev.id);
-    if (control != NULL) {
-      control->control.flags = ev.u.ctrl.flags;
-      if (control->control.flags & V4L2_CTRL_FLAG_DISABLED)
-        continue;
-
-      control->control.minimum = ev.u.ctrl.minimum;
-      control->control.maximum = ev.u.ctrl.maximum;
-      control->control.step = ev.u.ctrl.step;
-      control->control.default_value = ev.u.ctrl.default_value;
-
-      switch (control->control.type) {
-#ifdef V4L2_CTRL_TYPE_INTEGER64
-      case V4L2_CTRL_TYPE_INTEGER64:
-        control->value64 = ev.u.ctrl.value64;
-        break;
-#endif
-#ifdef V4L2_CTRL_TYPE_STRING
-      case V4L2_CTRL_TYPE_STRING:
-        break;
-#endif
-      default:
-        control->value = ev.u.ctrl.value;
-      }
-    }
-  }
+  return process_control_events(vd);
+}
 
-  return ret;
+/*
+ * enumerate the frame formats and controls again if the background
+ *   verification found the capabilities cache stale
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: 1 if the lists were enumerated again, 0 otherwise
+ */
+int v4l2core_check_device_caps(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (!__atomic_load_n(&vd->caps_stale, __ATOMIC_ACQUIRE))
+    return 0;
+
+  /*the verification thread is done with the device*/
+  close_device_cache(vd);
+  vd->caps_stale = 0;
+
+  free_v4l2_control_list(vd);
+  if (vd->list_stream_formats)
+    free_frame_formats(vd);
+  vd->numb_formats = 0;
+
+  if (enum_frame_formats(vd) != E_OK)
+    fprintf(stderr, "V4L2_CORE: no valid frame formats (with valid sizes) "
+                    "found for device\n");
+  enumerate_v4l2_control(vd);
+  save_device_cache(vd);
+
+  add_h264_format(vd);
+  get_v4l2_control_values(vd);
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: enumerated %i formats and %i controls again\n",
+           vd->numb_formats, vd->num_controls);
+
+  return 1;
 }
 
 /*
@@ -2017,13 +2826,15 @@ void v4l2core_clean_buffers(v4l2_dev_t *vd) {
     memset(&vd->rb, 0, sizeof(struct v4l2_requestbuffers));
     vd->rb.count = 0;
     vd->rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    vd->rb.memory = V4L2_MEMORY_MMAP;
+    vd->rb.memory = get_v4l2_memory(vd);
     if (xioctl(vd->fd, VIDIOC_REQBUFS, &vd->rb) < 0) {
       fprintf(stderr,
               "V4L2_CORE: (VIDIOC_REQBUFS) Failed to delete buffers: %s (errno "
               "%d)\n",
               strerror(errno), errno);
     }
+    /*userptr buffers: the driver no longer references the arena*/
+    frame_arena_clean(&vd->frame_arena);
     break;
   }
 }
@@ -2041,6 +2852,9 @@ void v4l2core_close_dev(v4l2_dev_t *vd) {
   if (vd == NULL)
     return;
 
+  /*stop the decode pool threads (they use the device)*/
+  v4l2core_set_decode_pool(vd, 0);
+
   /* thread must be joined before destroying the mutex
    * so no need to unlock before destroying it
    */
@@ -2072,7 +2886,7 @@ void v4l2core_request_framerate_update(v4l2_dev_t *vd) {
    * else change fps immediatly
    */
   if (vd->streaming == STRM_OK)
-    flag_fps_change = 1;
+    vd->fps_change_req = 1;
   else
     set_v4l2_framerate(vd);
 }
@@ -2340,6 +3154,32 @@ uint8_t *v4l2core_get_h264_sps(v4l2_dev_t *vd) {
  */
 void v4l2core_h264_request_idr(v4l2_dev_t *vd) { h264_request_idr(vd); }
 
+/*
+ * replays the compressed h264 frames since the last IDR (annex-b),
+ *   IDR first (with SPS and PPS): primes a new consumer (decoder or
+ *   muxer) without requesting an IDR from the camera
+ *   the gop is locked during the replay: the callback should not block
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   callback - called for each frame (in capture order)
+ *   data - callback user data
+ *
+ * asserts:
+ *   vd is not null
+ *   callback is not null
+ *
+ * returns: number of replayed frames
+ *          or E_NO_DATA if there is no (complete) gop: request an IDR
+ */
+int v4l2core_h264_replay_gop(v4l2_dev_t *vd, v4l2_h264_gop_cb_t callback,
+                             void *data) {
+  /*assertions*/
+  assert(vd != NULL);
+  assert(callback != NULL);
+
+  return h264_gop_replay(&vd->h264_gop, callback, data);
+}
+
 /*
  * resets the h264 encoder
  * args:
@@ -2484,6 +3324,94 @@ int v4l2core_set_h264_frame_rate_config(v4l2_dev_t *vd, uint32_t framerate) {
   return h264_set_frame_rate_config(vd, framerate);
 }
 
+/*
+ * query the h264 encoder bit rate
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   query - query type (UVC_GET_CUR; UVC_GET_MAX; UVC_GET_MIN; ...)
+ *   average - pointer to average bit rate (bits/sec)
+ *   peak - pointer to peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *   average is not null
+ *   peak is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int v4l2core_query_h264_bitrate(v4l2_dev_t *vd, uint8_t query,
+                                uint32_t *average, uint32_t *peak) {
+  return h264_query_bitrate(vd, query, average, peak);
+}
+
+/*
+ * set the h264 encoder bit rate
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   average - average bit rate (bits/sec)
+ *   peak - peak bit rate (bits/sec)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int v4l2core_set_h264_bitrate(v4l2_dev_t *vd, uint32_t average,
+                              uint32_t peak) {
+  return h264_set_bitrate(vd, average, peak);
+}
+
+/*
+ * starts/stops the h264 bit rate controller: the camera encoder bit
+ *   rate follows the consumer backpressure (v4l2core_h264_rate_control_update)
+ *   starting takes the current bit rate as ceiling; stopping restores it
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   enable - start (1) or stop (0) the controller
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code ( 0 -OK)
+ */
+int v4l2core_h264_rate_control_enable(v4l2_dev_t *vd, int enable) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  if (enable && vd->requested_fmt != V4L2_PIX_FMT_H264)
+    return E_NO_STREAM_ERR;
+
+  return h264_rate_control_enable(vd, enable);
+}
+
+/*
+ * feeds the h264 bit rate controller with the consumer backpressure
+ *   (call it regularly, e.g. on every recorded frame)
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   ring_fill - encoder ring buffer fill (0 - empty; 1 - full/dropping)
+ *   io_load - share of time the writer spends writing (0 to 1)
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: current average bit rate (0 if the controller is stopped)
+ */
+uint32_t v4l2core_h264_rate_control_update(v4l2_dev_t *vd, double ring_fill,
+                                           double io_load) {
+  /*assertions*/
+  assert(vd != NULL);
+
+  /*the most loaded stage sets the pace*/
+  double pressure = MAX(ring_fill, io_load);
+  if (pressure < 0)
+    pressure = 0;
+  if (pressure > 1)
+    pressure = 1;
+
+  return h264_rate_control_update(vd, pressure);
+}
+
 /*
  * updates the h264_probe_commit_req field
  * args:
@@ -2565,6 +3493,21 @@ int v4l2core_save_control_profile(v4l2_dev_t *vd, const char *filename) {
   return save_control_profile(vd, filename);
 }
 
+/*
+ * save the device control values into a binary profile file
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *   filename - profile filename
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (0 -E_OK)
+ */
+int v4l2core_save_control_profile_bin(v4l2_dev_t *vd, const char *filename) {
+  return save_control_profile_bin(vd, filename);
+}
+
 /*
  * load the device control values from a profile file
  * args:
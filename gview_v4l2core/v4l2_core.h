@@ -22,6 +22,13 @@
 #ifndef V4L2CORE_H
 #define V4L2CORE_H
 
+#include "frame_arena.h"
+#include "frame_slots.h"
+#include "frame_timestamp.h"
+#include "h264_gop.h"
+#include "h264_rate_control.h"
+#include "jpeg_decoder.h"
+#include "latency_hist.h"
 #include "neoguvc.h"
 #include "neoguvc_v4l2core.h"
 
@@ -29,12 +36,13 @@
  * video device data
  */
 struct _v4l2_dev_t {
-  int fd;            // device file descriptor
-  char *videodevice; // video device string (default "/dev/video0)"
+  int fd;             // device file descriptor
+  uint8_t is_virtual; // replay file backed device (virtual_device.c)
+  char *videodevice;  // video device string (default "/dev/video0)"
 
   __MUTEX_TYPE mutex; // device mutex
 
-  int cap_meth; // capture method: IO_READ or IO_MMAP
+  int cap_meth; // capture method: IO_READ, IO_MMAP, IO_DMABUF or IO_USERPTR
   v4l2_stream_formats_t *list_stream_formats; // list of available stream
                                               // formats
   int numb_formats; // list size
@@ -56,17 +64,36 @@ struct _v4l2_dev_t {
   int fps_denom; // fps denominator
 
   double real_fps; // real fps (calculated from number of captured frames)
+  uint64_t fps_ref_ts;      // real fps reference timestamp
+  uint32_t fps_frame_count; // frames captured since fps_ref_ts
+  uint8_t fps_change_req;   // set to 1 to request a fps change while streaming
+
+  latency_hist_t stage_hist[V4L2_STAGE_COUNT]; // stage latencies (ns)
+  int64_t last_sequence;  // last dequeued buffer sequence (-1 at stream start)
+  uint64_t sequence_gaps; // frames lost by the driver (buffer sequence gaps)
+  ts_filter_t ts_filter;  // frame timestamps (driver clock or dequeue time)
 
   uint8_t streaming; // flag device stream : STRM_STOP ; STRM_REQ_STOP; STRM_OK
   uint64_t frame_index; // captured frame index from 0 to max(uint64_t)
-  void *mem[NB_BUFFER]; // memory buffers for mmap driver frames
-  uint32_t
-      buff_length[NB_BUFFER]; // memory buffers length as set by VIDIOC_QUERYBUF
-  uint32_t
-      buff_offset[NB_BUFFER]; // memory buffers offset as set by VIDIOC_QUERYBUF
+  int nb_buffers;        // driver buffers in use (NB_BUFFER by default)
+  void *mem[V4L2_MAX_BUFFERS]; // memory buffers for mmap driver frames
+  uint32_t buff_length[V4L2_MAX_BUFFERS]; // memory buffers length as set by
+                                          // VIDIOC_QUERYBUF
+  uint32_t buff_offset[V4L2_MAX_BUFFERS]; // memory buffers offset as set by
+                                          // VIDIOC_QUERYBUF
+  int dmabuf_fd[V4L2_MAX_BUFFERS]; // exported (IO_MMAP) or imported
+                                   // (IO_DMABUF) fds
+  uint8_t dmabuf_export;    // export the mmap buffers as dmabufs
+  frame_arena_t frame_arena; // raw and decode buffers arena (IO_USERPTR)
 
   v4l2_frame_buff_t *frame_queue; // frame queue
   int frame_queue_size;           // size of frame queue (in frames)
+  frame_slots_t frame_slots;      // free frame queue slots (lock-free)
+
+  uint8_t buffer_autotune;  // grow buffers/queue when the consumer drops frames
+  uint8_t create_bufs_err;  // VIDIOC_CREATE_BUFS not supported while streaming
+  int req_nb_buffers;       // driver buffers for the next allocation
+  int req_frame_queue_size; // frame queue size for the next allocation
 
   uint8_t
       h264_unit_id; // uvc h264 unit id, if <= 0 then uvc h264 is not supported
@@ -75,18 +102,32 @@ struct _v4l2_dev_t {
                                  // default before commit)
   uvcx_video_config_probe_commit_t
       h264_config_probe_req; // probe commit struct for h264 streams
-  uint8_t *h264_last_IDR;    // last IDR frame retrieved from uvc h264 stream
-  int h264_last_IDR_size;    // last IDR frame size
+  int h264_dec_threads;      // h264 decoder threads (0 - auto)
+  int h264_dec_thread_type;  // V4L2_DEC_THREAD_* flags
+  h264_gop_t h264_gop;       // frames since the last IDR (uvc h264 stream)
+  h264_rate_control_t h264_rc; // uvc h264 bit rate controller
   uint8_t *h264_SPS;         // h264 SPS info
   uint16_t h264_SPS_size;    // SPS size
   uint8_t *h264_PPS;         // h264 PPS info
   uint16_t h264_PPS_size;    // PPS size
 
+  jpeg_decoder_context_t *jpeg_ctx;   // (m)jpeg decoder context
+  struct _decode_pool_t *decode_pool; // pipelined decode pool (NULL if off)
+
   int this_device; // index of this device in device list
 
+  uint64_t caps_fingerprint;        // device capabilities fingerprint
+  char *caps_cache_file;            // capabilities cache file (NULL if none)
+  uint8_t caps_verify_on;           // cache verification thread running
+  __THREAD_TYPE caps_verify_thread; // cache verification thread
+  uint8_t caps_stale; // cache didn't match the device: lists are enumerated
+                      // again by the owner (v4l2core_check_device_caps)
+
   v4l2_ctrl_t *list_device_controls; // null terminated linked list of available
                                      // device controls
   int num_controls; // number of controls in list
+  uint8_t ctrl_events_pending; // control events flagged by the capture
+                               // thread (dequeued by the control owner)
 
   uint8_t isbayer; // flag if we are streaming bayer data in yuyv frame
                    // (logitech only)
@@ -104,4 +145,30 @@ struct _v4l2_dev_t {
   uint8_t pantilt_unit_id; // logitech peripheral V3 unit id (if any)
 };
 
+/*
+ * checks the stream state and applies pending stream requests
+ *   (fps change, buffer growth) before dequeuing a frame
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: error code  (0- E_OK)
+ */
+int check_stream_state(v4l2_dev_t *vd);
+
+/*
+ * dequeues the next frame from the driver (doesn't wait for data)
+ *   the frame must be released after processing
+ * args:
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   vd is not null
+ *
+ * returns: pointer frame buffer (NULL on error)
+ */
+v4l2_frame_buff_t *dequeue_v4l2_frame(v4l2_dev_t *vd);
+
 #endif
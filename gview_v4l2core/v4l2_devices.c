@@ -24,6 +24,7 @@
 #include <fcntl.h>
 #include <libv4l2.h>
 #include <linux/videodev2.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,9 +35,42 @@
 
 extern int verbosity;
 
+/*device probe threads (besides the calling thread)*/
+#define DEVICE_PROBE_THREADS (3)
+/*device monitor poll timeout (ms): bounds the thread stop time*/
+#define DEVICE_MONITOR_POLL_MS (200)
+/*max device list callbacks*/
+#define DEVICE_MAX_CALLBACKS (8)
+
 /* device list structure */
 static v4l2_device_list_t my_device_list;
 
+/*
+ * device monitor data: the monitor thread owns the udev monitor while
+ *   running and hands updated lists to check_device_list_events
+ */
+static struct {
+  __THREAD_TYPE thread;
+  int running;       // monitor thread running
+  volatile int quit; // request the monitor thread to quit
+
+  v4l2_dev_sys_data_t *base; // initial list (taken by the thread)
+  int num_base;
+
+  __MUTEX_TYPE mutex;           // protects the pending list
+  v4l2_dev_sys_data_t *pending; // updated list (not yet taken)
+  int num_pending;
+  int updated; // pending list is set
+
+  __MUTEX_TYPE cb_mutex; // protects the callbacks
+  struct {
+    v4l2_device_list_cb_t callback;
+    void *data;
+  } callbacks[DEVICE_MAX_CALLBACKS];
+  int num_callbacks;
+} device_monitor = {.mutex = __STATIC_MUTEX_INIT,
+                    .cb_mutex = __STATIC_MUTEX_INIT};
+
 /*
  * get the device list
  * args:
@@ -86,29 +120,364 @@ v4l2_dev_sys_data_t *v4l2core_get_device_sys_data(int index) {
   return &(my_device_list.list_devices[index]);
 }
 
+/*
+ * free a device sys data list
+ * args:
+ *   list - pointer to device sys data list (can be null)
+ *   num - number of devices in list
+ *
+ * asserts:
+ *   none
+ *
+ * returns: void
+ */
+static void free_sys_data_list(v4l2_dev_sys_data_t *list, int num) {
+  if (list == NULL)
+    return;
+
+  int i = 0;
+  for (i = 0; i < num; i++) {
+    free(list[i].device);
+    free(list[i].name);
+    free(list[i].driver);
+    free(list[i].location);
+    free(list[i].serial);
+  }
+  free(list);
+}
+
 /*
  * free v4l2 devices list
  * args:
  *   none
  *
  * asserts:
- *   vd->list_devices is not null
+ *   none
  *
  * returns: void
  */
 static void free_device_list() {
+  free_sys_data_list(my_device_list.list_devices, my_device_list.num_devices);
+  my_device_list.list_devices = NULL;
+  my_device_list.num_devices = 0;
+}
+
+/*
+ * duplicate a string (null safe)
+ * args:
+ *   str - string to duplicate (can be null)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: newly allocated string (null if str is null)
+ */
+static char *dup_string(const char *str) {
+  if (str == NULL)
+    return NULL;
+
+  char *dup = strdup(str);
+  if (dup == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (dup_string): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+  return dup;
+}
+
+/*
+ * copy a device sys data list (deep copy)
+ * args:
+ *   list - pointer to device sys data list
+ *   num - number of devices in list
+ *
+ * asserts:
+ *   none
+ *
+ * returns: newly allocated list (null if num is 0)
+ */
+static v4l2_dev_sys_data_t *copy_sys_data_list(v4l2_dev_sys_data_t *list,
+                                               int num) {
+  if (list == NULL || num <= 0)
+    return NULL;
+
+  v4l2_dev_sys_data_t *copy = calloc(num, sizeof(v4l2_dev_sys_data_t));
+  if (copy == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure "
+            "(copy_sys_data_list): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  int i = 0;
+  for (i = 0; i < num; i++) {
+    copy[i] = list[i];
+    copy[i].device = dup_string(list[i].device);
+    copy[i].name = dup_string(list[i].name);
+    copy[i].driver = dup_string(list[i].driver);
+    copy[i].location = dup_string(list[i].location);
+    copy[i].serial = dup_string(list[i].serial);
+    copy[i].current = 0;
+  }
+  return copy;
+}
+
+/*
+ * fill the device node and usb data (from udev) of a device
+ * args:
+ *   dev - pointer to udev device (video4linux)
+ *   sys - pointer to device sys data to fill (zeroed)
+ *
+ * asserts:
+ *   dev is not null
+ *   sys is not null
+ *
+ * returns: error code (E_NO_DATA if the device has no node)
+ */
+static int get_udev_data(struct udev_device *dev, v4l2_dev_sys_data_t *sys) {
+  /*assertions*/
+  assert(dev != NULL);
+  assert(sys != NULL);
+
+  /* usb_device_get_devnode() returns the path to the device node
+      itself in /dev. */
+  const char *v4l2_device = udev_device_get_devnode(dev);
+  if (v4l2_device == NULL)
+    return E_NO_DATA;
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: Device Node Path: %s\n", v4l2_device);
+
+  sys->device = dup_string(v4l2_device);
+
+  /* The device pointed to by dev contains information about
+      the v4l2 device. In order to get information about the
+      USB device, get the parent device with the
+      subsystem/devtype pair of "usb"/"usb_device". This will
+      be several levels up the tree, but the function will find
+      it (the parent belongs to dev, so it's not unref'ed).*/
+  struct udev_device *parent =
+      udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
+  if (!parent) {
+    fprintf(stderr, "V4L2_CORE: Unable to find parent usb device.\n");
+    return E_OK;
+  }
+
+  /* From here, we can call get_sysattr_value() for each file
+      in the device's /sys entry. The strings passed into these
+      functions (idProduct, idVendor, serial, etc.) correspond
+      directly to the files in the directory which represents
+      the USB device. Note that USB strings are Unicode, UCS2
+      encoded, but the strings returned from
+      udev_device_get_sysattr_value() are UTF-8 encoded. */
+  if (verbosity > 0) {
+    printf("  VID/PID: %s %s\n",
+           udev_device_get_sysattr_value(parent, "idVendor"),
+           udev_device_get_sysattr_value(parent, "idProduct"));
+    printf("  %s\n  %s\n",
+           udev_device_get_sysattr_value(parent, "manufacturer"),
+           udev_device_get_sysattr_value(parent, "product"));
+    printf("  serial: %s\n", udev_device_get_sysattr_value(parent, "serial"));
+    printf("  busnum: %s\n", udev_device_get_sysattr_value(parent, "busnum"));
+    printf("  devnum: %s\n", udev_device_get_sysattr_value(parent, "devnum"));
+  }
+
+  const char *value = udev_device_get_sysattr_value(parent, "idVendor");
+  if (value)
+    sys->vendor = strtoull(value, NULL, 16);
+  value = udev_device_get_sysattr_value(parent, "idProduct");
+  if (value)
+    sys->product = strtoull(value, NULL, 16);
+  value = udev_device_get_sysattr_value(parent, "busnum");
+  if (value)
+    sys->busnum = strtoull(value, NULL, 10);
+  value = udev_device_get_sysattr_value(parent, "devnum");
+  if (value)
+    sys->devnum = strtoull(value, NULL, 10);
+  value = udev_device_get_sysattr_value(parent, "bcdDevice");
+  if (value)
+    sys->bcd_device = strtoul(value, NULL, 16);
+  sys->serial = dup_string(udev_device_get_sysattr_value(parent, "serial"));
+
+  return E_OK;
+}
+
+/*
+ * probe a device node: query the capabilities and check that the
+ *   device has capture formats (device io, can be slow for usb devices)
+ * args:
+ *   sys - pointer to device sys data (with device node)
+ *
+ * asserts:
+ *   sys is not null
+ *   sys->device is not null
+ *
+ * returns: 1 if the node is a video capture device, 0 otherwise
+ */
+static int probe_device_node(v4l2_dev_sys_data_t *sys) {
   /*assertions*/
-  assert(my_device_list.list_devices != NULL);
+  assert(sys != NULL);
+  assert(sys->device != NULL);
+
+  int fd = 0;
+  /* open the device and query the capabilities */
+  if ((fd = v4l2_open(sys->device, O_RDWR | O_NONBLOCK, 0)) < 0) {
+    fprintf(stderr, "V4L2_CORE: ERROR opening V4L2 interface for %s\n",
+            sys->device);
+    return 0;
+  }
 
+  struct v4l2_capability v4l2_cap;
+  memset(&v4l2_cap, 0, sizeof(struct v4l2_capability));
+  if (xioctl(fd, VIDIOC_QUERYCAP, &v4l2_cap) < 0) {
+    fprintf(stderr, "V4L2_CORE: VIDIOC_QUERYCAP error: %s\n",
+            strerror(errno));
+    fprintf(stderr, "V4L2_CORE: couldn't query device %s\n", sys->device);
+    v4l2_close(fd);
+    return 0;
+  }
+
+  uint32_t caps;
+  if (v4l2_cap.capabilities & V4L2_CAP_DEVICE_CAPS) {
+    caps = v4l2_cap.device_caps;
+  } else {
+    caps = v4l2_cap.capabilities;
+  }
+
+  if (!(caps & V4L2_CAP_VIDEO_CAPTURE)) {
+    v4l2_close(fd);
+    return 0;
+  }
+
+  /*uvc metadata and similar nodes may report capture with no formats*/
+  struct v4l2_fmtdesc fmt;
+  memset(&fmt, 0, sizeof(struct v4l2_fmtdesc));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  int has_formats = (xioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0) ? 1 : 0;
+  v4l2_close(fd);
+
+  if (!has_formats) {
+    if (verbosity > 0)
+      printf("V4L2_CORE: %s has no capture formats\n", sys->device);
+    return 0;
+  }
+
+  sys->name = dup_string((char *)v4l2_cap.card);
+  sys->driver = dup_string((char *)v4l2_cap.driver);
+  sys->location = dup_string((char *)v4l2_cap.bus_info);
+  sys->valid = 1;
+  sys->current = 0;
+
+  return 1;
+}
+
+/*
+ * device probe pool data
+ */
+typedef struct _probe_pool_t {
+  v4l2_dev_sys_data_t *list; // devices to probe
+  int *capture;              // probe results (1 - video capture device)
+  int num;                   // number of devices to probe
+  int next;                  // next device to probe
+  __MUTEX_TYPE mutex;        // protects next
+} probe_pool_t;
+
+/*
+ * device probe thread: probes devices from the pool until it's empty
+ * args:
+ *   data - pointer to probe pool
+ *
+ * asserts:
+ *   data is not null
+ *
+ * returns: NULL
+ */
+static void *probe_thread(void *data) {
+  probe_pool_t *pool = (probe_pool_t *)data;
+
+  /*assertions*/
+  assert(pool != NULL);
+
+  while (1) {
+    __LOCK_MUTEX(&pool->mutex);
+    int i = pool->next++;
+    __UNLOCK_MUTEX(&pool->mutex);
+
+    if (i >= pool->num)
+      break;
+
+    pool->capture[i] = probe_device_node(&pool->list[i]);
+  }
+
+  return NULL;
+}
+
+/*
+ * probe a list of device nodes concurrently (on a small thread pool)
+ *   and drop the ones that are not video capture devices
+ * args:
+ *   list - pointer to device sys data list (with device nodes)
+ *   num - number of devices in list
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of video capture devices (compacted at the list start)
+ */
+static int probe_devices(v4l2_dev_sys_data_t *list, int num) {
+  if (list == NULL || num <= 0)
+    return 0;
+
+  probe_pool_t pool;
+  memset(&pool, 0, sizeof(probe_pool_t));
+  pool.list = list;
+  pool.num = num;
+  pool.capture = calloc(num, sizeof(int));
+  if (pool.capture == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (probe_devices): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+  __INIT_MUTEX(&pool.mutex);
+
+  /*the calling thread is also a worker*/
+  __THREAD_TYPE threads[DEVICE_PROBE_THREADS];
+  int nthreads = MIN(num, DEVICE_PROBE_THREADS + 1) - 1;
   int i = 0;
-  for (i = 0; i < (my_device_list.num_devices); i++) {
-    free(my_device_list.list_devices[i].device);
-    free(my_device_list.list_devices[i].name);
-    free(my_device_list.list_devices[i].driver);
-    free(my_device_list.list_devices[i].location);
+  for (i = 0; i < nthreads; i++) {
+    if (__THREAD_CREATE(&threads[i], probe_thread, &pool)) {
+      fprintf(stderr, "V4L2_CORE: (device probe) thread creation failed\n");
+      break;
+    }
   }
-  free(my_device_list.list_devices);
-  my_device_list.list_devices = NULL;
+  nthreads = i;
+
+  probe_thread(&pool);
+
+  for (i = 0; i < nthreads; i++)
+    __THREAD_JOIN(threads[i]);
+
+  __CLOSE_MUTEX(&pool.mutex);
+
+  /*compact the list (keep the enumeration order)*/
+  int n = 0;
+  for (i = 0; i < num; i++) {
+    if (pool.capture[i]) {
+      list[n++] = list[i];
+      continue;
+    }
+    free(list[i].device);
+    free(list[i].name);
+    free(list[i].driver);
+    free(list[i].location);
+    free(list[i].serial);
+  }
+
+  free(pool.capture);
+  return n;
 }
 
 /*
@@ -124,21 +493,16 @@ static void free_device_list() {
  * returns: error code
  */
 int enum_v4l2_devices() {
+  /*assertions*/
+  assert(my_device_list.udev != NULL);
+  assert(my_device_list.list_devices == NULL);
+
   struct udev_enumerate *enumerate;
   struct udev_list_entry *devices;
   struct udev_list_entry *dev_list_entry;
 
   int num_dev = 0;
-  struct v4l2_capability v4l2_cap;
-
-  my_device_list.list_devices = calloc(1, sizeof(v4l2_dev_sys_data_t));
-  if (my_device_list.list_devices == NULL) {
-    fprintf(
-        stderr,
-        "V4L2_CORE: FATAL memory allocation failure (enum_v4l2_devices): %s\n",
-        strerror(errno));
-    exit(-1);
-  }
+  v4l2_dev_sys_data_t *list = NULL;
 
   /* Create a list of the devices in the 'v4l2' subsystem. */
   enumerate = udev_enumerate_new(my_device_list.udev);
@@ -146,124 +510,51 @@ int enum_v4l2_devices() {
   udev_enumerate_scan_devices(enumerate);
   devices = udev_enumerate_get_list_entry(enumerate);
   /*
-   * For each item enumerated, print out its information.
    * udev_list_entry_foreach is a macro which expands to
    * a loop. The loop will be executed for each member in
    * devices, setting dev_list_entry to a list entry
    * which contains the device's path in /sys.
+   * (udev data only: the device nodes are probed afterwards)
    */
   udev_list_entry_foreach(dev_list_entry, devices) {
-    const char *path;
-
     /*
      * Get the filename of the /sys entry for the device
      * and create a udev_device object (dev) representing it
      */
-    path = udev_list_entry_get_name(dev_list_entry);
+    const char *path = udev_list_entry_get_name(dev_list_entry);
     struct udev_device *dev =
         udev_device_new_from_syspath(my_device_list.udev, path);
-
-    /* usb_device_get_devnode() returns the path to the device node
-        itself in /dev. */
-    const char *v4l2_device = udev_device_get_devnode(dev);
-    if (verbosity > 0)
-      printf("V4L2_CORE: Device Node Path: %s\n", v4l2_device);
-
-    int fd = 0;
-    /* open the device and query the capabilities */
-    if ((fd = v4l2_open(v4l2_device, O_RDWR | O_NONBLOCK, 0)) < 0) {
-      fprintf(stderr, "V4L2_CORE: ERROR opening V4L2 interface for %s\n",
-              v4l2_device);
-      v4l2_close(fd);
-      continue; /*next dir entry*/
-    }
-
-    if (xioctl(fd, VIDIOC_QUERYCAP, &v4l2_cap) < 0) {
-      fprintf(stderr, "V4L2_CORE: VIDIOC_QUERYCAP error: %s\n",
-              strerror(errno));
-      fprintf(stderr, "V4L2_CORE: couldn't query device %s\n", v4l2_device);
-      v4l2_close(fd);
-      continue; /*next dir entry*/
-    }
-    v4l2_close(fd);
-
-    uint32_t caps;
-    if (v4l2_cap.capabilities & V4L2_CAP_DEVICE_CAPS) {
-      caps = v4l2_cap.device_caps;
-    } else {
-      caps = v4l2_cap.capabilities;
-    }
-
-    if (!(caps & V4L2_CAP_VIDEO_CAPTURE)) {
+    if (dev == NULL)
       continue;
-    }
 
-    num_dev++;
-    /* Update the device list*/
-    my_device_list.list_devices = realloc(
-        my_device_list.list_devices, num_dev * sizeof(v4l2_dev_sys_data_t));
-    if (my_device_list.list_devices == NULL) {
+    list = realloc(list, (num_dev + 1) * sizeof(v4l2_dev_sys_data_t));
+    if (list == NULL) {
       fprintf(stderr,
               "V4L2_CORE: FATAL memory allocation failure (enum_v4l2_devices): "
               "%s\n",
               strerror(errno));
       exit(-1);
     }
-    my_device_list.list_devices[num_dev - 1].device = strdup(v4l2_device);
-    my_device_list.list_devices[num_dev - 1].name =
-        strdup((char *)v4l2_cap.card);
-    my_device_list.list_devices[num_dev - 1].driver =
-        strdup((char *)v4l2_cap.driver);
-    my_device_list.list_devices[num_dev - 1].location =
-        strdup((char *)v4l2_cap.bus_info);
-    my_device_list.list_devices[num_dev - 1].valid = 1;
-    my_device_list.list_devices[num_dev - 1].current = 0;
-
-    /* The device pointed to by dev contains information about
-        the v4l2 device. In order to get information about the
-        USB device, get the parent device with the
-        subsystem/devtype pair of "usb"/"usb_device". This will
-        be several levels up the tree, but the function will find
-        it.*/
-    dev =
-        udev_device_get_parent_with_subsystem_devtype(dev, "usb", "usb_device");
-    if (!dev) {
-      fprintf(stderr, "V4L2_CORE: Unable to find parent usb device.");
-      continue;
-    }
-
-    /* From here, we can call get_sysattr_value() for each file
-        in the device's /sys entry. The strings passed into these
-        functions (idProduct, idVendor, serial, etc.) correspond
-        directly to the files in the directory which represents
-        the USB device. Note that USB strings are Unicode, UCS2
-        encoded, but the strings returned from
-        udev_device_get_sysattr_value() are UTF-8 encoded. */
-    if (verbosity > 0) {
-      printf("  VID/PID: %s %s\n",
-             udev_device_get_sysattr_value(dev, "idVendor"),
-             udev_device_get_sysattr_value(dev, "idProduct"));
-      printf("  %s\n  %s\n", udev_device_get_sysattr_value(dev, "manufacturer"),
-             udev_device_get_sysattr_value(dev, "product"));
-      printf("  serial: %s\n", udev_device_get_sysattr_value(dev, "serial"));
-      printf("  busnum: %s\n", udev_device_get_sysattr_value(dev, "busnum"));
-      printf("  devnum: %s\n", udev_device_get_sysattr_value(dev, "devnum"));
-    }
+    memset(&list[num_dev], 0, sizeof(v4l2_dev_sys_data_t));
 
-    my_device_list.list_devices[num_dev - 1].vendor =
-        strtoull(udev_device_get_sysattr_value(dev, "idVendor"), NULL, 16);
-    my_device_list.list_devices[num_dev - 1].product =
-        strtoull(udev_device_get_sysattr_value(dev, "idProduct"), NULL, 16);
-    my_device_list.list_devices[num_dev - 1].busnum =
-        strtoull(udev_device_get_sysattr_value(dev, "busnum"), NULL, 10);
-    my_device_list.list_devices[num_dev - 1].devnum =
-        strtoull(udev_device_get_sysattr_value(dev, "devnum"), NULL, 10);
+    if (get_udev_data(dev, &list[num_dev]) == E_OK)
+      num_dev++;
+    else
+      free(list[num_dev].device);
 
     udev_device_unref(dev);
   }
   /* Free the enumerator object */
   udev_enumerate_unref(enumerate);
 
+  /*probe the device nodes (in parallel)*/
+  num_dev = probe_devices(list, num_dev);
+  if (num_dev == 0) {
+    free(list);
+    list = NULL;
+  }
+
+  my_device_list.list_devices = list;
   my_device_list.num_devices = num_dev;
 
   return (E_OK);
@@ -326,76 +617,368 @@ int v4l2core_get_device_index(const char *videodevice) {
 }
 
 /*
- * check for new devices
+ * remove a device from a device sys data list
  * args:
- *   vd - pointer to device data (can be null)
+ *   list - pointer to device sys data list
+ *   num - pointer to number of devices in list
+ *   device - device node
  *
  * asserts:
- *   my_device_list.udev is not null
- *   my_device_list.udev_fd is valid (> 0)
+ *   num is not null
+ *   device is not null
+ *
+ * returns: none
+ */
+static void remove_sys_data(v4l2_dev_sys_data_t *list, int *num,
+                            const char *device) {
+  /*assertions*/
+  assert(num != NULL);
+  assert(device != NULL);
+
+  int i = 0;
+  for (i = 0; i < *num; i++) {
+    if (list[i].device == NULL || strcmp(list[i].device, device) != 0)
+      continue;
+
+    free(list[i].device);
+    free(list[i].name);
+    free(list[i].driver);
+    free(list[i].location);
+    free(list[i].serial);
+    memmove(&list[i], &list[i + 1],
+            (*num - i - 1) * sizeof(v4l2_dev_sys_data_t));
+    (*num)--;
+    return;
+  }
+}
+
+/*
+ * apply the pending udev events to a device sys data list:
+ *   removed nodes are dropped and added (or changed) nodes are
+ *   probed concurrently and appended
+ * args:
+ *   list - pointer to device sys data list pointer
+ *   num - pointer to number of devices in list
+ *   timeout - time to wait for the first event (ms)
+ *
+ * asserts:
+ *   list is not null
+ *   num is not null
  *   my_device_list.udev_mon is not null
  *
- * returns: true(1) if device list was updated, false(0) otherwise
+ * returns: number of processed events
  */
-int check_device_list_events(v4l2_dev_t *vd) {
+static int apply_device_events(v4l2_dev_sys_data_t **list, int *num,
+                               int timeout) {
   /*assertions*/
-  assert(my_device_list.udev != NULL);
-  assert(my_device_list.udev_fd > 0);
+  assert(list != NULL);
+  assert(num != NULL);
   assert(my_device_list.udev_mon != NULL);
 
-  fd_set fds;
-  struct timeval tv;
-  int ret = 0;
+  v4l2_dev_sys_data_t *added = NULL;
+  int num_added = 0;
+  int events = 0;
 
-  FD_ZERO(&fds);
-  FD_SET(my_device_list.udev_fd, &fds);
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
+  struct pollfd pfd;
+  pfd.fd = my_device_list.udev_fd;
+  pfd.events = POLLIN;
 
-  ret = select(my_device_list.udev_fd + 1, &fds, NULL, NULL, &tv);
-
-  /* Check if our file descriptor has received data. */
-  if (ret > 0 && FD_ISSET(my_device_list.udev_fd, &fds)) {
+  /*drain all the queued events (nodes of a device come together)*/
+  while (poll(&pfd, 1, events ? 0 : timeout) > 0 &&
+         (pfd.revents & POLLIN)) {
     /*
      * Make the call to receive the device.
-     *   select() ensured that this will not block.
+     *   poll() ensured that this will not block.
      */
     struct udev_device *dev =
         udev_monitor_receive_device(my_device_list.udev_mon);
-    if (dev) {
-      if (verbosity > 0) {
-        printf("V4L2_CORE: Got Device event\n");
-        printf("          Node: %s\n", udev_device_get_devnode(dev));
-        printf("     Subsystem: %s\n", udev_device_get_subsystem(dev));
-        printf("       Devtype: %s\n", udev_device_get_devtype(dev));
-        printf("        Action: %s\n", udev_device_get_action(dev));
-      }
+    if (!dev) {
+      fprintf(
+          stderr,
+          "V4L2_CORE: No Device from receive_device(). An error occured.\n");
+      break;
+    }
 
-      /*update device list*/
-      if (my_device_list.list_devices != NULL)
-        free_device_list();
-      enum_v4l2_devices();
+    events++;
 
-      /*update the current device index*/
-      if (vd) {
-        vd->this_device = v4l2core_get_device_index(vd->videodevice);
-        if (vd->this_device < 0)
-          vd->this_device = 0;
+    const char *action = udev_device_get_action(dev);
+    const char *node = udev_device_get_devnode(dev);
 
-        if (my_device_list.list_devices)
-          my_device_list.list_devices[vd->this_device].current = 1;
-      }
+    if (verbosity > 0) {
+      printf("V4L2_CORE: Got Device event\n");
+      printf("          Node: %s\n", node);
+      printf("     Subsystem: %s\n", udev_device_get_subsystem(dev));
+      printf("       Devtype: %s\n", udev_device_get_devtype(dev));
+      printf("        Action: %s\n", action);
+    }
 
+    if (node == NULL || action == NULL) {
       udev_device_unref(dev);
+      continue;
+    }
 
-      return (1);
-    } else
-      fprintf(
-          stderr,
-          "V4L2_CORE: No Device from receive_device(). An error occured.\n");
+    /*the node is removed or re-probed*/
+    remove_sys_data(*list, num, node);
+    remove_sys_data(added, &num_added, node);
+
+    if (strcmp(action, "remove") != 0) {
+      added = realloc(added, (num_added + 1) * sizeof(v4l2_dev_sys_data_t));
+      if (added == NULL) {
+        fprintf(stderr,
+                "V4L2_CORE: FATAL memory allocation failure "
+                "(apply_device_events): %s\n",
+                strerror(errno));
+        exit(-1);
+      }
+      memset(&added[num_added], 0, sizeof(v4l2_dev_sys_data_t));
+      if (get_udev_data(dev, &added[num_added]) == E_OK)
+        num_added++;
+      else
+        free(added[num_added].device);
+    }
+
+    udev_device_unref(dev);
+  }
+
+  num_added = probe_devices(added, num_added);
+
+  if (num_added > 0) {
+    *list = realloc(*list, (*num + num_added) * sizeof(v4l2_dev_sys_data_t));
+    if (*list == NULL) {
+      fprintf(stderr,
+              "V4L2_CORE: FATAL memory allocation failure "
+              "(apply_device_events): %s\n",
+              strerror(errno));
+      exit(-1);
+    }
+    memcpy(&(*list)[*num], added, num_added * sizeof(v4l2_dev_sys_data_t));
+    *num += num_added;
+  }
+
+  free(added);
+  return events;
+}
+
+/*
+ * device monitor thread: keeps an updated copy of the device list
+ *   and notifies the subscribers when it changes
+ * args:
+ *   data - not used
+ *
+ * asserts:
+ *   none
+ *
+ * returns: NULL
+ */
+static void *device_monitor_thread(void *data) {
+  (void)data;
+
+  /*working copy of the device list (owned by this thread)*/
+  v4l2_dev_sys_data_t *list = device_monitor.base;
+  int num = device_monitor.num_base;
+  device_monitor.base = NULL;
+  device_monitor.num_base = 0;
+
+  while (!device_monitor.quit) {
+    if (apply_device_events(&list, &num, DEVICE_MONITOR_POLL_MS) <= 0)
+      continue;
+
+    /*publish the updated list*/
+    v4l2_dev_sys_data_t *update = copy_sys_data_list(list, num);
+
+    __LOCK_MUTEX(&device_monitor.mutex);
+    free_sys_data_list(device_monitor.pending, device_monitor.num_pending);
+    device_monitor.pending = update;
+    device_monitor.num_pending = num;
+    device_monitor.updated = 1;
+    __UNLOCK_MUTEX(&device_monitor.mutex);
+
+    /*notify the subscribers*/
+    __LOCK_MUTEX(&device_monitor.cb_mutex);
+    int i = 0;
+    for (i = 0; i < device_monitor.num_callbacks; i++)
+      device_monitor.callbacks[i].callback(device_monitor.callbacks[i].data);
+    __UNLOCK_MUTEX(&device_monitor.cb_mutex);
+  }
+
+  free_sys_data_list(list, num);
+  return NULL;
+}
+
+/*
+ * start the device monitor thread
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code
+ */
+static int start_device_monitor() {
+  if (device_monitor.running)
+    return E_OK;
+
+  if (my_device_list.udev == NULL || my_device_list.udev_mon == NULL)
+    return E_DEVICE_ERR;
+
+  /*the thread starts from a copy of the current list*/
+  device_monitor.num_base = my_device_list.num_devices;
+  device_monitor.base = copy_sys_data_list(my_device_list.list_devices,
+                                           my_device_list.num_devices);
+
+  device_monitor.quit = 0;
+  if (__THREAD_CREATE(&device_monitor.thread, device_monitor_thread, NULL)) {
+    fprintf(stderr, "V4L2_CORE: (device monitor) thread creation failed\n");
+    free_sys_data_list(device_monitor.base, device_monitor.num_base);
+    device_monitor.base = NULL;
+    device_monitor.num_base = 0;
+    return E_DEVICE_ERR;
+  }
+
+  device_monitor.running = 1;
+  return E_OK;
+}
+
+/*
+ * stop the device monitor thread
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void stop_device_monitor() {
+  if (!device_monitor.running)
+    return;
+
+  device_monitor.quit = 1;
+  __THREAD_JOIN(device_monitor.thread);
+  device_monitor.running = 0;
+
+  free_sys_data_list(device_monitor.pending, device_monitor.num_pending);
+  device_monitor.pending = NULL;
+  device_monitor.num_pending = 0;
+  device_monitor.updated = 0;
+}
+
+/*
+ * add a device list callback: called (from the device monitor thread)
+ *   when the device list changes; the first callback starts the monitor
+ * args:
+ *   callback - callback function
+ *   data - callback user data
+ *
+ * asserts:
+ *   callback is not null
+ *
+ * returns: error code
+ */
+int v4l2core_add_device_list_callback(v4l2_device_list_cb_t callback,
+                                      void *data) {
+  /*assertions*/
+  assert(callback != NULL);
+
+  __LOCK_MUTEX(&device_monitor.cb_mutex);
+  if (device_monitor.num_callbacks >= DEVICE_MAX_CALLBACKS) {
+    __UNLOCK_MUTEX(&device_monitor.cb_mutex);
+    fprintf(stderr, "V4L2_CORE: too many device list callbacks (max %i)\n",
+            DEVICE_MAX_CALLBACKS);
+    return E_ALLOC_ERR;
+  }
+  device_monitor.callbacks[device_monitor.num_callbacks].callback = callback;
+  device_monitor.callbacks[device_monitor.num_callbacks].data = data;
+  device_monitor.num_callbacks++;
+  __UNLOCK_MUTEX(&device_monitor.cb_mutex);
+
+  return start_device_monitor();
+}
+
+/*
+ * remove a device list callback
+ *   (no calls to it are made after this returns)
+ * args:
+ *   callback - callback function
+ *   data - callback user data
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+void v4l2core_remove_device_list_callback(v4l2_device_list_cb_t callback,
+                                          void *data) {
+  __LOCK_MUTEX(&device_monitor.cb_mutex);
+  int i = 0;
+  for (i = 0; i < device_monitor.num_callbacks; i++) {
+    if (device_monitor.callbacks[i].callback != callback ||
+        device_monitor.callbacks[i].data != data)
+      continue;
+
+    memmove(&device_monitor.callbacks[i], &device_monitor.callbacks[i + 1],
+            (device_monitor.num_callbacks - i - 1) *
+                sizeof(device_monitor.callbacks[0]));
+    device_monitor.num_callbacks--;
+    break;
+  }
+  __UNLOCK_MUTEX(&device_monitor.cb_mutex);
+}
+
+/*
+ * check for new devices
+ *   with the device monitor running this only takes its updated list
+ *   (no device io), otherwise the udev events are processed here
+ * args:
+ *   vd - pointer to device data (can be null)
+ *
+ * asserts:
+ *   my_device_list.udev is not null
+ *   my_device_list.udev_fd is valid (> 0)
+ *   my_device_list.udev_mon is not null
+ *
+ * returns: true(1) if device list was updated, false(0) otherwise
+ */
+int check_device_list_events(v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(my_device_list.udev != NULL);
+  assert(my_device_list.udev_fd > 0);
+  assert(my_device_list.udev_mon != NULL);
+
+  if (device_monitor.running) {
+    __LOCK_MUTEX(&device_monitor.mutex);
+    if (!device_monitor.updated) {
+      __UNLOCK_MUTEX(&device_monitor.mutex);
+      return (0);
+    }
+    v4l2_dev_sys_data_t *list = device_monitor.pending;
+    int num = device_monitor.num_pending;
+    device_monitor.pending = NULL;
+    device_monitor.num_pending = 0;
+    device_monitor.updated = 0;
+    __UNLOCK_MUTEX(&device_monitor.mutex);
+
+    free_device_list();
+    my_device_list.list_devices = list;
+    my_device_list.num_devices = num;
+  } else {
+    if (apply_device_events(&my_device_list.list_devices,
+                            &my_device_list.num_devices, 0) <= 0)
+      return (0);
   }
 
-  return (0);
+  if (my_device_list.num_devices == 0) {
+    free(my_device_list.list_devices);
+    my_device_list.list_devices = NULL;
+  }
+
+  /*update the current device index*/
+  if (vd && my_device_list.list_devices &&
+      v4l2core_get_this_device_index(vd) >= 0)
+    my_device_list.list_devices[vd->this_device].current = 1;
+
+  return (1);
 }
 
 /*
@@ -404,11 +987,13 @@ int check_device_list_events(v4l2_dev_t *vd) {
  *   none
  *
  * asserts:
- *   vd->list_devices is not null
+ *   none
  *
  * returns: void
  */
 void v4l2core_close_v4l2_device_list() {
+  stop_device_monitor();
+
   free_device_list();
 
   if (my_device_list.udev)
@@ -193,21 +193,31 @@ uint8_t get_guid_unit_id(v4l2_dev_t *vd, uint8_t *guid) {
   assert(vd != NULL);
   assert(my_device_list->list_devices != NULL);
 
-  if (my_device_list->list_devices[vd->this_device].vendor != 0x046D) {
+  /*the list may have changed since the device was opened*/
+  int index = v4l2core_get_this_device_index(vd);
+  if (index < 0) {
+    if (verbosity > 2)
+      printf("V4L2_CORE: device %s not in device list: skiping "
+             "peripheral V3 unit id check\n",
+             vd->videodevice);
+    return 0;
+  }
+
+  if (my_device_list->list_devices[index].vendor != 0x046D) {
     if (verbosity > 2)
       printf("V4L2_CORE: not a logitech device (vendor_id=0x%4x): skiping "
              "peripheral V3 unit id check\n",
-             my_device_list->list_devices[vd->this_device].vendor);
+             my_device_list->list_devices[index].vendor);
     return 0;
   }
 
-  uint64_t busnum = my_device_list->list_devices[vd->this_device].busnum;
-  uint64_t devnum = my_device_list->list_devices[vd->this_device].devnum;
+  uint64_t busnum = my_device_list->list_devices[index].busnum;
+  uint64_t devnum = my_device_list->list_devices[index].devnum;
 
   if (verbosity > 2)
     printf("V4L2_CORE: checking pan/tilt unit id for device %i (bus:%" PRId64
            " dev:%" PRId64 ")\n",
-           vd->this_device, busnum, devnum);
+           index, busnum, devnum);
   /* use libusb */
   libusb_context *usb_ctx = NULL;
   libusb_device **device_list = NULL;
@@ -0,0 +1,1240 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/******************************************************************************#
+#                                                                              #
+#  virtual capture devices: replay of recorded raw streams (no hardware)       #
+#                                                                              #
+*******************************************************************************/
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "core_time.h"
+#include "neoguvc.h"
+#include "neoguvc_v4l2core.h"
+#include "v4l2_core.h"
+#include "virtual_device.h"
+
+#define VDEV_MAX_DEVICES (8)
+#define VDEV_MAX_BUFFERS (32)
+
+extern int verbosity;
+
+/*emulated controls (values are kept but don't change the replayed frames)*/
+typedef struct _vdev_control_t {
+  uint32_t id;
+  uint32_t type;
+  const char *name;
+  int32_t minimum;
+  int32_t maximum;
+  int32_t step;
+  int32_t default_value;
+} vdev_control_t;
+
+static const vdev_control_t vdev_controls[] = {
+    {V4L2_CID_BRIGHTNESS, V4L2_CTRL_TYPE_INTEGER, "Brightness", -64, 64, 1, 0},
+    {V4L2_CID_CONTRAST, V4L2_CTRL_TYPE_INTEGER, "Contrast", 0, 95, 1, 32},
+    {V4L2_CID_SATURATION, V4L2_CTRL_TYPE_INTEGER, "Saturation", 0, 100, 1, 64},
+    {V4L2_CID_POWER_LINE_FREQUENCY, V4L2_CTRL_TYPE_MENU,
+     "Power Line Frequency", 0, 2, 1, 1},
+};
+
+#define VDEV_NCONTROLS (int)ARRAY_LENGTH(vdev_controls)
+
+static const char *power_line_menu[] = {"Disabled", "50 Hz", "60 Hz"};
+
+typedef struct _vdev_buffer_t {
+  uint8_t *mem;          // mmap buffer (V4L2_MEMORY_MMAP)
+  unsigned long userptr; // user buffer (V4L2_MEMORY_USERPTR)
+  uint32_t length;       // user buffer length
+  int queued;            // buffer is queued
+} vdev_buffer_t;
+
+typedef struct _virtual_dev_t {
+  int fd;        // timerfd (readable when the next frame is due)
+  char *name;    // device name
+  int fast;      // replay as fast as possible
+  uint8_t *data; // mapped replay file
+  size_t data_size;
+
+  replay_file_header_t header;
+  int nframes;            // number of frames in file
+  size_t *frame_offset;   // frame data offset (in data)
+  uint32_t sizeimage;     // maximum frame size
+  uint64_t loop_duration; // duration of one pass through the file (ns)
+
+  int memory;   // buffer memory type
+  int nbuffers; // number of requested buffers
+  vdev_buffer_t buffers[VDEV_MAX_BUFFERS];
+  int queue[VDEV_MAX_BUFFERS]; // queued buffers (fifo)
+  int queue_head;
+  int queue_count;
+
+  int streaming;
+  uint64_t start_ts;    // stream start (monotonic ns)
+  uint64_t loop_offset; // time offset of the current pass
+  int next_frame;       // next frame to deliver
+  uint32_t sequence;    // delivered frames
+
+  int32_t control_value[VDEV_NCONTROLS];
+
+  __MUTEX_TYPE mutex;
+} virtual_dev_t;
+
+static virtual_dev_t *vdev_list[VDEV_MAX_DEVICES];
+static int vdev_count = 0;
+static __MUTEX_TYPE vdev_list_mutex = __STATIC_MUTEX_INIT;
+
+/*
+ * gets the frame header of frame n
+ * args:
+ *   vdev - pointer to virtual device
+ *   n - frame number
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to frame header (in the mapped file)
+ */
+static replay_frame_header_t *get_frame_header(virtual_dev_t *vdev, int n) {
+  return (replay_frame_header_t *)(vdev->data + vdev->frame_offset[n] -
+                                   sizeof(replay_frame_header_t));
+}
+
+/*
+ * maps the replay file and indexes its frames
+ * args:
+ *   vdev - pointer to virtual device
+ *   filename - replay file
+ *
+ * asserts:
+ *   none
+ *
+ * returns: error code (E_OK)
+ */
+static int load_replay_file(virtual_dev_t *vdev, const char *filename) {
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "V4L2_CORE: couldn't open replay file %s: %s\n", filename,
+            strerror(errno));
+    return E_FILE_IO_ERR;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 ||
+      (size_t)st.st_size < sizeof(replay_file_header_t)) {
+    fprintf(stderr, "V4L2_CORE: %s is not a replay file\n", filename);
+    close(fd);
+    return E_FILE_IO_ERR;
+  }
+
+  vdev->data_size = st.st_size;
+  vdev->data = mmap(NULL, vdev->data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (vdev->data == MAP_FAILED) {
+    fprintf(stderr, "V4L2_CORE: couldn't map replay file %s: %s\n", filename,
+            strerror(errno));
+    vdev->data = NULL;
+    return E_FILE_IO_ERR;
+  }
+
+  memcpy(&vdev->header, vdev->data, sizeof(replay_file_header_t));
+  if (memcmp(vdev->header.magic, REPLAY_MAGIC, 8) != 0 ||
+      vdev->header.width == 0 || vdev->header.height == 0) {
+    fprintf(stderr, "V4L2_CORE: %s is not a replay file\n", filename);
+    return E_FILE_IO_ERR;
+  }
+
+  if (vdev->header.fps_num == 0 || vdev->header.fps_denom == 0) {
+    vdev->header.fps_num = 1;
+    vdev->header.fps_denom = 30;
+  }
+
+  /*index the frames*/
+  int max_frames = 0;
+  size_t pos = sizeof(replay_file_header_t);
+  while (pos + sizeof(replay_frame_header_t) <= vdev->data_size) {
+    replay_frame_header_t frame;
+    memcpy(&frame, vdev->data + pos, sizeof(replay_frame_header_t));
+    pos += sizeof(replay_frame_header_t);
+
+    if (frame.size == 0 || pos + frame.size > vdev->data_size) {
+      if (verbosity > 0)
+        fprintf(stderr, "V4L2_CORE: replay file truncated at frame %i\n",
+                vdev->nframes);
+      break;
+    }
+
+    if (vdev->nframes >= max_frames) {
+      max_frames = max_frames ? max_frames * 2 : 256;
+      vdev->frame_offset =
+          realloc(vdev->frame_offset, max_frames * sizeof(size_t));
+      if (vdev->frame_offset == NULL) {
+        fprintf(stderr,
+                "V4L2_CORE: FATAL memory allocation failure "
+                "(load_replay_file): %s\n",
+                strerror(errno));
+        exit(-1);
+      }
+    }
+
+    vdev->frame_offset[vdev->nframes] = pos;
+    vdev->nframes++;
+
+    if (frame.size > vdev->sizeimage)
+      vdev->sizeimage = frame.size;
+
+    pos += frame.size;
+  }
+
+  if (vdev->nframes == 0) {
+    fprintf(stderr, "V4L2_CORE: no frames in replay file %s\n", filename);
+    return E_FILE_IO_ERR;
+  }
+
+  /*uncompressed formats: use the full image size*/
+  if (vdev->header.bytesperline > 0 &&
+      vdev->header.bytesperline * vdev->header.height > vdev->sizeimage)
+    vdev->sizeimage = vdev->header.bytesperline * vdev->header.height;
+
+  uint64_t frame_interval =
+      (uint64_t)vdev->header.fps_num * NSEC_PER_SEC / vdev->header.fps_denom;
+  vdev->loop_duration = get_frame_header(vdev, vdev->nframes - 1)->timestamp -
+                        get_frame_header(vdev, 0)->timestamp + frame_interval;
+
+  if (verbosity > 0)
+    printf("V4L2_CORE: replay file %s: %c%c%c%c %ux%u with %i frames\n",
+           filename, vdev->header.pixelformat & 0xFF,
+           (vdev->header.pixelformat >> 8) & 0xFF,
+           (vdev->header.pixelformat >> 16) & 0xFF,
+           (vdev->header.pixelformat >> 24) & 0xFF, vdev->header.width,
+           vdev->header.height, vdev->nframes);
+
+  return E_OK;
+}
+
+/*
+ * gets the (monotonic) time at which the next frame is due
+ * args:
+ *   vdev - pointer to virtual device
+ *
+ * asserts:
+ *   none
+ *
+ * returns: due time in ns
+ */
+static uint64_t get_next_frame_due(virtual_dev_t *vdev) {
+  uint64_t first_ts = get_frame_header(vdev, 0)->timestamp;
+  return vdev->start_ts + vdev->loop_offset +
+         (get_frame_header(vdev, vdev->next_frame)->timestamp - first_ts);
+}
+
+/*
+ * arms the device timer for the next frame (or disarms it if no
+ * frame can be delivered): the fd polls readable when a frame is due
+ * args:
+ *   vdev - pointer to virtual device
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void arm_timer(virtual_dev_t *vdev) {
+  struct itimerspec timer;
+  memset(&timer, 0, sizeof(struct itimerspec));
+
+  /*read i/o (no buffers requested) always has a frame to deliver*/
+  if (vdev->streaming && (vdev->nbuffers == 0 || vdev->queue_count > 0)) {
+    /*an expiration time in the past fires immediately (fast mode)*/
+    uint64_t due = vdev->fast ? 1 : get_next_frame_due(vdev);
+    timer.it_value.tv_sec = due / NSEC_PER_SEC;
+    timer.it_value.tv_nsec = due % NSEC_PER_SEC;
+  }
+
+  timerfd_settime(vdev->fd, TFD_TIMER_ABSTIME, &timer, NULL);
+}
+
+/*
+ * gets the virtual device for fd
+ * args:
+ *   fd - file descriptor
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to virtual device (NULL if none)
+ */
+static virtual_dev_t *get_vdev(int fd) {
+  virtual_dev_t *vdev = NULL;
+
+  __LOCK_MUTEX(&vdev_list_mutex);
+  int i = 0;
+  for (i = 0; i < VDEV_MAX_DEVICES; i++) {
+    if (vdev_list[i] && vdev_list[i]->fd == fd) {
+      vdev = vdev_list[i];
+      break;
+    }
+  }
+  __UNLOCK_MUTEX(&vdev_list_mutex);
+
+  return vdev;
+}
+
+/*
+ * frees the virtual device data
+ * args:
+ *   vdev - pointer to virtual device
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void free_vdev(virtual_dev_t *vdev) {
+  int i = 0;
+  for (i = 0; i < VDEV_MAX_BUFFERS; i++)
+    free(vdev->buffers[i].mem);
+
+  if (vdev->data)
+    munmap(vdev->data, vdev->data_size);
+  if (vdev->fd >= 0)
+    close(vdev->fd);
+
+  __CLOSE_MUTEX(&vdev->mutex);
+  free(vdev->frame_offset);
+  free(vdev->name);
+  free(vdev);
+}
+
+/*
+ * checks for a virtual device name
+ *   (V4L2_REPLAY_PREFIX or V4L2_REPLAY_FAST_PREFIX followed by a file)
+ * args:
+ *   device - device name
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if device names a virtual device, 0 otherwise
+ */
+int vdev_is_virtual_name(const char *device) {
+  if (device == NULL)
+    return 0;
+
+  return (strncmp(device, V4L2_REPLAY_PREFIX, strlen(V4L2_REPLAY_PREFIX)) ==
+              0 ||
+          strncmp(device, V4L2_REPLAY_FAST_PREFIX,
+                  strlen(V4L2_REPLAY_FAST_PREFIX)) == 0);
+}
+
+/*
+ * opens a virtual (replay file backed) device
+ * args:
+ *   device - device name (see vdev_is_virtual_name)
+ *
+ * asserts:
+ *   device is not null
+ *
+ * returns: device file descriptor (pollable, -1 on error)
+ */
+int vdev_open(const char *device) {
+  /*assertions*/
+  assert(device != NULL);
+
+  if (!vdev_is_virtual_name(device)) {
+    errno = ENODEV;
+    return -1;
+  }
+
+  virtual_dev_t *vdev = calloc(1, sizeof(virtual_dev_t));
+  if (vdev == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure (vdev_open): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  __INIT_MUTEX(&vdev->mutex);
+  vdev->name = strdup(device);
+
+  const char *filename = device;
+  if (strncmp(device, V4L2_REPLAY_FAST_PREFIX,
+              strlen(V4L2_REPLAY_FAST_PREFIX)) == 0) {
+    vdev->fast = 1;
+    filename += strlen(V4L2_REPLAY_FAST_PREFIX);
+  } else
+    filename += strlen(V4L2_REPLAY_PREFIX);
+
+  vdev->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (vdev->fd < 0) {
+    fprintf(stderr, "V4L2_CORE: (vdev_open) timerfd_create failed: %s\n",
+            strerror(errno));
+    free_vdev(vdev);
+    errno = ENODEV;
+    return -1;
+  }
+
+  if (load_replay_file(vdev, filename) != E_OK) {
+    free_vdev(vdev);
+    errno = ENODEV;
+    return -1;
+  }
+
+  int i = 0;
+  for (i = 0; i < VDEV_NCONTROLS; i++)
+    vdev->control_value[i] = vdev_controls[i].default_value;
+
+  __LOCK_MUTEX(&vdev_list_mutex);
+  for (i = 0; i < VDEV_MAX_DEVICES; i++) {
+    if (vdev_list[i] == NULL) {
+      vdev_list[i] = vdev;
+      __atomic_add_fetch(&vdev_count, 1, __ATOMIC_RELEASE);
+      break;
+    }
+  }
+  __UNLOCK_MUTEX(&vdev_list_mutex);
+
+  if (i >= VDEV_MAX_DEVICES) {
+    fprintf(stderr, "V4L2_CORE: too many virtual devices open (max %i)\n",
+            VDEV_MAX_DEVICES);
+    free_vdev(vdev);
+    errno = EMFILE;
+    return -1;
+  }
+
+  return vdev->fd;
+}
+
+/*
+ * checks if fd belongs to a virtual device
+ * args:
+ *   fd - file descriptor
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 for a virtual device, 0 otherwise
+ */
+int vdev_is_virtual(int fd) {
+  /*fast path for real devices*/
+  if (__atomic_load_n(&vdev_count, __ATOMIC_ACQUIRE) == 0)
+    return 0;
+
+  return (get_vdev(fd) != NULL);
+}
+
+/*
+ * closes a virtual device
+ * args:
+ *   fd - virtual device file descriptor
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+int vdev_close(int fd) {
+  virtual_dev_t *vdev = NULL;
+
+  __LOCK_MUTEX(&vdev_list_mutex);
+  int i = 0;
+  for (i = 0; i < VDEV_MAX_DEVICES; i++) {
+    if (vdev_list[i] && vdev_list[i]->fd == fd) {
+      vdev = vdev_list[i];
+      vdev_list[i] = NULL;
+      __atomic_sub_fetch(&vdev_count, 1, __ATOMIC_RELEASE);
+      break;
+    }
+  }
+  __UNLOCK_MUTEX(&vdev_list_mutex);
+
+  if (vdev == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+
+  free_vdev(vdev);
+  return 0;
+}
+
+/*
+ * fills the v4l2 pixel format from the replay file
+ * args:
+ *   vdev - pointer to virtual device
+ *   pix - pointer to v4l2 pixel format
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void fill_pix_format(virtual_dev_t *vdev, struct v4l2_pix_format *pix) {
+  memset(pix, 0, sizeof(struct v4l2_pix_format));
+  pix->width = vdev->header.width;
+  pix->height = vdev->header.height;
+  pix->pixelformat = vdev->header.pixelformat;
+  pix->field = V4L2_FIELD_NONE;
+  pix->bytesperline = vdev->header.bytesperline;
+  pix->sizeimage = vdev->sizeimage;
+  pix->colorspace = V4L2_COLORSPACE_SRGB;
+}
+
+/*
+ * finds an emulated control
+ * args:
+ *   id - control id
+ *   next - find the first control with an id higher than id
+ *
+ * asserts:
+ *   none
+ *
+ * returns: control index (-1 if not found)
+ */
+static int find_control(uint32_t id, int next) {
+  int found = -1;
+  int i = 0;
+  for (i = 0; i < VDEV_NCONTROLS; i++) {
+    if (!next && vdev_controls[i].id == id)
+      return i;
+    if (next && vdev_controls[i].id > id &&
+        (found < 0 || vdev_controls[i].id < vdev_controls[found].id))
+      found = i;
+  }
+  return found;
+}
+
+/*
+ * emulates VIDIOC_G/S/TRY_EXT_CTRLS
+ * args:
+ *   vdev - pointer to virtual device
+ *   ctrls - pointer to v4l2 ext controls
+ *   set - 0: get, 1: try, 2: set
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error (with errno set)
+ */
+static int do_ext_ctrls(virtual_dev_t *vdev, struct v4l2_ext_controls *ctrls,
+                        int set) {
+  uint32_t i = 0;
+  for (i = 0; i < ctrls->count; i++) {
+    int n = find_control(ctrls->controls[i].id, 0);
+    if (n < 0) {
+      ctrls->error_idx = set ? i : ctrls->count;
+      errno = EINVAL;
+      return -1;
+    }
+
+    if (!set) {
+      ctrls->controls[i].value = vdev->control_value[n];
+      continue;
+    }
+
+    int32_t value = ctrls->controls[i].value;
+    if (value < vdev_controls[n].minimum || value > vdev_controls[n].maximum) {
+      ctrls->error_idx = i;
+      errno = ERANGE;
+      return -1;
+    }
+  }
+
+  /*set only after all values are validated (atomic)*/
+  if (set == 2) {
+    for (i = 0; i < ctrls->count; i++)
+      vdev->control_value[find_control(ctrls->controls[i].id, 0)] =
+          ctrls->controls[i].value;
+  }
+
+  return 0;
+}
+
+/*
+ * copies the next frame to buffer and advances the replay position
+ * args:
+ *   vdev - pointer to virtual device
+ *   buffer - pointer to buffer
+ *   length - buffer length
+ *   timestamp - pointer to frame timestamp (set by the function)
+ *   flags - pointer to frame flags (set by the function)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: frame size (bytes)
+ */
+static uint32_t deliver_frame(virtual_dev_t *vdev, uint8_t *buffer,
+                              size_t length, uint64_t *timestamp,
+                              uint32_t *flags) {
+  replay_frame_header_t *frame = get_frame_header(vdev, vdev->next_frame);
+
+  uint32_t size = frame->size;
+  if (size > length)
+    size = length;
+  memcpy(buffer, vdev->data + vdev->frame_offset[vdev->next_frame], size);
+
+  /*recorded timestamp, relative to the stream start*/
+  *timestamp = vdev->start_ts + vdev->loop_offset +
+               (frame->timestamp - get_frame_header(vdev, 0)->timestamp);
+  *flags = frame->flags;
+
+  vdev->sequence++;
+  vdev->next_frame++;
+  if (vdev->next_frame >= vdev->nframes) {
+    /*loop back to the first frame*/
+    vdev->next_frame = 0;
+    vdev->loop_offset += vdev->loop_duration;
+  }
+
+  return size;
+}
+
+/*
+ * checks if the next frame can be delivered
+ * args:
+ *   vdev - pointer to virtual device
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if the next frame is due, 0 otherwise
+ */
+static int frame_due(virtual_dev_t *vdev) {
+  return (vdev->fast || ns_time_monotonic() >= get_next_frame_due(vdev));
+}
+
+/*
+ * emulates VIDIOC_DQBUF
+ * args:
+ *   vdev - pointer to virtual device
+ *   buf - pointer to v4l2 buffer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error (with errno set)
+ */
+static int do_dqbuf(virtual_dev_t *vdev, struct v4l2_buffer *buf) {
+  if (!vdev->streaming || (int)buf->memory != vdev->memory) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (vdev->queue_count == 0 || !frame_due(vdev)) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  int index = vdev->queue[vdev->queue_head];
+  vdev->queue_head = (vdev->queue_head + 1) % VDEV_MAX_BUFFERS;
+  vdev->queue_count--;
+
+  vdev_buffer_t *vbuf = &vdev->buffers[index];
+  vbuf->queued = 0;
+
+  uint8_t *dst = vbuf->mem;
+  size_t length = vdev->sizeimage;
+  if (vdev->memory == V4L2_MEMORY_USERPTR) {
+    dst = (uint8_t *)vbuf->userptr;
+    length = vbuf->length;
+  }
+
+  uint64_t timestamp = 0;
+  uint32_t flags = 0;
+
+  memset(buf, 0, sizeof(struct v4l2_buffer));
+  buf->index = index;
+  buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf->memory = vdev->memory;
+  buf->bytesused = deliver_frame(vdev, dst, length, &timestamp, &flags);
+  buf->sequence = vdev->sequence - 1;
+  buf->field = V4L2_FIELD_NONE;
+  buf->flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC | V4L2_BUF_FLAG_DONE;
+  if (flags & REPLAY_FRAME_KEYFRAME)
+    buf->flags |= V4L2_BUF_FLAG_KEYFRAME;
+  buf->timestamp.tv_sec = timestamp / NSEC_PER_SEC;
+  buf->timestamp.tv_usec = (timestamp % NSEC_PER_SEC) / 1000;
+  if (vdev->memory == V4L2_MEMORY_USERPTR) {
+    buf->m.userptr = vbuf->userptr;
+    buf->length = vbuf->length;
+  } else {
+    buf->m.offset = index * vdev->sizeimage;
+    buf->length = vdev->sizeimage;
+  }
+
+  arm_timer(vdev);
+
+  return 0;
+}
+
+/*
+ * emulates VIDIOC_QBUF
+ * args:
+ *   vdev - pointer to virtual device
+ *   buf - pointer to v4l2 buffer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error (with errno set)
+ */
+static int do_qbuf(virtual_dev_t *vdev, struct v4l2_buffer *buf) {
+  if (buf->index >= (uint32_t)vdev->nbuffers ||
+      (int)buf->memory != vdev->memory || vdev->buffers[buf->index].queued) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  vdev_buffer_t *vbuf = &vdev->buffers[buf->index];
+  if (vdev->memory == V4L2_MEMORY_USERPTR) {
+    if (buf->m.userptr == 0 || buf->length < vdev->sizeimage) {
+      errno = EINVAL;
+      return -1;
+    }
+    vbuf->userptr = buf->m.userptr;
+    vbuf->length = buf->length;
+  }
+
+  vbuf->queued = 1;
+  vdev->queue[(vdev->queue_head + vdev->queue_count) % VDEV_MAX_BUFFERS] =
+      buf->index;
+  vdev->queue_count++;
+
+  arm_timer(vdev);
+
+  return 0;
+}
+
+/*
+ * emulates VIDIOC_REQBUFS
+ * args:
+ *   vdev - pointer to virtual device
+ *   rb - pointer to v4l2 request buffers
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error (with errno set)
+ */
+static int do_reqbufs(virtual_dev_t *vdev, struct v4l2_requestbuffers *rb) {
+  if (rb->memory != V4L2_MEMORY_MMAP && rb->memory != V4L2_MEMORY_USERPTR) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (vdev->streaming) {
+    errno = EBUSY;
+    return -1;
+  }
+
+  int i = 0;
+  for (i = 0; i < VDEV_MAX_BUFFERS; i++) {
+    free(vdev->buffers[i].mem);
+    memset(&vdev->buffers[i], 0, sizeof(vdev_buffer_t));
+  }
+  vdev->queue_head = 0;
+  vdev->queue_count = 0;
+
+  if (rb->count > VDEV_MAX_BUFFERS)
+    rb->count = VDEV_MAX_BUFFERS;
+  vdev->nbuffers = rb->count;
+  vdev->memory = rb->memory;
+
+  if (vdev->memory == V4L2_MEMORY_MMAP) {
+    for (i = 0; i < vdev->nbuffers; i++) {
+      vdev->buffers[i].mem = calloc(vdev->sizeimage, sizeof(uint8_t));
+      if (vdev->buffers[i].mem == NULL) {
+        fprintf(stderr,
+                "V4L2_CORE: FATAL memory allocation failure "
+                "(vdev REQBUFS): %s\n",
+                strerror(errno));
+        exit(-1);
+      }
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * emulates a v4l2 ioctl on a virtual device
+ * args:
+ *   fd - virtual device file descriptor
+ *   request - ioctl request
+ *   arg - pointer to ioctl data
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error (with errno set)
+ */
+int vdev_ioctl(int fd, unsigned long request, void *arg) {
+  virtual_dev_t *vdev = get_vdev(fd);
+  if (vdev == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+
+  int ret = 0;
+
+  __LOCK_MUTEX(&vdev->mutex);
+
+  switch (request) {
+  case VIDIOC_QUERYCAP: {
+    struct v4l2_capability *cap = arg;
+    memset(cap, 0, sizeof(struct v4l2_capability));
+    strncpy((char *)cap->driver, "neoguvc-replay", sizeof(cap->driver) - 1);
+    snprintf((char *)cap->card, sizeof(cap->card), "Replay: %s",
+             strchr(vdev->name, ':') + 1);
+    strncpy((char *)cap->bus_info, "virtual", sizeof(cap->bus_info) - 1);
+    cap->version = 0x050000;
+    cap->device_caps =
+        V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING | V4L2_CAP_READWRITE;
+    cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+    break;
+  }
+
+  case VIDIOC_ENUM_FMT: {
+    struct v4l2_fmtdesc *fmtdesc = arg;
+    if (fmtdesc->index > 0) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    fmtdesc->flags =
+        (vdev->header.bytesperline == 0) ? V4L2_FMT_FLAG_COMPRESSED : 0;
+    fmtdesc->pixelformat = vdev->header.pixelformat;
+    snprintf((char *)fmtdesc->description, sizeof(fmtdesc->description),
+             "Replay %c%c%c%c", vdev->header.pixelformat & 0xFF,
+             (vdev->header.pixelformat >> 8) & 0xFF,
+             (vdev->header.pixelformat >> 16) & 0xFF,
+             (vdev->header.pixelformat >> 24) & 0xFF);
+    break;
+  }
+
+  case VIDIOC_ENUM_FRAMESIZES: {
+    struct v4l2_frmsizeenum *fsize = arg;
+    if (fsize->index > 0 || fsize->pixel_format != vdev->header.pixelformat) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    fsize->type = V4L2_FRMSIZE_TYPE_DISCRETE;
+    fsize->discrete.width = vdev->header.width;
+    fsize->discrete.height = vdev->header.height;
+    break;
+  }
+
+  case VIDIOC_ENUM_FRAMEINTERVALS: {
+    struct v4l2_frmivalenum *fival = arg;
+    if (fival->index > 0 || fival->pixel_format != vdev->header.pixelformat ||
+        fival->width != vdev->header.width ||
+        fival->height != vdev->header.height) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    fival->type = V4L2_FRMIVAL_TYPE_DISCRETE;
+    fival->discrete.numerator = vdev->header.fps_num;
+    fival->discrete.denominator = vdev->header.fps_denom;
+    break;
+  }
+
+  case VIDIOC_G_FMT:
+  case VIDIOC_S_FMT:
+  case VIDIOC_TRY_FMT: {
+    /*only the recorded format is available*/
+    struct v4l2_format *fmt = arg;
+    if (fmt->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    if (request == VIDIOC_S_FMT && vdev->nbuffers > 0) {
+      errno = EBUSY;
+      ret = -1;
+      break;
+    }
+    fill_pix_format(vdev, &fmt->fmt.pix);
+    break;
+  }
+
+  case VIDIOC_G_PARM:
+  case VIDIOC_S_PARM: {
+    /*the replay rate is the recorded rate*/
+    struct v4l2_streamparm *parm = arg;
+    if (parm->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    memset(&parm->parm.capture, 0, sizeof(parm->parm.capture));
+    parm->parm.capture.capability = V4L2_CAP_TIMEPERFRAME;
+    parm->parm.capture.timeperframe.numerator = vdev->header.fps_num;
+    parm->parm.capture.timeperframe.denominator = vdev->header.fps_denom;
+    parm->parm.capture.readbuffers = 2;
+    break;
+  }
+
+  case VIDIOC_REQBUFS:
+    ret = do_reqbufs(vdev, arg);
+    break;
+
+  case VIDIOC_QUERYBUF: {
+    struct v4l2_buffer *buf = arg;
+    if (buf->index >= (uint32_t)vdev->nbuffers) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    buf->memory = vdev->memory;
+    buf->length = vdev->sizeimage;
+    buf->m.offset = buf->index * vdev->sizeimage;
+    buf->flags = vdev->buffers[buf->index].queued ? V4L2_BUF_FLAG_QUEUED : 0;
+    break;
+  }
+
+  case VIDIOC_QBUF:
+    ret = do_qbuf(vdev, arg);
+    break;
+
+  case VIDIOC_DQBUF:
+    ret = do_dqbuf(vdev, arg);
+    break;
+
+  case VIDIOC_STREAMON:
+    if (!vdev->streaming) {
+      vdev->streaming = 1;
+      vdev->start_ts = ns_time_monotonic();
+      vdev->loop_offset = 0;
+      vdev->next_frame = 0;
+      vdev->sequence = 0;
+      arm_timer(vdev);
+    }
+    break;
+
+  case VIDIOC_STREAMOFF: {
+    /*all buffers are returned to the dequeued state*/
+    vdev->streaming = 0;
+    int i = 0;
+    for (i = 0; i < vdev->nbuffers; i++)
+      vdev->buffers[i].queued = 0;
+    vdev->queue_head = 0;
+    vdev->queue_count = 0;
+    arm_timer(vdev);
+    break;
+  }
+
+  case VIDIOC_QUERYCTRL: {
+    struct v4l2_queryctrl *qctrl = arg;
+    uint32_t id = qctrl->id &
+                  ~(V4L2_CTRL_FLAG_NEXT_CTRL | V4L2_CTRL_FLAG_NEXT_COMPOUND);
+    int n = find_control(id, (qctrl->id & V4L2_CTRL_FLAG_NEXT_CTRL) != 0);
+    if (n < 0) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    memset(qctrl, 0, sizeof(struct v4l2_queryctrl));
+    qctrl->id = vdev_controls[n].id;
+    qctrl->type = vdev_controls[n].type;
+    strncpy((char *)qctrl->name, vdev_controls[n].name,
+            sizeof(qctrl->name) - 1);
+    qctrl->minimum = vdev_controls[n].minimum;
+    qctrl->maximum = vdev_controls[n].maximum;
+    qctrl->step = vdev_controls[n].step;
+    qctrl->default_value = vdev_controls[n].default_value;
+    break;
+  }
+
+  case VIDIOC_QUERYMENU: {
+    struct v4l2_querymenu *qmenu = arg;
+    if (qmenu->id != V4L2_CID_POWER_LINE_FREQUENCY ||
+        qmenu->index >= ARRAY_LENGTH(power_line_menu)) {
+      errno = EINVAL;
+      ret = -1;
+      break;
+    }
+    strncpy((char *)qmenu->name, power_line_menu[qmenu->index],
+            sizeof(qmenu->name) - 1);
+    break;
+  }
+
+  case VIDIOC_G_CTRL:
+  case VIDIOC_S_CTRL: {
+    struct v4l2_control *ctrl = arg;
+    struct v4l2_ext_control ext_ctrl;
+    memset(&ext_ctrl, 0, sizeof(struct v4l2_ext_control));
+    ext_ctrl.id = ctrl->id;
+    ext_ctrl.value = ctrl->value;
+    struct v4l2_ext_controls ext_ctrls;
+    memset(&ext_ctrls, 0, sizeof(struct v4l2_ext_controls));
+    ext_ctrls.count = 1;
+    ext_ctrls.controls = &ext_ctrl;
+    ret = do_ext_ctrls(vdev, &ext_ctrls, (request == VIDIOC_S_CTRL) ? 2 : 0);
+    ctrl->value = ext_ctrl.value;
+    break;
+  }
+
+  case VIDIOC_G_EXT_CTRLS:
+    ret = do_ext_ctrls(vdev, arg, 0);
+    break;
+
+  case VIDIOC_TRY_EXT_CTRLS:
+    ret = do_ext_ctrls(vdev, arg, 1);
+    break;
+
+  case VIDIOC_S_EXT_CTRLS:
+    ret = do_ext_ctrls(vdev, arg, 2);
+    break;
+
+  default:
+    /*not emulated (events, extension units, dmabuf export, ...)*/
+    errno = ENOTTY;
+    ret = -1;
+    break;
+  }
+
+  __UNLOCK_MUTEX(&vdev->mutex);
+
+  return ret;
+}
+
+/*
+ * maps a virtual device buffer (buffers are owned by the device)
+ * args:
+ *   fd - virtual device file descriptor
+ *   length - buffer length
+ *   offset - buffer offset (as returned by VIDIOC_QUERYBUF)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to buffer (MAP_FAILED on error)
+ */
+void *vdev_mmap(int fd, size_t length, off_t offset) {
+  virtual_dev_t *vdev = get_vdev(fd);
+  if (vdev == NULL) {
+    errno = EBADF;
+    return MAP_FAILED;
+  }
+
+  void *mem = MAP_FAILED;
+
+  __LOCK_MUTEX(&vdev->mutex);
+  if (vdev->memory == V4L2_MEMORY_MMAP && vdev->sizeimage > 0 &&
+      offset % vdev->sizeimage == 0 &&
+      offset / vdev->sizeimage < vdev->nbuffers && length <= vdev->sizeimage)
+    mem = vdev->buffers[offset / vdev->sizeimage].mem;
+  else
+    errno = EINVAL;
+  __UNLOCK_MUTEX(&vdev->mutex);
+
+  return mem;
+}
+
+/*
+ * reads the next frame (read i/o method)
+ * args:
+ *   fd - virtual device file descriptor
+ *   buffer - pointer to buffer
+ *   length - buffer length
+ *
+ * asserts:
+ *   none
+ *
+ * returns: frame size (-1 on error, with errno set)
+ */
+ssize_t vdev_read(int fd, void *buffer, size_t length) {
+  virtual_dev_t *vdev = get_vdev(fd);
+  if (vdev == NULL) {
+    errno = EBADF;
+    return -1;
+  }
+
+  ssize_t ret = -1;
+
+  __LOCK_MUTEX(&vdev->mutex);
+  if (!vdev->streaming) {
+    /*read starts the stream*/
+    vdev->streaming = 1;
+    vdev->start_ts = ns_time_monotonic();
+    vdev->loop_offset = 0;
+    vdev->next_frame = 0;
+  }
+
+  if (frame_due(vdev)) {
+    uint64_t timestamp = 0;
+    uint32_t flags = 0;
+    ret = deliver_frame(vdev, buffer, length, &timestamp, &flags);
+  } else
+    errno = EAGAIN;
+
+  arm_timer(vdev);
+  __UNLOCK_MUTEX(&vdev->mutex);
+
+  return ret;
+}
+
+/*
+ * replay file writer
+ */
+struct _v4l2_replay_writer_t {
+  FILE *fp;
+  uint32_t pixelformat; // recorded format
+  uint32_t frames;      // written frames
+};
+
+/*
+ * creates a replay file for the current device stream format
+ *   (the raw frames are recorded: uvc muxed h264 is recorded as mjpeg)
+ * args:
+ *   filename - replay file name
+ *   vd - pointer to v4l2 device handler
+ *
+ * asserts:
+ *   filename is not null
+ *   vd is not null
+ *
+ * returns: pointer to replay writer (NULL on error)
+ */
+v4l2_replay_writer_t *v4l2core_replay_writer_new(const char *filename,
+                                                 v4l2_dev_t *vd) {
+  /*assertions*/
+  assert(filename != NULL);
+  assert(vd != NULL);
+
+  replay_file_header_t header;
+  memset(&header, 0, sizeof(replay_file_header_t));
+  memcpy(header.magic, REPLAY_MAGIC, 8);
+  header.pixelformat = vd->format.fmt.pix.pixelformat;
+  header.width = vd->format.fmt.pix.width;
+  header.height = vd->format.fmt.pix.height;
+  /*compressed formats have no stride*/
+  if (header.pixelformat != V4L2_PIX_FMT_MJPEG &&
+      header.pixelformat != V4L2_PIX_FMT_JPEG &&
+      header.pixelformat != V4L2_PIX_FMT_H264)
+    header.bytesperline = vd->format.fmt.pix.bytesperline;
+  header.fps_num = vd->fps_num;
+  header.fps_denom = vd->fps_denom;
+
+  FILE *fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "V4L2_CORE: couldn't create replay file %s: %s\n",
+            filename, strerror(errno));
+    return NULL;
+  }
+
+  if (fwrite(&header, sizeof(replay_file_header_t), 1, fp) != 1) {
+    fprintf(stderr, "V4L2_CORE: couldn't write replay file %s: %s\n",
+            filename, strerror(errno));
+    fclose(fp);
+    return NULL;
+  }
+
+  v4l2_replay_writer_t *writer = calloc(1, sizeof(v4l2_replay_writer_t));
+  if (writer == NULL) {
+    fprintf(stderr,
+            "V4L2_CORE: FATAL memory allocation failure "
+            "(v4l2core_replay_writer_new): %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  writer->fp = fp;
+  writer->pixelformat = header.pixelformat;
+
+  return writer;
+}
+
+/*
+ * appends the raw frame (and its timestamp) to the replay file
+ * args:
+ *   writer - pointer to replay writer
+ *   frame - pointer to frame buffer (as returned by v4l2core_get_frame)
+ *
+ * asserts:
+ *   writer is not null
+ *   frame is not null
+ *
+ * returns: error code (E_OK)
+ */
+int v4l2core_replay_writer_add_frame(v4l2_replay_writer_t *writer,
+                                     v4l2_frame_buff_t *frame) {
+  /*assertions*/
+  assert(writer != NULL);
+  assert(frame != NULL);
+
+  if (frame->raw_frame == NULL || frame->raw_frame_size == 0)
+    return E_NO_DATA;
+
+  replay_frame_header_t header;
+  memset(&header, 0, sizeof(replay_frame_header_t));
+  header.size = (uint32_t)frame->raw_frame_size;
+  header.flags = frame->isKeyframe ? REPLAY_FRAME_KEYFRAME : 0;
+  header.timestamp = frame->timestamp;
+
+  if (fwrite(&header, sizeof(replay_frame_header_t), 1, writer->fp) != 1 ||
+      fwrite(frame->raw_frame, frame->raw_frame_size, 1, writer->fp) != 1) {
+    fprintf(stderr, "V4L2_CORE: couldn't write replay frame: %s\n",
+            strerror(errno));
+    return E_FILE_IO_ERR;
+  }
+
+  writer->frames++;
+
+  return E_OK;
+}
+
+/*
+ * closes the replay file and frees the writer
+ * args:
+ *   writer - pointer to replay writer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of recorded frames
+ */
+int v4l2core_replay_writer_close(v4l2_replay_writer_t *writer) {
+  if (writer == NULL)
+    return 0;
+
+  int frames = (int)writer->frames;
+
+  if (fclose(writer->fp) != 0)
+    fprintf(stderr, "V4L2_CORE: error closing replay file: %s\n",
+            strerror(errno));
+  free(writer);
+
+  return frames;
+}
@@ -0,0 +1,148 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef VIRTUAL_DEVICE_H
+#define VIRTUAL_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * replay file (native byte order):
+ *   replay_file_header_t
+ *   { replay_frame_header_t + frame data (size bytes) } * number of frames
+ */
+#define REPLAY_MAGIC "NGVRPL01"
+
+typedef struct _replay_file_header_t {
+  char magic[8];         // REPLAY_MAGIC
+  uint32_t pixelformat;  // v4l2 fourcc of the recorded frames
+  uint32_t width;        // frame width (in pixels)
+  uint32_t height;       // frame height (in pixels)
+  uint32_t bytesperline; // line stride (0 for compressed formats)
+  uint32_t fps_num;      // frame interval numerator
+  uint32_t fps_denom;    // frame interval denominator
+  uint32_t reserved;
+} replay_file_header_t;
+
+#define REPLAY_FRAME_KEYFRAME (1 << 0)
+
+typedef struct _replay_frame_header_t {
+  uint32_t size;      // frame data size (bytes)
+  uint32_t flags;     // REPLAY_FRAME_*
+  uint64_t timestamp; // capture timestamp (ns)
+} replay_frame_header_t;
+
+/*
+ * checks for a virtual device name
+ *   (V4L2_REPLAY_PREFIX or V4L2_REPLAY_FAST_PREFIX followed by a file)
+ * args:
+ *   device - device name
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if device names a virtual device, 0 otherwise
+ */
+int vdev_is_virtual_name(const char *device);
+
+/*
+ * opens a virtual (replay file backed) device
+ * args:
+ *   device - device name (see vdev_is_virtual_name)
+ *
+ * asserts:
+ *   device is not null
+ *
+ * returns: device file descriptor (pollable, -1 on error)
+ */
+int vdev_open(const char *device);
+
+/*
+ * checks if fd belongs to a virtual device
+ * args:
+ *   fd - file descriptor
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 for a virtual device, 0 otherwise
+ */
+int vdev_is_virtual(int fd);
+
+/*
+ * emulates a v4l2 ioctl on a virtual device
+ * args:
+ *   fd - virtual device file descriptor
+ *   request - ioctl request
+ *   arg - pointer to ioctl data
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error (with errno set)
+ */
+int vdev_ioctl(int fd, unsigned long request, void *arg);
+
+/*
+ * maps a virtual device buffer (buffers are owned by the device)
+ * args:
+ *   fd - virtual device file descriptor
+ *   length - buffer length
+ *   offset - buffer offset (as returned by VIDIOC_QUERYBUF)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to buffer (MAP_FAILED on error)
+ */
+void *vdev_mmap(int fd, size_t length, off_t offset);
+
+/*
+ * reads the next frame (read i/o method)
+ * args:
+ *   fd - virtual device file descriptor
+ *   buffer - pointer to buffer
+ *   length - buffer length
+ *
+ * asserts:
+ *   none
+ *
+ * returns: frame size (-1 on error, with errno set)
+ */
+ssize_t vdev_read(int fd, void *buffer, size_t length);
+
+/*
+ * closes a virtual device
+ * args:
+ *   fd - virtual device file descriptor
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+int vdev_close(int fd);
+
+#endif
@@ -0,0 +1,194 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef H264_NAL_H
+#define H264_NAL_H
+
+#include <inttypes.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * annex-b (start code delimited) h264 nal scanner (shared by the core
+ * libraries): the uvc demuxer scans each frame once and caches the nal
+ * table with the frame, so the decoder and the muxer don't rescan it
+ */
+
+/*
+ * find the next annex-b start code (00 00 01)
+ *   scans 16 bytes per step (sse2) or skips 8 byte words without a
+ *   zero byte (other archs)
+ * args:
+ *   p - pointer to first byte to check
+ *   end - pointer to the end of the buffer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to the start code or end if none found
+ */
+static inline const uint8_t *h264_find_start_code(const uint8_t *p,
+                                                  const uint8_t *end) {
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+
+  /*a start code at p + i needs p[i] = p[i + 1] = 0 and p[i + 2] = 1*/
+  while (end - p >= 18) {
+    __m128i b0 = _mm_loadu_si128((const __m128i *)p);
+    __m128i b1 = _mm_loadu_si128((const __m128i *)(p + 1));
+    __m128i b2 = _mm_loadu_si128((const __m128i *)(p + 2));
+
+    int mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(b0, zero),
+                                    _mm_cmpeq_epi8(b1, zero)),
+                      _mm_cmpeq_epi8(b2, one)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+
+    p += 16;
+  }
+#else
+  /*a start code at p + i needs a zero byte at p + i*/
+  while (end - p >= 10) {
+    uint64_t word = 0;
+    memcpy(&word, p, sizeof(word));
+
+    if ((word - 0x0101010101010101ULL) & ~word & 0x8080808080808080ULL) {
+      int i = 0;
+      for (i = 0; i < 8; i++)
+        if (p[i] == 0x00 && p[i + 1] == 0x00 && p[i + 2] == 0x01)
+          return p + i;
+    }
+
+    p += 8;
+  }
+#endif
+
+  for (; end - p >= 3; p++)
+    if (p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x01)
+      return p;
+
+  return end;
+}
+
+/*
+ * scan an annex-b buffer for nal units (single pass)
+ *   start codes may be 3 or 4 bytes long; zero bytes before a start
+ *   code (4 byte start codes, trailing_zero_8bits) are not part of
+ *   the nal, empty nals are skipped
+ * args:
+ *   buff - pointer to annex-b data
+ *   size - buff size
+ *   nal_offset - pointer to nal offsets table (offset of the nal header)
+ *   nal_size - pointer to nal sizes table (without start code)
+ *   nal_type - pointer to nal types table (nal_unit_type) or NULL
+ *   max_nals - tables size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of nals in buff (only the first max_nals are stored)
+ */
+static inline int h264_scan_nals(const uint8_t *buff, int size,
+                                 int *nal_offset, int *nal_size,
+                                 uint8_t *nal_type, int max_nals) {
+  if (buff == NULL || size <= 0)
+    return 0;
+
+  const uint8_t *end = buff + size;
+  const uint8_t *sc = h264_find_start_code(buff, end);
+  int count = 0;
+
+  while (sc < end) {
+    const uint8_t *nal = sc + 3;
+    const uint8_t *next = h264_find_start_code(nal, end);
+    const uint8_t *nal_end = next;
+
+    while (nal_end > nal && nal_end[-1] == 0x00)
+      nal_end--;
+
+    if (nal_end > nal) {
+      if (count < max_nals) {
+        nal_offset[count] = (int)(nal - buff);
+        nal_size[count] = (int)(nal_end - nal);
+        if (nal_type != NULL)
+          nal_type[count] = nal[0] & 0x1F;
+      }
+      count++;
+    }
+
+    sc = next;
+  }
+
+  return count;
+}
+
+/*
+ * convert scanned annex-b nals to length prefixed form (4 byte big
+ * endian nal size, as used by avcC/matroska)
+ *   out can be the input buffer (in place) if the nals are delimited
+ *   by 4 byte start codes
+ * args:
+ *   in - pointer to annex-b data
+ *   nal_offset - nal offsets table (h264_scan_nals)
+ *   nal_size - nal sizes table (h264_scan_nals)
+ *   nal_count - number of nals in the tables
+ *   out - pointer to output buffer
+ *   out_size - out buffer size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: output size or -1 if out is too small (or would overwrite
+ *          unread input when converting in place)
+ */
+static inline int h264_nals_to_avcc(const uint8_t *in, const int *nal_offset,
+                                    const int *nal_size, int nal_count,
+                                    uint8_t *out, int out_size) {
+  int size = 0;
+  int i = 0;
+
+  for (i = 0; i < nal_count; i++) {
+    if (size + 4 + nal_size[i] > out_size)
+      return -1;
+    if (out == in && size + 4 > nal_offset[i])
+      return -1;
+
+    uint32_t len = (uint32_t)nal_size[i];
+    out[size] = (len >> 24) & 0xFF;
+    out[size + 1] = (len >> 16) & 0xFF;
+    out[size + 2] = (len >> 8) & 0xFF;
+    out[size + 3] = len & 0xFF;
+    memmove(out + size + 4, in + nal_offset[i], nal_size[i]);
+
+    size += 4 + nal_size[i];
+  }
+
+  return size;
+}
+
+#endif
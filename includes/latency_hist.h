@@ -0,0 +1,158 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <inttypes.h>
+
+/*
+ * hdr style latency histogram (shared by the core libraries)
+ *   each power of two range of ns values is split in
+ *   LATENCY_HIST_SUB_BUCKETS linear sub-buckets, so any recorded value
+ *   is kept with a relative error below 1/LATENCY_HIST_SUB_BUCKETS;
+ *   values above 2^42 ns (~73 min) go to the last bucket
+ *
+ *   recording is lock free (relaxed atomics) and can be done from
+ *   several threads; readers get a (not strictly consistent) snapshot
+ */
+#define LATENCY_HIST_SUB_BITS (3)
+#define LATENCY_HIST_SUB_BUCKETS (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_RANGES (40)
+#define LATENCY_HIST_BUCKETS (LATENCY_HIST_RANGES * LATENCY_HIST_SUB_BUCKETS)
+
+typedef struct _latency_hist_t {
+  uint64_t count; // recorded values
+  uint64_t sum;   // sum of recorded values (ns)
+  uint64_t max;   // max recorded value (ns)
+  uint64_t bucket[LATENCY_HIST_BUCKETS];
+} latency_hist_t;
+
+/*
+ * get the histogram bucket for a value
+ * args:
+ *   value - value (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: bucket index
+ */
+static inline int latency_hist_index(uint64_t value) {
+  if (value < LATENCY_HIST_SUB_BUCKETS)
+    return (int)value;
+
+  int msb = 63 - __builtin_clzll(value);
+  int shift = msb - LATENCY_HIST_SUB_BITS;
+  int index = ((shift + 1) << LATENCY_HIST_SUB_BITS) +
+              (int)((value >> shift) & (LATENCY_HIST_SUB_BUCKETS - 1));
+
+  return (index < LATENCY_HIST_BUCKETS) ? index : LATENCY_HIST_BUCKETS - 1;
+}
+
+/*
+ * get the value represented by a histogram bucket (bucket middle)
+ * args:
+ *   index - bucket index
+ *
+ * asserts:
+ *   none
+ *
+ * returns: value (ns)
+ */
+static inline uint64_t latency_hist_value(int index) {
+  if (index < LATENCY_HIST_SUB_BUCKETS)
+    return (uint64_t)index;
+
+  int shift = (index >> LATENCY_HIST_SUB_BITS) - 1;
+  uint64_t low = (uint64_t)(LATENCY_HIST_SUB_BUCKETS +
+                            (index & (LATENCY_HIST_SUB_BUCKETS - 1)))
+                 << shift;
+
+  return low + ((((uint64_t)1) << shift) >> 1);
+}
+
+/*
+ * record a value
+ * args:
+ *   hist - pointer to histogram
+ *   value - value (ns)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static inline void latency_hist_add(latency_hist_t *hist, uint64_t value) {
+  __atomic_fetch_add(&hist->bucket[latency_hist_index(value)], 1,
+                     __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->sum, value, __ATOMIC_RELAXED);
+
+  uint64_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+  while (value > max &&
+         !__atomic_compare_exchange_n(&hist->max, &max, value, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+/*
+ * get the value at a percentile
+ * args:
+ *   hist - pointer to histogram
+ *   permille - percentile (in 1/1000: 500 - median, 999 - p99.9)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: value (ns) - 0 if the histogram is empty
+ */
+static inline uint64_t latency_hist_percentile(const latency_hist_t *hist,
+                                               int permille) {
+  uint64_t total = 0;
+  int i = 0;
+  for (i = 0; i < LATENCY_HIST_BUCKETS; i++)
+    total += __atomic_load_n(&hist->bucket[i], __ATOMIC_RELAXED);
+
+  if (total == 0)
+    return 0;
+
+  /*rank of the requested value (1 based)*/
+  uint64_t rank = (total * (uint64_t)permille + 999) / 1000;
+  if (rank == 0)
+    rank = 1;
+
+  uint64_t seen = 0;
+  for (i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+    seen += __atomic_load_n(&hist->bucket[i], __ATOMIC_RELAXED);
+    if (seen >= rank)
+      break;
+  }
+
+  uint64_t value = latency_hist_value(i);
+  uint64_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+
+  return (value < max) ? value : max;
+}
+
+#endif
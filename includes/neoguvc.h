@@ -86,6 +86,7 @@ Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA     # # #
 #define __CLOSE_COND(c) (pthread_cond_destroy(c))
 #define __COND_BCAST(c) (pthread_cond_broadcast(c))
 #define __COND_SIGNAL(c) (pthread_cond_signal(c))
+#define __COND_WAIT(c, m) (pthread_cond_wait(c, m))
 #define __COND_TIMED_WAIT(c, m, t) (pthread_cond_timedwait(c, m, t))
 
 /*next index of ring buffer with size elements*/
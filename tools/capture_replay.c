@@ -0,0 +1,168 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/*
+ * capture_replay: records a raw camera stream to a replay file
+ *
+ * the replay file holds the raw (undecoded) frames and their capture
+ * timestamps; open it as a capture device with v4l2core_init_dev:
+ *   "replay:<file>"       at the recorded rate
+ *   "replay-fast:<file>"  as fast as frames are requested (benchmarks)
+ *
+ * usage: capture_replay [-d device] [-f fourcc] [-s WxH] [-r fps]
+ *                       [-n frames] output_file
+ *   capture_replay -d /dev/video0 -f MJPG -s 1280x720 -n 300 mjpg720.ngr
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "neoguvc_v4l2core.h"
+
+int verbosity = 0;
+
+/*
+ * prints usage
+ * args:
+ *   name - program name
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [-d device] [-f fourcc] [-s WxH] [-r fps] [-n frames] "
+          "output_file\n",
+          name);
+}
+
+int main(int argc, char *argv[]) {
+  const char *device = "/dev/video0";
+  const char *fourcc = NULL;
+  const char *output = NULL;
+  int width = 0;
+  int height = 0;
+  int fps = 0;
+  int nframes = 300;
+
+  int i = 0;
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+      device = argv[++i];
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+      fourcc = argv[++i];
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+        usage(argv[0]);
+        return -1;
+      }
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+      fps = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      nframes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-v") == 0)
+      verbosity++;
+    else if (argv[i][0] != '-' && output == NULL)
+      output = argv[i];
+    else {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  if (output == NULL || nframes <= 0) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  v4l2_dev_t *vd = v4l2core_init_dev(device);
+  if (vd == NULL) {
+    fprintf(stderr, "capture_replay: couldn't open %s\n", device);
+    return -1;
+  }
+
+  if (fourcc)
+    v4l2core_prepare_new_format(vd,
+                                v4l2core_fourcc_2_v4l2_pixelformat(fourcc));
+  else
+    v4l2core_prepare_valid_format(vd);
+
+  if (width > 0 && height > 0)
+    v4l2core_prepare_new_resolution(vd, width, height);
+  else
+    v4l2core_prepare_valid_resolution(vd);
+
+  if (fps > 0)
+    v4l2core_define_fps(vd, 1, fps);
+
+  int ret = -1;
+  v4l2_replay_writer_t *writer = NULL;
+
+  if (v4l2core_update_current_format(vd) != E_OK) {
+    fprintf(stderr, "capture_replay: couldn't set the stream format\n");
+    goto finish;
+  }
+
+  if (fps > 0)
+    v4l2core_request_framerate_update(vd);
+
+  writer = v4l2core_replay_writer_new(output, vd);
+  if (writer == NULL)
+    goto finish;
+
+  if (v4l2core_start_stream(vd) != E_OK)
+    goto finish;
+
+  int recorded = 0;
+  int failures = 0;
+  while (recorded < nframes && failures < 10) {
+    v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
+    if (frame == NULL) {
+      failures++;
+      continue;
+    }
+    failures = 0;
+
+    if (v4l2core_replay_writer_add_frame(writer, frame) == E_OK)
+      recorded++;
+
+    v4l2core_release_frame(vd, frame);
+  }
+
+  v4l2core_stop_stream(vd);
+
+  printf("capture_replay: recorded %i frames (%ix%i at %.2f fps) to %s\n",
+         recorded, v4l2core_get_frame_width(vd), v4l2core_get_frame_height(vd),
+         v4l2core_get_realfps(vd), output);
+
+  ret = (recorded == nframes) ? 0 : -1;
+
+finish:
+  v4l2core_replay_writer_close(writer);
+  v4l2core_close_dev(vd);
+
+  return ret;
+}
@@ -0,0 +1,421 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/*
+ * colorspaces_bench: conversion kernels benchmark and golden checksum check
+ *
+ * runs every kernel in the conversion registry (frame_convert.c) on
+ * synthetic frames (deterministic pseudo random data) and:
+ *   --check   compares the output checksums with colorspaces_golden.h
+ *   --bench   reports megapixels per second for each kernel
+ *   --golden  prints a new colorspaces_golden.h table (after an
+ *             intended output change)
+ *
+ * golden checksums were generated on x86_64 (gcc): the float based kernels
+ * may differ on other architectures if the compiler contracts to fma.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "colorspaces.h"
+#include "frame_convert.h"
+
+#include "colorspaces_golden.h"
+
+int verbosity = 0;
+
+/*implementation tag (only the plain C kernels exist for now)*/
+#define BENCH_IMPL "c"
+
+/*
+ * check resolutions (include odd widths)
+ *   heights are kept even: the 420 kernels process two lines at a time
+ *   and are not defined for odd heights
+ */
+static const int check_res[][2] = {{64, 48},   {322, 242},  {321, 240},
+                                   {319, 238}, {640, 480},  {1280, 720}};
+
+/*benchmark resolutions*/
+static const int bench_res[][2] = {{640, 480}, {1280, 720}, {1920, 1080}};
+
+/*
+ * fourcc to string
+ * args:
+ *   fmt - fourcc
+ *   str - pointer to string (5 bytes)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: pointer to str
+ */
+static char *fourcc_str(uint32_t fmt, char *str) {
+  str[0] = fmt & 0xFF;
+  str[1] = (fmt >> 8) & 0xFF;
+  str[2] = (fmt >> 16) & 0xFF;
+  str[3] = (fmt >> 24) & 0xFF;
+  str[4] = '\0';
+  return str;
+}
+
+/*
+ * size of a converted frame
+ * args:
+ *   fmt - destination format
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *   none
+ *
+ * returns: size in bytes
+ */
+static size_t frame_size(uint32_t fmt, int width, int height) {
+  switch (fmt) {
+  case V4L2_PIX_FMT_YUV420:
+    return (size_t)width * height * 3 / 2;
+  case V4L2_PIX_FMT_YUYV:
+    return (size_t)width * height * 2;
+  case V4L2_PIX_FMT_RGB24:
+  case CONV_FMT_DIB24:
+    return (size_t)width * height * 3;
+  default:
+    return (size_t)width * height * 4;
+  }
+}
+
+/*
+ * buffer size for a frame (max 4 bytes per pixel) with some slack:
+ *   the kernels process pixels in pairs (and lines in pairs) so odd
+ *   dimensions may touch the bytes past the nominal frame size
+ * args:
+ *   width - frame width
+ *   height - frame height
+ *
+ * asserts:
+ *   none
+ *
+ * returns: size in bytes
+ */
+static size_t buffer_size(int width, int height) {
+  return (size_t)(width + 2) * (height + 2) * 4 + 64;
+}
+
+/*
+ * fill buffer with deterministic pseudo random data (lcg)
+ * args:
+ *   buf - pointer to buffer
+ *   size - buffer size
+ *   seed - lcg seed
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void fill_synthetic(uint8_t *buf, size_t size, uint32_t seed) {
+  size_t i = 0;
+  uint32_t x = seed;
+  for (i = 0; i < size; i++) {
+    x = x * 1664525u + 1013904223u;
+    buf[i] = x >> 24;
+  }
+}
+
+/*
+ * 64 bit FNV-1a hash
+ * args:
+ *   buf - pointer to data
+ *   size - data size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: hash
+ */
+static uint64_t fnv1a64(const uint8_t *buf, size_t size) {
+  size_t i = 0;
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (i = 0; i < size; i++) {
+    h ^= buf[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/*
+ * run kernel once on a synthetic frame and hash the output
+ * args:
+ *   edge - pointer to registry entry
+ *   width - frame width
+ *   height - frame height
+ *   in - pointer to input buffer
+ *   out - pointer to output buffer
+ *
+ * asserts:
+ *   none
+ *
+ * returns: output checksum
+ */
+static uint64_t kernel_checksum(const conv_edge_t *edge, int width, int height,
+                                uint8_t *in, uint8_t *out) {
+  fill_synthetic(in, buffer_size(width, height), edge->src_fmt);
+  memset(out, 0, buffer_size(width, height));
+
+  edge->kernel(out, in, width, height);
+
+  return fnv1a64(out, frame_size(edge->dst_fmt, width, height));
+}
+
+/*
+ * find golden checksum
+ * args:
+ *   edge - pointer to registry entry
+ *   width - frame width
+ *   height - frame height
+ *   hash - pointer to store the golden checksum
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 1 if found, 0 otherwise
+ */
+static int find_golden(const conv_edge_t *edge, int width, int height,
+                       uint64_t *hash) {
+  char src[5], dst[5];
+  size_t i = 0;
+
+  fourcc_str(edge->src_fmt, src);
+  fourcc_str(edge->dst_fmt, dst);
+
+  for (i = 0; i < ARRAY_LENGTH(colorspaces_golden); i++) {
+    if (strcmp(colorspaces_golden[i].src, src) == 0 &&
+        strcmp(colorspaces_golden[i].dst, dst) == 0 &&
+        colorspaces_golden[i].width == width &&
+        colorspaces_golden[i].height == height) {
+      *hash = colorspaces_golden[i].hash;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * check (or print) the checksums of every kernel
+ * args:
+ *   print_golden - print a new golden table instead of checking
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of failures (kernels without golden checksum included)
+ */
+static int run_check(int print_golden) {
+  int size = 0;
+  const conv_edge_t *registry = get_conv_registry(&size);
+
+  int max_w = 0, max_h = 0;
+  size_t r = 0;
+  for (r = 0; r < ARRAY_LENGTH(check_res); r++) {
+    max_w = MAX(max_w, check_res[r][0]);
+    max_h = MAX(max_h, check_res[r][1]);
+  }
+
+  uint8_t *in = calloc(buffer_size(max_w, max_h), sizeof(uint8_t));
+  uint8_t *out = calloc(buffer_size(max_w, max_h), sizeof(uint8_t));
+  if (in == NULL || out == NULL) {
+    fprintf(stderr, "colorspaces_bench: FATAL memory allocation failure\n");
+    exit(-1);
+  }
+
+  int fail = 0, pass = 0, missing = 0;
+  int i = 0;
+
+  if (print_golden)
+    printf("static const colorspaces_golden_t colorspaces_golden[] = {\n");
+
+  for (i = 0; i < size; i++) {
+    const conv_edge_t *edge = &registry[i];
+    char src[5], dst[5];
+    fourcc_str(edge->src_fmt, src);
+    fourcc_str(edge->dst_fmt, dst);
+
+    for (r = 0; r < ARRAY_LENGTH(check_res); r++) {
+      int w = check_res[r][0];
+      int h = check_res[r][1];
+
+      uint64_t hash = kernel_checksum(edge, w, h, in, out);
+
+      if (print_golden) {
+        printf("    {\"%s\", \"%s\", %i, %i, 0x%016" PRIx64 "ULL}, /*%s*/\n",
+               src, dst, w, h, hash, edge->name);
+        continue;
+      }
+
+      uint64_t golden = 0;
+      if (!find_golden(edge, w, h, &golden)) {
+        printf("MISSING %-16s %s -> %s %ix%i\n", edge->name, src, dst, w, h);
+        missing++;
+      } else if (golden != hash) {
+        printf("FAIL    %-16s %s -> %s %ix%i (0x%016" PRIx64
+               " != 0x%016" PRIx64 ")\n",
+               edge->name, src, dst, w, h, hash, golden);
+        fail++;
+      } else {
+        if (verbosity > 0)
+          printf("OK      %-16s %s -> %s %ix%i\n", edge->name, src, dst, w, h);
+        pass++;
+      }
+    }
+  }
+
+  if (print_golden)
+    printf("};\n");
+  else
+    printf("colorspaces check: %i passed, %i failed, %i without golden\n",
+           pass, fail, missing);
+
+  free(in);
+  free(out);
+
+  /*a new kernel must come with its golden checksums*/
+  return fail + missing;
+}
+
+/*
+ * benchmark every kernel
+ * args:
+ *   iterations - number of conversions per kernel and resolution
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void run_bench(int iterations) {
+  int size = 0;
+  const conv_edge_t *registry = get_conv_registry(&size);
+
+  size_t r = 0;
+  int i = 0, n = 0;
+
+  printf("%-18s %-4s %-4s %-4s %-10s %10s\n", "kernel", "impl", "src", "dst",
+         "resolution", "MP/s");
+
+  for (r = 0; r < ARRAY_LENGTH(bench_res); r++) {
+    int w = bench_res[r][0];
+    int h = bench_res[r][1];
+
+    uint8_t *in = calloc(buffer_size(w, h), sizeof(uint8_t));
+    uint8_t *out = calloc(buffer_size(w, h), sizeof(uint8_t));
+    if (in == NULL || out == NULL) {
+      fprintf(stderr, "colorspaces_bench: FATAL memory allocation failure\n");
+      exit(-1);
+    }
+
+    for (i = 0; i < size; i++) {
+      const conv_edge_t *edge = &registry[i];
+      char src[5], dst[5];
+      char res[16];
+
+      fill_synthetic(in, buffer_size(w, h), edge->src_fmt);
+      edge->kernel(out, in, w, h); /*warm up*/
+
+      struct timespec t0, t1;
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      for (n = 0; n < iterations; n++)
+        edge->kernel(out, in, w, h);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+
+      double elapsed =
+          (double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+      double mps = elapsed > 0 ? ((double)w * h * iterations) / elapsed / 1e6
+                               : 0;
+
+      snprintf(res, sizeof(res), "%ix%i", w, h);
+      printf("%-18s %-4s %-4s %-4s %-10s %10.1f\n", edge->name, BENCH_IMPL,
+             fourcc_str(edge->src_fmt, src), fourcc_str(edge->dst_fmt, dst),
+             res, mps);
+    }
+
+    free(in);
+    free(out);
+  }
+}
+
+static void usage(const char *name) {
+  printf("usage: %s [--check] [--bench] [--golden] [--iterations N] "
+         "[--verbose]\n",
+         name);
+  printf("  --check         compare kernel output with golden checksums "
+         "(default)\n");
+  printf("  --bench         report megapixels/s per kernel\n");
+  printf("  --golden        print a new golden checksum table\n");
+  printf("  --iterations N  conversions per kernel in benchmark (default 20)\n");
+}
+
+int main(int argc, char *argv[]) {
+  int check = 0, bench = 0, golden = 0;
+  int iterations = 20;
+  int i = 0;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--check") == 0)
+      check = 1;
+    else if (strcmp(argv[i], "--bench") == 0)
+      bench = 1;
+    else if (strcmp(argv[i], "--golden") == 0)
+      golden = 1;
+    else if (strcmp(argv[i], "--verbose") == 0)
+      verbosity = 1;
+    else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+      if (iterations < 1)
+        iterations = 1;
+    }
+    else {
+      usage(argv[0]);
+      return (strcmp(argv[i], "--help") == 0) ? 0 : 1;
+    }
+  }
+
+  if (golden)
+    return run_check(1);
+
+  if (!check && !bench)
+    check = 1;
+
+  int ret = 0;
+  if (check)
+    ret = run_check(0) ? 1 : 0;
+
+  if (bench)
+    run_bench(iterations);
+
+  return ret;
+}
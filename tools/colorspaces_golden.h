@@ -0,0 +1,408 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/*
+ * golden checksums (64 bit FNV-1a) of the conversion kernels output
+ * for the colorspaces_bench synthetic frames
+ *
+ * regenerate with "colorspaces_bench --golden" only after an intended
+ * change to a kernel output
+ */
+
+#ifndef COLORSPACES_GOLDEN_H
+#define COLORSPACES_GOLDEN_H
+
+#include <stdint.h>
+
+typedef struct _colorspaces_golden_t {
+  const char *src; // source fourcc
+  const char *dst; // destination fourcc
+  int width;
+  int height;
+  uint64_t hash;
+} colorspaces_golden_t;
+
+static const colorspaces_golden_t colorspaces_golden[] = {
+    {"YUYV", "YU12", 64, 48, 0x6d6c6e3b357bdcf0ULL}, /*yuyv_to_yu12*/
+    {"YUYV", "YU12", 322, 242, 0x0a6a81a3145e81faULL}, /*yuyv_to_yu12*/
+    {"YUYV", "YU12", 321, 240, 0x1c321c003dba9a6aULL}, /*yuyv_to_yu12*/
+    {"YUYV", "YU12", 319, 238, 0x9c44cf6849165f94ULL}, /*yuyv_to_yu12*/
+    {"YUYV", "YU12", 640, 480, 0x370c79b3facc33a7ULL}, /*yuyv_to_yu12*/
+    {"YUYV", "YU12", 1280, 720, 0x3830cae618ae3e73ULL}, /*yuyv_to_yu12*/
+    {"YVYU", "YU12", 64, 48, 0x7f364605c324f4c1ULL}, /*yvyu_to_yu12*/
+    {"YVYU", "YU12", 322, 242, 0x0a6f1f2bafc798f3ULL}, /*yvyu_to_yu12*/
+    {"YVYU", "YU12", 321, 240, 0x38a2611aee8e4f45ULL}, /*yvyu_to_yu12*/
+    {"YVYU", "YU12", 319, 238, 0x75f0de44dcae3820ULL}, /*yvyu_to_yu12*/
+    {"YVYU", "YU12", 640, 480, 0xf3adfe43ba859cb6ULL}, /*yvyu_to_yu12*/
+    {"YVYU", "YU12", 1280, 720, 0x0e9b891fdc24a80bULL}, /*yvyu_to_yu12*/
+    {"UYVY", "YU12", 64, 48, 0x1b26b28e017c03baULL}, /*uyvy_to_yu12*/
+    {"UYVY", "YU12", 322, 242, 0x5d57e2360d0e7827ULL}, /*uyvy_to_yu12*/
+    {"UYVY", "YU12", 321, 240, 0x36d35899fdc5a1eeULL}, /*uyvy_to_yu12*/
+    {"UYVY", "YU12", 319, 238, 0xd6784e9045f4391aULL}, /*uyvy_to_yu12*/
+    {"UYVY", "YU12", 640, 480, 0x38dd34078ec36b87ULL}, /*uyvy_to_yu12*/
+    {"UYVY", "YU12", 1280, 720, 0xb7a066cf3bca5855ULL}, /*uyvy_to_yu12*/
+    {"VYUY", "YU12", 64, 48, 0xa2dc4bf57d769423ULL}, /*vyuy_to_yu12*/
+    {"VYUY", "YU12", 322, 242, 0x30f9fd009d3f6a73ULL}, /*vyuy_to_yu12*/
+    {"VYUY", "YU12", 321, 240, 0xd1efc97bfb07c7d8ULL}, /*vyuy_to_yu12*/
+    {"VYUY", "YU12", 319, 238, 0x86e015b731b04b4bULL}, /*vyuy_to_yu12*/
+    {"VYUY", "YU12", 640, 480, 0x5f6f3beb70b3ca18ULL}, /*vyuy_to_yu12*/
+    {"VYUY", "YU12", 1280, 720, 0x4a5fdb5098e597f8ULL}, /*vyuy_to_yu12*/
+    {"YYUV", "YU12", 64, 48, 0x154e5c6debfb5fc8ULL}, /*yyuv_to_yu12*/
+    {"YYUV", "YU12", 322, 242, 0x806a47603dca597bULL}, /*yyuv_to_yu12*/
+    {"YYUV", "YU12", 321, 240, 0x795fc2b8fb20b737ULL}, /*yyuv_to_yu12*/
+    {"YYUV", "YU12", 319, 238, 0x0af715dfbc55820eULL}, /*yyuv_to_yu12*/
+    {"YYUV", "YU12", 640, 480, 0xbd25d51854b4352cULL}, /*yyuv_to_yu12*/
+    {"YYUV", "YU12", 1280, 720, 0x0f06df088b88f190ULL}, /*yyuv_to_yu12*/
+    {"Y444", "YU12", 64, 48, 0x5b48d301aff5dbe1ULL}, /*y444_to_yu12*/
+    {"Y444", "YU12", 322, 242, 0x81506eb8f4e5d559ULL}, /*y444_to_yu12*/
+    {"Y444", "YU12", 321, 240, 0x0839e2760f4e3e4dULL}, /*y444_to_yu12*/
+    {"Y444", "YU12", 319, 238, 0x78e175c6b93f2c6bULL}, /*y444_to_yu12*/
+    {"Y444", "YU12", 640, 480, 0xfc9352cba014aa51ULL}, /*y444_to_yu12*/
+    {"Y444", "YU12", 1280, 720, 0xe30111c42e737aedULL}, /*y444_to_yu12*/
+    {"YUVO", "YU12", 64, 48, 0x518ff165d313a66bULL}, /*yuvo_to_yu12*/
+    {"YUVO", "YU12", 322, 242, 0x2ad92309b73ebb8dULL}, /*yuvo_to_yu12*/
+    {"YUVO", "YU12", 321, 240, 0xa9840a5c53bb745bULL}, /*yuvo_to_yu12*/
+    {"YUVO", "YU12", 319, 238, 0xa57078c1311ecd01ULL}, /*yuvo_to_yu12*/
+    {"YUVO", "YU12", 640, 480, 0x85761e05eaa7d6d9ULL}, /*yuvo_to_yu12*/
+    {"YUVO", "YU12", 1280, 720, 0x95ed738f9d65a0cbULL}, /*yuvo_to_yu12*/
+    {"YUVP", "YU12", 64, 48, 0x1952b253052bfa4bULL}, /*yuvp_to_yu12*/
+    {"YUVP", "YU12", 322, 242, 0x8bff8b2cd5835088ULL}, /*yuvp_to_yu12*/
+    {"YUVP", "YU12", 321, 240, 0xa40a58d4f65903b8ULL}, /*yuvp_to_yu12*/
+    {"YUVP", "YU12", 319, 238, 0x2788990dc9950c81ULL}, /*yuvp_to_yu12*/
+    {"YUVP", "YU12", 640, 480, 0x1da3c5627ac95bb0ULL}, /*yuvp_to_yu12*/
+    {"YUVP", "YU12", 1280, 720, 0x34ce8d7214e7c76bULL}, /*yuvp_to_yu12*/
+    {"YUV4", "YU12", 64, 48, 0xfab3868d8656d7ccULL}, /*yuv4_to_yu12*/
+    {"YUV4", "YU12", 322, 242, 0xb82a2f9f99744489ULL}, /*yuv4_to_yu12*/
+    {"YUV4", "YU12", 321, 240, 0xb26da6baaf4ffebbULL}, /*yuv4_to_yu12*/
+    {"YUV4", "YU12", 319, 238, 0x089758f125ec0c48ULL}, /*yuv4_to_yu12*/
+    {"YUV4", "YU12", 640, 480, 0x7e146d7b9e7d5683ULL}, /*yuv4_to_yu12*/
+    {"YUV4", "YU12", 1280, 720, 0x24a6d82b8182e833ULL}, /*yuv4_to_yu12*/
+    {"422P", "YU12", 64, 48, 0x56462d1a2d0cae22ULL}, /*yuv422p_to_yu12*/
+    {"422P", "YU12", 322, 242, 0xc5c8decaddb73ab4ULL}, /*yuv422p_to_yu12*/
+    {"422P", "YU12", 321, 240, 0xe8c51c5b5a55467bULL}, /*yuv422p_to_yu12*/
+    {"422P", "YU12", 319, 238, 0xa78288f630876a01ULL}, /*yuv422p_to_yu12*/
+    {"422P", "YU12", 640, 480, 0x7975ec20f47f555fULL}, /*yuv422p_to_yu12*/
+    {"422P", "YU12", 1280, 720, 0x457e17642a877a93ULL}, /*yuv422p_to_yu12*/
+    {"YV12", "YU12", 64, 48, 0xbe8790177b3539deULL}, /*yv12_to_yu12*/
+    {"YV12", "YU12", 322, 242, 0x1ed1c1adfdb622bfULL}, /*yv12_to_yu12*/
+    {"YV12", "YU12", 321, 240, 0x3ff6fd57d1ace833ULL}, /*yv12_to_yu12*/
+    {"YV12", "YU12", 319, 238, 0xb7a43e406e04213bULL}, /*yv12_to_yu12*/
+    {"YV12", "YU12", 640, 480, 0x044705a6b37e00acULL}, /*yv12_to_yu12*/
+    {"YV12", "YU12", 1280, 720, 0x34c88892ca7b4fdbULL}, /*yv12_to_yu12*/
+    {"NV12", "YU12", 64, 48, 0x91409cda943964f3ULL}, /*nv12_to_yu12*/
+    {"NV12", "YU12", 322, 242, 0x5279f6b7ab9704a3ULL}, /*nv12_to_yu12*/
+    {"NV12", "YU12", 321, 240, 0x64de8711dba9b0e7ULL}, /*nv12_to_yu12*/
+    {"NV12", "YU12", 319, 238, 0x6894995ff0bd4ab6ULL}, /*nv12_to_yu12*/
+    {"NV12", "YU12", 640, 480, 0xbaa6e511285c83eaULL}, /*nv12_to_yu12*/
+    {"NV12", "YU12", 1280, 720, 0xb3b9923e17dfe709ULL}, /*nv12_to_yu12*/
+    {"NV21", "YU12", 64, 48, 0xdcb303d914701fb8ULL}, /*nv21_to_yu12*/
+    {"NV21", "YU12", 322, 242, 0x2dd8ee2b2b84b706ULL}, /*nv21_to_yu12*/
+    {"NV21", "YU12", 321, 240, 0x28fd2114b30363baULL}, /*nv21_to_yu12*/
+    {"NV21", "YU12", 319, 238, 0x8e67abf55aefb275ULL}, /*nv21_to_yu12*/
+    {"NV21", "YU12", 640, 480, 0x7604ca62946c0a8eULL}, /*nv21_to_yu12*/
+    {"NV21", "YU12", 1280, 720, 0xdc26e9dfed64317cULL}, /*nv21_to_yu12*/
+    {"NV16", "YU12", 64, 48, 0xf64346ea28dc97f1ULL}, /*nv16_to_yu12*/
+    {"NV16", "YU12", 322, 242, 0x942005c3d486f57cULL}, /*nv16_to_yu12*/
+    {"NV16", "YU12", 321, 240, 0xa7144cc57ef8db61ULL}, /*nv16_to_yu12*/
+    {"NV16", "YU12", 319, 238, 0x3dbd43f728f12e89ULL}, /*nv16_to_yu12*/
+    {"NV16", "YU12", 640, 480, 0x78e657f7d240da69ULL}, /*nv16_to_yu12*/
+    {"NV16", "YU12", 1280, 720, 0xe8eff59e4de91dd0ULL}, /*nv16_to_yu12*/
+    {"NV61", "YU12", 64, 48, 0x163018534b3426a1ULL}, /*nv61_to_yu12*/
+    {"NV61", "YU12", 322, 242, 0xcee50a33d2f1ba7eULL}, /*nv61_to_yu12*/
+    {"NV61", "YU12", 321, 240, 0x129ea66e3e7186ceULL}, /*nv61_to_yu12*/
+    {"NV61", "YU12", 319, 238, 0x961a49dda295ccf1ULL}, /*nv61_to_yu12*/
+    {"NV61", "YU12", 640, 480, 0xe3be4efd33f8e68bULL}, /*nv61_to_yu12*/
+    {"NV61", "YU12", 1280, 720, 0xfa46800c6ff6357cULL}, /*nv61_to_yu12*/
+    {"NV24", "YU12", 64, 48, 0x064efc9003b74934ULL}, /*nv24_to_yu12*/
+    {"NV24", "YU12", 322, 242, 0x5fd8d383846af3e2ULL}, /*nv24_to_yu12*/
+    {"NV24", "YU12", 321, 240, 0x5c3e99d2e226cadbULL}, /*nv24_to_yu12*/
+    {"NV24", "YU12", 319, 238, 0xe7d3f11cd5ed1283ULL}, /*nv24_to_yu12*/
+    {"NV24", "YU12", 640, 480, 0x7a9ea409fdcfcd85ULL}, /*nv24_to_yu12*/
+    {"NV24", "YU12", 1280, 720, 0x69fb181b50a89802ULL}, /*nv24_to_yu12*/
+    {"NV42", "YU12", 64, 48, 0x2273d789ca734202ULL}, /*nv42_to_yu12*/
+    {"NV42", "YU12", 322, 242, 0xba0feb38480be794ULL}, /*nv42_to_yu12*/
+    {"NV42", "YU12", 321, 240, 0x82bd9844d656ac46ULL}, /*nv42_to_yu12*/
+    {"NV42", "YU12", 319, 238, 0x35ab280c77d11c5eULL}, /*nv42_to_yu12*/
+    {"NV42", "YU12", 640, 480, 0x13e0d672742380f3ULL}, /*nv42_to_yu12*/
+    {"NV42", "YU12", 1280, 720, 0xc5f68fecb2a1f92cULL}, /*nv42_to_yu12*/
+    {"Y41P", "YU12", 64, 48, 0xb274e2ee2ad193f9ULL}, /*y41p_to_yu12*/
+    {"Y41P", "YU12", 322, 242, 0xd53e67f15a65ad96ULL}, /*y41p_to_yu12*/
+    {"Y41P", "YU12", 321, 240, 0xefa95dec421899d2ULL}, /*y41p_to_yu12*/
+    {"Y41P", "YU12", 319, 238, 0xfe93e29cf51552a0ULL}, /*y41p_to_yu12*/
+    {"Y41P", "YU12", 640, 480, 0x981709f7f7bcae8eULL}, /*y41p_to_yu12*/
+    {"Y41P", "YU12", 1280, 720, 0x041072cdf0cc3b8aULL}, /*y41p_to_yu12*/
+    {"GREY", "YU12", 64, 48, 0xb0d457a5be451d37ULL}, /*grey_to_yu12*/
+    {"GREY", "YU12", 322, 242, 0xd5bf5fe63110553aULL}, /*grey_to_yu12*/
+    {"GREY", "YU12", 321, 240, 0xcdd0194fcc454305ULL}, /*grey_to_yu12*/
+    {"GREY", "YU12", 319, 238, 0x5290a30bd108865bULL}, /*grey_to_yu12*/
+    {"GREY", "YU12", 640, 480, 0xe25a75f42ac52d77ULL}, /*grey_to_yu12*/
+    {"GREY", "YU12", 1280, 720, 0x8e274dd4565240aeULL}, /*grey_to_yu12*/
+    {"Y10B", "YU12", 64, 48, 0x747888e3640f8e88ULL}, /*y10b_to_yu12*/
+    {"Y10B", "YU12", 322, 242, 0x2f3558c08c324790ULL}, /*y10b_to_yu12*/
+    {"Y10B", "YU12", 321, 240, 0xc226b211621bbfa4ULL}, /*y10b_to_yu12*/
+    {"Y10B", "YU12", 319, 238, 0xde3cb55116dae284ULL}, /*y10b_to_yu12*/
+    {"Y10B", "YU12", 640, 480, 0xb607d87e4551bd21ULL}, /*y10b_to_yu12*/
+    {"Y10B", "YU12", 1280, 720, 0x1f8c52a9a14c9518ULL}, /*y10b_to_yu12*/
+    {"Y16 ", "YU12", 64, 48, 0x73e01c32b8e1cf61ULL}, /*y16_to_yu12*/
+    {"Y16 ", "YU12", 322, 242, 0x3e79093eaefaae32ULL}, /*y16_to_yu12*/
+    {"Y16 ", "YU12", 321, 240, 0x823eb1c8f6599bb9ULL}, /*y16_to_yu12*/
+    {"Y16 ", "YU12", 319, 238, 0x2d87fdaceadb31d2ULL}, /*y16_to_yu12*/
+    {"Y16 ", "YU12", 640, 480, 0x4cbf31916663d3a2ULL}, /*y16_to_yu12*/
+    {"Y16 ", "YU12", 1280, 720, 0x84ff0f75f10b67baULL}, /*y16_to_yu12*/
+    {"Y16", "YU12", 64, 48, 0x652a05fe1a69c341ULL}, /*y16x_to_yu12*/
+    {"Y16", "YU12", 322, 242, 0x7f66bc2a805ddda5ULL}, /*y16x_to_yu12*/
+    {"Y16", "YU12", 321, 240, 0xbcc3eaf933aa68e4ULL}, /*y16x_to_yu12*/
+    {"Y16", "YU12", 319, 238, 0x8a8f7162fd3a1c5dULL}, /*y16x_to_yu12*/
+    {"Y16", "YU12", 640, 480, 0xd03ffd62a08e1fe0ULL}, /*y16x_to_yu12*/
+    {"Y16", "YU12", 1280, 720, 0xcfc946961fb2d1b3ULL}, /*y16x_to_yu12*/
+    {"S501", "YU12", 64, 48, 0xce3a0d244727d60cULL}, /*s501_to_yu12*/
+    {"S501", "YU12", 322, 242, 0x2a3827bd2bbfbdb9ULL}, /*s501_to_yu12*/
+    {"S501", "YU12", 321, 240, 0x8a5fabc6c29cf851ULL}, /*s501_to_yu12*/
+    {"S501", "YU12", 319, 238, 0x61e4000643a9f35dULL}, /*s501_to_yu12*/
+    {"S501", "YU12", 640, 480, 0x4640490071e3447eULL}, /*s501_to_yu12*/
+    {"S501", "YU12", 1280, 720, 0xa91d87519cd4b03dULL}, /*s501_to_yu12*/
+    {"S505", "YU12", 64, 48, 0xbf45ffc574f38960ULL}, /*s505_to_yu12*/
+    {"S505", "YU12", 322, 242, 0xf97fa4d74073acfbULL}, /*s505_to_yu12*/
+    {"S505", "YU12", 321, 240, 0xbd014c1b5d972f4dULL}, /*s505_to_yu12*/
+    {"S505", "YU12", 319, 238, 0xdcd64aac5b52db95ULL}, /*s505_to_yu12*/
+    {"S505", "YU12", 640, 480, 0xf812b378a0465f6aULL}, /*s505_to_yu12*/
+    {"S505", "YU12", 1280, 720, 0xe5d62a706e1d0321ULL}, /*s505_to_yu12*/
+    {"S508", "YU12", 64, 48, 0x4c9dee1a7caa0292ULL}, /*s508_to_yu12*/
+    {"S508", "YU12", 322, 242, 0x0220a51d3cbddf47ULL}, /*s508_to_yu12*/
+    {"S508", "YU12", 321, 240, 0xc4a1aca402bb0ad7ULL}, /*s508_to_yu12*/
+    {"S508", "YU12", 319, 238, 0x82b77fcf9fb83999ULL}, /*s508_to_yu12*/
+    {"S508", "YU12", 640, 480, 0x6c63e51ee68b6e04ULL}, /*s508_to_yu12*/
+    {"S508", "YU12", 1280, 720, 0x248bd662b61342e1ULL}, /*s508_to_yu12*/
+    {"RGB3", "YU12", 64, 48, 0x3b149ef1bf5ff473ULL}, /*rgb24_to_yu12*/
+    {"RGB3", "YU12", 322, 242, 0x3515a8727d8384afULL}, /*rgb24_to_yu12*/
+    {"RGB3", "YU12", 321, 240, 0x60b6532619b23139ULL}, /*rgb24_to_yu12*/
+    {"RGB3", "YU12", 319, 238, 0x18290da7de997ab8ULL}, /*rgb24_to_yu12*/
+    {"RGB3", "YU12", 640, 480, 0x8e2dfcc1b34ddc51ULL}, /*rgb24_to_yu12*/
+    {"RGB3", "YU12", 1280, 720, 0x1f13cceb25830ff1ULL}, /*rgb24_to_yu12*/
+    {"BGR3", "YU12", 64, 48, 0xf52321ed4ecb5f56ULL}, /*bgr24_to_yu12*/
+    {"BGR3", "YU12", 322, 242, 0x1dd4afc09040999bULL}, /*bgr24_to_yu12*/
+    {"BGR3", "YU12", 321, 240, 0xe7d2c97873f91237ULL}, /*bgr24_to_yu12*/
+    {"BGR3", "YU12", 319, 238, 0x21bcaa4c25b5e066ULL}, /*bgr24_to_yu12*/
+    {"BGR3", "YU12", 640, 480, 0x47a340e7cda7b0a0ULL}, /*bgr24_to_yu12*/
+    {"BGR3", "YU12", 1280, 720, 0x49025e6dd1935a22ULL}, /*bgr24_to_yu12*/
+    {"RGB1", "YU12", 64, 48, 0xa270aca221a3eeefULL}, /*rgb1_to_yu12*/
+    {"RGB1", "YU12", 322, 242, 0x737d87e80092bfd0ULL}, /*rgb1_to_yu12*/
+    {"RGB1", "YU12", 321, 240, 0xa95f2fc9bfeaaa83ULL}, /*rgb1_to_yu12*/
+    {"RGB1", "YU12", 319, 238, 0x23a8e5e5d72a65e2ULL}, /*rgb1_to_yu12*/
+    {"RGB1", "YU12", 640, 480, 0x6f693df1c1f98c27ULL}, /*rgb1_to_yu12*/
+    {"RGB1", "YU12", 1280, 720, 0x9cc5696c96d939b0ULL}, /*rgb1_to_yu12*/
+    {"RGBP", "YU12", 64, 48, 0xe74426358d084daaULL}, /*rgbp_to_yu12*/
+    {"RGBP", "YU12", 322, 242, 0x144eb6ae78f3e2eaULL}, /*rgbp_to_yu12*/
+    {"RGBP", "YU12", 321, 240, 0xf0507fda364b803cULL}, /*rgbp_to_yu12*/
+    {"RGBP", "YU12", 319, 238, 0x7fc32ecec680b281ULL}, /*rgbp_to_yu12*/
+    {"RGBP", "YU12", 640, 480, 0x5575ef0ca40c2831ULL}, /*rgbp_to_yu12*/
+    {"RGBP", "YU12", 1280, 720, 0x657b49df5a8e587aULL}, /*rgbp_to_yu12*/
+    {"RGBR", "YU12", 64, 48, 0xde07c897b2caf6a1ULL}, /*rgbr_to_yu12*/
+    {"RGBR", "YU12", 322, 242, 0x6f1b4d55033cfeb0ULL}, /*rgbr_to_yu12*/
+    {"RGBR", "YU12", 321, 240, 0x20611644758146f6ULL}, /*rgbr_to_yu12*/
+    {"RGBR", "YU12", 319, 238, 0x74520df02fe9f761ULL}, /*rgbr_to_yu12*/
+    {"RGBR", "YU12", 640, 480, 0xfafbb331ead94222ULL}, /*rgbr_to_yu12*/
+    {"RGBR", "YU12", 1280, 720, 0x47e46421b316736dULL}, /*rgbr_to_yu12*/
+    {"R444", "YU12", 64, 48, 0x9c673d9c9cba941cULL}, /*ar12_to_yu12*/
+    {"R444", "YU12", 322, 242, 0x3196bc9d57238f54ULL}, /*ar12_to_yu12*/
+    {"R444", "YU12", 321, 240, 0xa5d1a41509ce9303ULL}, /*ar12_to_yu12*/
+    {"R444", "YU12", 319, 238, 0xc43549b15d984f78ULL}, /*ar12_to_yu12*/
+    {"R444", "YU12", 640, 480, 0x50525a3abff26325ULL}, /*ar12_to_yu12*/
+    {"R444", "YU12", 1280, 720, 0x1ed7803363d0e0acULL}, /*ar12_to_yu12*/
+    {"AR12", "YU12", 64, 48, 0xfcd89c70fe57809aULL}, /*ar12_to_yu12*/
+    {"AR12", "YU12", 322, 242, 0xdfe5fc34a6d6a635ULL}, /*ar12_to_yu12*/
+    {"AR12", "YU12", 321, 240, 0xa3e47df4d220cb38ULL}, /*ar12_to_yu12*/
+    {"AR12", "YU12", 319, 238, 0xd02dc486ed60234dULL}, /*ar12_to_yu12*/
+    {"AR12", "YU12", 640, 480, 0x5bb887b2114a8848ULL}, /*ar12_to_yu12*/
+    {"AR12", "YU12", 1280, 720, 0xf5b94444c2020445ULL}, /*ar12_to_yu12*/
+    {"XR12", "YU12", 64, 48, 0xb07c0e5289e80957ULL}, /*ar12_to_yu12*/
+    {"XR12", "YU12", 322, 242, 0x6bd8a88c82ad3961ULL}, /*ar12_to_yu12*/
+    {"XR12", "YU12", 321, 240, 0x73e23f296f1d8395ULL}, /*ar12_to_yu12*/
+    {"XR12", "YU12", 319, 238, 0x55ecd97629125f58ULL}, /*ar12_to_yu12*/
+    {"XR12", "YU12", 640, 480, 0xbc1c93422ae09cc8ULL}, /*ar12_to_yu12*/
+    {"XR12", "YU12", 1280, 720, 0x339735cc914ca405ULL}, /*ar12_to_yu12*/
+    {"RGBO", "YU12", 64, 48, 0xbf6ead1d2c2552dfULL}, /*ar15_to_yu12*/
+    {"RGBO", "YU12", 322, 242, 0xf4cb2d1c6f850e08ULL}, /*ar15_to_yu12*/
+    {"RGBO", "YU12", 321, 240, 0x66de8589a87dbd9eULL}, /*ar15_to_yu12*/
+    {"RGBO", "YU12", 319, 238, 0xe4c5e6a4d62c4ee1ULL}, /*ar15_to_yu12*/
+    {"RGBO", "YU12", 640, 480, 0x1df52dba1248d4f7ULL}, /*ar15_to_yu12*/
+    {"RGBO", "YU12", 1280, 720, 0xfe4da968829074bfULL}, /*ar15_to_yu12*/
+    {"AR15", "YU12", 64, 48, 0xab9d7f3070718903ULL}, /*ar15_to_yu12*/
+    {"AR15", "YU12", 322, 242, 0x99ae49b485e4c2f5ULL}, /*ar15_to_yu12*/
+    {"AR15", "YU12", 321, 240, 0x480d1c02cac62ae0ULL}, /*ar15_to_yu12*/
+    {"AR15", "YU12", 319, 238, 0xf656cf74f5a1cccbULL}, /*ar15_to_yu12*/
+    {"AR15", "YU12", 640, 480, 0xca06660445e049d5ULL}, /*ar15_to_yu12*/
+    {"AR15", "YU12", 1280, 720, 0x35f037e41b667e2dULL}, /*ar15_to_yu12*/
+    {"XR15", "YU12", 64, 48, 0x8d0ff7bafe93e286ULL}, /*ar15_to_yu12*/
+    {"XR15", "YU12", 322, 242, 0x5454a583d8e299c2ULL}, /*ar15_to_yu12*/
+    {"XR15", "YU12", 321, 240, 0x5d8a36c0b0b3befcULL}, /*ar15_to_yu12*/
+    {"XR15", "YU12", 319, 238, 0xe215ae6bfc819197ULL}, /*ar15_to_yu12*/
+    {"XR15", "YU12", 640, 480, 0x919d294ff515861dULL}, /*ar15_to_yu12*/
+    {"XR15", "YU12", 1280, 720, 0x600f367555eda5a9ULL}, /*ar15_to_yu12*/
+    {"RGBQ", "YU12", 64, 48, 0x16b52a6f72ea715fULL}, /*ar15x_to_yu12*/
+    {"RGBQ", "YU12", 322, 242, 0xc091715b8089d517ULL}, /*ar15x_to_yu12*/
+    {"RGBQ", "YU12", 321, 240, 0xc0060fda33865440ULL}, /*ar15x_to_yu12*/
+    {"RGBQ", "YU12", 319, 238, 0x57fdb121cdba2519ULL}, /*ar15x_to_yu12*/
+    {"RGBQ", "YU12", 640, 480, 0x09942c2d6934e7c0ULL}, /*ar15x_to_yu12*/
+    {"RGBQ", "YU12", 1280, 720, 0x32800e634f46bd41ULL}, /*ar15x_to_yu12*/
+    {"AR1", "YU12", 64, 48, 0xfca4f86b867a5581ULL}, /*ar15x_to_yu12*/
+    {"AR1", "YU12", 322, 242, 0x07ceb27d0fb98286ULL}, /*ar15x_to_yu12*/
+    {"AR1", "YU12", 321, 240, 0x5f3ccb3c24269dcdULL}, /*ar15x_to_yu12*/
+    {"AR1", "YU12", 319, 238, 0x0592bf80a0c5aff4ULL}, /*ar15x_to_yu12*/
+    {"AR1", "YU12", 640, 480, 0xf9a0b040fd2fe487ULL}, /*ar15x_to_yu12*/
+    {"AR1", "YU12", 1280, 720, 0x65c41338ba30efb4ULL}, /*ar15x_to_yu12*/
+    {"XR1", "YU12", 64, 48, 0xfb9ab8403c4a7e18ULL}, /*ar15x_to_yu12*/
+    {"XR1", "YU12", 322, 242, 0xa026b46ff6ae94c8ULL}, /*ar15x_to_yu12*/
+    {"XR1", "YU12", 321, 240, 0xa7db29cf0955b4dcULL}, /*ar15x_to_yu12*/
+    {"XR1", "YU12", 319, 238, 0x12565fcf92220557ULL}, /*ar15x_to_yu12*/
+    {"XR1", "YU12", 640, 480, 0x1f0e0ba332f8a955ULL}, /*ar15x_to_yu12*/
+    {"XR1", "YU12", 1280, 720, 0x6b2a8b7217d6321eULL}, /*ar15x_to_yu12*/
+    {"BGRH", "YU12", 64, 48, 0x8e528f4e04a81b92ULL}, /*bgrh_to_yu12*/
+    {"BGRH", "YU12", 322, 242, 0x485924da92e2d17eULL}, /*bgrh_to_yu12*/
+    {"BGRH", "YU12", 321, 240, 0x0886036144fa68b0ULL}, /*bgrh_to_yu12*/
+    {"BGRH", "YU12", 319, 238, 0xe329324a03840c19ULL}, /*bgrh_to_yu12*/
+    {"BGRH", "YU12", 640, 480, 0xc01df4efe5f9e29bULL}, /*bgrh_to_yu12*/
+    {"BGRH", "YU12", 1280, 720, 0x31d111d8684e178cULL}, /*bgrh_to_yu12*/
+    {"BGR4", "YU12", 64, 48, 0x3dd3ec039aa368d8ULL}, /*ar24_to_yu12*/
+    {"BGR4", "YU12", 322, 242, 0x7081072a113122aeULL}, /*ar24_to_yu12*/
+    {"BGR4", "YU12", 321, 240, 0x07ac1301e279a714ULL}, /*ar24_to_yu12*/
+    {"BGR4", "YU12", 319, 238, 0x0f76c0d3de6fdab7ULL}, /*ar24_to_yu12*/
+    {"BGR4", "YU12", 640, 480, 0xc75f7a920bb9447dULL}, /*ar24_to_yu12*/
+    {"BGR4", "YU12", 1280, 720, 0xf1b2404c49980d50ULL}, /*ar24_to_yu12*/
+    {"AR24", "YU12", 64, 48, 0x6414d95a45e0b1ecULL}, /*ar24_to_yu12*/
+    {"AR24", "YU12", 322, 242, 0x4f8cf70bbf7a3811ULL}, /*ar24_to_yu12*/
+    {"AR24", "YU12", 321, 240, 0x1c851c554c19dcc7ULL}, /*ar24_to_yu12*/
+    {"AR24", "YU12", 319, 238, 0x8e5554cc931c0c43ULL}, /*ar24_to_yu12*/
+    {"AR24", "YU12", 640, 480, 0x6ba145d869294e12ULL}, /*ar24_to_yu12*/
+    {"AR24", "YU12", 1280, 720, 0x4999addcc017b2bdULL}, /*ar24_to_yu12*/
+    {"XR24", "YU12", 64, 48, 0x6fd06f382e30556dULL}, /*ar24_to_yu12*/
+    {"XR24", "YU12", 322, 242, 0x71d606e199a612d4ULL}, /*ar24_to_yu12*/
+    {"XR24", "YU12", 321, 240, 0xf0865df0a7ddc050ULL}, /*ar24_to_yu12*/
+    {"XR24", "YU12", 319, 238, 0x946e11efcdc8777cULL}, /*ar24_to_yu12*/
+    {"XR24", "YU12", 640, 480, 0xa56553818a479a78ULL}, /*ar24_to_yu12*/
+    {"XR24", "YU12", 1280, 720, 0xf2290e83683ff925ULL}, /*ar24_to_yu12*/
+    {"RGB4", "YU12", 64, 48, 0x05e65690996c5b2fULL}, /*ba24_to_yu12*/
+    {"RGB4", "YU12", 322, 242, 0xd0e05e3c67d32d4eULL}, /*ba24_to_yu12*/
+    {"RGB4", "YU12", 321, 240, 0xe9dbf1fe55e60c5bULL}, /*ba24_to_yu12*/
+    {"RGB4", "YU12", 319, 238, 0x717cd89ca20f2284ULL}, /*ba24_to_yu12*/
+    {"RGB4", "YU12", 640, 480, 0x738fe00f33b5dea3ULL}, /*ba24_to_yu12*/
+    {"RGB4", "YU12", 1280, 720, 0x134cbc506a7e39bdULL}, /*ba24_to_yu12*/
+    {"BA24", "YU12", 64, 48, 0xb33588fd391c246bULL}, /*ba24_to_yu12*/
+    {"BA24", "YU12", 322, 242, 0x8702b78f9b68d872ULL}, /*ba24_to_yu12*/
+    {"BA24", "YU12", 321, 240, 0x53e1eca96d97476eULL}, /*ba24_to_yu12*/
+    {"BA24", "YU12", 319, 238, 0x5ef0c4f83ca7dd0fULL}, /*ba24_to_yu12*/
+    {"BA24", "YU12", 640, 480, 0xae5c81c42b325e02ULL}, /*ba24_to_yu12*/
+    {"BA24", "YU12", 1280, 720, 0x7ec2aef0110db333ULL}, /*ba24_to_yu12*/
+    {"BX24", "YU12", 64, 48, 0xd4540a67b25100d8ULL}, /*ba24_to_yu12*/
+    {"BX24", "YU12", 322, 242, 0x7439c7b650cdd61eULL}, /*ba24_to_yu12*/
+    {"BX24", "YU12", 321, 240, 0x0b45b5437973b361ULL}, /*ba24_to_yu12*/
+    {"BX24", "YU12", 319, 238, 0x6b872d758b31aeafULL}, /*ba24_to_yu12*/
+    {"BX24", "YU12", 640, 480, 0x528f68781a51c690ULL}, /*ba24_to_yu12*/
+    {"BX24", "YU12", 1280, 720, 0x36d8875c563810bbULL}, /*ba24_to_yu12*/
+    {"GBRG", "RGB3", 64, 48, 0x9a696585a16f02ccULL}, /*sgbrg8_to_rgb24*/
+    {"GBRG", "RGB3", 322, 242, 0xf4fd7d4d55a3b61fULL}, /*sgbrg8_to_rgb24*/
+    {"GBRG", "RGB3", 321, 240, 0xba6802966da2dc2fULL}, /*sgbrg8_to_rgb24*/
+    {"GBRG", "RGB3", 319, 238, 0x05b6d15ff23aa135ULL}, /*sgbrg8_to_rgb24*/
+    {"GBRG", "RGB3", 640, 480, 0x8c435892b3392966ULL}, /*sgbrg8_to_rgb24*/
+    {"GBRG", "RGB3", 1280, 720, 0xa8095e9ca3caa354ULL}, /*sgbrg8_to_rgb24*/
+    {"GRBG", "RGB3", 64, 48, 0x8118c17bf605e952ULL}, /*sgrbg8_to_rgb24*/
+    {"GRBG", "RGB3", 322, 242, 0x31647fc99745d27dULL}, /*sgrbg8_to_rgb24*/
+    {"GRBG", "RGB3", 321, 240, 0x4258d023fc60b11eULL}, /*sgrbg8_to_rgb24*/
+    {"GRBG", "RGB3", 319, 238, 0x948bc123e977ffdcULL}, /*sgrbg8_to_rgb24*/
+    {"GRBG", "RGB3", 640, 480, 0x5d83ea81342fb4f0ULL}, /*sgrbg8_to_rgb24*/
+    {"GRBG", "RGB3", 1280, 720, 0x211995ce004719d6ULL}, /*sgrbg8_to_rgb24*/
+    {"BA81", "RGB3", 64, 48, 0xd89a613072e7e5f2ULL}, /*sbggr8_to_rgb24*/
+    {"BA81", "RGB3", 322, 242, 0x26367382ae4f2f60ULL}, /*sbggr8_to_rgb24*/
+    {"BA81", "RGB3", 321, 240, 0xed685b27689b66a9ULL}, /*sbggr8_to_rgb24*/
+    {"BA81", "RGB3", 319, 238, 0x61e415471c47de75ULL}, /*sbggr8_to_rgb24*/
+    {"BA81", "RGB3", 640, 480, 0x70300cd479b724e4ULL}, /*sbggr8_to_rgb24*/
+    {"BA81", "RGB3", 1280, 720, 0xf21399da8b6a59b4ULL}, /*sbggr8_to_rgb24*/
+    {"RGGB", "RGB3", 64, 48, 0xac07fb11e23a3c56ULL}, /*srggb8_to_rgb24*/
+    {"RGGB", "RGB3", 322, 242, 0x5e40a18a57430b50ULL}, /*srggb8_to_rgb24*/
+    {"RGGB", "RGB3", 321, 240, 0x34fafb0e1725b295ULL}, /*srggb8_to_rgb24*/
+    {"RGGB", "RGB3", 319, 238, 0x6b29fe14a29bbdf1ULL}, /*srggb8_to_rgb24*/
+    {"RGGB", "RGB3", 640, 480, 0x599b34d34250fc58ULL}, /*srggb8_to_rgb24*/
+    {"RGGB", "RGB3", 1280, 720, 0x881d7076aa6f0029ULL}, /*srggb8_to_rgb24*/
+    {"YU12", "RGB3", 64, 48, 0x1bd49872fd4e509cULL}, /*yu12_to_rgb24*/
+    {"YU12", "RGB3", 322, 242, 0xa342af6e6116bc78ULL}, /*yu12_to_rgb24*/
+    {"YU12", "RGB3", 321, 240, 0xadb8464cf9877dffULL}, /*yu12_to_rgb24*/
+    {"YU12", "RGB3", 319, 238, 0x9787e7d5f214758aULL}, /*yu12_to_rgb24*/
+    {"YU12", "RGB3", 640, 480, 0x9257686cd13e4bbfULL}, /*yu12_to_rgb24*/
+    {"YU12", "RGB3", 1280, 720, 0x56666ba094563973ULL}, /*yu12_to_rgb24*/
+    {"YU12", "DIB3", 64, 48, 0x94d0dfdbbf0fd98cULL}, /*yu12_to_dib24*/
+    {"YU12", "DIB3", 322, 242, 0x71b7e3f8a8523800ULL}, /*yu12_to_dib24*/
+    {"YU12", "DIB3", 321, 240, 0x5f46ff98ff282e39ULL}, /*yu12_to_dib24*/
+    {"YU12", "DIB3", 319, 238, 0x8be7dded2176f346ULL}, /*yu12_to_dib24*/
+    {"YU12", "DIB3", 640, 480, 0x33cc8de91a4e68abULL}, /*yu12_to_dib24*/
+    {"YU12", "DIB3", 1280, 720, 0x776606e950e73ae3ULL}, /*yu12_to_dib24*/
+    {"YU12", "YUYV", 64, 48, 0x7dcf8a6ba2f5301dULL}, /*yu12_to_yuyv*/
+    {"YU12", "YUYV", 322, 242, 0x800e84f655b51befULL}, /*yu12_to_yuyv*/
+    {"YU12", "YUYV", 321, 240, 0x687cdc1a891d584dULL}, /*yu12_to_yuyv*/
+    {"YU12", "YUYV", 319, 238, 0x009434ff1e70993eULL}, /*yu12_to_yuyv*/
+    {"YU12", "YUYV", 640, 480, 0xb22e33bea924e152ULL}, /*yu12_to_yuyv*/
+    {"YU12", "YUYV", 1280, 720, 0x9a6d386b40fefaf8ULL}, /*yu12_to_yuyv*/
+    {"YU12", "AB24", 64, 48, 0x8ee826a878f9d09cULL}, /*yu12_to_rgba*/
+    {"YU12", "AB24", 322, 242, 0x6d03d63bede91890ULL}, /*yu12_to_rgba*/
+    {"YU12", "AB24", 321, 240, 0x55a9ea5da91f3e71ULL}, /*yu12_to_rgba*/
+    {"YU12", "AB24", 319, 238, 0xed0d9a9587300d76ULL}, /*yu12_to_rgba*/
+    {"YU12", "AB24", 640, 480, 0xc15dc9512e8b3cafULL}, /*yu12_to_rgba*/
+    {"YU12", "AB24", 1280, 720, 0x98a69e541c283b11ULL}, /*yu12_to_rgba*/
+    {"YUYV", "RGB3", 64, 48, 0x2f512d14826d6a7aULL}, /*yuyv_to_rgb24*/
+    {"YUYV", "RGB3", 322, 242, 0xc201270abc164f16ULL}, /*yuyv_to_rgb24*/
+    {"YUYV", "RGB3", 321, 240, 0xc9986355dde8b759ULL}, /*yuyv_to_rgb24*/
+    {"YUYV", "RGB3", 319, 238, 0x4c88559ec53d4036ULL}, /*yuyv_to_rgb24*/
+    {"YUYV", "RGB3", 640, 480, 0x8cdd8c96d0d82f4fULL}, /*yuyv_to_rgb24*/
+    {"YUYV", "RGB3", 1280, 720, 0x5e180c77e1d03992ULL}, /*yuyv_to_rgb24*/
+    {"UYVY", "YUYV", 64, 48, 0x4c3186f3f7b081d2ULL}, /*uyvy_to_yuyv*/
+    {"UYVY", "YUYV", 322, 242, 0x6318601d9809db43ULL}, /*uyvy_to_yuyv*/
+    {"UYVY", "YUYV", 321, 240, 0x4522b9b3a01977b8ULL}, /*uyvy_to_yuyv*/
+    {"UYVY", "YUYV", 319, 238, 0xf028bbac9d300bacULL}, /*uyvy_to_yuyv*/
+    {"UYVY", "YUYV", 640, 480, 0x8ec95b268f69baadULL}, /*uyvy_to_yuyv*/
+    {"UYVY", "YUYV", 1280, 720, 0x18f727d083cb3b2dULL}, /*uyvy_to_yuyv*/
+    {"YVYU", "YUYV", 64, 48, 0xafc298ebd20ca41dULL}, /*yvyu_to_yuyv*/
+    {"YVYU", "YUYV", 322, 242, 0x271917bb08d39bbeULL}, /*yvyu_to_yuyv*/
+    {"YVYU", "YUYV", 321, 240, 0xbc47b018c4a82096ULL}, /*yvyu_to_yuyv*/
+    {"YVYU", "YUYV", 319, 238, 0xdfb4f5369e2936f7ULL}, /*yvyu_to_yuyv*/
+    {"YVYU", "YUYV", 640, 480, 0x377b0af3ec88c715ULL}, /*yvyu_to_yuyv*/
+    {"YVYU", "YUYV", 1280, 720, 0x2f75446478729994ULL}, /*yvyu_to_yuyv*/
+    {"BGR3", "RGB3", 64, 48, 0x1e880e25d0a35a34ULL}, /*bgr24_to_rgb24*/
+    {"BGR3", "RGB3", 322, 242, 0xc9d832bbddd25785ULL}, /*bgr24_to_rgb24*/
+    {"BGR3", "RGB3", 321, 240, 0x9800cef5ed64e407ULL}, /*bgr24_to_rgb24*/
+    {"BGR3", "RGB3", 319, 238, 0x19dbfb659e78fa99ULL}, /*bgr24_to_rgb24*/
+    {"BGR3", "RGB3", 640, 480, 0x2152d78e64ddbf76ULL}, /*bgr24_to_rgb24*/
+    {"BGR3", "RGB3", 1280, 720, 0x1e39856cff29a4a6ULL}, /*bgr24_to_rgb24*/
+    {"RGB3", "DIB3", 64, 48, 0xcc865c82470f20bcULL}, /*rgb24_to_dib24*/
+    {"RGB3", "DIB3", 322, 242, 0x958f1676a797532fULL}, /*rgb24_to_dib24*/
+    {"RGB3", "DIB3", 321, 240, 0xf9d9a8641fe1641eULL}, /*rgb24_to_dib24*/
+    {"RGB3", "DIB3", 319, 238, 0x9dcb7497e435756aULL}, /*rgb24_to_dib24*/
+    {"RGB3", "DIB3", 640, 480, 0xcc4581803a3da42dULL}, /*rgb24_to_dib24*/
+    {"RGB3", "DIB3", 1280, 720, 0xd20d3d1c0c72c175ULL}, /*rgb24_to_dib24*/
+    {"RGB3", "AB24", 64, 48, 0x635bbc1ca2e5252eULL}, /*rgb24_to_rgba*/
+    {"RGB3", "AB24", 322, 242, 0x6685d13ed220b731ULL}, /*rgb24_to_rgba*/
+    {"RGB3", "AB24", 321, 240, 0x108a4423a866c1e2ULL}, /*rgb24_to_rgba*/
+    {"RGB3", "AB24", 319, 238, 0xe7867e80befd96ceULL}, /*rgb24_to_rgba*/
+    {"RGB3", "AB24", 640, 480, 0x2debfa33d9e77091ULL}, /*rgb24_to_rgba*/
+    {"RGB3", "AB24", 1280, 720, 0x89c7bd75553e40f5ULL}, /*rgb24_to_rgba*/
+};
+
+#endif
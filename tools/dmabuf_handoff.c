@@ -0,0 +1,242 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/*
+ * dmabuf_handoff: zero-copy frame handoff check (e.g. with the vivid driver)
+ *
+ * captures YUYV frames and hands the dmabuf of each frame to a child
+ * process over a unix socket (SCM_RIGHTS); the child maps the dmabuf,
+ * checksums it and sends the frame back. Both processes checksum the
+ * same memory, so the totals must match.
+ *   (default)  exports the driver mmap buffers (VIDIOC_EXPBUF)
+ *   --import   captures into dmabufs from the system dma heap
+ *              (V4L2_MEMORY_DMABUF)
+ *
+ * usage: dmabuf_handoff [--import] [--frames N] [device]
+ *   sudo modprobe vivid && dmabuf_handoff /dev/video0
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "neoguvc_v4l2core.h"
+
+int verbosity = 0;
+
+/*
+ * 32 bit FNV-1a hash
+ * args:
+ *   hash - current hash value
+ *   data - pointer to data
+ *   size - data size in bytes
+ *
+ * asserts:
+ *   none
+ *
+ * returns: updated hash
+ */
+static uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t size) {
+  size_t i = 0;
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/*
+ * child process: maps and checksums the received frames
+ * args:
+ *   sock - unix socket connected to the capture process
+ *
+ * asserts:
+ *   none
+ *
+ * returns: exit code
+ */
+static int run_consumer(int sock) {
+  uint32_t hash = 2166136261u;
+  int frames = 0;
+
+  v4l2_dmabuf_frame_t info;
+  int fd = -1;
+  while ((fd = v4l2core_dmabuf_recv_frame(sock, &info)) >= 0) {
+    uint8_t *data = mmap(NULL, info.length, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      fprintf(stderr, "dmabuf_handoff: couldn't map received dmabuf\n");
+      close(fd);
+      return -1;
+    }
+
+    hash = fnv1a(hash, data, info.bytesused);
+    frames++;
+
+    munmap(data, info.length);
+    close(fd);
+
+    if (v4l2core_dmabuf_send_release(sock, info.index) != E_OK)
+      return -1;
+  }
+
+  /*report the total back to the capture process*/
+  if (send(sock, &hash, sizeof(uint32_t), 0) != sizeof(uint32_t))
+    return -1;
+
+  printf("consumer: %i frames checksum %08" PRIx32 "\n", frames, hash);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  const char *device = "/dev/video0";
+  int import = 0;
+  int nframes = 60;
+
+  int i = 0;
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--import") == 0)
+      import = 1;
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      nframes = atoi(argv[++i]);
+    else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: %s [--import] [--frames N] [device]\n",
+              argv[0]);
+      return -1;
+    } else
+      device = argv[i];
+  }
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+    perror("dmabuf_handoff: socketpair");
+    return -1;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("dmabuf_handoff: fork");
+    return -1;
+  }
+  if (pid == 0) {
+    close(sv[0]);
+    exit(run_consumer(sv[1]));
+  }
+  close(sv[1]);
+  int sock = sv[0];
+
+  /*emulated formats would be converted into a copy*/
+  v4l2core_disable_libv4l2();
+
+  int ret = -1;
+  int heap_fds[NB_BUFFER];
+  for (i = 0; i < NB_BUFFER; i++)
+    heap_fds[i] = -1;
+
+  v4l2_dev_t *vd = v4l2core_init_dev(device);
+  if (vd == NULL) {
+    fprintf(stderr, "dmabuf_handoff: couldn't open %s\n", device);
+    goto finish;
+  }
+
+  v4l2core_prepare_new_format(vd, V4L2_PIX_FMT_YUYV);
+  v4l2core_prepare_valid_resolution(vd);
+
+  if (import) {
+    uint32_t size = (uint32_t)v4l2core_get_frame_width(vd) *
+                    v4l2core_get_frame_height(vd) * 2;
+    size = (size + 4095) & ~4095u;
+    for (i = 0; i < NB_BUFFER; i++) {
+      if ((heap_fds[i] = v4l2core_dmabuf_alloc(size)) < 0)
+        goto finish;
+    }
+    if (v4l2core_set_dmabuf_import(vd, heap_fds, size) != E_OK)
+      goto finish;
+  } else if (v4l2core_set_dmabuf_export(vd, 1) != E_OK)
+    goto finish;
+
+  if (v4l2core_update_current_format(vd) != E_OK) {
+    fprintf(stderr, "dmabuf_handoff: couldn't set the YUYV format\n");
+    goto finish;
+  }
+
+  printf("capture: %s %ix%i YUYV (%s dmabufs)\n", device,
+         v4l2core_get_frame_width(vd), v4l2core_get_frame_height(vd),
+         import ? "imported" : "exported");
+
+  if (v4l2core_start_stream(vd) != E_OK)
+    goto finish;
+
+  uint32_t hash = 2166136261u;
+  int sent = 0;
+  while (sent < nframes) {
+    v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
+    if (frame == NULL)
+      continue;
+
+    hash = fnv1a(hash, frame->raw_frame, frame->raw_frame_size);
+
+    /*the driver can't reuse the buffer until the consumer is done*/
+    if (v4l2core_dmabuf_send_frame(sock, vd, frame) != E_OK ||
+        v4l2core_dmabuf_recv_release(sock) != frame->index) {
+      v4l2core_release_frame(vd, frame);
+      break;
+    }
+
+    v4l2core_release_frame(vd, frame);
+    sent++;
+  }
+
+  v4l2core_stop_stream(vd);
+
+  /*end of stream: the consumer sends its checksum*/
+  shutdown(sock, SHUT_WR);
+  uint32_t consumer_hash = 0;
+  if (recv(sock, &consumer_hash, sizeof(uint32_t), MSG_WAITALL) !=
+      sizeof(uint32_t))
+    fprintf(stderr, "dmabuf_handoff: no checksum from the consumer\n");
+
+  printf("capture: %i frames checksum %08" PRIx32 "\n", sent, hash);
+
+  if (sent == nframes && consumer_hash == hash) {
+    printf("OK\n");
+    ret = 0;
+  } else
+    printf("FAILED\n");
+
+finish:
+  if (vd)
+    v4l2core_close_dev(vd);
+  for (i = 0; i < NB_BUFFER; i++) {
+    if (heap_fds[i] >= 0)
+      close(heap_fds[i]);
+  }
+  close(sock);
+  waitpid(pid, NULL, 0);
+
+  return ret;
+}
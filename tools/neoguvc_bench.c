@@ -0,0 +1,1106 @@
+/******************************************************************************#
+#           guvcview              http://guvcview.sourceforge.net              #
+#                                                                              #
+#           Paulo Assis <pj.assis@gmail.com>                                   #
+#           Nobuhiro Iwamatsu <iwamatsu@nigauri.org>                           #
+#                             Add UYVY color support(Macbook iSight)           #
+#                                                                              #
+# This program is free software; you can redistribute it and/or modify         #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation; either version 2 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# This program is distributed in the hope that it will be useful,              #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with this program; if not, write to the Free Software                  #
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA    #
+#                                                                              #
+*******************************************************************************/
+
+/*
+ * neoguvc_bench: headless end-to-end pipeline benchmark
+ *
+ * runs the stages of the capture loop on a replay-fast virtual device
+ * (see capture_replay) for every combination of source format,
+ * resolution, video codec and muxer:
+ *   capture    - v4l2core_get_frame
+ *   decode     - v4l2core_frame_convert to yu12 (frame yuv buffer)
+ *   fx         - render_fx_apply (only with --fx)
+ *   preview    - v4l2core_frame_convert to rgb24
+ *   encode_mux - encoder_add_video_frame + encoder_process_next_video_buffer
+ *                (the encoder writes the muxer itself, so muxing is included)
+ * and writes a json report (frames/s, per stage p50/p99 latency, cpu time
+ * per frame and memory high-water mark) to stdout or to --output.
+ *
+ * sources are synthetic moving patterns (YUYV, NV12, YU12, GRBG, MJPG)
+ * or replay files (--replay, e.g. an h264 stream recorded with
+ * capture_replay); --codecs none benchmarks the pipeline without encoding
+ *
+ * usage: neoguvc_bench [--frames N] [--formats YUYV,MJPG,...]
+ *                      [--sizes 640x480,1280x720,...] [--codecs raw,H264,...]
+ *                      [--muxers mkv,avi,y4m,yuv] [--fx mask]
+ *                      [--replay file]... [--tune] [--threads N]
+ *                      [--output file] [-v]
+ *
+ * --tune runs the encoder auto-tuner (encoder_tune_video_profile) for
+ * every codec and resolution and encodes with the profile it picks;
+ * --threads fixes the encoder thread count (on top of --tune)
+ *
+ * e.g. lossless archival (FFV1 v3) at 1080p on 4 cores:
+ *   neoguvc_bench --formats YU12 --sizes 1920x1080 --codecs FFV1
+ *                 --muxers mkv --frames 3600 --threads 4
+ * sustains 1080p60 if "fps" >= 60 and encode_mux p99 < 16667 us
+ *
+ * thread scaling of the archival profile (record "fps" and
+ * "cpu_ms_per_frame" of each report; repeat on every target machine,
+ * the figures depend on core count and memory bandwidth):
+ *   for t in 1 2 4 8; do
+ *     neoguvc_bench --formats YU12 --sizes 1920x1080 --codecs FFV1
+ *                   --muxers mkv --frames 3600 --threads $t
+ *                   --output ffv1_1080p_t$t.json
+ *   done
+ * pick the lowest thread count whose fps stays >= 60 (cpu_ms_per_frame
+ * is the cost of that choice on the other running stages)
+ *
+ * uncompressed 4K30 to disk (raw sinks, set TMPDIR to the target disk):
+ *   neoguvc_bench --formats YU12 --sizes 3840x2160 --codecs raw
+ *                 --muxers y4m,yuv --frames 900 --output raw_4k.json
+ * record "fps", "cpu_ms_per_frame" and the encode_mux "p99_us" of each
+ * muxer; the sink keeps up if fps >= 30 and encode_mux p99 < 33333 us
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "neoguvc.h"
+#include "neoguvc_v4l2core.h"
+#include "neoguvcencoder.h"
+#include "neoguvcrender.h"
+#include "render.h"
+#include "virtual_device.h"
+
+int verbosity = 0;
+
+#define MAX_LIST_ITEMS (32)
+#define SYNTH_FRAMES (16)  /*distinct synthetic frames (the replay loops)*/
+#define WARMUP_FRAMES (10) /*frames not accounted for*/
+#define MAX_FAILURES (10)
+
+enum {
+  STAGE_CAPTURE = 0,
+  STAGE_DECODE,
+  STAGE_FX,
+  STAGE_PREVIEW,
+  STAGE_ENCODE,
+  STAGE_COUNT
+};
+
+static const char *stage_name[STAGE_COUNT] = {"capture", "decode", "fx",
+                                              "preview", "encode_mux"};
+
+typedef struct _bench_source_t {
+  char path[PATH_MAX];  // replay file
+  const char *origin;   // "synthetic" or the replay file name
+  uint32_t pixelformat; // v4l2 fourcc
+  int width;
+  int height;
+} bench_source_t;
+
+typedef struct _bench_options_t {
+  int frames;
+  uint32_t fx_mask;
+  int codec_ind[MAX_LIST_ITEMS]; // -1 for no encoding
+  int ncodecs;
+  int muxer[MAX_LIST_ITEMS];
+  int nmuxers;
+  int tune;    // auto-tune the encoder profile
+  int threads; // encoder threads (0 - profile or codec default)
+  char tmpdir[PATH_MAX];
+} bench_options_t;
+
+static const char *muxer_name[] = {"mkv", "webm", "avi", "y4m", "yuv"};
+
+/*
+ * monotonic clock
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: time in ns
+ */
+static uint64_t ns_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+/*
+ * process cpu time (user + system, all threads)
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: cpu time in ns
+ */
+static uint64_t cpu_time(void) {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+             NSEC_PER_SEC +
+         (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+}
+
+/*
+ * resets the process resident set high-water mark
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void reset_mem_hwm(void) {
+  FILE *fp = fopen("/proc/self/clear_refs", "w");
+  if (fp == NULL)
+    return; /*VmHWM will hold the process peak*/
+
+  fputs("5", fp);
+  fclose(fp);
+}
+
+/*
+ * gets the process resident set high-water mark
+ * args:
+ *   none
+ *
+ * asserts:
+ *   none
+ *
+ * returns: VmHWM in kB (0 if not available)
+ */
+static long get_mem_hwm(void) {
+  FILE *fp = fopen("/proc/self/status", "r");
+  if (fp == NULL)
+    return 0;
+
+  char line[256];
+  long hwm = 0;
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (strncmp(line, "VmHWM:", 6) == 0) {
+      hwm = strtol(line + 6, NULL, 10);
+      break;
+    }
+  }
+
+  fclose(fp);
+  return hwm;
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t va = *(const uint64_t *)a;
+  uint64_t vb = *(const uint64_t *)b;
+  return (va > vb) - (va < vb);
+}
+
+/*
+ * writes a json string (quoted and escaped)
+ * args:
+ *   fp - output file
+ *   str - string
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void json_string(FILE *fp, const char *str) {
+  fputc('"', fp);
+  for (; str && *str; str++) {
+    if (*str == '"' || *str == '\\')
+      fputc('\\', fp);
+    if ((unsigned char)*str >= 0x20)
+      fputc(*str, fp);
+  }
+  fputc('"', fp);
+}
+
+/*
+ * fills a yu12 frame with a moving pattern (gradient, box and sensor noise)
+ * args:
+ *   yuv - pointer to yu12 buffer (width*height*3/2)
+ *   width - frame width
+ *   height - frame height
+ *   n - frame number
+ *   seed - pointer to noise generator state
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void fill_pattern(uint8_t *yuv, int width, int height, int n,
+                         uint32_t *seed) {
+  uint8_t *py = yuv;
+  uint8_t *pu = yuv + width * height;
+  uint8_t *pv = pu + (width * height) / 4;
+
+  int box_w = width / 8;
+  int box_h = height / 8;
+  int box_x = (n * width / SYNTH_FRAMES) % (width - box_w);
+  int box_y = (n * height / (2 * SYNTH_FRAMES)) % (height - box_h);
+
+  int x = 0;
+  int y = 0;
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      *seed = *seed * 1664525 + 1013904223;
+      int val = ((x * 2 + y + n * 6) & 0xbf) + ((*seed >> 24) & 0x0f);
+      if (x >= box_x && x < box_x + box_w && y >= box_y && y < box_y + box_h)
+        val = 235;
+      *py++ = (uint8_t)val;
+    }
+  }
+
+  for (y = 0; y < height / 2; y++) {
+    for (x = 0; x < width / 2; x++) {
+      *pu++ = (uint8_t)(64 + (x * 128) / (width / 2) + n);
+      *pv++ = (uint8_t)(192 - (y * 128) / (height / 2) - n);
+    }
+  }
+}
+
+static uint8_t clip_u8(int val) {
+  return (uint8_t)(val < 0 ? 0 : (val > 255 ? 255 : val));
+}
+
+/*
+ * converts a yu12 frame to the synthetic source format
+ * args:
+ *   out - pointer to output buffer
+ *   yuv - pointer to yu12 frame
+ *   width - frame width
+ *   height - frame height
+ *   pixelformat - output format (YUYV, NV12, YU12 or SGRBG8)
+ *
+ * asserts:
+ *   none
+ *
+ * returns: output size in bytes (0 if format is not supported)
+ */
+static size_t pack_pattern(uint8_t *out, const uint8_t *yuv, int width,
+                           int height, uint32_t pixelformat) {
+  const uint8_t *py = yuv;
+  const uint8_t *pu = yuv + width * height;
+  const uint8_t *pv = pu + (width * height) / 4;
+  int x = 0;
+  int y = 0;
+
+  switch (pixelformat) {
+  case V4L2_PIX_FMT_YUV420:
+    memcpy(out, yuv, width * height * 3 / 2);
+    return width * height * 3 / 2;
+
+  case V4L2_PIX_FMT_NV12:
+    memcpy(out, py, width * height);
+    out += width * height;
+    for (x = 0; x < (width * height) / 4; x++) {
+      *out++ = pu[x];
+      *out++ = pv[x];
+    }
+    return width * height * 3 / 2;
+
+  case V4L2_PIX_FMT_YUYV:
+    for (y = 0; y < height; y++) {
+      for (x = 0; x < width; x += 2) {
+        int c = (y / 2) * (width / 2) + x / 2;
+        *out++ = py[y * width + x];
+        *out++ = pu[c];
+        *out++ = py[y * width + x + 1];
+        *out++ = pv[c];
+      }
+    }
+    return width * height * 2;
+
+  case V4L2_PIX_FMT_SGRBG8:
+    /* G R
+     * B G */
+    for (y = 0; y < height; y++) {
+      for (x = 0; x < width; x++) {
+        int c = (y / 2) * (width / 2) + x / 2;
+        int lum = py[y * width + x];
+        if ((x & 1) == (y & 1))
+          *out++ = (uint8_t)lum;
+        else if ((y & 1) == 0)
+          *out++ = clip_u8(lum + (1402 * (pv[c] - 128)) / 1000);
+        else
+          *out++ = clip_u8(lum + (1772 * (pu[c] - 128)) / 1000);
+      }
+    }
+    return width * height;
+
+  default:
+    return 0;
+  }
+}
+
+/*
+ * encodes a yuyv frame as jpeg (with the core jpeg encoder)
+ * args:
+ *   out - pointer to output buffer (big enough for the yuyv frame)
+ *   yuyv - pointer to yuyv frame
+ *   width - frame width
+ *   height - frame height
+ *   tmpfile - scratch file name
+ *
+ * asserts:
+ *   none
+ *
+ * returns: jpeg size in bytes (0 on error)
+ */
+static size_t encode_pattern_jpeg(uint8_t *out, uint8_t *yuyv, int width,
+                                  int height, const char *tmpfile) {
+  v4l2_frame_buff_t frame;
+  memset(&frame, 0, sizeof(v4l2_frame_buff_t));
+  frame.width = width;
+  frame.height = height;
+  frame.raw_frame = yuyv;
+  frame.raw_frame_size = width * height * 2;
+  frame.raw_pixelformat = V4L2_PIX_FMT_YUYV;
+
+  if (v4l2core_save_image(&frame, tmpfile, IMG_FMT_JPG) != E_OK)
+    return 0;
+
+  size_t size = 0;
+  FILE *fp = fopen(tmpfile, "rb");
+  if (fp != NULL) {
+    size = fread(out, 1, width * height * 2, fp);
+    fclose(fp);
+  }
+  unlink(tmpfile);
+
+  return size;
+}
+
+/*
+ * writes a synthetic replay file for a source
+ * args:
+ *   src - pointer to source (path is set)
+ *   tmpdir - directory for the replay file
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int make_synthetic_source(bench_source_t *src, const char *tmpdir) {
+  uint8_t fourcc[5] = {0};
+  memcpy(fourcc, &src->pixelformat, 4);
+  snprintf(src->path, sizeof(src->path), "%s/%s_%ix%i.ngr", tmpdir,
+           (char *)fourcc, src->width, src->height);
+
+  int width = src->width;
+  int height = src->height;
+  uint8_t *yuv = malloc(width * height * 3 / 2);
+  uint8_t *yuyv = malloc(width * height * 2);
+  uint8_t *data = malloc(width * height * 2);
+  if (yuv == NULL || yuyv == NULL || data == NULL) {
+    fprintf(stderr, "neoguvc_bench: FATAL memory allocation failure: %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  int ret = -1;
+  FILE *fp = fopen(src->path, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "neoguvc_bench: couldn't create %s: %s\n", src->path,
+            strerror(errno));
+    goto finish;
+  }
+
+  replay_file_header_t header;
+  memset(&header, 0, sizeof(replay_file_header_t));
+  memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+  header.pixelformat = src->pixelformat;
+  header.width = width;
+  header.height = height;
+  header.fps_num = 1;
+  header.fps_denom = 30;
+  switch (src->pixelformat) {
+  case V4L2_PIX_FMT_YUYV:
+    header.bytesperline = width * 2;
+    break;
+  case V4L2_PIX_FMT_MJPEG:
+    header.bytesperline = 0;
+    break;
+  default:
+    header.bytesperline = width;
+    break;
+  }
+
+  if (fwrite(&header, sizeof(replay_file_header_t), 1, fp) != 1)
+    goto finish;
+
+  char jpgfile[PATH_MAX];
+  snprintf(jpgfile, sizeof(jpgfile), "%s/pattern.jpg", tmpdir);
+
+  uint32_t seed = 0x6e677663;
+  int n = 0;
+  for (n = 0; n < SYNTH_FRAMES; n++) {
+    fill_pattern(yuv, width, height, n, &seed);
+
+    size_t size = 0;
+    if (src->pixelformat == V4L2_PIX_FMT_MJPEG) {
+      pack_pattern(yuyv, yuv, width, height, V4L2_PIX_FMT_YUYV);
+      size = encode_pattern_jpeg(data, yuyv, width, height, jpgfile);
+    } else
+      size = pack_pattern(data, yuv, width, height, src->pixelformat);
+
+    if (size == 0) {
+      fprintf(stderr, "neoguvc_bench: couldn't generate %s frames\n",
+              (char *)fourcc);
+      goto finish;
+    }
+
+    replay_frame_header_t fheader;
+    fheader.size = (uint32_t)size;
+    fheader.flags = REPLAY_FRAME_KEYFRAME;
+    fheader.timestamp = ((uint64_t)n * NSEC_PER_SEC) / 30;
+
+    if (fwrite(&fheader, sizeof(replay_frame_header_t), 1, fp) != 1 ||
+        fwrite(data, size, 1, fp) != 1)
+      goto finish;
+  }
+
+  ret = 0;
+
+finish:
+  if (fp != NULL && fclose(fp) != 0)
+    ret = -1;
+  if (ret != 0)
+    unlink(src->path);
+  free(data);
+  free(yuyv);
+  free(yuv);
+  return ret;
+}
+
+/*
+ * sets a source from a replay file header
+ * args:
+ *   src - pointer to source
+ *   filename - replay file
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int load_replay_source(bench_source_t *src, const char *filename) {
+  replay_file_header_t header;
+
+  FILE *fp = fopen(filename, "rb");
+  if (fp == NULL) {
+    fprintf(stderr, "neoguvc_bench: couldn't open %s: %s\n", filename,
+            strerror(errno));
+    return -1;
+  }
+
+  size_t ret = fread(&header, sizeof(replay_file_header_t), 1, fp);
+  fclose(fp);
+
+  if (ret != 1 || memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic))) {
+    fprintf(stderr, "neoguvc_bench: %s is not a replay file\n", filename);
+    return -1;
+  }
+
+  strncpy(src->path, filename, sizeof(src->path) - 1);
+  src->origin = filename;
+  src->pixelformat = header.pixelformat;
+  src->width = header.width;
+  src->height = header.height;
+  return 0;
+}
+
+/*
+ * writes the common fields of a result entry
+ * args:
+ *   fp - output file
+ *   src - pointer to source
+ *   codec_ind - video codec index (-1 for none)
+ *   muxer - muxer id (-1 for none)
+ *   first - pointer to first entry flag
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void json_entry_start(FILE *fp, const bench_source_t *src,
+                             int codec_ind, int muxer, int *first) {
+  char fourcc[5] = {0};
+  memcpy(fourcc, &src->pixelformat, 4);
+
+  fprintf(fp, "%s\n    {\"source\": ", *first ? "" : ",");
+  json_string(fp, src->origin);
+  fprintf(fp, ", \"format\": ");
+  json_string(fp, fourcc);
+  fprintf(fp, ", \"width\": %i, \"height\": %i, \"codec\": ", src->width,
+          src->height);
+  if (codec_ind < 0)
+    json_string(fp, "none");
+  else if (codec_ind == 0)
+    json_string(fp, "raw");
+  else
+    json_string(fp, encoder_get_video_codec_4cc(codec_ind));
+  fprintf(fp, ", \"muxer\": ");
+  json_string(fp, muxer < 0 ? "none" : muxer_name[muxer]);
+
+  *first = 0;
+}
+
+/*
+ * runs the pipeline for one combination and writes its result entry
+ * args:
+ *   fp - output file
+ *   src - pointer to source
+ *   codec_ind - video codec index (-1 for none)
+ *   muxer - muxer id (-1 for none)
+ *   opts - pointer to options
+ *   first - pointer to first entry flag
+ *
+ * asserts:
+ *   none
+ *
+ * returns: 0 on success, -1 on error
+ */
+static int run_combination(FILE *fp, const bench_source_t *src, int codec_ind,
+                           int muxer, const bench_options_t *opts,
+                           int *first) {
+  const char *error = NULL;
+  char outfile[PATH_MAX] = {0};
+  encoder_context_t *encoder_ctx = NULL;
+  encoder_video_profile_t profile;
+  int tuned = 0;
+  uint8_t *rgb = NULL;
+  uint64_t *stage_ns[STAGE_COUNT] = {NULL};
+  int stage_count[STAGE_COUNT] = {0};
+  int i = 0;
+
+  reset_mem_hwm();
+
+  char device[PATH_MAX + 16];
+  snprintf(device, sizeof(device), "%s%s", V4L2_REPLAY_FAST_PREFIX, src->path);
+
+  v4l2_dev_t *vd = v4l2core_init_dev(device);
+  if (vd == NULL) {
+    error = "couldn't open the replay device";
+    goto finish;
+  }
+
+  v4l2core_prepare_new_format(vd, src->pixelformat);
+  v4l2core_prepare_new_resolution(vd, src->width, src->height);
+  if (v4l2core_update_current_format(vd) != E_OK) {
+    error = "couldn't set the stream format";
+    goto finish;
+  }
+
+  int width = v4l2core_get_frame_width(vd);
+  int height = v4l2core_get_frame_height(vd);
+
+  rgb = malloc(width * height * 3);
+  int alloc_failed = (rgb == NULL);
+  for (i = 0; i < STAGE_COUNT; i++) {
+    stage_ns[i] = calloc(opts->frames, sizeof(uint64_t));
+    alloc_failed |= (stage_ns[i] == NULL);
+  }
+  if (alloc_failed) {
+    fprintf(stderr, "neoguvc_bench: FATAL memory allocation failure: %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+
+  if (codec_ind >= 0) {
+    int fps_num = v4l2core_get_fps_num(vd);
+    int fps_den = v4l2core_get_fps_denom(vd);
+    if (fps_num <= 0 || fps_den <= 0) {
+      fps_num = 1;
+      fps_den = 30;
+    }
+
+    memset(&profile, 0, sizeof(encoder_video_profile_t));
+    if (opts->tune)
+      tuned = (encoder_tune_video_profile(codec_ind, width, height, fps_num,
+                                          fps_den, &profile) == 0);
+    if (opts->threads > 0) {
+      profile.thread_count = opts->threads;
+      tuned = 1;
+    }
+
+    encoder_ctx = encoder_init_profile(src->pixelformat, codec_ind, 0, muxer,
+                                       width, height, fps_num, fps_den, 0, 0,
+                                       tuned ? &profile : NULL);
+    if (encoder_ctx == NULL) {
+      error = "couldn't initialize the encoder";
+      goto finish;
+    }
+
+    snprintf(outfile, sizeof(outfile), "%s/output.%s", opts->tmpdir,
+             muxer_name[muxer]);
+    if (encoder_muxer_init(encoder_ctx, outfile) != 0) {
+      error = "couldn't open the output file";
+      goto finish;
+    }
+  }
+
+  if (v4l2core_start_stream(vd) != E_OK) {
+    error = "couldn't start the stream";
+    goto finish;
+  }
+
+  uint64_t wall_start = 0;
+  uint64_t cpu_start = 0;
+  int failures = 0;
+  int nframes = 0;
+
+  for (i = -WARMUP_FRAMES; i < opts->frames && failures < MAX_FAILURES;) {
+    uint64_t ts[STAGE_COUNT + 1] = {0};
+    int used[STAGE_COUNT] = {0};
+
+    if (i == 0) {
+      wall_start = ns_time();
+      cpu_start = cpu_time();
+    }
+
+    ts[STAGE_CAPTURE] = ns_time();
+    v4l2_frame_buff_t *frame = v4l2core_get_frame(vd);
+    if (frame == NULL) {
+      failures++;
+      continue;
+    }
+    failures = 0;
+    used[STAGE_CAPTURE] = 1;
+
+    ts[STAGE_DECODE] = ns_time();
+    int decoded = (v4l2core_frame_convert(vd, frame, V4L2_PIX_FMT_YUV420,
+                                          frame->yuv_frame) == E_OK);
+    used[STAGE_DECODE] = decoded;
+
+    ts[STAGE_FX] = ns_time();
+    if (decoded && opts->fx_mask != REND_FX_YUV_NOFILT) {
+      render_fx_apply(frame->yuv_frame, width, height, opts->fx_mask);
+      used[STAGE_FX] = 1;
+    }
+
+    ts[STAGE_PREVIEW] = ns_time();
+    used[STAGE_PREVIEW] =
+        (v4l2core_frame_convert(vd, frame, V4L2_PIX_FMT_RGB24, rgb) == E_OK);
+
+    ts[STAGE_ENCODE] = ns_time();
+    if (encoder_ctx != NULL) {
+      uint8_t *input_frame = frame->yuv_frame;
+      int size = (width * height * 3) / 2;
+      int nal_count = 0;
+
+      if (encoder_check_raw_muxer(muxer)) {
+        if (!decoded)
+          input_frame = NULL;
+      } else if (codec_ind == 0) {
+        if (src->pixelformat == V4L2_PIX_FMT_H264) {
+          input_frame = frame->h264_frame;
+          size = (int)frame->h264_frame_size;
+          nal_count = frame->h264_nal_count;
+        } else {
+          input_frame = frame->raw_frame;
+          size = (int)frame->raw_frame_size;
+        }
+      } else if (!decoded)
+        input_frame = NULL;
+
+      if (input_frame != NULL) {
+        encoder_add_video_frame_nal(input_frame, size, frame->timestamp,
+                                    frame->isKeyframe, frame->h264_nal_offset,
+                                    frame->h264_nal_size, nal_count);
+        encoder_process_next_video_buffer(encoder_ctx);
+        used[STAGE_ENCODE] = 1;
+      }
+    }
+    ts[STAGE_COUNT] = ns_time();
+
+    v4l2core_release_frame(vd, frame);
+
+    if (i >= 0) {
+      int s = 0;
+      for (s = 0; s < STAGE_COUNT; s++) {
+        if (used[s])
+          stage_ns[s][stage_count[s]++] = ts[s + 1] - ts[s];
+      }
+      nframes++;
+    }
+    i++;
+  }
+
+  uint64_t wall_time = ns_time() - wall_start;
+  uint64_t cpu = cpu_time() - cpu_start;
+
+  v4l2core_stop_stream(vd);
+
+  if (nframes == 0) {
+    error = "no frames captured";
+    goto finish;
+  }
+
+  long output_bytes = 0;
+  if (encoder_ctx != NULL) {
+    encoder_flush_video_buffer(encoder_ctx);
+    encoder_muxer_close(encoder_ctx);
+    encoder_close(encoder_ctx);
+    encoder_ctx = NULL;
+
+    struct stat st;
+    if (stat(outfile, &st) == 0)
+      output_bytes = (long)st.st_size;
+  }
+
+  json_entry_start(fp, src, codec_ind, muxer, first);
+  fprintf(fp,
+          ", \"frames\": %i, \"fps\": %.2f, \"cpu_ms_per_frame\": %.3f, "
+          "\"mem_hwm_kb\": %ld, \"output_bytes\": %ld,",
+          nframes, (double)nframes * NSEC_PER_SEC / (double)wall_time,
+          (double)cpu / (1000000.0 * nframes), get_mem_hwm(), output_bytes);
+  if (tuned)
+    fprintf(fp, " \"speed\": %i, \"threads\": %i,", profile.speed,
+            profile.thread_count);
+  fprintf(fp, "\n     \"stages\": {");
+
+  int first_stage = 1;
+  for (i = 0; i < STAGE_COUNT; i++) {
+    int n = stage_count[i];
+    if (n == 0)
+      continue;
+
+    uint64_t total = 0;
+    int k = 0;
+    for (k = 0; k < n; k++)
+      total += stage_ns[i][k];
+    qsort(stage_ns[i], n, sizeof(uint64_t), compare_u64);
+
+    fprintf(fp,
+            "%s\n       \"%s\": {\"p50_us\": %.1f, \"p99_us\": %.1f, "
+            "\"mean_us\": %.1f}",
+            first_stage ? "" : ",", stage_name[i],
+            stage_ns[i][((n - 1) * 50) / 100] / 1000.0,
+            stage_ns[i][((n - 1) * 99) / 100] / 1000.0,
+            (double)total / (1000.0 * n));
+    first_stage = 0;
+  }
+  fprintf(fp, "}}");
+
+finish:
+  if (error != NULL) {
+    fprintf(stderr, "neoguvc_bench: %s (%s)\n", error, src->path);
+    json_entry_start(fp, src, codec_ind, muxer, first);
+    fprintf(fp, ", \"error\": ");
+    json_string(fp, error);
+    fprintf(fp, "}");
+  }
+
+  if (encoder_ctx != NULL) {
+    encoder_muxer_close(encoder_ctx);
+    encoder_close(encoder_ctx);
+  }
+  if (outfile[0] != '\0') {
+    unlink(outfile);
+    /*raw sinks timestamp sidecar*/
+    char index[PATH_MAX + 8];
+    snprintf(index, sizeof(index), "%s.idx", outfile);
+    unlink(index);
+  }
+  if (vd != NULL)
+    v4l2core_close_dev(vd);
+  render_clean_fx();
+
+  for (i = 0; i < STAGE_COUNT; i++)
+    free(stage_ns[i]);
+  free(rgb);
+
+  fflush(fp);
+  return (error == NULL) ? 0 : -1;
+}
+
+/*
+ * splits a comma separated list
+ * args:
+ *   list - list string (modified)
+ *   items - pointer to items array
+ *   max_items - items array size
+ *
+ * asserts:
+ *   none
+ *
+ * returns: number of items
+ */
+static int split_list(char *list, char **items, int max_items) {
+  int n = 0;
+  char *saveptr = NULL;
+  char *item = strtok_r(list, ",", &saveptr);
+  while (item != NULL && n < max_items) {
+    items[n++] = item;
+    item = strtok_r(NULL, ",", &saveptr);
+  }
+  return n;
+}
+
+/*
+ * prints usage
+ * args:
+ *   name - program name
+ *
+ * asserts:
+ *   none
+ *
+ * returns: none
+ */
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [--frames N] [--formats YUYV,NV12,YU12,GRBG,MJPG]\n"
+          "          [--sizes 640x480,1280x720] [--codecs raw,H264,...|none]\n"
+          "          [--muxers mkv,webm,avi,y4m,yuv] [--fx mask]\n"
+          "          [--replay file]...\n"
+          "          [--tune] [--threads N] [--output file] [-v]\n",
+          name);
+}
+
+int main(int argc, char *argv[]) {
+  char formats_arg[256] = "YUYV,NV12,YU12,GRBG,MJPG";
+  char sizes_arg[256] = "640x480,1280x720";
+  char muxers_arg[64] = "mkv,avi";
+  char *codecs_arg = NULL;
+  const char *output = NULL;
+  const char *replay[MAX_LIST_ITEMS];
+  int nreplay = 0;
+  int synthetic = 0;
+
+  bench_options_t opts;
+  memset(&opts, 0, sizeof(bench_options_t));
+  opts.frames = 300;
+
+  int i = 0;
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      opts.frames = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--formats") == 0 && i + 1 < argc) {
+      strncpy(formats_arg, argv[++i], sizeof(formats_arg) - 1);
+      synthetic = 1;
+    } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+      strncpy(sizes_arg, argv[++i], sizeof(sizes_arg) - 1);
+      synthetic = 1;
+    } else if (strcmp(argv[i], "--codecs") == 0 && i + 1 < argc)
+      codecs_arg = argv[++i];
+    else if (strcmp(argv[i], "--muxers") == 0 && i + 1 < argc)
+      strncpy(muxers_arg, argv[++i], sizeof(muxers_arg) - 1);
+    else if (strcmp(argv[i], "--fx") == 0 && i + 1 < argc)
+      opts.fx_mask = (uint32_t)strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc &&
+             nreplay < MAX_LIST_ITEMS)
+      replay[nreplay++] = argv[++i];
+    else if (strcmp(argv[i], "--tune") == 0)
+      opts.tune = 1;
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      opts.threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+      output = argv[++i];
+    else if (strcmp(argv[i], "-v") == 0)
+      verbosity++;
+    else {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+
+  if (opts.frames <= 0) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  encoder_set_verbosity(verbosity);
+  render_set_verbosity(verbosity);
+
+  /*video codecs (default: all valid codecs)*/
+  if (codecs_arg != NULL) {
+    char *items[MAX_LIST_ITEMS];
+    int n = split_list(codecs_arg, items, MAX_LIST_ITEMS);
+    for (i = 0; i < n; i++) {
+      int ind = -1;
+      if (strcasecmp(items[i], "none") != 0) {
+        ind = encoder_get_video_codec_ind_4cc(items[i]);
+        if (ind < 0 || ind >= encoder_get_valid_video_codecs()) {
+          fprintf(stderr, "neoguvc_bench: video codec %s not available\n",
+                  items[i]);
+          continue;
+        }
+      }
+      opts.codec_ind[opts.ncodecs++] = ind;
+    }
+  } else {
+    int n = encoder_get_valid_video_codecs();
+    for (i = 0; i < n && opts.ncodecs < MAX_LIST_ITEMS; i++)
+      opts.codec_ind[opts.ncodecs++] = i;
+  }
+
+  /*muxers*/
+  char *items[MAX_LIST_ITEMS];
+  int n = split_list(muxers_arg, items, MAX_LIST_ITEMS);
+  for (i = 0; i < n; i++) {
+    if (strcasecmp(items[i], "mkv") == 0)
+      opts.muxer[opts.nmuxers++] = ENCODER_MUX_MKV;
+    else if (strcasecmp(items[i], "webm") == 0)
+      opts.muxer[opts.nmuxers++] = ENCODER_MUX_WEBM;
+    else if (strcasecmp(items[i], "avi") == 0)
+      opts.muxer[opts.nmuxers++] = ENCODER_MUX_AVI;
+    else if (strcasecmp(items[i], "y4m") == 0)
+      opts.muxer[opts.nmuxers++] = ENCODER_MUX_Y4M;
+    else if (strcasecmp(items[i], "yuv") == 0)
+      opts.muxer[opts.nmuxers++] = ENCODER_MUX_YUV;
+    else
+      fprintf(stderr, "neoguvc_bench: unknown muxer %s\n", items[i]);
+  }
+
+  if (opts.ncodecs == 0 || opts.nmuxers == 0) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  const char *tmp = getenv("TMPDIR");
+  snprintf(opts.tmpdir, sizeof(opts.tmpdir), "%s/neoguvc_bench.XXXXXX",
+           tmp ? tmp : "/tmp");
+  if (mkdtemp(opts.tmpdir) == NULL) {
+    fprintf(stderr, "neoguvc_bench: couldn't create a temporary dir: %s\n",
+            strerror(errno));
+    return -1;
+  }
+
+  /*sources: synthetic (format x size) and replay files*/
+  int max_sources = MAX_LIST_ITEMS * MAX_LIST_ITEMS + nreplay;
+  bench_source_t *sources = calloc(max_sources, sizeof(bench_source_t));
+  if (sources == NULL) {
+    fprintf(stderr, "neoguvc_bench: FATAL memory allocation failure: %s\n",
+            strerror(errno));
+    exit(-1);
+  }
+  int nsources = 0;
+
+  char *formats[MAX_LIST_ITEMS];
+  char *sizes[MAX_LIST_ITEMS];
+  int nformats = split_list(formats_arg, formats, MAX_LIST_ITEMS);
+  int nsizes = split_list(sizes_arg, sizes, MAX_LIST_ITEMS);
+  /*only the replay files unless synthetic formats or sizes were requested*/
+  if (nreplay > 0 && !synthetic)
+    nformats = 0;
+
+  for (i = 0; i < nformats; i++) {
+    int s = 0;
+    for (s = 0; s < nsizes; s++) {
+      bench_source_t *src = &sources[nsources];
+      src->origin = "synthetic";
+      src->pixelformat = v4l2core_fourcc_2_v4l2_pixelformat(formats[i]);
+      if (sscanf(sizes[s], "%dx%d", &src->width, &src->height) != 2 ||
+          src->width < 16 || src->height < 16 || (src->width & 1) ||
+          (src->height & 1)) {
+        fprintf(stderr, "neoguvc_bench: bad frame size %s\n", sizes[s]);
+        continue;
+      }
+
+      fprintf(stderr, "neoguvc_bench: generating %s %s\n", formats[i],
+              sizes[s]);
+      if (make_synthetic_source(src, opts.tmpdir) == 0)
+        nsources++;
+    }
+  }
+
+  for (i = 0; i < nreplay; i++) {
+    if (load_replay_source(&sources[nsources], replay[i]) == 0)
+      nsources++;
+  }
+
+  FILE *fp = stdout;
+  if (output != NULL) {
+    fp = fopen(output, "w");
+    if (fp == NULL) {
+      fprintf(stderr, "neoguvc_bench: couldn't create %s: %s\n", output,
+              strerror(errno));
+      fp = stdout;
+    }
+  }
+
+  fprintf(fp, "{\n  \"version\": ");
+  json_string(fp, PACKAGE_STRING);
+  fprintf(fp, ",\n  \"warmup_frames\": %i,\n  \"fx_mask\": %u,\n"
+              "  \"results\": [",
+          WARMUP_FRAMES, opts.fx_mask);
+
+  int first = 1;
+  int failed = 0;
+  for (i = 0; i < nsources; i++) {
+    int c = 0;
+    for (c = 0; c < opts.ncodecs; c++) {
+      int m = 0;
+      for (m = 0; m < opts.nmuxers; m++) {
+        int codec_ind = opts.codec_ind[c];
+        int muxer = (codec_ind < 0) ? -1 : opts.muxer[m];
+
+        /*webm codecs (vp8/vp9) can't be muxed in avi*/
+        if (muxer == ENCODER_MUX_AVI &&
+            encoder_check_webm_video_codec(codec_ind))
+          continue;
+        /*raw sinks store yu12 frames (raw codec only)*/
+        if (codec_ind != 0 && encoder_check_raw_muxer(muxer))
+          continue;
+
+        fprintf(stderr, "neoguvc_bench: %s %ix%i codec %i muxer %s\n",
+                sources[i].origin, sources[i].width, sources[i].height,
+                codec_ind, muxer < 0 ? "none" : muxer_name[muxer]);
+
+        if (run_combination(fp, &sources[i], codec_ind, muxer, &opts,
+                            &first) != 0)
+          failed++;
+
+        if (codec_ind < 0)
+          break; /*no muxer*/
+      }
+    }
+  }
+
+  fprintf(fp, "\n  ]\n}\n");
+  if (fp != stdout)
+    fclose(fp);
+
+  /*clean up the synthetic sources*/
+  for (i = 0; i < nsources; i++) {
+    if (strcmp(sources[i].origin, "synthetic") == 0)
+      unlink(sources[i].path);
+  }
+  rmdir(opts.tmpdir);
+  free(sources);
+
+  return (failed == 0) ? 0 : -1;
+}
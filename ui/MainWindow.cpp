@@ -53,6 +53,15 @@ constexpr int kWindowWidth = 640;
 constexpr int kWindowHeight = 360;
 constexpr int kCameraDisplayWidth = 640;
 constexpr int kCameraDisplayHeight = 360;
+constexpr std::chrono::milliseconds kRateControlInterval{250};
+constexpr std::chrono::milliseconds kEncoderIdleWait{10};
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
 
 enum class IconShape { Circle, RoundedSquare };
 
@@ -170,6 +179,8 @@ MainWindow::MainWindow() {
   current_device_path_ = kDefaultDevice;
 
   dispatcher_.connect(sigc::mem_fun(*this, &MainWindow::on_frame_ready));
+  device_list_dispatcher_.connect(
+      sigc::mem_fun(*this, &MainWindow::on_device_list_changed));
 
   auto css = Gtk::CssProvider::create();
   auto css_path = "/usr/share/neoguvc/style.css";
@@ -377,9 +388,14 @@ MainWindow::MainWindow() {
   capture_flash_frame_.hide();
   initialise_audio();
   initialise_device();
+
+  // hotplug: the device list is kept current by the core monitor thread
+  v4l2core_add_device_list_callback(&MainWindow::on_device_list_event, this);
 }
 
 MainWindow::~MainWindow() {
+  v4l2core_remove_device_list_callback(&MainWindow::on_device_list_event,
+                                       this);
   stop_capture_thread();
   stop_recording();
   stop_stream();
@@ -388,6 +404,8 @@ MainWindow::~MainWindow() {
     audio_close(audio_ctx_);
     audio_ctx_ = nullptr;
   }
+  if (tune_thread_.joinable())
+    tune_thread_.join();
 }
 
 void MainWindow::initialise_device() {
@@ -428,6 +446,54 @@ void MainWindow::stop_stream() {
   }
 }
 
+void MainWindow::close_device_windows() {
+  // image controls keep the device handle and its control list: close them
+  // before either is freed
+  for (auto &entry : config_windows_) {
+    if (!dynamic_cast<ImageControls *>(entry.window.get()))
+      continue;
+    if (entry.hide_connection.connected())
+      entry.hide_connection.disconnect();
+    entry.window.reset();
+  }
+}
+
+void MainWindow::on_device_list_event(void *data) {
+  // called from the core device monitor thread
+  static_cast<MainWindow *>(data)->device_list_dispatcher_.emit();
+}
+
+void MainWindow::on_device_list_changed() {
+  if (!v4l2core_check_device_list_events())
+    return;
+
+  const int num_devices = v4l2core_get_num_devices();
+  const bool current_present =
+      num_devices > 0 && !current_device_path_.empty() &&
+      v4l2core_get_device_index(current_device_path_.c_str()) >= 0;
+
+  if (device_ && !current_present) {
+    post_status("Câmera desconectada: " + current_device_path_);
+    stop_capture_thread();
+    stop_recording();
+    close_device_windows();
+    stop_stream();
+    show_no_camera_warning();
+  } else if (!device_ && num_devices > 0) {
+    if (!current_present) {
+      auto *sys_data = v4l2core_get_device_sys_data(0);
+      if (sys_data && sys_data->device)
+        current_device_path_ = sys_data->device;
+    }
+    initialise_device();
+  }
+
+  for (auto &entry : config_windows_) {
+    if (auto *controls = dynamic_cast<VideoControls *>(entry.window.get()))
+      controls->refresh_devices();
+  }
+}
+
 void MainWindow::stop_capture_thread() {
   running_.store(false, std::memory_order_release);
   if (capture_thread_.joinable())
@@ -489,7 +555,13 @@ bool MainWindow::reconfigure_video(
       mutator(vd);
   };
 
-  return reopen_video_device(current_device_path_, initializer);
+  if (!reopen_video_device(current_device_path_, initializer))
+    return false;
+
+  // new size or frame rate: re-tune the selected software codec
+  if (record_settings().codec_ind > 0)
+    request_encoder_tuning();
+  return true;
 }
 
 bool MainWindow::switch_device(const std::string &device_path) {
@@ -516,6 +588,7 @@ bool MainWindow::reopen_video_device(
   stop_capture_thread();
 
   if (device_) {
+    close_device_windows();
     v4l2core_stop_stream(device_);
     v4l2core_close_dev(device_);
     device_ = nullptr;
@@ -563,21 +636,34 @@ void MainWindow::capture_loop() {
       continue;
     }
 
-    v4l2_frame_buff_t *frame = v4l2core_get_decoded_frame(device_);
+    v4l2_frame_buff_t *frame = v4l2core_get_frame(device_);
     if (!frame) {
       std::this_thread::sleep_for(kRetryDelay);
       continue;
     }
 
+    // frames are only decoded to yu12 when something needs it (effects,
+    // encoder, compressed sources); the preview converts from the raw
+    // format directly whenever a kernel path exists
+    // (fx and preview latencies go to the core stats: v4l2core_get_stats)
     const uint32_t fx_mask = render_fx_mask_.load(std::memory_order_relaxed);
-    if (fx_mask != REND_FX_YUV_NOFILT)
+    if (fx_mask != REND_FX_YUV_NOFILT &&
+        v4l2core_frame_convert(device_, frame, V4L2_PIX_FMT_YUV420,
+                               frame->yuv_frame) == E_OK) {
+      const auto fx_start = std::chrono::steady_clock::now();
       render_fx_apply(frame->yuv_frame, frame_width_, frame_height_, fx_mask);
+      v4l2core_add_stage_latency(device_, V4L2_STAGE_FX, elapsed_ns(fx_start));
+    }
 
     {
       std::lock_guard<std::mutex> guard(frame_mutex_);
-      yu12_to_rgb24(rgb_buffer_.data(), frame->yuv_frame, frame_width_,
-                    frame_height_);
-      pending_frame_ = true;
+      const auto preview_start = std::chrono::steady_clock::now();
+      if (v4l2core_frame_convert(device_, frame, V4L2_PIX_FMT_RGB24,
+                                 rgb_buffer_.data()) == E_OK) {
+        v4l2core_add_stage_latency(device_, V4L2_STAGE_PREVIEW,
+                                   elapsed_ns(preview_start));
+        pending_frame_ = true;
+      }
     }
 
     if (snapshot_request_.exchange(false)) {
@@ -652,6 +738,17 @@ void MainWindow::on_config_window_hidden(const std::string &id) {
 }
 
 void MainWindow::on_frame_ready() {
+  // a stale capabilities cache is enumerated again on this thread (the
+  // lists are ours): rebuild whatever holds format or control data
+  if (device_ && v4l2core_check_device_caps(device_)) {
+    post_status("Capacidades da câmera mudaram, listas atualizadas");
+    close_device_windows();
+    for (auto &entry : config_windows_) {
+      if (auto *controls = dynamic_cast<VideoControls *>(entry.window.get()))
+        controls->refresh_devices();
+    }
+  }
+
   std::vector<uint8_t> local_copy;
   {
     std::lock_guard<std::mutex> guard(frame_mutex_);
@@ -1065,9 +1162,29 @@ std::string MainWindow::build_output_path(bool video) const {
   else
     base = ".";
 
+  std::string extension = ".jpg";
+  if (video) {
+    switch (encoder_ctx_ ? encoder_ctx_->muxer_id : record_settings().muxer) {
+    case ENCODER_MUX_WEBM:
+      extension = ".webm";
+      break;
+    case ENCODER_MUX_AVI:
+      extension = ".avi";
+      break;
+    case ENCODER_MUX_Y4M:
+      extension = ".y4m";
+      break;
+    case ENCODER_MUX_YUV:
+      extension = ".yuv";
+      break;
+    default:
+      extension = ".mkv";
+      break;
+    }
+  }
+
   std::string filename =
-      std::string("guvcview_") + timestamp_string() +
-      (video ? ".mkv" : ".jpg");
+      std::string("guvcview_") + timestamp_string() + extension;
   if (!base.empty())
     g_mkdir_with_parents(base.c_str(), 0755);
 
@@ -1176,19 +1293,92 @@ bool MainWindow::start_recording(v4l2_frame_buff_t *frame) {
     }
   }
 
+  const RecordSettings settings = record_settings();
+  int video_codec = settings.codec_ind;
+  int audio_codec = 0;
+  int muxer = settings.muxer;
+  if (video_codec < 0 || video_codec >= encoder_get_valid_video_codecs())
+    video_codec = 0;
+
+  // raw sinks store the yu12 frames (no codec, no audio)
+  if (encoder_check_raw_muxer(muxer)) {
+    video_codec = 0;
+    audio_channels = 0;
+  }
+
+  // webm only takes vp8/vp9 video and vorbis/opus audio
+  if (muxer == ENCODER_MUX_WEBM) {
+    const int webm_codec = encoder_check_webm_video_codec(video_codec)
+                               ? video_codec
+                               : encoder_get_webm_video_codec_index();
+    const int webm_audio = encoder_get_webm_audio_codec_index();
+    if (webm_codec < 0) {
+      post_status("WebM indisponível, a gravar em MKV");
+      muxer = ENCODER_MUX_MKV;
+    } else {
+      video_codec = webm_codec;
+      if (webm_audio >= 0)
+        audio_codec = webm_audio;
+      else
+        audio_channels = 0;
+    }
+  }
+
+  // use the auto-tuner profile when it matches this recording
+  encoder_video_profile_t profile{};
+  if (video_codec > 0) {
+    std::lock_guard<std::mutex> lock(tune_mutex_);
+    if (tune_valid_ && tune_key_ == TuneKey(video_codec, frame_width_,
+                                            frame_height_, fps_num, fps_den))
+      profile = tune_profile_;
+  }
+  // bit rate 0 keeps the codec table default
+  profile.bit_rate = settings.bit_rate > 0 ? settings.bit_rate : 0;
+
   {
     std::lock_guard<std::mutex> lock(encoder_mutex_);
-    encoder_ctx_ =
-        encoder_init(v4l2core_get_requested_frame_format(device_), 0, 0,
-                     ENCODER_MUX_MKV, frame_width_, frame_height_, fps_num,
-                     fps_den, audio_channels, audio_samprate);
+    encoder_ctx_ = encoder_init_profile(
+        v4l2core_get_requested_frame_format(device_), video_codec,
+        audio_codec, muxer, frame_width_, frame_height_, fps_num, fps_den,
+        audio_channels, audio_samprate, &profile);
     if (!encoder_ctx_) {
       post_status("Falha ao iniciar encoder");
       return false;
     }
 
     current_video_path_ = build_output_path(true);
-    encoder_muxer_init(encoder_ctx_, current_video_path_.c_str());
+    if (encoder_muxer_init(encoder_ctx_, current_video_path_.c_str()) != 0) {
+      encoder_muxer_close(encoder_ctx_);
+      encoder_close(encoder_ctx_);
+      encoder_ctx_ = nullptr;
+      post_status("Falha ao abrir " + current_video_path_);
+      current_video_path_.clear();
+      return false;
+    }
+    start_encoder_thread();
+
+    const bool direct_h264 =
+        encoder_ctx_->video_codec_ind == 0 &&
+        !encoder_check_raw_muxer(encoder_ctx_->muxer_id) &&
+        v4l2core_get_requested_frame_format(device_) == V4L2_PIX_FMT_H264;
+
+    // direct h264: start the file with the frames since the last IDR
+    // (already captured); with no complete gop ask the camera for an IDR
+    gop_replay_last_ts_ = 0;
+    wait_keyframe_ = false;
+    if (direct_h264 &&
+        v4l2core_h264_replay_gop(device_, &MainWindow::on_gop_frame, this) <=
+            0) {
+      v4l2core_h264_request_idr(device_);
+      wait_keyframe_ = true;
+    }
+
+    // direct h264: ease the camera bit rate when the writer lags
+    h264_rate_control_ =
+        direct_h264 && v4l2core_h264_rate_control_enable(device_, 1) == E_OK;
+    rc_last_update_ = std::chrono::steady_clock::now();
+    rc_last_io_ns_ = 0;
+    rc_last_ring_full_ = 0;
   }
   recording_.store(true, std::memory_order_release);
   Glib::signal_idle().connect_once([this]() {
@@ -1211,12 +1401,27 @@ void MainWindow::handle_recording_frame(v4l2_frame_buff_t *frame) {
 
   int size = (frame->width * frame->height * 3) / 2;
   uint8_t *input_frame = frame->yuv_frame;
+  int nal_count = 0;
+
+  // software codecs and raw sinks take yu12 frames
+  const bool yu12_input = encoder_ctx_->video_codec_ind != 0 ||
+                          encoder_check_raw_muxer(encoder_ctx_->muxer_id);
+  if (yu12_input &&
+      v4l2core_frame_convert(device_, frame, V4L2_PIX_FMT_YUV420,
+                             frame->yuv_frame) != E_OK)
+    return;
 
-  if (encoder_ctx_->video_codec_ind == 0) {
+  if (!yu12_input) {
     switch (v4l2core_get_requested_frame_format(device_)) {
     case V4L2_PIX_FMT_H264:
+      // already in the file (gop replay) or before the requested IDR
+      if (frame->timestamp <= gop_replay_last_ts_ ||
+          (wait_keyframe_ && !frame->isKeyframe))
+        return;
+      wait_keyframe_ = false;
       input_frame = frame->h264_frame;
       size = static_cast<int>(frame->h264_frame_size);
+      nal_count = frame->h264_nal_count;
       break;
     default:
       input_frame = frame->raw_frame;
@@ -1225,9 +1430,142 @@ void MainWindow::handle_recording_frame(v4l2_frame_buff_t *frame) {
     }
   }
 
-  encoder_add_video_frame(input_frame, size, frame->timestamp,
-                          frame->isKeyframe);
-  encoder_process_next_video_buffer(encoder_ctx_);
+  encoder_add_video_frame_nal(input_frame, size, frame->timestamp,
+                              frame->isKeyframe, frame->h264_nal_offset,
+                              frame->h264_nal_size, nal_count);
+  encoder_wait_cv_.notify_one();
+
+  if (h264_rate_control_)
+    update_h264_rate_control();
+}
+
+void MainWindow::on_gop_frame(uint8_t *frame, int size, uint64_t timestamp,
+                              int keyframe, void *data) {
+  // called by v4l2core_h264_replay_gop (encoder_mutex_ is held)
+  auto *self = static_cast<MainWindow *>(data);
+  encoder_add_video_frame(frame, size, static_cast<int64_t>(timestamp),
+                          keyframe);
+  self->gop_replay_last_ts_ = timestamp;
+}
+
+void MainWindow::update_h264_rate_control() {
+  const auto now = std::chrono::steady_clock::now();
+  const auto interval = now - rc_last_update_;
+  if (interval < kRateControlInterval)
+    return;
+
+  encoder_stats_t stats;
+  encoder_get_stats(&stats);
+
+  // ring fill: frames waiting to be encoded (dropping counts as full)
+  double ring_fill = 0.0;
+  if (stats.video_ring_size > 0)
+    ring_fill = static_cast<double>(stats.video_ring_used) /
+                stats.video_ring_size;
+  if (stats.video_ring_full > rc_last_ring_full_)
+    ring_fill = 1.0;
+
+  // io load: share of the interval spent blocked on disk writes
+  const uint64_t interval_ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count());
+  const uint64_t io_ns = stats.io_write_ns - rc_last_io_ns_;
+  const double io_load = static_cast<double>(io_ns) / interval_ns;
+
+  v4l2core_h264_rate_control_update(device_, ring_fill, io_load);
+
+  rc_last_update_ = now;
+  rc_last_io_ns_ = stats.io_write_ns;
+  rc_last_ring_full_ = stats.video_ring_full;
+}
+
+void MainWindow::start_encoder_thread() {
+  encoder_thread_running_.store(true, std::memory_order_release);
+  encoder_thread_ = std::thread(&MainWindow::encoder_loop, this, encoder_ctx_);
+}
+
+void MainWindow::stop_encoder_thread() {
+  encoder_thread_running_.store(false, std::memory_order_release);
+  encoder_wait_cv_.notify_one();
+  if (encoder_thread_.joinable())
+    encoder_thread_.join();
+}
+
+void MainWindow::encoder_loop(encoder_context_t *encoder_ctx) {
+  // the context outlives the thread (stop_recording joins before closing)
+  while (encoder_thread_running_.load(std::memory_order_acquire)) {
+    if (encoder_process_next_video_buffer(encoder_ctx) == 0)
+      continue;
+
+    std::unique_lock<std::mutex> lock(encoder_wait_mutex_);
+    encoder_wait_cv_.wait_for(lock, kEncoderIdleWait);
+  }
+}
+
+MainWindow::RecordSettings MainWindow::record_settings() const {
+  std::lock_guard<std::mutex> lock(record_settings_mutex_);
+  return record_settings_;
+}
+
+void MainWindow::set_record_settings(const RecordSettings &settings) {
+  {
+    std::lock_guard<std::mutex> lock(record_settings_mutex_);
+    record_settings_ = settings;
+  }
+  if (settings.codec_ind > 0)
+    request_encoder_tuning();
+}
+
+MainWindow::TuneKey MainWindow::current_tune_key() const {
+  int fps_num = device_ ? v4l2core_get_fps_num(device_) : 0;
+  int fps_den = device_ ? v4l2core_get_fps_denom(device_) : 0;
+  if (fps_num <= 0 || fps_den <= 0) {
+    fps_num = 30;
+    fps_den = 1;
+  }
+  return TuneKey(record_settings().codec_ind, frame_width_, frame_height_,
+                 fps_num, fps_den);
+}
+
+void MainWindow::request_encoder_tuning() {
+  if (!device_ || frame_width_ <= 0 || frame_height_ <= 0)
+    return;
+
+  const TuneKey key = current_tune_key();
+  std::lock_guard<std::mutex> lock(tune_mutex_);
+  if (tune_valid_ && tune_key_ == key)
+    return;
+  tune_request_ = key;
+  tune_pending_ = true;
+  if (tune_running_)
+    return; // picked up by the running tuner
+
+  if (tune_thread_.joinable())
+    tune_thread_.join();
+  tune_running_ = true;
+  tune_thread_ = std::thread(&MainWindow::tune_loop, this);
+}
+
+void MainWindow::tune_loop() {
+  std::unique_lock<std::mutex> lock(tune_mutex_);
+  while (tune_pending_) {
+    tune_pending_ = false;
+    const TuneKey key = tune_request_;
+    lock.unlock();
+
+    encoder_video_profile_t profile{};
+    const bool tuned =
+        encoder_tune_video_profile(std::get<0>(key), std::get<1>(key),
+                                   std::get<2>(key), std::get<3>(key),
+                                   std::get<4>(key), &profile) == 0;
+
+    lock.lock();
+    if (tuned) {
+      tune_key_ = key;
+      tune_profile_ = profile;
+      tune_valid_ = true;
+    }
+  }
+  tune_running_ = false;
 }
 
 void MainWindow::stop_recording() {
@@ -1241,6 +1579,7 @@ void MainWindow::stop_recording() {
       record_button_icon_->set(record_icon_idle_);
   });
   stop_audio_capture();
+  stop_encoder_thread();
   {
     std::lock_guard<std::mutex> lock(encoder_mutex_);
     if (encoder_ctx_) {
@@ -1251,6 +1590,9 @@ void MainWindow::stop_recording() {
       encoder_close(encoder_ctx_);
       encoder_ctx_ = nullptr;
     }
+    if (h264_rate_control_ && device_)
+      v4l2core_h264_rate_control_enable(device_, 0);
+    h264_rate_control_ = false;
   }
   if (!current_video_path_.empty())
     current_video_path_.clear();
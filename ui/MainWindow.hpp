@@ -1,11 +1,14 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <vector>
 
 #include <gtkmm/box.h>
@@ -61,11 +64,22 @@ public:
   int audio_api() const;
   int audio_device_index() const;
 
+  struct RecordSettings {
+    int codec_ind = 0;           // encoder video codec (0 - camera stream)
+    int muxer = ENCODER_MUX_MKV; // ENCODER_MUX_*
+    int bit_rate = 0;            // video bit rate (0 - codec default)
+  };
+  RecordSettings record_settings() const;
+  void set_record_settings(const RecordSettings &settings);
+
 private:
   void initialise_device();
   void capture_loop();
   void on_frame_ready();
   void stop_stream();
+  void close_device_windows();
+  static void on_device_list_event(void *data);
+  void on_device_list_changed();
 
   void on_save_profile_activate();
   void on_open_images_directory();
@@ -118,6 +132,7 @@ private:
   Glib::RefPtr<Gdk::Pixbuf> record_icon_active_glow_;
   Gtk::Menu menu_popup_;
   Glib::Dispatcher dispatcher_;
+  Glib::Dispatcher device_list_dispatcher_;
 
   v4l2_dev_t *device_ = nullptr;
   std::thread capture_thread_;
@@ -136,6 +151,35 @@ private:
 
   encoder_context_t *encoder_ctx_ = nullptr;
   std::string current_video_path_;
+  mutable std::mutex record_settings_mutex_;
+  RecordSettings record_settings_;
+
+  // video encoding runs in its own thread (the capture thread only queues)
+  std::thread encoder_thread_;
+  std::atomic<bool> encoder_thread_running_{false};
+  std::mutex encoder_wait_mutex_;
+  std::condition_variable encoder_wait_cv_;
+
+  // encoder profile picked by the auto-tuner (codec, size and frame rate)
+  using TuneKey = std::tuple<int, int, int, int, int>;
+  std::thread tune_thread_;
+  std::mutex tune_mutex_;
+  bool tune_running_ = false;
+  bool tune_pending_ = false;
+  bool tune_valid_ = false;
+  TuneKey tune_key_;
+  TuneKey tune_request_;
+  encoder_video_profile_t tune_profile_{};
+
+  // direct h264: recording starts from the camera gop (no IDR round-trip)
+  uint64_t gop_replay_last_ts_ = 0;
+  bool wait_keyframe_ = false;
+
+  // camera h264 bit rate control (recording backpressure)
+  bool h264_rate_control_ = false;
+  std::chrono::steady_clock::time_point rc_last_update_;
+  uint64_t rc_last_io_ns_ = 0;
+  uint64_t rc_last_ring_full_ = 0;
 
   audio_context_t *audio_ctx_ = nullptr;
   audio_buff_t *audio_buffer_ = nullptr;
@@ -153,6 +197,15 @@ private:
   void on_config_window_hidden(const std::string &id);
   void save_snapshot(v4l2_frame_buff_t *frame);
   void handle_recording_frame(v4l2_frame_buff_t *frame);
+  static void on_gop_frame(uint8_t *frame, int size, uint64_t timestamp,
+                           int keyframe, void *data);
+  void update_h264_rate_control();
+  void start_encoder_thread();
+  void stop_encoder_thread();
+  void encoder_loop(encoder_context_t *encoder_ctx);
+  TuneKey current_tune_key() const;
+  void request_encoder_tuning();
+  void tune_loop();
   bool start_recording(v4l2_frame_buff_t *frame);
   void stop_recording();
   std::string build_output_path(bool video) const;
@@ -2,6 +2,8 @@
 
 #include "MainWindow.hpp"
 
+#include <algorithm>
+
 #include <gtkmm/grid.h>
 #include <sigc++/bind.h>
 
@@ -36,6 +38,28 @@ const std::vector<std::pair<uint32_t, Glib::ustring>> &video_filters() {
       {REND_FX_YUV_BINARY, "Binary"}};
   return kFilters;
 }
+
+// Recording containers (ENCODER_MUX_*) and video bit rates (0 - codec default).
+const std::vector<std::pair<int, Glib::ustring>> &record_muxers() {
+  static const std::vector<std::pair<int, Glib::ustring>> kMuxers = {
+      {ENCODER_MUX_MKV, "Matroska (MKV)"},
+      {ENCODER_MUX_WEBM, "WebM"},
+      {ENCODER_MUX_AVI, "AVI"},
+      {ENCODER_MUX_Y4M, "Y4M (sem compressão)"},
+      {ENCODER_MUX_YUV, "YUV planar + índice (sem compressão)"}};
+  return kMuxers;
+}
+
+const std::vector<std::pair<int, Glib::ustring>> &record_bit_rates() {
+  static const std::vector<std::pair<int, Glib::ustring>> kBitRates = {
+      {0, "Padrão do codec"},
+      {1000000, "1 Mbit/s"},
+      {2000000, "2 Mbit/s"},
+      {4000000, "4 Mbit/s"},
+      {8000000, "8 Mbit/s"},
+      {16000000, "16 Mbit/s"}};
+  return kBitRates;
+}
 } // namespace
 
 VideoControls::VideoControls(MainWindow &window)
@@ -109,6 +133,79 @@ void VideoControls::initialise_ui() {
 
   filters_section->pack_start(*filters_grid, Gtk::PACK_SHRINK);
   add_row(*filters_section);
+
+  auto record_title = Gtk::manage(new Gtk::Label("---- Gravação ----"));
+  record_title->set_halign(Gtk::ALIGN_CENTER);
+  record_title->set_margin_top(8);
+  record_title->get_style_context()->add_class("controls-label");
+  add_row(*record_title);
+
+  ControlsBase::ComboRowConfig codec_config;
+  codec_config.combo_hexpand = true;
+  codec_config.on_configure = [this](Gtk::ComboBoxText &combo) {
+    codec_combo_ = &combo;
+    combo.signal_changed().connect(
+        sigc::mem_fun(*this, &VideoControls::on_record_settings_changed));
+  };
+  add_row(*create_combo_row("Codec de vídeo:", {}, codec_config));
+
+  ControlsBase::ComboRowConfig muxer_config;
+  muxer_config.combo_hexpand = true;
+  muxer_config.on_configure = [this](Gtk::ComboBoxText &combo) {
+    muxer_combo_ = &combo;
+    combo.signal_changed().connect(
+        sigc::mem_fun(*this, &VideoControls::on_record_settings_changed));
+  };
+  add_row(*create_combo_row("Contêiner:", {}, muxer_config));
+
+  ControlsBase::ComboRowConfig bit_rate_config;
+  bit_rate_config.combo_hexpand = true;
+  bit_rate_config.on_configure = [this](Gtk::ComboBoxText &combo) {
+    bit_rate_combo_ = &combo;
+    combo.signal_changed().connect(
+        sigc::mem_fun(*this, &VideoControls::on_record_settings_changed));
+  };
+  add_row(*create_combo_row("Taxa de bits:", {}, bit_rate_config));
+
+  populate_record_settings();
+}
+
+void VideoControls::populate_record_settings() {
+  if (!codec_combo_ || !muxer_combo_ || !bit_rate_combo_)
+    return;
+
+  const auto settings = main_window_.record_settings();
+  with_update_guard([&]() {
+    codec_combo_->remove_all();
+    const int num_codecs = encoder_get_valid_video_codecs();
+    for (int i = 0; i < num_codecs; ++i) {
+      const char *description = encoder_get_video_codec_description(i);
+      if (i == 0)
+        codec_combo_->append("Sem compressão (direto da câmara)");
+      else
+        codec_combo_->append(description ? description : "?");
+    }
+    if (settings.codec_ind >= 0 && settings.codec_ind < num_codecs)
+      codec_combo_->set_active(settings.codec_ind);
+    else
+      codec_combo_->set_active(0);
+
+    muxer_combo_->remove_all();
+    const auto &muxers = record_muxers();
+    for (size_t i = 0; i < muxers.size(); ++i) {
+      muxer_combo_->append(muxers[i].second);
+      if (muxers[i].first == settings.muxer)
+        muxer_combo_->set_active(static_cast<int>(i));
+    }
+
+    bit_rate_combo_->remove_all();
+    const auto &bit_rates = record_bit_rates();
+    for (size_t i = 0; i < bit_rates.size(); ++i) {
+      bit_rate_combo_->append(bit_rates[i].second);
+      if (bit_rates[i].first == settings.bit_rate)
+        bit_rate_combo_->set_active(static_cast<int>(i));
+    }
+  });
 }
 
 void VideoControls::bind_filter_buttons(
@@ -159,7 +256,8 @@ void VideoControls::populate_devices() {
     device_combo_->remove_all();
     devices_.clear();
 
-    int current_index = device_ ? v4l2core_get_this_device_index(device_) : -1;
+    const char *current_path = device_ ? v4l2core_get_videodevice(device_)
+                                       : nullptr;
     const int num_devices = v4l2core_get_num_devices();
 
     if (num_devices <= 0) {
@@ -186,12 +284,20 @@ void VideoControls::populate_devices() {
       device_combo_->append(label);
     }
 
-    if (current_index < 0 || current_index >= static_cast<int>(devices_.size()))
-      current_index = 0;
+    // match by path: the list indexes change when devices come and go
+    int current_index = 0;
+    for (size_t i = 0; current_path && i < devices_.size(); ++i) {
+      if (devices_[i].device_path == current_path) {
+        current_index = static_cast<int>(i);
+        break;
+      }
+    }
     device_combo_->set_active(current_index);
   });
 }
 
+void VideoControls::refresh_devices() { refresh_state(); }
+
 void VideoControls::populate_formats() {
   if (!format_combo_ || !device_)
     return;
@@ -473,6 +579,26 @@ void VideoControls::on_frame_rate_changed() {
   }
 }
 
+void VideoControls::on_record_settings_changed() {
+  if (updating_ui_ || !codec_combo_ || !muxer_combo_ || !bit_rate_combo_)
+    return;
+
+  const int muxer_index = muxer_combo_->get_active_row_number();
+  const int bit_rate_index = bit_rate_combo_->get_active_row_number();
+  const auto &muxers = record_muxers();
+  const auto &bit_rates = record_bit_rates();
+
+  MainWindow::RecordSettings settings;
+  settings.codec_ind = std::max(codec_combo_->get_active_row_number(), 0);
+  if (muxer_index >= 0 && muxer_index < static_cast<int>(muxers.size()))
+    settings.muxer = muxers[muxer_index].first;
+  if (bit_rate_index >= 0 &&
+      bit_rate_index < static_cast<int>(bit_rates.size()))
+    settings.bit_rate = bit_rates[bit_rate_index].first;
+
+  main_window_.set_record_settings(settings);
+}
+
 void VideoControls::on_filter_toggled(Gtk::CheckButton *button,
                                       uint32_t mask) {
   if (!button || updating_ui_)
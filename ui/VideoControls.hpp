@@ -19,6 +19,9 @@ public:
   explicit VideoControls(MainWindow &window);
   ~VideoControls() override = default;
 
+  // reload the device list (after a hotplug event)
+  void refresh_devices();
+
 private:
   struct DeviceEntry {
     std::string label;
@@ -56,6 +59,9 @@ private:
   Gtk::ComboBoxText *format_combo_ = nullptr;
   Gtk::ComboBoxText *resolution_combo_ = nullptr;
   Gtk::ComboBoxText *frame_rate_combo_ = nullptr;
+  Gtk::ComboBoxText *codec_combo_ = nullptr;
+  Gtk::ComboBoxText *muxer_combo_ = nullptr;
+  Gtk::ComboBoxText *bit_rate_combo_ = nullptr;
 
   std::vector<DeviceEntry> devices_;
   std::vector<FormatEntry> formats_;
@@ -70,12 +76,14 @@ private:
   void populate_formats();
   void populate_resolutions();
   void populate_frame_rates();
+  void populate_record_settings();
   void refresh_state();
 
   void on_device_changed();
   void on_format_changed();
   void on_resolution_changed();
   void on_frame_rate_changed();
+  void on_record_settings_changed();
   void on_filter_toggled(Gtk::CheckButton *button, uint32_t mask);
   void on_reset_clicked();
 